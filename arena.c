@@ -0,0 +1,81 @@
+/*
+    C-- Compiler Front End
+    Copyright (C) 2019 NSKernel. All rights reserved.
+
+    A lab of Compilers at Nanjing University
+
+    arena.c
+    Region allocators
+*/
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <arena.h>
+
+void *_arena_new_chunk(arena *a, size_t size) {
+    arena_chunk *chunk;
+    if (size < ARENA_CHUNK_SIZE)
+        size = ARENA_CHUNK_SIZE;
+    chunk = malloc(sizeof(arena_chunk) + size);
+    chunk->size = size;
+    chunk->used = 0;
+    chunk->next = a->head;
+    a->head = chunk;
+    return chunk;
+}
+
+void *arena_alloc(arena *a, size_t size) {
+    arena_chunk *chunk = a->head;
+    void *ret;
+
+    size = (size + ARENA_ALIGNMENT - 1) & ~(size_t)(ARENA_ALIGNMENT - 1);
+    if (chunk == NULL || chunk->size - chunk->used < size)
+        chunk = _arena_new_chunk(a, size);
+    ret = chunk->data + chunk->used;
+    chunk->used += size;
+    a->allocated += size;
+    a->count++;
+    a->total += size;
+    if (a->allocated > a->peak)
+        a->peak = a->allocated;
+    return ret;
+}
+
+char *arena_strdup(arena *a, const char *str) {
+    size_t length = strlen(str) + 1;
+    char *ret = arena_alloc(a, length);
+    memcpy(ret, str, length);
+    return ret;
+}
+
+void arena_release(arena *a) {
+    arena_chunk *chunk = a->head;
+    arena_chunk *next;
+
+    if (chunk == NULL)
+        return;
+    // keep the oldest chunk around for the next round,
+    // the rest goes back to the system
+    while (chunk->next != NULL) {
+        next = chunk->next;
+        free(chunk);
+        chunk = next;
+    }
+    chunk->used = 0;
+    a->head = chunk;
+    a->allocated = 0;
+}
+
+void arena_destroy(arena *a) {
+    arena_chunk *chunk = a->head;
+    arena_chunk *next;
+
+    while (chunk != NULL) {
+        next = chunk->next;
+        free(chunk);
+        chunk = next;
+    }
+    a->head = NULL;
+    a->allocated = 0;
+}
@@ -0,0 +1,47 @@
+/*
+    C-- Compiler Front End
+    Copyright (C) 2019 NSKernel. All rights reserved.
+
+    A lab of Compilers at Nanjing University
+
+    arena.h
+    Region allocators
+*/
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifndef ARENA_H
+#define ARENA_H
+
+#define ARENA_CHUNK_SIZE  0x10000
+#define ARENA_ALIGNMENT   8
+
+typedef struct arena_chunk_t arena_chunk;
+typedef struct arena_t arena;
+
+struct arena_chunk_t {
+    arena_chunk *next;
+    size_t size;
+    size_t used;
+    char data[];
+};
+
+// objects are never freed one by one, the whole
+// region goes away at once in arena_release
+struct arena_t {
+    arena_chunk *head;      // chunk currently allocated from
+    size_t allocated;       // bytes handed out since the last release
+    size_t peak;            // largest allocated ever seen
+    size_t count;           // allocations ever made, for -fmem-report
+    size_t total;           // bytes ever handed out
+};
+
+// the arenas of a compilation live in its cmmc_context
+
+void *arena_alloc(arena *a, size_t size);
+char *arena_strdup(arena *a, const char *str);
+void arena_release(arena *a);
+void arena_destroy(arena *a);
+
+#endif
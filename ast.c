@@ -1,38 +1,83 @@
-/*
-    C-- Compiler Front End
-    Copyright (C) 2019 NSKernel. All rights reserved.
-
-    A lab of Compilers at Nanjing University
-
-    ast.c
-    Defines ast operations
-*/
-
-#include <stdint.h>
-
-#include <ast.h>
-
-ast_node *ast_make_new_node(char *name, uint32_t line_number, char is_terminal, const void *value, char terminal_type, uint32_t children_count) {
-	  ast_node *return_node;
-	  return_node = (ast_node*)malloc(sizeof(ast_node));
-	  return_node->children_count = children_count;
-	  return_node->name = name;
-	  return_node->line_number = line_number;
-	  return_node->terminal_type = terminal_type;
-	  if (terminal_type == T_ID_TYPE || terminal_type == T_OTHER) {
-		    return_node->string_value = (char*)malloc(strlen(value) + 1);
-				strncpy(return_node->string_value, value, strlen(value));
-				return_node->string_value[strlen(value)] = 0;
-	  }
-	  if (terminal_type == T_INT) {
-			  if (value != NULL)
-	  	  		return_node->int_value = *(int*)value;
-	  }
-  	else if (terminal_type == T_FLOAT) {
-			  if (value != NULL)
-		    		return_node->float_value = *(float*)value;
-	  }
-	  return_node->is_terminal = is_terminal;
-
-	  return return_node;
-}
+/*
+    C-- Compiler Front End
+    Copyright (C) 2019 NSKernel. All rights reserved.
+
+    A lab of Compilers at Nanjing University
+
+    ast.c
+    Defines ast operations
+*/
+
+#include <stdint.h>
+
+#include <ast.h>
+#include <arena.h>
+#include <context.h>
+
+const char *ast_kind_names[AST_KIND_COUNT] = {
+    [AST_PROGRAM]           = "Program",
+    [AST_EXT_DEF_LIST]      = "ExtDefList",
+    [AST_EXT_DEF]           = "ExtDef",
+    [AST_EXT_DEC_LIST]      = "ExtDecList",
+    [AST_SPECIFIER]         = "Specifier",
+    [AST_STRUCT_SPECIFIER]  = "StructSpecifier",
+    [AST_OPT_TAG]           = "OptTag",
+    [AST_TAG]               = "Tag",
+    [AST_VAR_DEC]           = "VarDec",
+    [AST_FUN_DEC]           = "FunDec",
+    [AST_VAR_LIST]          = "VarList",
+    [AST_PARAM_DEC]         = "ParamDec",
+    [AST_COMP_ST]           = "CompSt",
+    [AST_STMT_LIST]         = "StmtList",
+    [AST_STMT]              = "Stmt",
+    [AST_DEF_LIST]          = "DefList",
+    [AST_DEF]               = "Def",
+    [AST_DEC_LIST]          = "DecList",
+    [AST_DEC]               = "Dec",
+    [AST_EXP]               = "Exp",
+    [AST_ARGS]              = "Args",
+    [AST_INT]               = "INT",
+    [AST_FLOAT]             = "FLOAT",
+    [AST_ID]                = "ID",
+    [AST_TYPE]              = "TYPE",
+    [AST_SEMI]              = "SEMI",
+    [AST_COMMA]             = "COMMA",
+    [AST_ASSIGNOP]          = "ASSIGNOP",
+    [AST_RELOP]             = "RELOP",
+    [AST_PLUS]              = "PLUS",
+    [AST_MINUS]             = "MINUS",
+    [AST_STAR]              = "STAR",
+    [AST_DIV]               = "DIV",
+    [AST_AND]               = "AND",
+    [AST_OR]                = "OR",
+    [AST_DOT]               = "DOT",
+    [AST_NOT]               = "NOT",
+    [AST_LP]                = "LP",
+    [AST_RP]                = "RP",
+    [AST_LB]                = "LB",
+    [AST_RB]                = "RB",
+    [AST_LC]                = "LC",
+    [AST_RC]                = "RC",
+    [AST_STRUCT]            = "STRUCT",
+    [AST_RETURN]            = "RETURN",
+    [AST_IF]                = "IF",
+    [AST_ELSE]              = "ELSE",
+    [AST_WHILE]             = "WHILE"
+};
+
+ast_node *ast_make_new_node(ast_kind kind, uint32_t line_number, const char *value, uint32_t children_count) {
+    ast_node *return_node;
+    // children are allocated along with the node
+    return_node = arena_alloc(&cmmc_ctx->ast_arena, sizeof(ast_node) + children_count * sizeof(ast_node*));
+    return_node->kind = kind;
+    return_node->subkind = 0;
+    return_node->children_count = children_count;
+    return_node->line_number = line_number;
+    return_node->string_value = NULL;
+    if (value != NULL) {
+        // only IDs carry their text
+        return_node->string_value = arena_strdup(&cmmc_ctx->ast_arena, value);
+    }
+
+    return return_node;
+}
@@ -1,49 +1,110 @@
-/*
-    C-- Compiler Front End
-    Copyright (C) 2019 NSKernel. All rights reserved.
-
-    A lab of Compilers at Nanjing University
-
-    ast.h
-    Defines ast variables and structures
-*/
-
-#include <stdlib.h>
-#include <stdint.h>
-#include <string.h>
-
-#ifndef TRUE_FALSE_KEYWORD
-#define TRUE_FALSE_KEYWORD
-#define true 1
-#define false 0
-#endif
-
-#ifndef AST_H
-#define AST_H
-
-#define T_NT		0x0
-#define T_ID_TYPE   0x1
-#define T_INT   	0x2
-#define T_FLOAT 	0x3
-#define T_OTHER 	0x4
-
-typedef struct ast_node_t {
-    char *name;
-
-	char terminal_type;
-	
-	char is_terminal;
-    uint32_t line_number;
-	uint32_t children_count;
-	union {
-		char *string_value;
-		int int_value;
-		float float_value;
-	};
-    struct ast_node_t *children[7];
-    struct ast_node_t *parent;
-} ast_node;
-
-ast_node *ast_make_new_node(char *name, uint32_t line_number, char is_terminal, const void *value, char terminal_type, uint32_t children_count);
-
-#endif
\ No newline at end of file
+/*
+    C-- Compiler Front End
+    Copyright (C) 2019 NSKernel. All rights reserved.
+
+    A lab of Compilers at Nanjing University
+
+    ast.h
+    Defines ast variables and structures
+*/
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#ifndef TRUE_FALSE_KEYWORD
+#define TRUE_FALSE_KEYWORD
+#define true 1
+#define false 0
+#endif
+
+#ifndef AST_H
+#define AST_H
+
+// node kinds, non-terminals first, terminals start at AST_INT
+typedef enum {
+    AST_PROGRAM = 0,
+    AST_EXT_DEF_LIST,
+    AST_EXT_DEF,
+    AST_EXT_DEC_LIST,
+    AST_SPECIFIER,
+    AST_STRUCT_SPECIFIER,
+    AST_OPT_TAG,
+    AST_TAG,
+    AST_VAR_DEC,
+    AST_FUN_DEC,
+    AST_VAR_LIST,
+    AST_PARAM_DEC,
+    AST_COMP_ST,
+    AST_STMT_LIST,
+    AST_STMT,
+    AST_DEF_LIST,
+    AST_DEF,
+    AST_DEC_LIST,
+    AST_DEC,
+    AST_EXP,
+    AST_ARGS,
+
+    AST_INT,
+    AST_FLOAT,
+    AST_ID,
+    AST_TYPE,
+    AST_SEMI,
+    AST_COMMA,
+    AST_ASSIGNOP,
+    AST_RELOP,
+    AST_PLUS,
+    AST_MINUS,
+    AST_STAR,
+    AST_DIV,
+    AST_AND,
+    AST_OR,
+    AST_DOT,
+    AST_NOT,
+    AST_LP,
+    AST_RP,
+    AST_LB,
+    AST_RB,
+    AST_LC,
+    AST_RC,
+    AST_STRUCT,
+    AST_RETURN,
+    AST_IF,
+    AST_ELSE,
+    AST_WHILE,
+
+    AST_KIND_COUNT
+} ast_kind;
+
+#define AST_IS_TERMINAL(kind) ((kind) >= AST_INT)
+
+// subkinds of RELOP
+#define AST_RELOP_GT    0x0
+#define AST_RELOP_GE    0x1
+#define AST_RELOP_EQ    0x2
+#define AST_RELOP_LE    0x3
+#define AST_RELOP_LT    0x4
+#define AST_RELOP_NEQ   0x5
+
+// subkinds of TYPE
+#define AST_TYPE_INT    0x0
+#define AST_TYPE_FLOAT  0x1
+
+typedef struct ast_node_t {
+    uint8_t kind;
+    uint8_t subkind;
+    uint16_t children_count;
+    uint32_t line_number;
+    union {
+        char *string_value; // ID only
+        int int_value;
+        float float_value;
+    };
+    struct ast_node_t *children[]; // sized by children_count
+} ast_node;
+
+extern const char *ast_kind_names[AST_KIND_COUNT];
+
+ast_node *ast_make_new_node(ast_kind kind, uint32_t line_number, const char *value, uint32_t children_count);
+
+#endif
@@ -15,5 +15,64 @@
 #include <ast.h>
 #include <ir.h>
 
+#ifndef BACKEND_H
+#define BACKEND_H
 
-void cg_mips_generate(ir_func_list *func);
\ No newline at end of file
+typedef struct cg_mips_regalloc_t cg_mips_regalloc;
+typedef struct cg_mips_isel_t cg_mips_isel;
+typedef struct cg_mips_frame_t cg_mips_frame;
+
+struct cg_mips_regalloc_t {
+    int min_id;
+    int max_id;
+    uint8_t *reg;           // register number of each id, 0 if it lives on the stack
+    uint32_t saved_mask;    // callee saved registers used, bit n for $sn
+    int saved_count;
+};
+
+// where the ids left on the stack live, see frame_mips.c
+struct cg_mips_frame_t {
+    int min_id;
+    int max_id;
+    int *home;              // of each id, fp - home is its slot
+    int size;               // of the slots below fp
+    int size_before;        // as DEC had it
+};
+
+void cg_mips_generate_header();
+void cg_mips_generate_function(ir_function *func);
+cg_mips_regalloc *cg_mips_regalloc_function(ir_function *func);
+void cg_mips_regalloc_free(cg_mips_regalloc *alloc);
+cg_mips_frame *cg_mips_frame_function(ir_function *func, cg_mips_regalloc *alloc);
+void cg_mips_frame_free(cg_mips_frame *frame);
+
+// instruction selection, see isel_mips.c. the rest work on the
+// instruction being generated and emit what they select
+cg_mips_isel *cg_mips_isel_function(ir_function *func);
+void cg_mips_isel_free(cg_mips_isel *sel);
+// computed as part of the instruction using it
+char cg_mips_isel_folded(cg_mips_isel *sel, uint32_t i);
+// register holding operand k, computed into reg if need be
+int cg_mips_isel_operand(ir_inst *content, int k, int reg);
+// operands 1 and 2, in $t0 and $t1 if need be
+void cg_mips_isel_operands(ir_inst *content, int *reg1, int *reg2);
+// an expression or ASSIGN computed into reg
+void cg_mips_isel_exp(ir_inst *content, int reg);
+// base register of the address a star dest stores to, leaving reg alone
+int cg_mips_isel_address(ir_inst *content, int reg, int *disp);
+
+static inline int cg_mips_regalloc_query(cg_mips_regalloc *alloc, int id)
+{
+    if (alloc == NULL || id < alloc->min_id || id > alloc->max_id || (id & 3))
+        return 0;
+    return alloc->reg[(id - alloc->min_id) >> 2];
+}
+
+static inline int cg_mips_frame_home(cg_mips_frame *frame, int id)
+{
+    if (frame == NULL || id < frame->min_id || id > frame->max_id || (id & 3))
+        return id;
+    return frame->home[(id - frame->min_id) >> 2];
+}
+
+#endif
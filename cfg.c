@@ -0,0 +1,402 @@
+/*
+    C-- Compiler Back End
+    Copyright (C) 2019 NSKernel. All rights reserved.
+
+    A lab of Compilers at Nanjing University
+
+    cfg.c
+    Basic blocks, dominators and loops of a function
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include <cfg.h>
+#include <ir.h>
+#include <arena.h>
+#include <context.h>
+
+int _cfg_is_jump(uint8_t op) {
+    switch (op) {
+        case IR_OP_GOTO:
+        case IR_OP_IF:
+        case IR_OP_IF_POSITIVE:
+        case IR_OP_IF_IMME:
+        case IR_OP_RETURN:
+            return 1;
+    }
+    return 0;
+}
+
+void _cfg_add_succ(cfg_block *block, uint32_t succ) {
+    if (block->succ_count == 0 || block->succ[0] != succ)
+        block->succ[block->succ_count++] = succ;
+}
+
+// cut the function at labels and after jumps
+void _cfg_split(cfg *graph, ir_function *func) {
+    uint32_t i, b;
+    uint32_t count = 1;
+    int label_max;
+    ir_inst *inst;
+    cfg_block *block;
+
+    graph->label_base = 0;
+    label_max = -1;
+    for (i = 0; i < func->count; i++) {
+        inst = &func->insts[i];
+        if (i > 0 && (inst->op == IR_OP_LABEL || _cfg_is_jump(func->insts[i - 1].op)))
+            count++;
+        if (inst->op == IR_OP_LABEL) {
+            if (label_max < 0 || inst->operand[0] < graph->label_base)
+                graph->label_base = inst->operand[0];
+            if (inst->operand[0] > label_max)
+                label_max = inst->operand[0];
+        }
+    }
+    // one more for the exit
+    graph->block_count = count + 1;
+    graph->exit = count;
+    graph->blocks = arena_alloc(&cmmc_ctx->ir_arena, sizeof(cfg_block) * graph->block_count);
+    memset(graph->blocks, 0, sizeof(cfg_block) * graph->block_count);
+    graph->label_count = label_max < 0 ? 0 : label_max - graph->label_base + 1;
+    graph->label_block = arena_alloc(&cmmc_ctx->ir_arena, sizeof(uint32_t) * graph->label_count);
+    for (i = 0; i < graph->label_count; i++)
+        graph->label_block[i] = CFG_NONE;
+
+    b = 0;
+    graph->blocks[0].first = 0;
+    for (i = 0; i < func->count; i++) {
+        inst = &func->insts[i];
+        if (i > 0 && (inst->op == IR_OP_LABEL || _cfg_is_jump(func->insts[i - 1].op))) {
+            graph->blocks[b].last = i;
+            graph->blocks[++b].first = i;
+        }
+        if (inst->op == IR_OP_LABEL)
+            graph->label_block[inst->operand[0] - graph->label_base] = b;
+    }
+    graph->blocks[b].last = func->count;
+    graph->blocks[graph->exit].first = graph->blocks[graph->exit].last = func->count;
+
+    for (b = 0; b < graph->exit; b++) {
+        block = &graph->blocks[b];
+        inst = &func->insts[block->last - 1];
+        switch (inst->op) {
+            case IR_OP_GOTO:
+                _cfg_add_succ(block, cfg_label_block(graph, inst->operand[0]));
+                break;
+            case IR_OP_IF:
+            case IR_OP_IF_POSITIVE:
+            case IR_OP_IF_IMME:
+                _cfg_add_succ(block, cfg_label_block(graph, inst->operand[0]));
+                _cfg_add_succ(block, b + 1);
+                break;
+            case IR_OP_RETURN:
+                _cfg_add_succ(block, graph->exit);
+                break;
+            default:
+                // the block after the last one is the exit
+                _cfg_add_succ(block, b + 1);
+                break;
+        }
+    }
+}
+
+void _cfg_link_preds(cfg *graph) {
+    uint32_t b, k;
+    cfg_block *succ;
+    for (b = 0; b < graph->block_count; b++) {
+        for (k = 0; k < graph->blocks[b].succ_count; k++)
+            graph->blocks[graph->blocks[b].succ[k]].pred_count++;
+    }
+    for (b = 0; b < graph->block_count; b++) {
+        graph->blocks[b].pred = arena_alloc(&cmmc_ctx->ir_arena, sizeof(uint32_t) * graph->blocks[b].pred_count);
+        graph->blocks[b].pred_count = 0;
+    }
+    for (b = 0; b < graph->block_count; b++) {
+        for (k = 0; k < graph->blocks[b].succ_count; k++) {
+            succ = &graph->blocks[graph->blocks[b].succ[k]];
+            succ->pred[succ->pred_count++] = b;
+        }
+    }
+}
+
+// depth first from root along succ, or along pred when reverse is
+// set. order gets the reverse postorder, number[b] the position of b
+// in it or CFG_NONE if b was not reached
+uint32_t _cfg_order(cfg *graph, uint32_t root, int reverse, uint32_t *order, uint32_t *number) {
+    uint32_t *stack = malloc(sizeof(uint32_t) * graph->block_count);
+    uint32_t *edge = malloc(sizeof(uint32_t) * graph->block_count);
+    uint32_t depth = 0;
+    uint32_t post = graph->block_count;
+    uint32_t b, next, degree;
+    cfg_block *block;
+
+    for (b = 0; b < graph->block_count; b++)
+        number[b] = CFG_NONE;
+    // mark on push, the real number is given on the way out
+    number[root] = 0;
+    stack[0] = root;
+    edge[0] = 0;
+    depth = 1;
+    while (depth > 0) {
+        b = stack[depth - 1];
+        block = &graph->blocks[b];
+        degree = reverse ? block->pred_count : block->succ_count;
+        if (edge[depth - 1] < degree) {
+            next = reverse ? block->pred[edge[depth - 1]] : block->succ[edge[depth - 1]];
+            edge[depth - 1]++;
+            if (number[next] == CFG_NONE) {
+                number[next] = 0;
+                stack[depth] = next;
+                edge[depth] = 0;
+                depth++;
+            }
+        }
+        else {
+            order[--post] = b;
+            depth--;
+        }
+    }
+    // slide the order to the front
+    if (post > 0)
+        memmove(order, order + post, sizeof(uint32_t) * (graph->block_count - post));
+    for (b = 0; b < graph->block_count - post; b++)
+        number[order[b]] = b;
+    free(stack);
+    free(edge);
+    return graph->block_count - post;
+}
+
+uint32_t _cfg_intersect(uint32_t *dom, uint32_t *number, uint32_t a, uint32_t b) {
+    while (a != b) {
+        while (number[a] > number[b])
+            a = dom[a];
+        while (number[b] > number[a])
+            b = dom[b];
+    }
+    return a;
+}
+
+// Cooper, Harvey and Kennedy, "A Simple, Fast Dominance Algorithm".
+// the same code does post dominators on the reversed graph
+void _cfg_dominators(cfg *graph, int reverse, uint32_t *order, uint32_t order_count, uint32_t *number, uint32_t *dom) {
+    uint32_t i, k, b, p, new_dom, degree;
+    cfg_block *block;
+    char changed = 1;
+
+    for (b = 0; b < graph->block_count; b++)
+        dom[b] = CFG_NONE;
+    dom[order[0]] = order[0];
+    while (changed) {
+        changed = 0;
+        for (i = 1; i < order_count; i++) {
+            b = order[i];
+            block = &graph->blocks[b];
+            degree = reverse ? block->succ_count : block->pred_count;
+            new_dom = CFG_NONE;
+            for (k = 0; k < degree; k++) {
+                p = reverse ? block->succ[k] : block->pred[k];
+                if (dom[p] == CFG_NONE)
+                    continue;
+                new_dom = new_dom == CFG_NONE ? p : _cfg_intersect(dom, number, p, new_dom);
+            }
+            if (dom[b] != new_dom) {
+                dom[b] = new_dom;
+                changed = 1;
+            }
+        }
+    }
+    dom[order[0]] = CFG_NONE;
+}
+
+void _cfg_number_dom_tree(cfg *graph) {
+    uint32_t *stack = malloc(sizeof(uint32_t) * graph->block_count);
+    uint32_t depth, b, i;
+    uint32_t pre = 0, post = 0;
+    cfg_block *block;
+
+    for (b = 0; b < graph->block_count; b++)
+        graph->blocks[b].dom_child = graph->blocks[b].dom_sibling = CFG_NONE;
+    // walk rpo backwards so that children end up in rpo order
+    for (i = graph->rpo_count; i-- > 1;) {
+        block = &graph->blocks[graph->rpo[i]];
+        block->dom_sibling = graph->blocks[block->idom].dom_child;
+        graph->blocks[block->idom].dom_child = graph->rpo[i];
+    }
+    // a node is on the stack while its children are visited, dom_post
+    // doubles as the cursor into them
+    stack[0] = 0;
+    depth = 1;
+    graph->blocks[0].dom_pre = pre++;
+    graph->blocks[0].dom_post = graph->blocks[0].dom_child;
+    while (depth > 0) {
+        block = &graph->blocks[stack[depth - 1]];
+        if (block->dom_post != CFG_NONE) {
+            b = block->dom_post;
+            block->dom_post = graph->blocks[b].dom_sibling;
+            graph->blocks[b].dom_pre = pre++;
+            graph->blocks[b].dom_post = graph->blocks[b].dom_child;
+            stack[depth++] = b;
+        }
+        else {
+            block->dom_post = post++;
+            depth--;
+        }
+    }
+    free(stack);
+}
+
+int _cfg_loop_compare(const void *a, const void *b) {
+    const cfg_loop *loop_a = a;
+    const cfg_loop *loop_b = b;
+    if (loop_a->block_count != loop_b->block_count)
+        return loop_a->block_count > loop_b->block_count ? -1 : 1;
+    return loop_a->header < loop_b->header ? -1 : loop_a->header > loop_b->header;
+}
+
+// natural loops, the body of a back edge p -> h is h and whatever
+// reaches p without passing through h
+void _cfg_find_loops(cfg *graph) {
+    uint32_t *mark = malloc(sizeof(uint32_t) * graph->block_count);
+    uint32_t *body = malloc(sizeof(uint32_t) * graph->block_count);
+    uint32_t i, k, j, h, p, q, b, count, head;
+    uint32_t capacity = 0;
+    cfg_block *header, *block;
+    cfg_loop *loop;
+
+    for (b = 0; b < graph->block_count; b++) {
+        mark[b] = CFG_NONE;
+        graph->blocks[b].loop = CFG_NONE;
+        graph->blocks[b].loop_depth = 0;
+    }
+    graph->loops = NULL;
+    graph->loop_count = 0;
+    for (i = 0; i < graph->rpo_count; i++) {
+        h = graph->rpo[i];
+        header = &graph->blocks[h];
+        count = 0;
+        for (k = 0; k < header->pred_count; k++) {
+            p = header->pred[k];
+            if (!cfg_dominates(graph, h, p))
+                continue;
+            if (count == 0) {
+                mark[h] = h;
+                body[count++] = h;
+            }
+            // body doubles as the worklist, head chases count
+            if (mark[p] != h) {
+                mark[p] = h;
+                body[count++] = p;
+            }
+            for (head = 1; head < count; head++) {
+                block = &graph->blocks[body[head]];
+                for (j = 0; j < block->pred_count; j++) {
+                    q = block->pred[j];
+                    if (mark[q] == h || graph->blocks[q].rpo == CFG_NONE)
+                        continue;
+                    mark[q] = h;
+                    body[count++] = q;
+                }
+            }
+        }
+        if (count == 0)
+            continue;
+        if (graph->loop_count == capacity) {
+            capacity = capacity ? capacity * 2 : 4;
+            graph->loops = realloc(graph->loops, sizeof(cfg_loop) * capacity);
+        }
+        loop = &graph->loops[graph->loop_count++];
+        loop->header = h;
+        loop->block_count = count;
+        loop->blocks = arena_alloc(&cmmc_ctx->ir_arena, sizeof(uint32_t) * count);
+        memcpy(loop->blocks, body, sizeof(uint32_t) * count);
+    }
+    free(mark);
+    free(body);
+    if (graph->loop_count == 0)
+        return;
+
+    // bigger loops first, so that every block ends up pointing at the
+    // innermost loop around it and a header at its parent just before
+    qsort(graph->loops, graph->loop_count, sizeof(cfg_loop), _cfg_loop_compare);
+    loop = graph->loops;
+    graph->loops = arena_alloc(&cmmc_ctx->ir_arena, sizeof(cfg_loop) * graph->loop_count);
+    memcpy(graph->loops, loop, sizeof(cfg_loop) * graph->loop_count);
+    free(loop);
+    for (i = 0; i < graph->loop_count; i++) {
+        loop = &graph->loops[i];
+        loop->parent = graph->blocks[loop->header].loop;
+        loop->depth = loop->parent == CFG_NONE ? 1 : graph->loops[loop->parent].depth + 1;
+        for (k = 0; k < loop->block_count; k++) {
+            graph->blocks[loop->blocks[k]].loop = i;
+            graph->blocks[loop->blocks[k]].loop_depth = loop->depth;
+        }
+    }
+}
+
+cfg *_cfg_build(ir_function *func) {
+    cfg *graph = arena_alloc(&cmmc_ctx->ir_arena, sizeof(cfg));
+    uint32_t *order, *number, *dom;
+    uint32_t order_count, b;
+
+    _cfg_split(graph, func);
+    _cfg_link_preds(graph);
+
+    dom = malloc(sizeof(uint32_t) * graph->block_count);
+    graph->rpo = arena_alloc(&cmmc_ctx->ir_arena, sizeof(uint32_t) * graph->block_count);
+    number = malloc(sizeof(uint32_t) * graph->block_count);
+    graph->rpo_count = _cfg_order(graph, 0, 0, graph->rpo, number);
+    _cfg_dominators(graph, 0, graph->rpo, graph->rpo_count, number, dom);
+    for (b = 0; b < graph->block_count; b++) {
+        graph->blocks[b].rpo = number[b];
+        graph->blocks[b].idom = dom[b];
+    }
+
+    order = malloc(sizeof(uint32_t) * graph->block_count);
+    order_count = _cfg_order(graph, graph->exit, 1, order, number);
+    _cfg_dominators(graph, 1, order, order_count, number, dom);
+    for (b = 0; b < graph->block_count; b++)
+        graph->blocks[b].ipdom = dom[b];
+    free(order);
+    free(number);
+    free(dom);
+
+    _cfg_number_dom_tree(graph);
+    _cfg_find_loops(graph);
+    return graph;
+}
+
+cfg *cfg_get(ir_function *func) {
+    if (func->cfg == NULL)
+        func->cfg = _cfg_build(func);
+    return func->cfg;
+}
+
+// the old graph stays in the arena until the function is done
+void cfg_invalidate(ir_function *func) {
+    func->cfg = NULL;
+}
+
+// a dominates b, every block dominates itself
+int cfg_dominates(cfg *graph, uint32_t a, uint32_t b) {
+    if (graph->blocks[a].rpo == CFG_NONE || graph->blocks[b].rpo == CFG_NONE)
+        return 0;
+    return graph->blocks[a].dom_pre <= graph->blocks[b].dom_pre
+        && graph->blocks[b].dom_post <= graph->blocks[a].dom_post;
+}
+
+int cfg_post_dominates(cfg *graph, uint32_t a, uint32_t b) {
+    for (; b != CFG_NONE; b = graph->blocks[b].ipdom) {
+        if (b == a)
+            return 1;
+    }
+    return 0;
+}
+
+uint32_t cfg_label_block(cfg *graph, int label) {
+    if (label < graph->label_base || (uint32_t)(label - graph->label_base) >= graph->label_count)
+        return CFG_NONE;
+    return graph->label_block[label - graph->label_base];
+}
@@ -0,0 +1,76 @@
+/*
+    C-- Compiler Back End
+    Copyright (C) 2019 NSKernel. All rights reserved.
+
+    A lab of Compilers at Nanjing University
+
+    cfg.h
+    Basic blocks, dominators and loops of a function
+*/
+
+#include <stdint.h>
+
+#include <ir.h>
+
+#ifndef CFG_H
+#define CFG_H
+
+#define CFG_NONE 0xFFFFFFFF
+
+typedef struct cfg_block_t cfg_block;
+typedef struct cfg_loop_t cfg_loop;
+typedef struct cfg_t cfg;
+
+// a block covers insts[first, last), only its last instruction may
+// jump. for an IF the taken edge comes first in succ
+struct cfg_block_t {
+    uint32_t first;
+    uint32_t last;
+    uint32_t succ[2];
+    uint32_t succ_count;
+    uint32_t *pred;
+    uint32_t pred_count;
+    uint32_t rpo;           // index into cfg.rpo, CFG_NONE if unreachable
+    uint32_t idom;          // CFG_NONE for the entry and unreachable blocks
+    uint32_t ipdom;         // CFG_NONE for the exit and blocks that never get there
+    uint32_t dom_child;     // dominator tree, first child
+    uint32_t dom_sibling;   // and next sibling
+    uint32_t dom_pre;       // preorder and postorder numbers in the
+    uint32_t dom_post;      // dominator tree, see cfg_dominates
+    uint32_t loop;          // innermost loop, CFG_NONE outside of loops
+    uint32_t loop_depth;
+};
+
+// natural loop, all back edges to one header share it
+struct cfg_loop_t {
+    uint32_t header;
+    uint32_t parent;        // enclosing loop, CFG_NONE if outermost
+    uint32_t depth;         // 1 for outermost
+    uint32_t *blocks;       // header first
+    uint32_t block_count;
+};
+
+// block 0 is the entry, the last block is an empty exit every
+// RETURN and the fall off the end go to. loops come outermost first
+struct cfg_t {
+    cfg_block *blocks;
+    uint32_t block_count;
+    uint32_t exit;
+    uint32_t *rpo;
+    uint32_t rpo_count;
+    uint32_t *label_block;  // block starting with label label_base + i
+    int label_base;
+    uint32_t label_count;
+    cfg_loop *loops;
+    uint32_t loop_count;
+};
+
+// built on first use and kept in func->cfg until a pass changes the
+// instructions, everything lives in the ir arena
+cfg *cfg_get(ir_function *func);
+void cfg_invalidate(ir_function *func);
+int cfg_dominates(cfg *graph, uint32_t a, uint32_t b);
+int cfg_post_dominates(cfg *graph, uint32_t a, uint32_t b);
+uint32_t cfg_label_block(cfg *graph, int label);
+
+#endif
@@ -0,0 +1,174 @@
+/*
+    C-- Compiler Back End
+    Copyright (C) 2019 NSKernel. All rights reserved.
+
+    A lab of Compilers at Nanjing University
+
+    coalesce.c
+    Coalescing of variables joined by copies
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include <ir.h>
+#include <cfg.h>
+#include <live.h>
+#include <opt.h>
+
+// x := y where x and y are never live at once with different values
+// can use one slot for both, and the copy goes away. the semantic pass
+// leaves plenty of these between temps and the variables they feed.
+// interference is a bit matrix, classes of merged variables keep the
+// union of the rows of their members
+
+#define _COALESCE_MAX_VARS 8192
+
+typedef struct _coalesce_state_t {
+    live_info *live;
+    uint32_t *row;          // [n * words] variables n interferes with
+    uint32_t *rep;          // union find
+    uint32_t *next;         // members of a class, from its rep
+    uint32_t *tail;
+    char *fixed;            // params keep their slots, one per class
+} _coalesce_state;
+
+uint32_t _coalesce_find(_coalesce_state *state, uint32_t n) {
+    while (state->rep[n] != n) {
+        state->rep[n] = state->rep[state->rep[n]];
+        n = state->rep[n];
+    }
+    return n;
+}
+
+void _coalesce_interfere(_coalesce_state *state, uint32_t a, uint32_t b) {
+    LIVE_SET(&state->row[a * state->live->words], b);
+    LIVE_SET(&state->row[b * state->live->words], a);
+}
+
+// a definition interferes with everything live after it, but the
+// source of a copy holds the same value
+void _coalesce_build(_coalesce_state *state) {
+    live_info *live = state->live;
+    ir_function *func = live->func;
+    cfg *graph = live->graph;
+    ir_inst *inst;
+    uint32_t *set = malloc(sizeof(uint32_t) * (live->words + 1));
+    uint32_t b, i, w, d, s, x;
+
+    for (b = 0; b < graph->block_count; b++) {
+        memcpy(set, &live->live_out[b * live->words], sizeof(uint32_t) * live->words);
+        for (i = graph->blocks[b].last; i > graph->blocks[b].first; i--) {
+            inst = &func->insts[i - 1];
+            if (ir_inst_writes(inst) && IR_INST_OP(inst, 0) == IR_MODE_NORMAL
+                && (d = live_var(live, inst, 0)) != LIVE_NONE) {
+                s = LIVE_NONE;
+                if (inst->op == IR_EXP_OP_ASSIGN && IR_INST_OP(inst, 1) == IR_MODE_NORMAL)
+                    s = live_var(live, inst, 1);
+                if (inst->op == IR_OP_PARAM)
+                    state->fixed[d] = 1;
+                for (w = 0; w < live->words; w++) {
+                    for (x = w << 5; set[w] && x < (w + 1) << 5; x++) {
+                        if (LIVE_TEST(set, x) && x != d && x != s)
+                            _coalesce_interfere(state, d, x);
+                    }
+                }
+            }
+            live_step(live, inst, set);
+        }
+    }
+    free(set);
+}
+
+// 1 if the classes of a and b were merged
+int _coalesce_union(_coalesce_state *state, uint32_t a, uint32_t b) {
+    uint32_t words = state->live->words;
+    uint32_t ra = _coalesce_find(state, a), rb = _coalesce_find(state, b), m, w, swap;
+    if (ra == rb)
+        return 1;
+    if (state->fixed[ra] && state->fixed[rb])
+        return 0;
+    for (m = rb; m != LIVE_NONE; m = state->next[m]) {
+        if (LIVE_TEST(&state->row[ra * words], m))
+            return 0;
+    }
+    // a param keeps its slot, otherwise a variable wins over a temp,
+    // its name is the one worth keeping
+    if (state->fixed[rb] || (!state->fixed[ra] && state->live->var_mode[ra] != IR_MODE_V && state->live->var_mode[rb] == IR_MODE_V)) {
+        swap = ra;
+        ra = rb;
+        rb = swap;
+    }
+    for (w = 0; w < words; w++)
+        state->row[ra * words + w] |= state->row[rb * words + w];
+    state->rep[rb] = ra;
+    state->next[state->tail[ra]] = rb;
+    state->tail[ra] = state->tail[rb];
+    return 1;
+}
+
+void coalesce_run(ir_function *func) {
+    _coalesce_state state;
+    live_info *live = live_compute(func);
+    ir_inst *inst;
+    uint32_t n, i, from, to, d, s, r;
+    int k, mask;
+    char changed = 0;
+
+    if (live->var_count == 0 || live->var_count > _COALESCE_MAX_VARS) {
+        live_destroy(live);
+        return;
+    }
+    state.live = live;
+    state.row = calloc((size_t)live->var_count * live->words, sizeof(uint32_t));
+    state.rep = malloc(sizeof(uint32_t) * live->var_count);
+    state.next = malloc(sizeof(uint32_t) * live->var_count);
+    state.tail = malloc(sizeof(uint32_t) * live->var_count);
+    state.fixed = calloc(live->var_count, 1);
+    for (n = 0; n < live->var_count; n++) {
+        state.rep[n] = state.tail[n] = n;
+        state.next[n] = LIVE_NONE;
+    }
+    _coalesce_build(&state);
+
+    for (i = 0; i < func->count; i++) {
+        inst = &func->insts[i];
+        if (inst->op != IR_EXP_OP_ASSIGN || IR_INST_OP(inst, 0) != IR_MODE_NORMAL || IR_INST_OP(inst, 1) != IR_MODE_NORMAL)
+            continue;
+        d = live_var(live, inst, 0);
+        s = live_var(live, inst, 1);
+        if (d != LIVE_NONE && s != LIVE_NONE && _coalesce_union(&state, d, s))
+            changed = 1;
+    }
+
+    if (changed) {
+        // every member takes the slot of its rep, copies inside a class
+        // are gone
+        for (from = 0, to = 0; from < func->count; from++) {
+            inst = &func->insts[from];
+            mask = ir_inst_reads(inst) | ir_inst_writes(inst);
+            for (k = 0; k < 3; k++) {
+                if (!(mask & (1 << k)) || (n = live_var(live, inst, k)) == LIVE_NONE)
+                    continue;
+                r = _coalesce_find(&state, n);
+                inst->mode[k] = live->var_mode[r] | IR_INST_OP(inst, k);
+                inst->operand[k] = live->var_id[r];
+            }
+            if (inst->op == IR_EXP_OP_ASSIGN && inst->mode[0] == inst->mode[1] && inst->operand[0] == inst->operand[1]
+                && IR_INST_OP(inst, 0) == IR_MODE_NORMAL)
+                continue;
+            if (to != from)
+                func->insts[to] = *inst;
+            to++;
+        }
+        func->count = to;
+        cfg_invalidate(func);
+    }
+    free(state.row);
+    free(state.rep);
+    free(state.next);
+    free(state.tail);
+    free(state.fixed);
+    live_destroy(live);
+}
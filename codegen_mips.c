@@ -14,148 +14,83 @@
 #include <global.h>
 #include <ast.h>
 #include <ir.h>
+#include <backend.h>
+#include <emit.h>
+#include <mips.h>
+#include <context.h>
 
-void _cg_mips_generate_header() {
+void cg_mips_generate_header() {
     // print the following code
-    fprintf(output_file, ".data\n");
-    fprintf(output_file, "_prompt: .asciiz \"Enter an integer:\"\n");
-    fprintf(output_file, "_ret: .asciiz \"\\n\"\n");
-    fprintf(output_file, ".globl main\n");
-    fprintf(output_file, ".text\n");
-    fprintf(output_file, "read:\n");
-    fprintf(output_file, "  li $v0, 4\n");
-    fprintf(output_file, "  la $a0, _prompt\n");
-    fprintf(output_file, "  syscall\n");
-    fprintf(output_file, "  li $v0, 5\n");
-    fprintf(output_file, "  syscall\n");
-    fprintf(output_file, "  jr $ra\n\n");
-    fprintf(output_file, "write:\n");
-    fprintf(output_file, "  li $v0, 1\n");
-    fprintf(output_file, "  syscall\n");
-    fprintf(output_file, "  li $v0, 4\n");
-    fprintf(output_file, "  la $a0, _ret\n");
-    fprintf(output_file, "  syscall\n");
-    fprintf(output_file, "  move $v0, $0\n");
-    fprintf(output_file, "  jr $ra\n\n");
+    emit_str(".data\n");
+    emit_str("_prompt: .asciiz \"Enter an integer:\"\n");
+    emit_str("_ret: .asciiz \"\\n\"\n");
+    emit_str(".globl main\n");
+    emit_str(".text\n");
+    emit_str("read:\n");
+    emit_str("  li $v0, 4\n");
+    emit_str("  la $a0, _prompt\n");
+    emit_str("  syscall\n");
+    emit_str("  li $v0, 5\n");
+    emit_str("  syscall\n");
+    emit_str("  jr $ra\n\n");
+    emit_str("write:\n");
+    emit_str("  li $v0, 1\n");
+    emit_str("  syscall\n");
+    emit_str("  li $v0, 4\n");
+    emit_str("  la $a0, _ret\n");
+    emit_str("  syscall\n");
+    emit_str("  move $v0, $0\n");
+    emit_str("  jr $ra\n\n");
 }
 
-void _cg_mips_set_reg(uint8_t mode, uint8_t op, int num, char *reg_mode, uint8_t reg_num) {
-    switch (op)
-    {
-        case IR_MODE_NORMAL:
-            switch (mode) {
-                case IR_MODE_T:
-                case IR_MODE_V:
-                    // frame pointer - num is the offset
-                    fprintf(output_file, "  lw $%s%d, %d($fp)\n", reg_mode, reg_num, -num);
-                    break;
-                case IR_MODE_I:
-                    fprintf(output_file, "  li $%s%d, %d\n", reg_mode, reg_num, num);
-                    break;
-                default:
-                    printf("Unexpected\n");
-                    break;
-            
-            }
-            break;
-        case IR_MODE_ADDR:
-            // all addresses are static!
-            switch (mode) {
-                case IR_MODE_T:
-                case IR_MODE_V:
-                    // frame pointer - num is the offset
-                    fprintf(output_file, "  addi $%s%d, $fp, %d\n", reg_mode, reg_num, -num);
-                    break;
-                case IR_MODE_I:
-                default:
-                    printf("Unexpected\n");
-                    break;
-            }
-            break;
-        case IR_MODE_STAR:
-            // all addresses are static!
-            switch (mode) {
-                case IR_MODE_T:
-                case IR_MODE_V:
-                    // frame pointer - num is the offset
-                    fprintf(output_file, "  lw $%s%d, %d($fp)\n", reg_mode, reg_num, -num);
-                    fprintf(output_file, "  lw $%s%d, 0($%s%d)\n", reg_mode, reg_num, reg_mode, reg_num);
-                    break;
-                case IR_MODE_I:
-                    fprintf(output_file, "  li $%s%d, %d\n", reg_mode, reg_num, num);
-                    fprintf(output_file, "  lw $%s%d, 0($%s%d)\n", reg_mode, reg_num, reg_mode, reg_num);
-                    break;
-                default:
-                    printf("Unexpected\n");
-                    break;
-            }
-            break;
-        default:
-            break;
-    }
+// 0 when the operand lives on the stack
+int _cg_mips_allocated_reg(uint8_t mode, int num) {
+    if (mode != IR_MODE_T && mode != IR_MODE_V)
+        return 0;
+    return cg_mips_regalloc_query(cmmc_ctx->cg_mips_alloc, num);
 }
 
-void _cg_mips_generate_exp_3(ir *content) {
-    // load oprand 1 to t0
-    switch (content->mode.mode2) {
-        case IR_MODE_T:
-            _cg_mips_set_reg(content->mode.mode2, content->mode.op2, content->temp_id1, "t", 0);
-            break;
-        case IR_MODE_V:
-            _cg_mips_set_reg(content->mode.mode2, content->mode.op2, content->var_id1, "t", 0);
-            break;
-        case IR_MODE_I:
-            _cg_mips_set_reg(content->mode.mode2, content->mode.op2, content->int_val1, "t", 0);
-            break;
-    }
-    // load oprand 2 to t1
-    switch (content->mode.mode3) {
-        case IR_MODE_T:
-            _cg_mips_set_reg(content->mode.mode3, content->mode.op3, content->temp_id2, "t", 1);
-            break;
-        case IR_MODE_V:
-            _cg_mips_set_reg(content->mode.mode3, content->mode.op3, content->var_id2, "t", 1);
-            break;
-        case IR_MODE_I:
-            _cg_mips_set_reg(content->mode.mode3, content->mode.op3, content->int_val2, "t", 1);
-            break;
-    }
-    // do action
-    switch (content->op) {
-        case IR_EXP_OP_ADD:
-            fprintf(output_file, "  add $v0, $t0, $t1\n");
-            break;
-        case IR_EXP_OP_MINUS:
-            fprintf(output_file, "  sub $v0, $t0, $t1\n");
-            break;
-        case IR_EXP_OP_MUL:
-            fprintf(output_file, "  mul $v0, $t0, $t1\n");
-            break;
-        case IR_EXP_OP_DIV:
-            fprintf(output_file, "  div $t0, $t1\n");
-            fprintf(output_file, "  mflo $v0\n");
-            break;
+// get the register holding an operand, computing it into scratch when
+// it is not already sitting in one
+int _cg_mips_operand_reg(ir_inst *content, int k, int scratch) {
+    return cg_mips_isel_operand(content, k, scratch);
+}
+
+void _cg_mips_load_operand(ir_inst *content, int k, int reg) {
+    int allocated = cg_mips_isel_operand(content, k, reg);
+    if (allocated != reg)
+        mips_rr(MIPS_MOVE, reg, allocated);
+}
+
+// the register the result should be computed into
+int _cg_mips_dest_reg(ir_inst *content) {
+    int allocated;
+    if (IR_INST_OP(content, 0) == IR_MODE_NORMAL && (allocated = _cg_mips_allocated_reg(IR_INST_MODE(content, 0), content->operand[0])) != 0)
+        return allocated;
+    return MIPS_REG_V0;
+}
+
+void _cg_mips_store_result(ir_inst *content, int reg) {
+    int allocated;
+    int address, disp;
+    if (IR_INST_MODE(content, 0) != IR_MODE_T && IR_INST_MODE(content, 0) != IR_MODE_V) {
+        printf("Unexpected\n");
+        return;
     }
-    // store result
-    switch (content->mode.op1) {
+    switch (IR_INST_OP(content, 0)) {
         case IR_MODE_NORMAL:
-            fprintf(output_file, "  sw $v0, ");
-            if (content->mode.mode1 == IR_MODE_T)
-                fprintf(output_file, "%d($fp)\n", -(content->temp_id));
-            else if (content->mode.mode1 == IR_MODE_V)
-                fprintf(output_file, "%d($fp)\n", -(content->var_id));
-            else
-                printf("Unexpected\n");
+            allocated = _cg_mips_allocated_reg(IR_INST_MODE(content, 0), content->operand[0]);
+            if (allocated) {
+                if (allocated != reg)
+                    mips_rr(MIPS_MOVE, allocated, reg);
+            }
+            else {
+                mips_mem(MIPS_SW, reg, -cg_mips_frame_home(cmmc_ctx->cg_mips_frame, content->operand[0]), MIPS_REG_FP);
+            }
             break;
         case IR_MODE_STAR:
-            if (content->mode.mode1 == IR_MODE_T)
-                fprintf(output_file, "  lw $%s%d, %d($fp)\n", "t", 2, -(content->temp_id));
-            else if (content->mode.mode1 == IR_MODE_V)
-                fprintf(output_file, "  lw $%s%d, %d($fp)\n", "t", 2, -(content->var_id));
-            else
-                printf("Unexpected\n");
-            
-            fprintf(output_file, "  sw $v0, 0($t2)\n");
+            address = cg_mips_isel_address(content, reg, &disp);
+            mips_mem(MIPS_SW, reg, disp, address);
             break;
         case IR_MODE_ADDR:
         default:
@@ -164,624 +99,328 @@ void _cg_mips_generate_exp_3(ir *content) {
     }
 }
 
-void _cg_mips_generate_relop(ir *content) {
+void _cg_mips_generate_exp_3(ir_inst *content) {
+    int dest = _cg_mips_dest_reg(content);
+    cg_mips_isel_exp(content, dest);
+    // store result
+    _cg_mips_store_result(content, dest);
+}
+
+// computes a boolean with a branch, on_branch is the result when
+// branch jumps and 1 - on_branch otherwise
+void _cg_mips_generate_bool(ir_inst *content, uint8_t branch, int reg1, int reg2, int on_branch) {
     uint32_t goto_label;
     uint32_t goto_label_end;
-    // load oprand 1 to t0
-    switch (content->mode.mode2) {
-        case IR_MODE_T:
-            _cg_mips_set_reg(content->mode.mode2, content->mode.op2, content->temp_id1, "t", 0);
-            break;
-        case IR_MODE_V:
-            _cg_mips_set_reg(content->mode.mode2, content->mode.op2, content->var_id1, "t", 0);
-            break;
-        case IR_MODE_I:
-            _cg_mips_set_reg(content->mode.mode2, content->mode.op2, content->int_val1, "t", 0);
-            break;
-    }
-    // load oprand 2 to t1
-    switch (content->mode.mode3) {
-        case IR_MODE_T:
-            _cg_mips_set_reg(content->mode.mode3, content->mode.op3, content->temp_id2, "t", 1);
-            break;
-        case IR_MODE_V:
-            _cg_mips_set_reg(content->mode.mode3, content->mode.op3, content->var_id2, "t", 1);
-            break;
-        case IR_MODE_I:
-            _cg_mips_set_reg(content->mode.mode3, content->mode.op3, content->int_val2, "t", 1);
-            break;
-    }
-    switch (content->op) {
+    int dest = _cg_mips_dest_reg(content);
+    goto_label = ir_new_label();
+    mips_branch(branch, reg1, reg2, goto_label);
+    mips_ri(MIPS_LI, dest, !on_branch);
+    mips_jump(MIPS_J, goto_label_end = ir_new_label());
+    mips_label(goto_label);
+    mips_ri(MIPS_LI, dest, on_branch);
+    mips_label(goto_label_end);
+    // store result
+    _cg_mips_store_result(content, dest);
+}
+
+uint8_t _cg_mips_relop_branch(uint32_t op) {
+    switch (op) {
         case IR_EXP_OP_EQ:
-            fprintf(output_file, "  beq $t0, $t1, label%d\n", goto_label = ir_new_label());
-            break;
+            return MIPS_BEQ;
         case IR_EXP_OP_NEQ:
-            fprintf(output_file, "  bne $t0, $t1, label%d\n", goto_label = ir_new_label());
-            break;
+            return MIPS_BNE;
         case IR_EXP_OP_GE:
-            fprintf(output_file, "  bge $t0, $t1, label%d\n", goto_label = ir_new_label());
-            break;
+            return MIPS_BGE;
         case IR_EXP_OP_GT:
-            fprintf(output_file, "  bgt $t0, $t1, label%d\n", goto_label = ir_new_label());
-            break;
+            return MIPS_BGT;
         case IR_EXP_OP_LT:
-            fprintf(output_file, "  blt $t0, $t1, label%d\n", goto_label = ir_new_label());
-            break;
+            return MIPS_BLT;
         case IR_EXP_OP_LE:
-            fprintf(output_file, "  ble $t0, $t1, label%d\n", goto_label = ir_new_label());
-            break;
+            return MIPS_BLE;
     }
-    fprintf(output_file, "  li $v0, 0\n");
-    // store result
-    switch (content->mode.op1) {
-        case IR_MODE_NORMAL:
-            fprintf(output_file, "  sw $v0, ");
-            if (content->mode.mode1 == IR_MODE_T)
-                fprintf(output_file, "%d($fp)\n", -(content->temp_id));
-            else if (content->mode.mode1 == IR_MODE_V)
-                fprintf(output_file, "%d($fp)\n", -(content->var_id));
-            else
-                printf("Unexpected\n");
-            break;
-        case IR_MODE_STAR:
-            if (content->mode.mode1 == IR_MODE_T)
-                fprintf(output_file, "  lw $%s%d, %d($fp)\n", "t", 2, -(content->temp_id));
-            else if (content->mode.mode1 == IR_MODE_V)
-                fprintf(output_file, "  lw $%s%d, %d($fp)\n", "t", 2, -(content->var_id));
-            else
-                printf("Unexpected\n");
-            
-            fprintf(output_file, "  sw $v0, 0($t2)\n");
-            break;
-        case IR_MODE_ADDR:
-        default:
-            printf("Unexpected\n");
-            break;
-    }
-    fprintf(output_file, "  j label%d\n", goto_label_end = ir_new_label());
-    fprintf(output_file, "label%d:\n", goto_label);
-    fprintf(output_file, "  li $v0, 1\n");
-    // store result
-    switch (content->mode.op1) {
-        case IR_MODE_NORMAL:
-            fprintf(output_file, "  sw $v0, ");
-            if (content->mode.mode1 == IR_MODE_T)
-                fprintf(output_file, "%d($fp)\n", -(content->temp_id));
-            else if (content->mode.mode1 == IR_MODE_V)
-                fprintf(output_file, "%d($fp)\n", -(content->var_id));
-            else
-                printf("Unexpected\n");
-            break;
-        case IR_MODE_STAR:
-            if (content->mode.mode1 == IR_MODE_T)
-                fprintf(output_file, "  lw $%s%d, %d($fp)\n", "t", 2, -(content->temp_id));
-            else if (content->mode.mode1 == IR_MODE_V)
-                fprintf(output_file, "  lw $%s%d, %d($fp)\n", "t", 2, -(content->var_id));
-            else
-                printf("Unexpected\n");
-            
-            fprintf(output_file, "  sw $v0, 0($t2)\n");
-            break;
-        case IR_MODE_ADDR:
-        default:
-            printf("Unexpected\n");
-            break;
+    printf("Unexpected\n");
+    return MIPS_BEQ;
+}
+
+// when optimizing, booleans are computed without branches:
+//
+//   !a        sltiu d, a, 1
+//   a || b    or d, a, b ; sltu d, $zero, d
+//   a && b    sltu of each against $zero, and of the two
+//
+// relops are picked by instruction selection along with the rest
+void _cg_mips_generate_relop(ir_inst *content) {
+    int reg1, reg2;
+    if (cmmc_ctx->args.opt_level >= 1) {
+        _cg_mips_generate_exp_3(content);
+        return;
     }
-    fprintf(output_file, "label%d:\n", goto_label_end);
+    // load oprand 1 and 2, t0 and t1 if they are on the stack
+    cg_mips_isel_operands(content, &reg1, &reg2);
+    _cg_mips_generate_bool(content, _cg_mips_relop_branch(content->op), reg1, reg2, 1);
 }
 
-void _cg_mips_generate_and(ir *content) {
+void _cg_mips_generate_and(ir_inst *content) {
     uint32_t goto_label;
     uint32_t goto_label_end;
-    // load oprand 1 to t0
-    switch (content->mode.mode2) {
-        case IR_MODE_T:
-            _cg_mips_set_reg(content->mode.mode2, content->mode.op2, content->temp_id1, "t", 0);
-            break;
-        case IR_MODE_V:
-            _cg_mips_set_reg(content->mode.mode2, content->mode.op2, content->var_id1, "t", 0);
-            break;
-        case IR_MODE_I:
-            _cg_mips_set_reg(content->mode.mode2, content->mode.op2, content->int_val1, "t", 0);
-            break;
-    }
-    // load oprand 2 to t1
-    switch (content->mode.mode3) {
-        case IR_MODE_T:
-            _cg_mips_set_reg(content->mode.mode3, content->mode.op3, content->temp_id2, "t", 1);
-            break;
-        case IR_MODE_V:
-            _cg_mips_set_reg(content->mode.mode3, content->mode.op3, content->var_id2, "t", 1);
-            break;
-        case IR_MODE_I:
-            _cg_mips_set_reg(content->mode.mode3, content->mode.op3, content->int_val2, "t", 1);
-            break;
-    }
-    fprintf(output_file, "  beq $t0, $zero, label%d\n", goto_label = ir_new_label());
-    fprintf(output_file, "  beq $t1, $zero, label%d\n", goto_label);
-    fprintf(output_file, "  li $v0, 1\n");
-    // store result
-    switch (content->mode.op1) {
-        case IR_MODE_NORMAL:
-            fprintf(output_file, "  sw $v0, ");
-            if (content->mode.mode1 == IR_MODE_T)
-                fprintf(output_file, "%d($fp)\n", -(content->temp_id));
-            else if (content->mode.mode1 == IR_MODE_V)
-                fprintf(output_file, "%d($fp)\n", -(content->var_id));
-            else
-                printf("Unexpected\n");
-            break;
-        case IR_MODE_STAR:
-            if (content->mode.mode1 == IR_MODE_T)
-                fprintf(output_file, "  lw $%s%d, %d($fp)\n", "t", 2, -(content->temp_id));
-            else if (content->mode.mode1 == IR_MODE_V)
-                fprintf(output_file, "  lw $%s%d, %d($fp)\n", "t", 2, -(content->var_id));
-            else
-                printf("Unexpected\n");
-            
-            fprintf(output_file, "  sw $v0, 0($t2)\n");
-            break;
-        case IR_MODE_ADDR:
-        default:
-            printf("Unexpected\n");
-            break;
+    int reg1, reg2, dest;
+    // load oprand 1 and 2, t0 and t1 if they are on the stack
+    cg_mips_isel_operands(content, &reg1, &reg2);
+    dest = _cg_mips_dest_reg(content);
+    if (cmmc_ctx->args.opt_level >= 1) {
+        // reg2 is never t0
+        mips_rrr(MIPS_SLTU, MIPS_REG_T0, MIPS_REG_ZERO, reg1);
+        mips_rrr(MIPS_SLTU, MIPS_REG_T1, MIPS_REG_ZERO, reg2);
+        mips_rrr(MIPS_AND, dest, MIPS_REG_T0, MIPS_REG_T1);
+        _cg_mips_store_result(content, dest);
+        return;
     }
-    fprintf(output_file, "  j label%d\n", goto_label_end = ir_new_label());
-    fprintf(output_file, "label%d:\n", goto_label);
-    fprintf(output_file, "  li $v0, 0\n");
+    mips_branch(MIPS_BEQ, reg1, MIPS_REG_ZERO, goto_label = ir_new_label());
+    mips_branch(MIPS_BEQ, reg2, MIPS_REG_ZERO, goto_label);
+    mips_ri(MIPS_LI, dest, 1);
+    mips_jump(MIPS_J, goto_label_end = ir_new_label());
+    mips_label(goto_label);
+    mips_ri(MIPS_LI, dest, 0);
+    mips_label(goto_label_end);
     // store result
-    switch (content->mode.op1) {
-        case IR_MODE_NORMAL:
-            fprintf(output_file, "  sw $v0, ");
-            if (content->mode.mode1 == IR_MODE_T)
-                fprintf(output_file, "%d($fp)\n", -(content->temp_id));
-            else if (content->mode.mode1 == IR_MODE_V)
-                fprintf(output_file, "%d($fp)\n", -(content->var_id));
-            else
-                printf("Unexpected\n");
-            break;
-        case IR_MODE_STAR:
-            if (content->mode.mode1 == IR_MODE_T)
-                fprintf(output_file, "  lw $%s%d, %d($fp)\n", "t", 2, -(content->temp_id));
-            else if (content->mode.mode1 == IR_MODE_V)
-                fprintf(output_file, "  lw $%s%d, %d($fp)\n", "t", 2, -(content->var_id));
-            else
-                printf("Unexpected\n");
-            
-            fprintf(output_file, "  sw $v0, 0($t2)\n");
-            break;
-        case IR_MODE_ADDR:
-        default:
-            printf("Unexpected\n");
-            break;
-    }
-    fprintf(output_file, "label%d:\n", goto_label_end);
+    _cg_mips_store_result(content, dest);
 }
 
-void _cg_mips_generate_or(ir *content) {
+void _cg_mips_generate_or(ir_inst *content) {
     uint32_t goto_label;
     uint32_t goto_label_end;
-    // load oprand 1 to t0
-    switch (content->mode.mode2) {
-        case IR_MODE_T:
-            _cg_mips_set_reg(content->mode.mode2, content->mode.op2, content->temp_id1, "t", 0);
-            break;
-        case IR_MODE_V:
-            _cg_mips_set_reg(content->mode.mode2, content->mode.op2, content->var_id1, "t", 0);
-            break;
-        case IR_MODE_I:
-            _cg_mips_set_reg(content->mode.mode2, content->mode.op2, content->int_val1, "t", 0);
-            break;
-    }
-    // load oprand 2 to t1
-    switch (content->mode.mode3) {
-        case IR_MODE_T:
-            _cg_mips_set_reg(content->mode.mode3, content->mode.op3, content->temp_id2, "t", 1);
-            break;
-        case IR_MODE_V:
-            _cg_mips_set_reg(content->mode.mode3, content->mode.op3, content->var_id2, "t", 1);
-            break;
-        case IR_MODE_I:
-            _cg_mips_set_reg(content->mode.mode3, content->mode.op3, content->int_val2, "t", 1);
-            break;
-    }
-    fprintf(output_file, "  bne $t0, $zero, label%d\n", goto_label = ir_new_label());
-    fprintf(output_file, "  bne $t1, $zero, label%d\n", goto_label);
-    fprintf(output_file, "  li $v0, 0\n");
-    // store result
-    switch (content->mode.op1) {
-        case IR_MODE_NORMAL:
-            fprintf(output_file, "  sw $v0, ");
-            if (content->mode.mode1 == IR_MODE_T)
-                fprintf(output_file, "%d($fp)\n", -(content->temp_id));
-            else if (content->mode.mode1 == IR_MODE_V)
-                fprintf(output_file, "%d($fp)\n", -(content->var_id));
-            else
-                printf("Unexpected\n");
-            break;
-        case IR_MODE_STAR:
-            if (content->mode.mode1 == IR_MODE_T)
-                fprintf(output_file, "  lw $%s%d, %d($fp)\n", "t", 2, -(content->temp_id));
-            else if (content->mode.mode1 == IR_MODE_V)
-                fprintf(output_file, "  lw $%s%d, %d($fp)\n", "t", 2, -(content->var_id));
-            else
-                printf("Unexpected\n");
-            
-            fprintf(output_file, "  sw $v0, 0($t2)\n");
-            break;
-        case IR_MODE_ADDR:
-        default:
-            printf("Unexpected\n");
-            break;
+    int reg1, reg2, dest;
+    // load oprand 1 and 2, t0 and t1 if they are on the stack
+    cg_mips_isel_operands(content, &reg1, &reg2);
+    dest = _cg_mips_dest_reg(content);
+    if (cmmc_ctx->args.opt_level >= 1) {
+        mips_rrr(MIPS_OR, dest, reg1, reg2);
+        mips_rrr(MIPS_SLTU, dest, MIPS_REG_ZERO, dest);
+        _cg_mips_store_result(content, dest);
+        return;
     }
-    fprintf(output_file, "  j label%d\n", goto_label_end = ir_new_label());
-    fprintf(output_file, "label%d:\n", goto_label);
-    fprintf(output_file, "  li $v0, 1\n");
+    mips_branch(MIPS_BNE, reg1, MIPS_REG_ZERO, goto_label = ir_new_label());
+    mips_branch(MIPS_BNE, reg2, MIPS_REG_ZERO, goto_label);
+    mips_ri(MIPS_LI, dest, 0);
+    mips_jump(MIPS_J, goto_label_end = ir_new_label());
+    mips_label(goto_label);
+    mips_ri(MIPS_LI, dest, 1);
+    mips_label(goto_label_end);
     // store result
-    switch (content->mode.op1) {
-        case IR_MODE_NORMAL:
-            fprintf(output_file, "  sw $v0, ");
-            if (content->mode.mode1 == IR_MODE_T)
-                fprintf(output_file, "%d($fp)\n", -(content->temp_id));
-            else if (content->mode.mode1 == IR_MODE_V)
-                fprintf(output_file, "%d($fp)\n", -(content->var_id));
-            else
-                printf("Unexpected\n");
-            break;
-        case IR_MODE_STAR:
-            if (content->mode.mode1 == IR_MODE_T)
-                fprintf(output_file, "  lw $%s%d, %d($fp)\n", "t", 2, -(content->temp_id));
-            else if (content->mode.mode1 == IR_MODE_V)
-                fprintf(output_file, "  lw $%s%d, %d($fp)\n", "t", 2, -(content->var_id));
-            else
-                printf("Unexpected\n");
-            
-            fprintf(output_file, "  sw $v0, 0($t2)\n");
-            break;
-        case IR_MODE_ADDR:
-        default:
-            printf("Unexpected\n");
-            break;
-    }
-    fprintf(output_file, "label%d:\n", goto_label_end);
+    _cg_mips_store_result(content, dest);
 }
 
-void _cg_mips_generate_assign(ir *content) {
-    // load oprand 1 to v0
-    switch (content->mode.mode2) {
-        case IR_MODE_T:
-            _cg_mips_set_reg(content->mode.mode2, content->mode.op2, content->temp_id1, "v", 0);
-            break;
-        case IR_MODE_V:
-            _cg_mips_set_reg(content->mode.mode2, content->mode.op2, content->var_id1, "v", 0);
-            break;
-        case IR_MODE_I:
-            _cg_mips_set_reg(content->mode.mode2, content->mode.op2, content->int_val1, "v", 0);
-            break;
+void _cg_mips_generate_assign(ir_inst *content) {
+    int reg;
+    if (IR_INST_OP(content, 0) == IR_MODE_NORMAL && _cg_mips_allocated_reg(IR_INST_MODE(content, 0), content->operand[0])) {
+        // load straight into the destination register
+        cg_mips_isel_exp(content, _cg_mips_dest_reg(content));
+        return;
     }
+    // load oprand 1 to v0 if it is on the stack
+    reg = _cg_mips_operand_reg(content, 1, MIPS_REG_V0);
     // store result
-    switch (content->mode.op1) {
-        case IR_MODE_NORMAL:
-            fprintf(output_file, "  sw $v0, ");
-            if (content->mode.mode1 == IR_MODE_T)
-                fprintf(output_file, "%d($fp)\n", -(content->temp_id));
-            else if (content->mode.mode1 == IR_MODE_V)
-                fprintf(output_file, "%d($fp)\n", -(content->var_id));
-            else
-                printf("Unexpected\n");
-            break;
-        case IR_MODE_STAR:
-            if (content->mode.mode1 == IR_MODE_T)
-                fprintf(output_file, "  lw $%s%d, %d($fp)\n", "t", 2, -(content->temp_id));
-            else if (content->mode.mode1 == IR_MODE_V)
-                fprintf(output_file, "  lw $%s%d, %d($fp)\n", "t", 2, -(content->var_id));
-            else
-                printf("Unexpected\n");
-            
-            fprintf(output_file, "  sw $v0, 0($t2)\n");
-            break;
-        case IR_MODE_ADDR:
-        default:
-            printf("Unexpected\n");
-            break;
-    }
+    _cg_mips_store_result(content, reg);
 }
 
-void _cg_mips_generate_not(ir *content) {
-    uint32_t goto_label;
-    uint32_t goto_label_end;
-    // load oprand 1 to t0
-    switch (content->mode.mode2) {
-        case IR_MODE_T:
-            _cg_mips_set_reg(content->mode.mode2, content->mode.op2, content->temp_id1, "t", 0);
-            break;
-        case IR_MODE_V:
-            _cg_mips_set_reg(content->mode.mode2, content->mode.op2, content->var_id1, "t", 0);
-            break;
-        case IR_MODE_I:
-            _cg_mips_set_reg(content->mode.mode2, content->mode.op2, content->int_val1, "t", 0);
-            break;
-    }
-    fprintf(output_file, "  beq $t0, $zero, label%d\n", goto_label = ir_new_label());
-    fprintf(output_file, "  li $v0, 0\n");
-    // store result
-    switch (content->mode.op1) {
-        case IR_MODE_NORMAL:
-            fprintf(output_file, "  sw $v0, ");
-            if (content->mode.mode1 == IR_MODE_T)
-                fprintf(output_file, "%d($fp)\n", -(content->temp_id));
-            else if (content->mode.mode1 == IR_MODE_V)
-                fprintf(output_file, "%d($fp)\n", -(content->var_id));
-            else
-                printf("Unexpected\n");
-            break;
-        case IR_MODE_STAR:
-            if (content->mode.mode1 == IR_MODE_T)
-                fprintf(output_file, "  lw $%s%d, %d($fp)\n", "t", 2, -(content->temp_id));
-            else if (content->mode.mode1 == IR_MODE_V)
-                fprintf(output_file, "  lw $%s%d, %d($fp)\n", "t", 2, -(content->var_id));
-            else
-                printf("Unexpected\n");
-            
-            fprintf(output_file, "  sw $v0, 0($t2)\n");
-            break;
-        case IR_MODE_ADDR:
-        default:
-            printf("Unexpected\n");
-            break;
-    }
-    fprintf(output_file, "  j label%d\n", goto_label_end = ir_new_label());
-    fprintf(output_file, "label%d:\n", goto_label);
-    fprintf(output_file, "  li $v0, 1\n");
-    // store result
-    switch (content->mode.op1) {
-        case IR_MODE_NORMAL:
-            fprintf(output_file, "  sw $v0, ");
-            if (content->mode.mode1 == IR_MODE_T)
-                fprintf(output_file, "%d($fp)\n", -(content->temp_id));
-            else if (content->mode.mode1 == IR_MODE_V)
-                fprintf(output_file, "%d($fp)\n", -(content->var_id));
-            else
-                printf("Unexpected\n");
-            break;
-        case IR_MODE_STAR:
-            if (content->mode.mode1 == IR_MODE_T)
-                fprintf(output_file, "  lw $%s%d, %d($fp)\n", "t", 2, -(content->temp_id));
-            else if (content->mode.mode1 == IR_MODE_V)
-                fprintf(output_file, "  lw $%s%d, %d($fp)\n", "t", 2, -(content->var_id));
-            else
-                printf("Unexpected\n");
-            
-            fprintf(output_file, "  sw $v0, 0($t2)\n");
-            break;
-        case IR_MODE_ADDR:
-        default:
-            printf("Unexpected\n");
-            break;
+void _cg_mips_generate_not(ir_inst *content) {
+    int reg;
+    // load oprand 1 to t0 if it is on the stack
+    reg = _cg_mips_operand_reg(content, 1, MIPS_REG_T0);
+    if (cmmc_ctx->args.opt_level >= 1) {
+        mips_rri(MIPS_SLTIU, _cg_mips_dest_reg(content), reg, 1);
+        _cg_mips_store_result(content, _cg_mips_dest_reg(content));
+        return;
     }
-    fprintf(output_file, "label%d:\n", goto_label_end);
+    _cg_mips_generate_bool(content, MIPS_BEQ, reg, MIPS_REG_ZERO, 1);
 }
 
-void _cg_mips_generate_if_imme(ir *content) {
-    // load oprand 1 to t0
-    switch (content->immediate_ir->mode.mode2) {
-        case IR_MODE_T:
-            _cg_mips_set_reg(content->immediate_ir->mode.mode2, content->immediate_ir->mode.op2, content->immediate_ir->temp_id1, "t", 0);
-            break;
-        case IR_MODE_V:
-            _cg_mips_set_reg(content->immediate_ir->mode.mode2, content->immediate_ir->mode.op2, content->immediate_ir->var_id1, "t", 0);
-            break;
-        case IR_MODE_I:
-            _cg_mips_set_reg(content->immediate_ir->mode.mode2, content->immediate_ir->mode.op2, content->immediate_ir->int_val1, "t", 0);
-            break;
+void _cg_mips_generate_if_imme(ir_inst *content) {
+    int reg1, reg2;
+    // load oprand 1 and 2, t0 and t1 if they are on the stack
+    cg_mips_isel_operands(content, &reg1, &reg2);
+    mips_branch(_cg_mips_relop_branch(content->mode[0]), reg1, reg2, content->operand[0]);
+}
+
+// frame of a function:
+//
+// | ARG5 | ARG6 | ...        stack args of the caller
+// ^
+// fp
+// | ... locals ... | ra | fp | saved $s | ...
+//                                       ^
+//                                       sp
+// the first four args are passed in $a0-$a3
+
+void _cg_mips_generate_arg(ir_inst *content) {
+    int reg;
+    int index = cmmc_ctx->cg_mips_arg_index--;
+    if (index < 4) {
+        // straight into $a0-$a3
+        _cg_mips_load_operand(content, 1, MIPS_REG_A0 + index);
+        return;
     }
-    // load oprand 2 to t1
-    switch (content->immediate_ir->mode.mode3) {
-        case IR_MODE_T:
-            _cg_mips_set_reg(content->immediate_ir->mode.mode3, content->immediate_ir->mode.op3, content->immediate_ir->temp_id2, "t", 1);
-            break;
-        case IR_MODE_V:
-            _cg_mips_set_reg(content->immediate_ir->mode.mode3, content->immediate_ir->mode.op3, content->immediate_ir->var_id2, "t", 1);
-            break;
-        case IR_MODE_I:
-            _cg_mips_set_reg(content->immediate_ir->mode.mode3, content->immediate_ir->mode.op3, content->immediate_ir->int_val2, "t", 1);
-            break;
+    // load oprand to t0 if it is on the stack
+    reg = _cg_mips_operand_reg(content, 1, MIPS_REG_T0);
+    mips_mem(MIPS_SW, reg, 4 * (index - 4), MIPS_REG_SP);
+}
+
+void _cg_mips_generate_dec(ir_inst *content) {
+    int i;
+    int locals = cmmc_ctx->cg_mips_frame ? cmmc_ctx->cg_mips_frame->size : content->operand[1];
+    int offset = locals + 8;
+    int frame_size = locals + 8 + (cmmc_ctx->cg_mips_alloc ? 4 * cmmc_ctx->cg_mips_alloc->saved_count : 0);
+    cmmc_ctx->cg_mips_frame_size = locals;
+    cmmc_ctx->report.frame_before = content->operand[1];
+    cmmc_ctx->report.frame_after = locals;
+    mips_rri(MIPS_ADDI, MIPS_REG_SP, MIPS_REG_SP, -frame_size);
+    if (cmmc_ctx->cg_mips_save_ra)
+        mips_mem(MIPS_SW, MIPS_REG_RA, frame_size - locals - 4, MIPS_REG_SP);
+    mips_mem(MIPS_SW, MIPS_REG_FP, frame_size - locals - 8, MIPS_REG_SP);
+    mips_rri(MIPS_ADDI, MIPS_REG_FP, MIPS_REG_SP, frame_size);
+    if (cmmc_ctx->cg_mips_alloc == NULL)
+        return;
+    // callee saved registers go right below ra and fp
+    for (i = 0; i < 8; i++) {
+        if (cmmc_ctx->cg_mips_alloc->saved_mask & (1u << i)) {
+            offset += 4;
+            mips_mem(MIPS_SW, MIPS_REG_S0 + i, -offset, MIPS_REG_FP);
+        }
     }
-    switch (content->immediate_ir->op) {
-        case IR_EXP_OP_EQ:
-            fprintf(output_file, "  beq $t0, $t1, label%d\n", content->goto_label);
-            break;
-        case IR_EXP_OP_NEQ:
-            fprintf(output_file, "  bne $t0, $t1, label%d\n", content->goto_label);
-            break;
-        case IR_EXP_OP_GE:
-            fprintf(output_file, "  bge $t0, $t1, label%d\n", content->goto_label);
-            break;
-        case IR_EXP_OP_GT:
-            fprintf(output_file, "  bgt $t0, $t1, label%d\n", content->goto_label);
-            break;
-        case IR_EXP_OP_LT:
-            fprintf(output_file, "  blt $t0, $t1, label%d\n", content->goto_label);
-            break;
-        case IR_EXP_OP_LE:
-            fprintf(output_file, "  ble $t0, $t1, label%d\n", content->goto_label);
-            break;
+}
+
+void _cg_mips_generate_param(ir_inst *content, int index) {
+    int allocated = _cg_mips_allocated_reg(IR_MODE_V, content->operand[0]);
+    // params are moved to their home once on entry,
+    // after the callee saved registers are spilled
+    if (index < 4) {
+        if (!allocated)
+            mips_mem(MIPS_SW, MIPS_REG_A0 + index, -cg_mips_frame_home(cmmc_ctx->cg_mips_frame, content->operand[0]), MIPS_REG_FP);
+        else if (allocated != MIPS_REG_A0 + index)
+            mips_rr(MIPS_MOVE, allocated, MIPS_REG_A0 + index);
+    }
+    else if (allocated) {
+        mips_mem(MIPS_LW, allocated, -cg_mips_frame_home(cmmc_ctx->cg_mips_frame, content->operand[0]), MIPS_REG_FP);
     }
 }
 
-void _cg_mips_generate_arg(ir *content) {
-    // load oprand to t0
-    switch (content->mode.mode1) {
-        case IR_MODE_T:
-            _cg_mips_set_reg(content->mode.mode1, content->mode.op1, content->temp_id, "t", 0);
-            break;
-        case IR_MODE_V:
-            _cg_mips_set_reg(content->mode.mode1, content->mode.op1, content->var_id, "t", 0);
-            break;
-        case IR_MODE_I:
-            _cg_mips_set_reg(content->mode.mode1, content->mode.op1, content->int_val1, "t", 0);
-            break;
+// restores what the prologue saved and pops the frame
+void _cg_mips_generate_epilogue() {
+    int i;
+    int offset = cmmc_ctx->cg_mips_frame_size + 8;
+    if (cmmc_ctx->cg_mips_alloc != NULL) {
+        for (i = 0; i < 8; i++) {
+            if (cmmc_ctx->cg_mips_alloc->saved_mask & (1u << i)) {
+                offset += 4;
+                mips_mem(MIPS_LW, MIPS_REG_S0 + i, -offset, MIPS_REG_FP);
+            }
+        }
     }
-    // store result to $sp - 4
-    fprintf(output_file, "  addi $sp, $sp, -4\n");
-    fprintf(output_file, "  sw $t0, 0($sp)\n");
+    if (cmmc_ctx->cg_mips_save_ra)
+        mips_mem(MIPS_LW, MIPS_REG_RA, -(cmmc_ctx->cg_mips_frame_size + 4), MIPS_REG_FP);
+    mips_rr(MIPS_MOVE, MIPS_REG_SP, MIPS_REG_FP);
+    mips_mem(MIPS_LW, MIPS_REG_FP, -(cmmc_ctx->cg_mips_frame_size + 8), MIPS_REG_FP);
 }
 
-void _cg_mips_generate_return(ir *content) {
+void _cg_mips_generate_return(ir_inst *content) {
     // load oprand to v0
-    switch (content->mode.mode1) {
-        case IR_MODE_T:
-            _cg_mips_set_reg(content->mode.mode1, content->mode.op1, content->temp_id, "v", 0);
-            break;
-        case IR_MODE_V:
-            _cg_mips_set_reg(content->mode.mode1, content->mode.op1, content->var_id, "v", 0);
-            break;
-        case IR_MODE_I:
-            _cg_mips_set_reg(content->mode.mode1, content->mode.op1, content->int_val1, "v", 0);
-            break;
-    }
-    fprintf(output_file, "  jr $ra\n");
+    _cg_mips_load_operand(content, 1, MIPS_REG_V0);
+    _cg_mips_generate_epilogue();
+    mips_r(MIPS_JR, MIPS_REG_RA);
 }
 
-void _cg_mips_generate_call(ir *content) {
-    // | sp | fp | ra | ARG1
-    //                ^
-    //                sp
-    fprintf(output_file, "  addi $sp, $sp, -12\n");
-    fprintf(output_file, "  sw $ra, 8($sp)\n");
-    fprintf(output_file, "  sw $fp, 4($sp)\n");
-    fprintf(output_file, "  sw $sp, 0($sp)\n");
-    fprintf(output_file, "  move $fp, $sp\n");
-    // | sp | fp | ra | ARG1
-    // ^
-    // fp & sp
-    if (!strcmp(content->func_name, "main")) {
-        fprintf(output_file, "  jal %s\n", content->func_name);
-    }
-    else {
-        fprintf(output_file, "  jal _%s\n", content->func_name);
+// a call whose result is returned right away, with all its args in
+// registers, leaves the frame first and jumps, the callee returns
+// straight to our caller
+int _cg_mips_is_tail_call(ir_function *func, uint32_t i) {
+    ir_inst *call = &func->insts[i];
+    if (cmmc_ctx->args.opt_level < 1 || call->operand[2] > 4 || IR_INST_OP(call, 0) != IR_MODE_NORMAL)
+        return 0;
+    for (i++; i < func->count && func->insts[i].op == IR_OP_LABEL; i++)
+        ;
+    return i < func->count && func->insts[i].op == IR_OP_RETURN
+        && func->insts[i].mode[1] == call->mode[0] && func->insts[i].operand[1] == call->operand[0];
+}
+
+void _cg_mips_generate_call(ir_inst *content, char tail) {
+    const char *func_name = cmmc_ctx->cg_mips_function->names[content->operand[1]];
+    if (tail) {
+        _cg_mips_generate_epilogue();
+        mips_call(MIPS_J, func_name);
+        return;
     }
-    // | .....  last frame ..... | sp | fp | ra | ARG1
-    // ^                         ^
-    // sp                        fp
-    // restore stack
-    fprintf(output_file, "  lw $sp, 0($fp)\n");
-    fprintf(output_file, "  lw $fp, 4($sp)\n");
-    fprintf(output_file, "  lw $ra, 8($sp)\n");
-    // pop args
-    fprintf(output_file, "  add $sp, $sp, %d\n", 4 * content->param_count);
+    mips_call(MIPS_JAL, func_name);
+    // pop stack args
+    if (content->operand[2] > 4)
+        mips_rri(MIPS_ADDI, MIPS_REG_SP, MIPS_REG_SP, 4 * (content->operand[2] - 4));
     // store the result
-    // store result
-    switch (content->mode.op1) {
-        case IR_MODE_NORMAL:
-            fprintf(output_file, "  sw $v0, ");
-            if (content->mode.mode1 == IR_MODE_T)
-                fprintf(output_file, "%d($fp)\n", -(content->temp_id));
-            else if (content->mode.mode1 == IR_MODE_V)
-                fprintf(output_file, "%d($fp)\n", -(content->var_id));
-            else
-                printf("Unexpected\n");
-            break;
-        case IR_MODE_STAR:
-            if (content->mode.mode1 == IR_MODE_T)
-                fprintf(output_file, "  lw $%s%d, %d($fp)\n", "t", 2, -(content->temp_id));
-            else if (content->mode.mode1 == IR_MODE_V)
-                fprintf(output_file, "  lw $%s%d, %d($fp)\n", "t", 2, -(content->var_id));
-            else
-                printf("Unexpected\n");
-            
-            fprintf(output_file, "  sw $v0, 0($t2)\n");
-            break;
-        case IR_MODE_ADDR:
-        default:
-            printf("Unexpected\n");
-            break;
-    }
+    _cg_mips_store_result(content, MIPS_REG_V0);
 }
 
-void _cg_mips_generate_read(ir *content) {
-    // call read
-    fprintf(output_file, "  addi $sp, $sp, -4\n");
-    fprintf(output_file, "  sw $ra, 0($sp)\n");
-    fprintf(output_file, "  jal read\n");
-    fprintf(output_file, "  lw $ra, 0($sp)\n");
-    fprintf(output_file, "  addi $sp, $sp, 4\n");
+void _cg_mips_generate_read(ir_inst *content) {
+    // call read, $ra is saved by the prologue
+    mips_call(MIPS_JAL, "read");
     // store result
-    switch (content->mode.op1) {
-        case IR_MODE_NORMAL:
-            fprintf(output_file, "  sw $v0, ");
-            if (content->mode.mode1 == IR_MODE_T)
-                fprintf(output_file, "%d($fp)\n", -(content->temp_id));
-            else if (content->mode.mode1 == IR_MODE_V)
-                fprintf(output_file, "%d($fp)\n", -(content->var_id));
-            else
-                printf("Unexpected\n");
-            break;
-        case IR_MODE_STAR:
-            if (content->mode.mode1 == IR_MODE_T)
-                fprintf(output_file, "  lw $%s%d, %d($fp)\n", "t", 2, -(content->temp_id));
-            else if (content->mode.mode1 == IR_MODE_V)
-                fprintf(output_file, "  lw $%s%d, %d($fp)\n", "t", 2, -(content->var_id));
-            else
-                printf("Unexpected\n");
-            
-            fprintf(output_file, "  sw $v0, 0($t2)\n");
-            break;
-        case IR_MODE_ADDR:
-        default:
-            printf("Unexpected\n");
-            break;
-    }
+    _cg_mips_store_result(content, MIPS_REG_V0);
 }
 
-void _cg_mips_generate_write(ir *content) {
+void _cg_mips_generate_write(ir_inst *content) {
     // load oprand 1 to a0
-    switch (content->mode.mode1) {
-        case IR_MODE_T:
-            _cg_mips_set_reg(content->mode.mode1, content->mode.op1, content->temp_id, "a", 0);
-            break;
-        case IR_MODE_V:
-            _cg_mips_set_reg(content->mode.mode1, content->mode.op1, content->var_id, "a", 0);
-            break;
-        case IR_MODE_I:
-            _cg_mips_set_reg(content->mode.mode1, content->mode.op1, content->int_val1, "a", 0);
-            break;
-    }
-    // call write
-    fprintf(output_file, "  addi $sp, $sp, -4\n");
-    fprintf(output_file, "  sw $ra, 0($sp)\n");
-    fprintf(output_file, "  jal write\n");
-    fprintf(output_file, "  lw $ra, 0($sp)\n");
-    fprintf(output_file, "  addi $sp, $sp, 4\n");
+    _cg_mips_load_operand(content, 1, MIPS_REG_A0);
+    // call write, $ra is saved by the prologue
+    mips_call(MIPS_JAL, "write");
 }
 
-void _cg_mips_generate_function(ir_list *list) {
+void cg_mips_generate_function(ir_function *func) {
 
-    ir_node *iterator;
-    if (list == NULL) {
+    ir_inst *inst;
+    int reg;
+    uint32_t i, j;
+    int param_index, sibling;
+    if (func == NULL) {
         printf("Empty\n");
         return;
     }
-    iterator = list->head;
-    if (iterator == NULL) {
+    if (func->count == 0) {
         printf("Empty list\n");
         return;
     }
-    // don't care the initial position of $sp
-    // but need to set $fp
-    if (!strcmp(iterator->content->func_name, "main")) {
-        fprintf(output_file, "main:\n");
-        fprintf(output_file, "  move $fp, $sp\n");
-        iterator = iterator->next;
-    }
-    while (iterator != NULL) {
+    cmmc_ctx->cg_mips_function = func;
+    if (!cmmc_ctx->args.no_regalloc) {
+        report_push(REPORT_PHASE_REGALLOC);
+        cmmc_ctx->cg_mips_alloc = cg_mips_regalloc_function(func);
+        report_pop();
+    }
+    // slots are laid out before isel folds their offsets into lw and sw
+    if (cmmc_ctx->args.opt_level >= 1)
+        cmmc_ctx->cg_mips_frame = cg_mips_frame_function(func, cmmc_ctx->cg_mips_alloc);
+    cmmc_ctx->cg_mips_isel = cg_mips_isel_function(func);
+    cmmc_ctx->cg_mips_save_ra = 0;
+    for (i = 0; i < func->count; i++) {
+        if (func->insts[i].op == IR_OP_CALL || func->insts[i].op == IR_OP_READ || func->insts[i].op == IR_OP_WRITE)
+            cmmc_ctx->cg_mips_save_ra = 1;
+    }
+    // an address into our frame may be among the args or kept by the
+    // callee, the frame has to stay for the call
+    sibling = !ir_function_takes_address(func);
+    i = 0;
+    // main sets up its frame like everyone else
+    if (!strcmp(func->names[0], "main")) {
+        mips_func(func->names[0]);
+        i++;
+    }
+    for (; i < func->count; i++) {
+        inst = &func->insts[i];
+        // computed by the instruction using it
+        if (cg_mips_isel_folded(cmmc_ctx->cg_mips_isel, i))
+            continue;
         // generate code
-        switch (iterator->content->op) {
+        switch (inst->op) {
             case IR_EXP_OP_ADD:
             case IR_EXP_OP_DIV:
             case IR_EXP_OP_MINUS:
             case IR_EXP_OP_MUL:
-                _cg_mips_generate_exp_3(iterator->content);
+                _cg_mips_generate_exp_3(inst);
                 break;
             case IR_EXP_OP_EQ:
             case IR_EXP_OP_GE:
@@ -789,94 +428,93 @@ void _cg_mips_generate_function(ir_list *list) {
             case IR_EXP_OP_LE:
             case IR_EXP_OP_LT:
             case IR_EXP_OP_NEQ:
-                _cg_mips_generate_relop(iterator->content);
+                _cg_mips_generate_relop(inst);
                 break;
             case IR_EXP_OP_AND:
-                _cg_mips_generate_and(iterator->content);
+                _cg_mips_generate_and(inst);
                 break;
             case IR_EXP_OP_OR:
-                _cg_mips_generate_or(iterator->content);
+                _cg_mips_generate_or(inst);
                 break;
             case IR_EXP_OP_ASSIGN:
-                _cg_mips_generate_assign(iterator->content);
+                _cg_mips_generate_assign(inst);
                 break;    
             case IR_EXP_OP_NOT:
-                _cg_mips_generate_not(iterator->content);
+                _cg_mips_generate_not(inst);
                 break;
             case IR_OP_ARG:
-                _cg_mips_generate_arg(iterator->content);
+                if (cmmc_ctx->cg_mips_arg_index < 0) {
+                    // first of a run, args come last one first
+                    cmmc_ctx->cg_mips_arg_index = -1;
+                    for (j = i; j < func->count && func->insts[j].op == IR_OP_ARG; j++)
+                        cmmc_ctx->cg_mips_arg_index++;
+                    if (cmmc_ctx->cg_mips_arg_index >= 4)
+                        mips_rri(MIPS_ADDI, MIPS_REG_SP, MIPS_REG_SP, -4 * (cmmc_ctx->cg_mips_arg_index - 3));
+                }
+                _cg_mips_generate_arg(inst);
                 break;
             case IR_OP_CALL:
-                _cg_mips_generate_call(iterator->content);
+                if (sibling && _cg_mips_is_tail_call(func, i)) {
+                    _cg_mips_generate_call(inst, 1);
+                    // nothing comes back to the RETURN right after
+                    if (func->insts[i + 1].op == IR_OP_RETURN)
+                        i++;
+                }
+                else {
+                    _cg_mips_generate_call(inst, 0);
+                }
                 break;
             case IR_OP_DEC:
-                fprintf(output_file, "  addi $sp, $sp, %d\n", -(iterator->content->size));
+                _cg_mips_generate_dec(inst);
+                param_index = 0;
+                for (j = 0; j < i; j++) {
+                    if (func->insts[j].op == IR_OP_PARAM)
+                        _cg_mips_generate_param(&func->insts[j], param_index++);
+                }
                 break;
             case IR_OP_FUNC:
-                fprintf(output_file, "_%s :\n", iterator->content->func_name);
+                mips_func(func->names[inst->operand[1]]);
                 break;
             case IR_OP_GOTO:
-                fprintf(output_file, "  j label%d\n", iterator->content->goto_label);
+                mips_jump(MIPS_J, inst->operand[0]);
                 break;
             case IR_OP_IF:
-                switch (iterator->content->mode.mode1) {
-                    case IR_MODE_T:
-                        _cg_mips_set_reg(iterator->content->mode.mode1, iterator->content->mode.op1, iterator->content->temp_id, "t", 0);
-                        break;
-                    case IR_MODE_V:
-                        _cg_mips_set_reg(iterator->content->mode.mode1, iterator->content->mode.op1, iterator->content->var_id, "t", 0);
-                        break;
-                }
-                fprintf(output_file, "  beq $t0, $zero, label%d\n", iterator->content->goto_label);
+                reg = _cg_mips_operand_reg(inst, 1, MIPS_REG_T0);
+                mips_branch(MIPS_BEQ, reg, MIPS_REG_ZERO, inst->operand[0]);
                 break;
             case IR_OP_IF_POSITIVE:
-                switch (iterator->content->mode.mode1) {
-                    case IR_MODE_T:
-                        _cg_mips_set_reg(iterator->content->mode.mode1, iterator->content->mode.op1, iterator->content->temp_id, "t", 0);
-                        break;
-                    case IR_MODE_V:
-                        _cg_mips_set_reg(iterator->content->mode.mode1, iterator->content->mode.op1, iterator->content->var_id, "t", 0);
-                        break;
-                }
-                fprintf(output_file, "  bne $t0, $zero, label%d\n", iterator->content->goto_label);
+                reg = _cg_mips_operand_reg(inst, 1, MIPS_REG_T0);
+                mips_branch(MIPS_BNE, reg, MIPS_REG_ZERO, inst->operand[0]);
                 break;
             case IR_OP_IF_IMME:
-                _cg_mips_generate_if_imme(iterator->content);
+                _cg_mips_generate_if_imme(inst);
                 break;
             case IR_OP_LABEL:
-                fprintf(output_file, "label%d:\n", iterator->content->goto_label);
+                mips_label(inst->operand[0]);
                 break;
             case IR_OP_PARAM:
-                //fprintf(output_file, "PARAM v%d\n", ir_content->var_id);
+                // loaded along with DEC
                 break;
             case IR_OP_RETURN:
-                _cg_mips_generate_return(iterator->content);
+                _cg_mips_generate_return(inst);
                 break;
             case IR_OP_READ:
-                _cg_mips_generate_read(iterator->content);
+                _cg_mips_generate_read(inst);
                 break;
             case IR_OP_WRITE:
-                _cg_mips_generate_write(iterator->content);
+                _cg_mips_generate_write(inst);
                 break;
             default:
-                printf("SHIT HAPPENED, %d\n", iterator->content->op);
+                printf("SHIT HAPPENED, %d\n", inst->op);
             break;
         }
-        iterator = iterator->next;
-    }
-}
-
-void cg_mips_generate(ir_func_list *func) {
-    ir_func_list *iterator = func;
-
-    // generate header
-    _cg_mips_generate_header();
-
-    while (iterator != NULL) {
-        // deal with func one by one
-        _cg_mips_generate_function(iterator->func_content);
-
-        iterator = iterator->next;
     }
-    return;
+    mips_flush();
+    cg_mips_isel_free(cmmc_ctx->cg_mips_isel);
+    cmmc_ctx->cg_mips_isel = NULL;
+    cg_mips_regalloc_free(cmmc_ctx->cg_mips_alloc);
+    cmmc_ctx->cg_mips_alloc = NULL;
+    cg_mips_frame_free(cmmc_ctx->cg_mips_frame);
+    cmmc_ctx->cg_mips_frame = NULL;
+    cmmc_ctx->cg_mips_function = NULL;
 }
@@ -0,0 +1,135 @@
+/*
+    C-- Compiler Front/Back End
+    Copyright (C) 2019 NSKernel. All rights reserved.
+
+    A lab of Compilers at Nanjing University
+
+    context.c
+    State of one compilation
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <context.h>
+#include <semantics.h>
+#include <emit.h>
+
+// from the scanner and parser
+typedef void *yyscan_t;
+int yylex_init_extra(cmmc_context *ctx, yyscan_t *scanner);
+void yyset_in(FILE *in, yyscan_t scanner);
+int yylex_destroy(yyscan_t scanner);
+int yyparse(yyscan_t scanner, cmmc_context *ctx);
+
+__thread cmmc_context *cmmc_ctx = NULL;
+
+cmmc_context *cmmc_context_new(struct global_args_t *args) {
+    cmmc_context *ctx = calloc(1, sizeof(cmmc_context));
+    if (args != NULL)
+        ctx->args = *args;
+    ctx->cg_mips_arg_index = -1;
+    ctx->diag_file = stdout;
+    ctx->report_file = stderr;
+    return ctx;
+}
+
+void cmmc_context_free(cmmc_context *ctx) {
+    if (ctx == NULL)
+        return;
+    arena_destroy(&ctx->ast_arena);
+    arena_destroy(&ctx->function_arena);
+    arena_destroy(&ctx->ir_arena);
+    arena_destroy(&ctx->symbol_arena);
+    arena_destroy(&ctx->inline_arena);
+    free(ctx->symtable_names);
+    free(ctx->cg_mips_insts);
+    report_reset(&ctx->report);
+    free(ctx);
+}
+
+void _cmmc_reset_arena(arena *a) {
+    arena_release(a);
+    a->peak = 0;
+    a->count = 0;
+    a->total = 0;
+}
+
+// forget everything the last compilation left behind,
+// the arenas keep a chunk each for the next one
+void _cmmc_reset(cmmc_context *ctx) {
+    _cmmc_reset_arena(&ctx->ast_arena);
+    _cmmc_reset_arena(&ctx->function_arena);
+    _cmmc_reset_arena(&ctx->ir_arena);
+    _cmmc_reset_arena(&ctx->symbol_arena);
+    _cmmc_reset_arena(&ctx->inline_arena);
+    free(ctx->symtable_names);
+    ctx->symtable_names = NULL;
+    ctx->symtable_name_capacity = 0;
+    ctx->symtable_name_count = 0;
+    ctx->symtable_scope_count = 0;
+    ctx->symbol_table_root = NULL;
+    ctx->root_node = NULL;
+    ctx->error_flag = 0;
+    ctx->sem_error = 0;
+    ctx->sem_unnamed_struct_count = 0;
+    ctx->inline_bodies = NULL;
+    ctx->ir_variable_offset = 0;
+    ctx->ir_label_count = 0;
+    ctx->ir_label_last_max = 0;
+    ctx->cg_mips_function = NULL;
+    ctx->cg_mips_alloc = NULL;
+    ctx->cg_mips_isel = NULL;
+    ctx->cg_mips_frame = NULL;
+    ctx->cg_mips_arg_index = -1;
+    ctx->cg_mips_count = 0;
+    ctx->emit_used = 0;
+    report_reset(&ctx->report);
+}
+
+int cmmc_compile(cmmc_context *ctx, const char *input, const char *output) {
+    cmmc_context *saved_ctx = cmmc_ctx;
+    FILE *input_file;
+    yyscan_t scanner;
+    int ret;
+
+    _cmmc_reset(ctx);
+    ctx->args.input_file = (char *)input;
+    ctx->args.output_file = (char *)output;
+    ctx->output_file = fopen(output, "w+");
+    if (ctx->output_file == NULL) {
+        fprintf(ctx->diag_file, "cmmc: \033[0;31merror\033[0m: cannot write file %s\n", output);
+        return -1;
+    }
+    if (!(input_file = fopen(input, "r"))) {
+        fprintf(ctx->diag_file, "cmmc: \033[0;31merror\033[0m: cannot open file %s\n", input);
+        fclose(ctx->output_file);
+        return -1;
+    }
+
+    cmmc_ctx = ctx;
+    yylex_init_extra(ctx, &scanner);
+    yyset_in(input_file, scanner);
+    report_push(REPORT_PHASE_PARSE);
+    yyparse(scanner, ctx);
+    report_pop();
+    yylex_destroy(scanner);
+    fclose(input_file);
+    if (!ctx->error_flag) {
+        report_push(REPORT_PHASE_SEMANTICS);
+        sem_validate(ctx->root_node);
+        report_pop();
+    }
+    report_push(REPORT_PHASE_CODEGEN);
+    emit_flush();
+    report_pop();
+    fclose(ctx->output_file);
+    ctx->output_file = NULL;
+    ret = ctx->error_flag || ctx->sem_error;
+    if (ctx->args.time_report || ctx->args.mem_report)
+        report_print(ctx->report_file);
+    _cmmc_reset(ctx);
+    cmmc_ctx = saved_ctx;
+    return ret;
+}
@@ -0,0 +1,96 @@
+/*
+    C-- Compiler Front/Back End
+    Copyright (C) 2019 NSKernel. All rights reserved.
+
+    A lab of Compilers at Nanjing University
+
+    context.h
+    State of one compilation
+*/
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include <global.h>
+#include <ast.h>
+#include <arena.h>
+#include <symbol_table.h>
+#include <ir.h>
+#include <backend.h>
+#include <emit.h>
+#include <report.h>
+#include <inline.h>
+#include <mips.h>
+
+#ifndef CONTEXT_H
+#define CONTEXT_H
+
+typedef struct cmmc_context_t cmmc_context;
+
+// everything a compilation touches lives here, so that any number of
+// them may run at once as long as each has its own context
+struct cmmc_context_t {
+    struct global_args_t args;
+    FILE *output_file;
+    FILE *diag_file;               // where errors in the source are reported, stdout by default
+    FILE *report_file;             // where -ftime-report and -fmem-report go, stderr by default
+
+    // front end
+    ast_node *root_node;
+    char error_flag;
+
+    // regions
+    arena ast_arena;               // the tree, lives through the compilation
+    arena function_arena;          // semantic types of the current function
+    arena ir_arena;                // ir of the current function
+    arena symbol_arena;            // symbols, struct specifiers and interned names
+    arena inline_arena;            // bodies kept for inlining, live through the compilation
+
+    // symbol table, open addressing hash table of interned names
+    symbol_table *symbol_table_root;
+    symtable_name **symtable_names;
+    uint32_t symtable_name_capacity;
+    uint32_t symtable_name_count;
+    uint32_t symtable_scope_count;
+
+    // semantics
+    char sem_error;
+    int sem_unnamed_struct_count;
+
+    // functions compiled so far that are small enough to inline
+    inline_body *inline_bodies;
+
+    // ir counters
+    int ir_variable_offset;
+    uint32_t ir_label_count;
+    uint32_t ir_label_last_max;
+
+    // mips back end, the function being generated
+    ir_function *cg_mips_function;
+    cg_mips_regalloc *cg_mips_alloc;    // NULL when everything lives on the stack
+    cg_mips_isel *cg_mips_isel;
+    cg_mips_frame *cg_mips_frame;       // NULL when every id keeps its own slot
+    int cg_mips_frame_size;
+    char cg_mips_save_ra;               // whether the function calls anything
+    int cg_mips_arg_index;              // next ARG of an argument list, counting down
+    mips_inst *cg_mips_insts;           // its code, written out by mips_flush
+    uint32_t cg_mips_count;
+    uint32_t cg_mips_capacity;
+
+    // output buffer
+    char emit_buffer[EMIT_BUFFER_SIZE];
+    size_t emit_used;
+
+    report report;
+};
+
+// the context being compiled on this thread, set by cmmc_compile
+extern __thread cmmc_context *cmmc_ctx;
+
+cmmc_context *cmmc_context_new(struct global_args_t *args);
+void cmmc_context_free(cmmc_context *ctx);
+// returns 0 on success, 1 when the source has errors and
+// -1 when a file cannot be opened
+int cmmc_compile(cmmc_context *ctx, const char *input, const char *output);
+
+#endif
@@ -0,0 +1,107 @@
+/*
+    C-- Compiler Back End
+    Copyright (C) 2019 NSKernel. All rights reserved.
+
+    A lab of Compilers at Nanjing University
+
+    copyprop.c
+    Copy propagation within basic blocks
+*/
+
+#include <stdlib.h>
+#include <stdint.h>
+
+#include <ir.h>
+#include <cfg.h>
+#include <live.h>
+#include <opt.h>
+
+// after x := y, reads of x see y until either of them is written
+// again. x := #k works the same for plain reads. x is then often dead
+// and dce takes the copy away
+
+#define _COPYPROP_NONE 0xFF
+
+typedef struct _copyprop_state_t {
+    live_info *live;
+    uint8_t *mode;          // source of the copy each variable holds,
+    int32_t *value;         // _COPYPROP_NONE if it holds none
+    uint32_t *active;       // variables holding a copy
+    uint32_t active_count;
+} _copyprop_state;
+
+// x is written, copies into it and copies of it are gone
+void _copyprop_kill(_copyprop_state *state, uint32_t n, int id) {
+    uint32_t a, x;
+    state->mode[n] = _COPYPROP_NONE;
+    for (a = 0; a < state->active_count; a++) {
+        x = state->active[a];
+        if (state->mode[x] != _COPYPROP_NONE && state->mode[x] != IR_MODE_I && state->value[x] == id)
+            state->mode[x] = _COPYPROP_NONE;
+        if (state->mode[x] == _COPYPROP_NONE)
+            state->active[a--] = state->active[--state->active_count];
+    }
+}
+
+void _copyprop_block(_copyprop_state *state, cfg_block *block) {
+    ir_function *func = state->live->func;
+    ir_inst *inst;
+    uint32_t i, n, s;
+    int k, reads;
+
+    for (i = block->first; i < block->last; i++) {
+        inst = &func->insts[i];
+        reads = ir_inst_reads(inst);
+        for (k = 0; k < 3; k++) {
+            if (!(reads & (1 << k)))
+                continue;
+            n = live_var(state->live, inst, k);
+            if (n == LIVE_NONE || state->mode[n] == _COPYPROP_NONE)
+                continue;
+            // a pointer is never a constant
+            if (IR_INST_OP(inst, k) != IR_MODE_NORMAL && state->mode[n] == IR_MODE_I)
+                continue;
+            inst->mode[k] = state->mode[n] | IR_INST_OP(inst, k);
+            inst->operand[k] = state->value[n];
+        }
+        if (!ir_inst_writes(inst) || IR_INST_OP(inst, 0) != IR_MODE_NORMAL)
+            continue;
+        n = live_var(state->live, inst, 0);
+        if (n == LIVE_NONE)
+            continue;
+        _copyprop_kill(state, n, inst->operand[0]);
+        if (inst->op != IR_EXP_OP_ASSIGN || IR_INST_OP(inst, 1) != IR_MODE_NORMAL)
+            continue;
+        if (IR_INST_MODE(inst, 1) != IR_MODE_I) {
+            s = live_var(state->live, inst, 1);
+            if (s == LIVE_NONE || s == n)
+                continue;
+        }
+        state->mode[n] = IR_INST_MODE(inst, 1);
+        state->value[n] = inst->operand[1];
+        state->active[state->active_count++] = n;
+    }
+    while (state->active_count > 0)
+        state->mode[state->active[--state->active_count]] = _COPYPROP_NONE;
+}
+
+void copyprop_run(ir_function *func) {
+    _copyprop_state state;
+    cfg *graph;
+    uint32_t b, n;
+
+    state.live = live_compute(func);
+    graph = state.live->graph;
+    state.mode = malloc(state.live->var_count + 1);
+    state.value = malloc(sizeof(int32_t) * (state.live->var_count + 1));
+    state.active = malloc(sizeof(uint32_t) * (state.live->var_count + 1));
+    state.active_count = 0;
+    for (n = 0; n < state.live->var_count; n++)
+        state.mode[n] = _COPYPROP_NONE;
+    for (b = 0; b < graph->block_count; b++)
+        _copyprop_block(&state, &graph->blocks[b]);
+    free(state.mode);
+    free(state.value);
+    free(state.active);
+    live_destroy(state.live);
+}
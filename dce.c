@@ -0,0 +1,80 @@
+/*
+    C-- Compiler Back End
+    Copyright (C) 2019 NSKernel. All rights reserved.
+
+    A lab of Compilers at Nanjing University
+
+    dce.c
+    Dead code and dead store elimination
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include <ir.h>
+#include <cfg.h>
+#include <live.h>
+#include <opt.h>
+
+// an expression that writes a variable nobody reads afterwards is
+// dropped, and so is a store to a variable that is never read again.
+// calls, READ, WRITE and stores through a pointer stay whatever
+// happens to their result
+
+int _dce_removable(live_info *live, ir_inst *inst, uint32_t *set) {
+    uint32_t n;
+    if (inst->op < IR_EXP_OP_ADD || inst->op > IR_EXP_OP_ASSIGN || IR_INST_OP(inst, 0) != IR_MODE_NORMAL)
+        return 0;
+    n = live_var(live, inst, 0);
+    return n != LIVE_NONE && !LIVE_TEST(set, n);
+}
+
+// one backward sweep, 1 if anything went
+int _dce_sweep(ir_function *func, char *dead) {
+    live_info *live = live_compute(func);
+    cfg *graph = live->graph;
+    uint32_t *set = malloc(sizeof(uint32_t) * (live->words + 1));
+    uint32_t b, i;
+    int removed = 0;
+
+    for (b = 0; b < graph->block_count; b++) {
+        memcpy(set, &live->live_out[b * live->words], sizeof(uint32_t) * live->words);
+        for (i = graph->blocks[b].last; i > graph->blocks[b].first; i--) {
+            if (_dce_removable(live, &func->insts[i - 1], set)) {
+                dead[i - 1] = 1;
+                removed = 1;
+                continue;
+            }
+            live_step(live, &func->insts[i - 1], set);
+        }
+    }
+    free(set);
+    live_destroy(live);
+    return removed;
+}
+
+void dce_run(ir_function *func) {
+    char *dead;
+    uint32_t from, to;
+
+    // a dead value may be all that kept another one alive in some
+    // other block, so sweep until nothing changes
+    while (func->count > 0) {
+        dead = calloc(func->count, 1);
+        if (!_dce_sweep(func, dead)) {
+            free(dead);
+            break;
+        }
+        for (from = 0, to = 0; from < func->count; from++) {
+            if (dead[from])
+                continue;
+            if (to != from)
+                func->insts[to] = func->insts[from];
+            to++;
+        }
+        func->count = to;
+        cfg_invalidate(func);
+        free(dead);
+    }
+}
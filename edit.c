@@ -0,0 +1,153 @@
+/*
+    C-- Compiler Back End
+    Copyright (C) 2019 NSKernel. All rights reserved.
+
+    A lab of Compilers at Nanjing University
+
+    edit.c
+    Batched insertions and removals on the instructions of a function
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include <ir.h>
+#include <cfg.h>
+#include <edit.h>
+#include <arena.h>
+#include <context.h>
+
+edit *edit_begin(ir_function *func, cfg *graph) {
+    edit *e = malloc(sizeof(edit));
+    uint32_t i;
+    e->func = func;
+    e->graph = graph;
+    e->removed = calloc(func->count, 1);
+    e->added_capacity = 16;
+    e->added_count = 0;
+    e->added = malloc(sizeof(ir_inst) * e->added_capacity);
+    e->next = malloc(sizeof(uint32_t) * e->added_capacity);
+    e->preheader = malloc(sizeof(uint32_t) * 2 * graph->block_count);
+    e->after = malloc(sizeof(uint32_t) * 2 * func->count);
+    for (i = 0; i < 2 * graph->block_count; i++)
+        e->preheader[i] = CFG_NONE;
+    for (i = 0; i < 2 * func->count; i++)
+        e->after[i] = CFG_NONE;
+    return e;
+}
+
+// a preheader goes between the label of the header and what comes
+// before it
+int edit_can_preheader(edit *e, uint32_t header) {
+    uint32_t first = e->graph->blocks[header].first;
+    return first != 0 && first < e->graph->blocks[header].last && e->func->insts[first].op == IR_OP_LABEL;
+}
+
+ir_inst *_edit_append(edit *e, uint32_t *chain) {
+    ir_inst *inst;
+    if (e->added_count == e->added_capacity) {
+        e->added_capacity *= 2;
+        e->added = realloc(e->added, sizeof(ir_inst) * e->added_capacity);
+        e->next = realloc(e->next, sizeof(uint32_t) * e->added_capacity);
+    }
+    e->next[e->added_count] = CFG_NONE;
+    if (chain[0] == CFG_NONE)
+        chain[0] = e->added_count;
+    else
+        e->next[chain[1]] = e->added_count;
+    chain[1] = e->added_count;
+    inst = &e->added[e->added_count++];
+    memset(inst, 0, sizeof(ir_inst));
+    return inst;
+}
+
+// a new instruction in the preheader of the loop headed by header,
+// after those already put there. the header must pass edit_can_preheader
+ir_inst *edit_preheader(edit *e, uint32_t header) {
+    return _edit_append(e, &e->preheader[2 * header]);
+}
+
+// a new instruction right after insts[i], even if that one is removed
+ir_inst *edit_after(edit *e, uint32_t i) {
+    return _edit_append(e, &e->after[2 * i]);
+}
+
+void edit_remove(edit *e, uint32_t i) {
+    e->removed[i] = 1;
+}
+
+void _edit_emit(ir_inst *insts, uint32_t *count, uint8_t op, int label) {
+    ir_inst *inst = &insts[(*count)++];
+    memset(inst, 0, sizeof(ir_inst));
+    inst->op = op;
+    inst->operand[0] = label;
+}
+
+void _edit_chain(edit *e, ir_inst *insts, uint32_t *count, uint32_t a) {
+    for (; a != CFG_NONE; a = e->next[a])
+        insts[(*count)++] = e->added[a];
+}
+
+// the preheader of a loop is reached by jumps from outside the loop
+// only, retargeted to a label of its own. a block of the loop falling
+// into the header jumps over it. 1 if anything changed, e is freed
+int edit_commit(edit *e) {
+    ir_function *func = e->func;
+    cfg *graph = e->graph;
+    ir_inst *insts, *last;
+    uint32_t count = 0, capacity, b, p, i;
+    int *label = malloc(sizeof(int) * graph->block_count);
+    int changed = e->added_count > 0;
+
+    for (i = 0; i < func->count && !changed; i++)
+        changed = e->removed[i];
+    for (b = 0; b < graph->exit && changed; b++) {
+        label[b] = -1;
+        if (e->preheader[2 * b] == CFG_NONE)
+            continue;
+        for (p = 0; p < graph->blocks[b].pred_count; p++) {
+            if (cfg_dominates(graph, b, graph->blocks[b].pred[p]))
+                continue;
+            last = &func->insts[graph->blocks[graph->blocks[b].pred[p]].last - 1];
+            if ((last->op == IR_OP_GOTO || last->op == IR_OP_IF || last->op == IR_OP_IF_POSITIVE
+                || last->op == IR_OP_IF_IMME) && last->operand[0] == func->insts[graph->blocks[b].first].operand[0]) {
+                if (label[b] < 0)
+                    label[b] = ir_new_label();
+                last->operand[0] = label[b];
+            }
+        }
+    }
+
+    if (changed) {
+        capacity = func->count + e->added_count + 2 * graph->block_count;
+        insts = arena_alloc(&cmmc_ctx->ir_arena, sizeof(ir_inst) * capacity);
+        for (b = 0; b < graph->exit; b++) {
+            if (e->preheader[2 * b] != CFG_NONE) {
+                last = count > 0 ? &insts[count - 1] : NULL;
+                if (last != NULL && last->op != IR_OP_GOTO && last->op != IR_OP_RETURN && cfg_dominates(graph, b, b - 1))
+                    _edit_emit(insts, &count, IR_OP_GOTO, func->insts[graph->blocks[b].first].operand[0]);
+                if (label[b] >= 0)
+                    _edit_emit(insts, &count, IR_OP_LABEL, label[b]);
+                _edit_chain(e, insts, &count, e->preheader[2 * b]);
+            }
+            for (i = graph->blocks[b].first; i < graph->blocks[b].last; i++) {
+                if (!e->removed[i])
+                    insts[count++] = func->insts[i];
+                _edit_chain(e, insts, &count, e->after[2 * i]);
+            }
+        }
+        func->insts = insts;
+        func->capacity = capacity;
+        func->count = count;
+        cfg_invalidate(func);
+    }
+    free(label);
+    free(e->removed);
+    free(e->added);
+    free(e->next);
+    free(e->preheader);
+    free(e->after);
+    free(e);
+    return changed;
+}
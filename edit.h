@@ -0,0 +1,45 @@
+/*
+    C-- Compiler Back End
+    Copyright (C) 2019 NSKernel. All rights reserved.
+
+    A lab of Compilers at Nanjing University
+
+    edit.h
+    Batched insertions and removals on the instructions of a function
+*/
+
+#include <stdint.h>
+
+#include <ir.h>
+#include <cfg.h>
+
+#ifndef EDIT_H
+#define EDIT_H
+
+typedef struct edit_t edit;
+
+// changes are recorded against the instruction indices of the graph
+// they were planned on and all applied at once by edit_commit. added
+// instructions are chained through next, head and tail of each chain
+// kept per block for preheaders and per instruction for the rest. an
+// added instruction is only good until the next one is added
+struct edit_t {
+    ir_function *func;
+    cfg *graph;
+    char *removed;
+    ir_inst *added;
+    uint32_t *next;
+    uint32_t added_count;
+    uint32_t added_capacity;
+    uint32_t *preheader;    // [2 * b] and [2 * b + 1] for header b
+    uint32_t *after;        // [2 * i] and [2 * i + 1] for insts[i]
+};
+
+edit *edit_begin(ir_function *func, cfg *graph);
+int edit_can_preheader(edit *e, uint32_t header);
+ir_inst *edit_preheader(edit *e, uint32_t header);
+ir_inst *edit_after(edit *e, uint32_t i);
+void edit_remove(edit *e, uint32_t i);
+int edit_commit(edit *e);
+
+#endif
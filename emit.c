@@ -0,0 +1,105 @@
+/*
+    C-- Compiler Back End
+    Copyright (C) 2019 NSKernel. All rights reserved.
+
+    A lab of Compilers at Nanjing University
+
+    emit.c
+    Buffered output of the generated code
+*/
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <global.h>
+#include <emit.h>
+#include <context.h>
+
+void emit_flush() {
+    size_t done = 0;
+    ssize_t ret;
+    if (cmmc_ctx->emit_used > 0)
+        cmmc_ctx->report.emit_writes++;
+    cmmc_ctx->report.emit_bytes += cmmc_ctx->emit_used;
+    while (done < cmmc_ctx->emit_used) {
+        ret = write(fileno(cmmc_ctx->output_file), cmmc_ctx->emit_buffer + done, cmmc_ctx->emit_used - done);
+        if (ret <= 0) {
+            fprintf(cmmc_ctx->diag_file, "cmmc: \033[0;31merror\033[0m: cannot write file %s\n", cmmc_ctx->args.output_file);
+            break;
+        }
+        done += ret;
+    }
+    cmmc_ctx->emit_used = 0;
+}
+
+void emit_char(char c) {
+    if (cmmc_ctx->emit_used == EMIT_BUFFER_SIZE)
+        emit_flush();
+    cmmc_ctx->emit_buffer[cmmc_ctx->emit_used++] = c;
+}
+
+void _emit_bytes(const char *str, size_t len) {
+    size_t room;
+    while (len > 0) {
+        if (cmmc_ctx->emit_used == EMIT_BUFFER_SIZE)
+            emit_flush();
+        room = EMIT_BUFFER_SIZE - cmmc_ctx->emit_used;
+        if (room > len)
+            room = len;
+        memcpy(cmmc_ctx->emit_buffer + cmmc_ctx->emit_used, str, room);
+        cmmc_ctx->emit_used += room;
+        str += room;
+        len -= room;
+    }
+}
+
+void emit_str(const char *str) {
+    _emit_bytes(str, strlen(str));
+}
+
+void emit_int(int num) {
+    char digits[12];
+    int i = sizeof(digits);
+    // work on the unsigned value so that INT_MIN survives
+    unsigned int value = num < 0 ? -(unsigned int)num : (unsigned int)num;
+    if (cmmc_ctx->emit_used + sizeof(digits) > EMIT_BUFFER_SIZE)
+        emit_flush();
+    do {
+        digits[--i] = '0' + value % 10;
+        value /= 10;
+    } while (value);
+    if (num < 0)
+        digits[--i] = '-';
+    memcpy(cmmc_ctx->emit_buffer + cmmc_ctx->emit_used, digits + i, sizeof(digits) - i);
+    cmmc_ctx->emit_used += sizeof(digits) - i;
+}
+
+void emit_fmt(const char *fmt, ...) {
+    va_list args;
+    const char *start;
+    va_start(args, fmt);
+    while (*fmt) {
+        // copy the literal run in one go
+        start = fmt;
+        while (*fmt && *fmt != '%')
+            fmt++;
+        _emit_bytes(start, fmt - start);
+        if (*fmt == '\0' || fmt[1] == '\0')
+            break;
+        switch (fmt[1]) {
+            case 's':
+                emit_str(va_arg(args, const char *));
+                break;
+            case 'd':
+                emit_int(va_arg(args, int));
+                break;
+            default:
+                emit_char(fmt[1]);
+                break;
+        }
+        fmt += 2;
+    }
+    va_end(args);
+}
@@ -0,0 +1,28 @@
+/*
+    C-- Compiler Back End
+    Copyright (C) 2019 NSKernel. All rights reserved.
+
+    A lab of Compilers at Nanjing University
+
+    emit.h
+    Buffered output of the generated code
+*/
+
+#include <stdint.h>
+
+#ifndef EMIT_H
+#define EMIT_H
+
+#define EMIT_BUFFER_SIZE  0x10000
+
+// everything written to output_file goes through here. text is kept
+// in one buffer and handed to write(2) when it fills up or on
+// emit_flush, which has to be called before output_file is closed
+void emit_char(char c);
+void emit_str(const char *str);
+void emit_int(int num);
+// only understands %s and %d
+void emit_fmt(const char *fmt, ...);
+void emit_flush();
+
+#endif
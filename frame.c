@@ -0,0 +1,101 @@
+/*
+    C-- Compiler Back End
+    Copyright (C) 2019 NSKernel. All rights reserved.
+
+    A lab of Compilers at Nanjing University
+
+    frame.c
+    Compaction of the stack frame of a function
+*/
+
+#include <stdlib.h>
+#include <stdint.h>
+
+#include <ir.h>
+#include <opt.h>
+
+// ids are handed out by bumping the frame size, so an id is the end
+// of what it names and the id before it is where it starts. slots that
+// nothing refers to any more leave holes, squeezing them out keeps
+// everything else in order. ids below 1 are stack args of the caller
+
+int _frame_compare(const void *a, const void *b) {
+    int x = *(const int *)a, y = *(const int *)b;
+    return x < y ? -1 : x > y;
+}
+
+int _frame_find(int *ids, uint32_t count, int id) {
+    uint32_t low = 0, high = count, mid;
+    while (low < high) {
+        mid = (low + high) >> 1;
+        if (ids[mid] < id)
+            low = mid + 1;
+        else
+            high = mid;
+    }
+    return low;
+}
+
+void frame_compact(ir_function *func) {
+    ir_inst *inst, *dec = NULL;
+    int *ids = malloc(sizeof(int) * (func->count * 3 + 1));
+    int *new_id;
+    char *memory;
+    uint32_t count = 0, i, j, k;
+    int mask, prev, offset;
+
+    for (i = 0; i < func->count; i++) {
+        inst = &func->insts[i];
+        if (inst->op == IR_OP_DEC)
+            dec = inst;
+        mask = ir_inst_reads(inst) | ir_inst_writes(inst);
+        for (k = 0; k < 3; k++) {
+            if ((mask & (1 << k)) && (IR_INST_MODE(inst, k) == IR_MODE_T || IR_INST_MODE(inst, k) == IR_MODE_V)
+                && inst->operand[k] > 0)
+                ids[count++] = inst->operand[k];
+        }
+    }
+    if (dec == NULL || count == 0) {
+        free(ids);
+        return;
+    }
+    qsort(ids, count, sizeof(int), _frame_compare);
+    for (i = 1, j = 1; i < count; i++) {
+        if (ids[i] != ids[j - 1])
+            ids[j++] = ids[i];
+    }
+    count = j;
+
+    // a slot whose address is taken may be the last word of an array
+    // or a struct, it keeps all the room up to the id before it
+    memory = calloc(count, 1);
+    for (i = 0; i < func->count; i++) {
+        inst = &func->insts[i];
+        mask = ir_inst_reads(inst);
+        for (k = 0; k < 3; k++) {
+            if ((mask & (1 << k)) && IR_INST_OP(inst, k) == IR_MODE_ADDR && inst->operand[k] > 0)
+                memory[_frame_find(ids, count, inst->operand[k])] = 1;
+        }
+    }
+    new_id = malloc(sizeof(int) * count);
+    for (i = 0, prev = 0, offset = 0; i < count; i++) {
+        offset += (memory[i] || (ids[i] & 3)) ? ids[i] - prev : 4;
+        new_id[i] = offset;
+        prev = ids[i];
+    }
+
+    for (i = 0; i < func->count; i++) {
+        inst = &func->insts[i];
+        mask = ir_inst_reads(inst) | ir_inst_writes(inst);
+        for (k = 0; k < 3; k++) {
+            if ((mask & (1 << k)) && (IR_INST_MODE(inst, k) == IR_MODE_T || IR_INST_MODE(inst, k) == IR_MODE_V)
+                && inst->operand[k] > 0)
+                inst->operand[k] = new_id[_frame_find(ids, count, inst->operand[k])];
+        }
+    }
+    if (offset < dec->operand[1])
+        dec->operand[1] = offset;
+    free(ids);
+    free(memory);
+    free(new_id);
+}
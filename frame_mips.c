@@ -0,0 +1,183 @@
+/*
+    C-- Compiler Back End
+    Copyright (C) 2019 NSKernel. All rights reserved.
+
+    A lab of Compilers at Nanjing University
+
+    frame_mips.c
+    Stack slot coloring for the MIPS back end
+*/
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <global.h>
+#include <ir.h>
+#include <cfg.h>
+#include <live.h>
+#include <backend.h>
+
+// every id had a slot of its own for the whole function. the ones the
+// register allocator put in a register need none, and the rest share
+// slots when they are never live at once, a slot being a color. what
+// has its address taken, arrays and structs among them, is always
+// live and keeps all its room in one piece right below $fp, then come
+// the colors. ids below 1 are stack args of the caller
+//
+// two variables interfere when one is written while the other is
+// live, but the source of a copy holds the same value, as in coalesce.c
+
+#define _CG_MIPS_FRAME_MAX_VARS 8192
+
+// a definition interferes with everything live after it
+static void _cg_mips_frame_build(live_info *live, const char *needs, uint32_t *row) {
+    ir_function *func = live->func;
+    cfg *graph = live->graph;
+    ir_inst *inst;
+    uint32_t *set = malloc(sizeof(uint32_t) * (live->words + 1));
+    uint32_t b, i, w, d, s, x;
+
+    for (b = 0; b < graph->block_count; b++) {
+        memcpy(set, &live->live_out[b * live->words], sizeof(uint32_t) * live->words);
+        for (i = graph->blocks[b].last; i > graph->blocks[b].first; i--) {
+            inst = &func->insts[i - 1];
+            if (ir_inst_writes(inst) && IR_INST_OP(inst, 0) == IR_MODE_NORMAL
+                && (d = live_var(live, inst, 0)) != LIVE_NONE && needs[d]) {
+                s = LIVE_NONE;
+                if (inst->op == IR_EXP_OP_ASSIGN && IR_INST_OP(inst, 1) == IR_MODE_NORMAL)
+                    s = live_var(live, inst, 1);
+                for (w = 0; w < live->words; w++) {
+                    for (x = w << 5; set[w] && x < (w + 1) << 5; x++) {
+                        if (LIVE_TEST(set, x) && x != d && x != s && needs[x]) {
+                            LIVE_SET(&row[d * live->words], x);
+                            LIVE_SET(&row[x * live->words], d);
+                        }
+                    }
+                }
+            }
+            live_step(live, inst, set);
+        }
+    }
+    free(set);
+}
+
+cg_mips_frame *cg_mips_frame_function(ir_function *func, cg_mips_regalloc *alloc) {
+    cg_mips_frame *frame;
+    live_info *live;
+    ir_inst *inst, *dec = NULL;
+    uint32_t *row;
+    int *color;
+    char *needs, *used, *taken;
+    int min_id = 0, max_id = 0, mask, prev, offset, colors = 0, id;
+    uint32_t i, n, x, w, slot, slot_count;
+    int k;
+
+    for (i = 0; i < func->count; i++) {
+        inst = &func->insts[i];
+        if (inst->op == IR_OP_DEC)
+            dec = inst;
+        mask = ir_inst_reads(inst) | ir_inst_writes(inst);
+        for (k = 0; k < 3; k++) {
+            if (!(mask & (1 << k)) || (IR_INST_MODE(inst, k) != IR_MODE_T && IR_INST_MODE(inst, k) != IR_MODE_V)
+                || inst->operand[k] <= 0)
+                continue;
+            // room is counted in words
+            if (inst->operand[k] & 3)
+                return NULL;
+            if (max_id == 0 || inst->operand[k] < min_id)
+                min_id = inst->operand[k];
+            if (inst->operand[k] > max_id)
+                max_id = inst->operand[k];
+        }
+    }
+    if (dec == NULL || max_id == 0)
+        return NULL;
+    live = live_compute(func);
+    if (live->var_count > _CG_MIPS_FRAME_MAX_VARS) {
+        live_destroy(live);
+        return NULL;
+    }
+
+    slot_count = ((max_id - min_id) >> 2) + 1;
+    used = calloc(slot_count, 1);
+    for (i = 0; i < func->count; i++) {
+        inst = &func->insts[i];
+        mask = ir_inst_reads(inst) | ir_inst_writes(inst);
+        for (k = 0; k < 3; k++) {
+            if ((mask & (1 << k)) && (IR_INST_MODE(inst, k) == IR_MODE_T || IR_INST_MODE(inst, k) == IR_MODE_V)
+                && inst->operand[k] > 0)
+                used[(inst->operand[k] - min_id) >> 2] = 1;
+        }
+    }
+    needs = calloc(live->var_count + 1, 1);
+    for (n = 0; n < live->var_count; n++)
+        needs[n] = live->var_id[n] > 0 && !cg_mips_regalloc_query(alloc, live->var_id[n]);
+    row = calloc((size_t)live->var_count * live->words + 1, sizeof(uint32_t));
+    _cg_mips_frame_build(live, needs, row);
+
+    // lowest color none of the neighbours colored so far has
+    color = malloc(sizeof(int) * (live->var_count + 1));
+    taken = calloc(live->var_count + 1, 1);
+    for (n = 0; n < live->var_count; n++)
+        color[n] = -1;
+    for (n = 0; n < live->var_count; n++) {
+        if (!needs[n])
+            continue;
+        for (w = 0; w < live->words; w++) {
+            for (x = w << 5; row[n * live->words + w] && x < (w + 1) << 5; x++) {
+                if (LIVE_TEST(&row[n * live->words], x) && color[x] >= 0)
+                    taken[color[x]] = 1;
+            }
+        }
+        for (color[n] = 0; taken[color[n]]; color[n]++)
+            ;
+        if (color[n] + 1 > colors)
+            colors = color[n] + 1;
+        memset(taken, 0, colors);
+    }
+
+    frame = malloc(sizeof(cg_mips_frame));
+    frame->min_id = min_id;
+    frame->max_id = max_id;
+    frame->home = calloc(slot_count, sizeof(int));
+    frame->size_before = dec->operand[1];
+    // an id is the end of what it names, memory keeps all the room
+    // up to the id before it
+    for (slot = 0, prev = 0, offset = 0; slot < slot_count; slot++) {
+        if (!used[slot])
+            continue;
+        id = min_id + (int)(slot << 2);
+        if (live->var_of[(id - live->min_id) >> 2] == LIVE_NONE) {
+            offset += id - prev;
+            frame->home[slot] = offset;
+        }
+        prev = id;
+    }
+    for (n = 0; n < live->var_count; n++) {
+        // a register needs no slot, its home is never looked at
+        if (color[n] >= 0)
+            frame->home[(live->var_id[n] - min_id) >> 2] = offset + 4 * (color[n] + 1);
+    }
+    frame->size = offset + 4 * colors;
+    if (frame->size > frame->size_before) {
+        // ids were not compacted, leave them be
+        cg_mips_frame_free(frame);
+        frame = NULL;
+    }
+
+    free(used);
+    free(needs);
+    free(row);
+    free(color);
+    free(taken);
+    live_destroy(live);
+    return frame;
+}
+
+void cg_mips_frame_free(cg_mips_frame *frame) {
+    if (frame == NULL)
+        return;
+    free(frame->home);
+    free(frame);
+}
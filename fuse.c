@@ -0,0 +1,160 @@
+/*
+    C-- Compiler Back End
+    Copyright (C) 2019 NSKernel. All rights reserved.
+
+    A lab of Compilers at Nanjing University
+
+    fuse.c
+    Fuses conditions into the branches testing them
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include <ir.h>
+#include <cfg.h>
+#include <live.h>
+#include <arena.h>
+#include <opt.h>
+#include <context.h>
+
+// a condition computed right before the IF or IF_POSITIVE ending its
+// block, and read by nothing after it, need not be a value at all:
+//
+//   t := a < b ; IF t GOTO L        IF a >= b GOTO L
+//   t := !x ; IF t GOTO L           IF_POSITIVE x GOTO L
+//   t := a && b ; IF t GOTO L       IF a GOTO L ; IF b GOTO L
+//   t := a || b ; IF t GOTO L       IF_POSITIVE a GOTO S ; IF b GOTO L ; LABEL S
+//
+// with IF_POSITIVE the other way around. a NOT leaves an IF behind that
+// may take in what comes before it in turn. an AND or OR is kept in the
+// IF with a in slot 1 and b in slot 2 until the instructions are laid
+// out again. a and b are values already, both are there to be tested
+
+uint8_t _fuse_invert(uint8_t op) {
+    switch (op) {
+        case IR_EXP_OP_GT:
+            return IR_EXP_OP_LE;
+        case IR_EXP_OP_GE:
+            return IR_EXP_OP_LT;
+        case IR_EXP_OP_LT:
+            return IR_EXP_OP_GE;
+        case IR_EXP_OP_LE:
+            return IR_EXP_OP_GT;
+        case IR_EXP_OP_EQ:
+            return IR_EXP_OP_NEQ;
+        case IR_EXP_OP_NEQ:
+            return IR_EXP_OP_EQ;
+    }
+    return op;
+}
+
+// 1 if the instruction at d went into the IF at p
+int _fuse_one(live_info *live, uint32_t b, uint32_t p, uint32_t d, uint8_t *split) {
+    ir_inst *branch = &live->func->insts[p], *def = &live->func->insts[d];
+    uint32_t n = live_var(live, branch, 1);
+
+    if (n == LIVE_NONE || LIVE_TEST(&live->live_out[b * live->words], n))
+        return 0;
+    if (def->op < IR_EXP_OP_GT || def->op > IR_EXP_OP_AND || IR_INST_OP(def, 0) != IR_MODE_NORMAL
+        || def->mode[0] != branch->mode[1] || def->operand[0] != branch->operand[1])
+        return 0;
+    if (def->op == IR_EXP_OP_NOT) {
+        branch->op = branch->op == IR_OP_IF ? IR_OP_IF_POSITIVE : IR_OP_IF;
+        branch->mode[1] = def->mode[1];
+        branch->operand[1] = def->operand[1];
+        return 1;
+    }
+    if (def->op == IR_EXP_OP_AND || def->op == IR_EXP_OP_OR) {
+        split[p] = def->op;
+        branch->mode[1] = def->mode[1];
+        branch->operand[1] = def->operand[1];
+        branch->mode[2] = def->mode[2];
+        branch->operand[2] = def->operand[2];
+        return 1;
+    }
+    branch->mode[0] = branch->op == IR_OP_IF ? _fuse_invert(def->op) : def->op;
+    branch->op = IR_OP_IF_IMME;
+    branch->mode[1] = def->mode[1];
+    branch->operand[1] = def->operand[1];
+    branch->mode[2] = def->mode[2];
+    branch->operand[2] = def->operand[2];
+    return 1;
+}
+
+ir_inst *_fuse_add(ir_inst *insts, uint32_t *count, uint8_t op, int label, uint8_t mode, int operand) {
+    ir_inst *inst = &insts[(*count)++];
+    memset(inst, 0, sizeof(ir_inst));
+    inst->op = op;
+    inst->operand[0] = label;
+    inst->mode[1] = mode;
+    inst->operand[1] = operand;
+    return inst;
+}
+
+void fuse_run(ir_function *func) {
+    live_info *live;
+    cfg *graph;
+    ir_inst *insts, *inst;
+    char *dead;
+    uint8_t *split;
+    uint32_t b, p, d, i, count = 0, capacity, fused = 0;
+    int skip;
+
+    if (func->count == 0)
+        return;
+    live = live_compute(func);
+    graph = live->graph;
+    dead = calloc(func->count, 1);
+    split = calloc(func->count, 1);
+    capacity = func->count;
+    for (b = 0; b < graph->block_count; b++) {
+        p = graph->blocks[b].last - 1;
+        if (graph->blocks[b].last - graph->blocks[b].first < 2
+            || (func->insts[p].op != IR_OP_IF && func->insts[p].op != IR_OP_IF_POSITIVE))
+            continue;
+        for (d = p; d-- > graph->blocks[b].first && !split[p] && func->insts[p].op != IR_OP_IF_IMME; ) {
+            if (!_fuse_one(live, b, p, d, split))
+                break;
+            dead[d] = 1;
+            fused++;
+            if (split[p])
+                capacity += 2;
+        }
+    }
+    live_destroy(live);
+    if (fused == 0) {
+        free(dead);
+        free(split);
+        return;
+    }
+
+    insts = arena_alloc(&cmmc_ctx->ir_arena, sizeof(ir_inst) * capacity);
+    for (i = 0; i < func->count; i++) {
+        inst = &func->insts[i];
+        if (dead[i])
+            continue;
+        if (!split[i]) {
+            insts[count++] = *inst;
+            continue;
+        }
+        // an IF of an AND and an IF_POSITIVE of an OR jump on either
+        // one alone, the other two need both and skip over the second
+        if ((split[i] == IR_EXP_OP_AND) == (inst->op == IR_OP_IF)) {
+            _fuse_add(insts, &count, inst->op, inst->operand[0], inst->mode[1], inst->operand[1]);
+            _fuse_add(insts, &count, inst->op, inst->operand[0], inst->mode[2], inst->operand[2]);
+            continue;
+        }
+        skip = ir_new_label();
+        _fuse_add(insts, &count, inst->op == IR_OP_IF ? IR_OP_IF_POSITIVE : IR_OP_IF, skip, inst->mode[1], inst->operand[1]);
+        _fuse_add(insts, &count, inst->op, inst->operand[0], inst->mode[2], inst->operand[2]);
+        _fuse_add(insts, &count, IR_OP_LABEL, skip, 0, 0);
+    }
+    func->insts = insts;
+    func->count = count;
+    func->capacity = capacity;
+    cfg_invalidate(func);
+    free(dead);
+    free(split);
+}
@@ -6,10 +6,16 @@
 struct global_args_t {
     char print_version;          /* -V or --version */
     char verbose;                /* -v or --verbose */
+    char no_regalloc;            /* -fno-regalloc */
+    char no_peephole;            /* -fno-peephole */
+    char time_report;            /* -ftime-report[=json] */
+    char mem_report;             /* -fmem-report[=json] */
+    char opt_level;              /* -O0, -O1 */
+    int inline_limit;            /* -finline-limit=N, 0 for -fno-inline */
+    int jobs;                    /* -j N */
+    char *output_dir;            /* -o dir, compile every input into it */
     char *input_file;
     char *output_file;
-} global_args;
+};
 
-FILE *output_file;
-
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,245 @@
+/*
+    C-- Compiler Back End
+    Copyright (C) 2019 NSKernel. All rights reserved.
+
+    A lab of Compilers at Nanjing University
+
+    gvn.c
+    Dominator based global value numbering
+*/
+
+#include <stdlib.h>
+#include <stdint.h>
+
+#include <ssa.h>
+#include <opt.h>
+#include <cfg.h>
+#include <ir.h>
+
+// a computation whose operands are the same values as one in a
+// dominating block gives the same value. the table is scoped: walking
+// down the dominator tree adds entries, coming back up drops them
+
+typedef struct _gvn_entry_t {
+    uint8_t op;
+    uint8_t mode[2];
+    int32_t operand[2];
+    uint32_t value;
+    uint32_t next;
+} _gvn_entry;
+
+typedef struct _gvn_table_t {
+    uint32_t *bucket;
+    uint32_t mask;
+    _gvn_entry *entries;    // a stack, the newest entry is first in its bucket
+    uint32_t count;
+} _gvn_table;
+
+uint32_t _gvn_hash(_gvn_entry *key, uint32_t mask) {
+    uint32_t h = key->op;
+    h = h * 31 + key->mode[0];
+    h = h * 31 + (uint32_t)key->operand[0];
+    h = h * 31 + key->mode[1];
+    h = h * 31 + (uint32_t)key->operand[1];
+    return (h ^ (h >> 13)) & mask;
+}
+
+int _gvn_operand_less(uint8_t mode1, int32_t operand1, uint8_t mode2, int32_t operand2) {
+    return mode1 != mode2 ? mode1 < mode2 : operand1 < operand2;
+}
+
+// the key of a computation, 0 if it reads memory or something that
+// is not a value
+int _gvn_key(ssa_form *form, ir_inst *inst, _gvn_entry *key) {
+    uint8_t mode, swap_mode;
+    int32_t swap;
+    int k, count = (ir_inst_reads(inst) & 0x4) ? 2 : 1;
+
+    key->op = inst->op;
+    key->mode[1] = IR_MODE_I;
+    key->operand[1] = 0;
+    for (k = 0; k < count; k++) {
+        mode = inst->mode[k + 1];
+        if (mode == IR_MODE_S) {
+            ssa_resolve(form, &mode, &inst->operand[k + 1]);
+            inst->mode[k + 1] = mode;
+        }
+        // an address in the frame never moves, the rest may change
+        // behind our back
+        if (mode != IR_MODE_S && mode != IR_MODE_I && IR_INST_OP(inst, k + 1) != IR_MODE_ADDR)
+            return 0;
+        key->mode[k] = inst->mode[k + 1];
+        key->operand[k] = inst->operand[k + 1];
+    }
+    switch (key->op) {
+        case IR_EXP_OP_GT:
+            key->op = IR_EXP_OP_LT;
+            break;
+        case IR_EXP_OP_GE:
+            key->op = IR_EXP_OP_LE;
+            break;
+        case IR_EXP_OP_ADD:
+        case IR_EXP_OP_MUL:
+        case IR_EXP_OP_EQ:
+        case IR_EXP_OP_NEQ:
+        case IR_EXP_OP_AND:
+        case IR_EXP_OP_OR:
+            if (!_gvn_operand_less(key->mode[1], key->operand[1], key->mode[0], key->operand[0]))
+                return 1;
+            break;
+        default:
+            return 1;
+    }
+    swap_mode = key->mode[0];
+    swap = key->operand[0];
+    key->mode[0] = key->mode[1];
+    key->operand[0] = key->operand[1];
+    key->mode[1] = swap_mode;
+    key->operand[1] = swap;
+    return 1;
+}
+
+uint32_t _gvn_lookup(_gvn_table *table, _gvn_entry *key) {
+    uint32_t e;
+    _gvn_entry *entry;
+    for (e = table->bucket[_gvn_hash(key, table->mask)]; e != CFG_NONE; e = entry->next) {
+        entry = &table->entries[e];
+        if (entry->op == key->op && entry->mode[0] == key->mode[0] && entry->operand[0] == key->operand[0]
+            && entry->mode[1] == key->mode[1] && entry->operand[1] == key->operand[1])
+            return entry->value;
+    }
+    return CFG_NONE;
+}
+
+void _gvn_insert(_gvn_table *table, _gvn_entry *key, uint32_t value) {
+    uint32_t h = _gvn_hash(key, table->mask);
+    _gvn_entry *entry = &table->entries[table->count];
+    *entry = *key;
+    entry->value = value;
+    entry->next = table->bucket[h];
+    table->bucket[h] = table->count++;
+}
+
+void _gvn_pop(_gvn_table *table, uint32_t count) {
+    _gvn_entry *entry;
+    while (table->count > count) {
+        entry = &table->entries[--table->count];
+        table->bucket[_gvn_hash(entry, table->mask)] = entry->next;
+    }
+}
+
+// a phi whose args on the edges that may be taken are all one value,
+// or itself, is that value. removing one may make others trivial
+void _gvn_trivial_phis(ssa_form *form) {
+    cfg *graph = form->graph;
+    ssa_phi *phi;
+    uint8_t mode, unique_mode;
+    int32_t arg, unique;
+    uint32_t p, j;
+    char changed = 1, trivial;
+
+    while (changed) {
+        changed = 0;
+        for (p = 0; p < form->phi_count; p++) {
+            phi = &form->phis[p];
+            if (phi->value == CFG_NONE || form->values[phi->value].replace_mode != SSA_KEEP || !form->block_live[phi->block])
+                continue;
+            trivial = 1;
+            unique_mode = SSA_KEEP;
+            unique = 0;
+            for (j = 0; j < graph->blocks[phi->block].pred_count && trivial; j++) {
+                if (!ssa_edge_live(form, graph->blocks[phi->block].pred[j], phi->block))
+                    continue;
+                mode = phi->arg_mode[j];
+                arg = phi->arg[j];
+                ssa_resolve(form, &mode, &arg);
+                if (mode == IR_MODE_S && (uint32_t)arg == phi->value)
+                    continue;
+                if (unique_mode == SSA_KEEP) {
+                    unique_mode = mode;
+                    unique = arg;
+                }
+                else if (unique_mode != mode || unique != arg) {
+                    trivial = 0;
+                }
+            }
+            if (trivial && unique_mode != SSA_KEEP) {
+                ssa_replace(form, phi->value, unique_mode, unique);
+                changed = 1;
+            }
+        }
+    }
+}
+
+void _gvn_visit_block(ssa_form *form, _gvn_table *table, uint32_t b) {
+    cfg_block *block = &form->graph->blocks[b];
+    ir_inst *inst;
+    _gvn_entry key;
+    uint32_t i, leader;
+
+    for (i = block->first; i < block->last; i++) {
+        inst = &form->func->insts[i];
+        if (inst->op == SSA_DELETED || inst->op < IR_EXP_OP_ADD || inst->op > IR_EXP_OP_ASSIGN
+            || inst->op == IR_EXP_OP_MACCESS || inst->mode[0] != IR_MODE_S)
+            continue;
+        if (!_gvn_key(form, inst, &key))
+            continue;
+        if (inst->op == IR_EXP_OP_ASSIGN && IR_INST_OP(inst, 1) == IR_MODE_NORMAL) {
+            // a copy is the value it copies
+            ssa_replace(form, inst->operand[0], inst->mode[1], inst->operand[1]);
+            continue;
+        }
+        leader = _gvn_lookup(table, &key);
+        if (leader != CFG_NONE)
+            ssa_replace(form, inst->operand[0], IR_MODE_S, leader);
+        else
+            _gvn_insert(table, &key, inst->operand[0]);
+    }
+}
+
+void gvn_run(ssa_form *form) {
+    cfg *graph = form->graph;
+    _gvn_table table;
+    uint32_t *stack = malloc(sizeof(uint32_t) * graph->block_count);
+    uint32_t *height = malloc(sizeof(uint32_t) * graph->block_count);
+    uint32_t size = 16, b, c;
+    int depth = 0;
+
+    _gvn_trivial_phis(form);
+    while (size < form->func->count * 2)
+        size *= 2;
+    table.mask = size - 1;
+    table.bucket = malloc(sizeof(uint32_t) * size);
+    for (b = 0; b < size; b++)
+        table.bucket[b] = CFG_NONE;
+    table.entries = malloc(sizeof(_gvn_entry) * (form->func->count + 1));
+    table.count = 0;
+
+    // blocks that can not run dominate nothing that can
+    stack[0] = 0;
+    height[0] = 0;
+    _gvn_visit_block(form, &table, 0);
+    stack[0] = graph->blocks[0].dom_child;
+    while (depth >= 0) {
+        c = stack[depth];
+        if (c == CFG_NONE) {
+            _gvn_pop(&table, height[depth]);
+            depth--;
+            continue;
+        }
+        stack[depth] = graph->blocks[c].dom_sibling;
+        if (!form->block_live[c])
+            continue;
+        depth++;
+        height[depth] = table.count;
+        _gvn_visit_block(form, &table, c);
+        stack[depth] = graph->blocks[c].dom_child;
+    }
+
+    _gvn_trivial_phis(form);
+    ssa_apply(form);
+    free(table.bucket);
+    free(table.entries);
+    free(stack);
+    free(height);
+}
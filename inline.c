@@ -0,0 +1,221 @@
+/*
+    C-- Compiler Back End
+    Copyright (C) 2019 NSKernel. All rights reserved.
+
+    A lab of Compilers at Nanjing University
+
+    inline.c
+    Inlining of small functions compiled earlier
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <limits.h>
+
+#include <ir.h>
+#include <cfg.h>
+#include <inline.h>
+#include <arena.h>
+#include <context.h>
+
+// functions are compiled one at a time in the order of the source, so
+// a call can only take in the body of a function defined before the
+// caller. that body had its own calls inlined and went through all the
+// passes already, which also makes the order a walk of the call graph
+// from the leaves up. a recursive cycle is never taken in more than
+// once around, the caller itself is not kept until it is done, and a
+// function calling itself is never kept at all.
+//
+// a call costs the ARGs and the CALL it replaces plus a frame set up
+// and torn down, the body costs its instructions. a body goes in where
+// it is at most the limit bigger than the ARGs and CALL, and a caller
+// grows by at most _INLINE_GROWTH limits in all
+
+#define _INLINE_GROWTH 8
+
+inline_body *_inline_find(const char *name) {
+    inline_body *body;
+    for (body = cmmc_ctx->inline_bodies; body != NULL; body = body->next) {
+        if (!strcmp(body->name, name))
+            return body;
+    }
+    return NULL;
+}
+
+int _inline_is_jump(ir_inst *inst) {
+    return inst->op == IR_OP_LABEL || inst->op == IR_OP_GOTO || inst->op == IR_OP_IF
+        || inst->op == IR_OP_IF_POSITIVE || inst->op == IR_OP_IF_IMME;
+}
+
+void inline_record(ir_function *func) {
+    arena *a = &cmmc_ctx->inline_arena;
+    inline_body *body;
+    ir_inst *inst;
+    uint32_t i, count = 0, param_count = 0;
+
+    if (cmmc_ctx->args.inline_limit <= 0)
+        return;
+    for (i = 0; i < func->count; i++) {
+        inst = &func->insts[i];
+        if (inst->op == IR_OP_CALL && !strcmp(func->names[inst->operand[1]], func->names[0]))
+            return;
+        if (inst->op == IR_OP_PARAM)
+            param_count++;
+        else if (inst->op != IR_OP_FUNC && inst->op != IR_OP_DEC)
+            count++;
+    }
+    if ((int)count - (int)param_count - 1 > cmmc_ctx->args.inline_limit)
+        return;
+
+    body = arena_alloc(a, sizeof(inline_body));
+    body->name = func->names[0];
+    body->insts = arena_alloc(a, sizeof(ir_inst) * (count + 1));
+    body->count = 0;
+    body->names = arena_alloc(a, sizeof(char *) * func->name_count);
+    memcpy(body->names, func->names, sizeof(char *) * func->name_count);
+    body->params = arena_alloc(a, sizeof(int) * (param_count + 1));
+    body->param_count = 0;
+    body->frame_size = 0;
+    body->label_min = INT_MAX;
+    body->label_max = INT_MIN;
+    for (i = 0; i < func->count; i++) {
+        inst = &func->insts[i];
+        if (inst->op == IR_OP_FUNC)
+            continue;
+        if (inst->op == IR_OP_PARAM) {
+            body->params[body->param_count++] = inst->operand[0];
+            continue;
+        }
+        if (inst->op == IR_OP_DEC) {
+            body->frame_size = inst->operand[1];
+            continue;
+        }
+        if (_inline_is_jump(inst)) {
+            if (inst->operand[0] < body->label_min)
+                body->label_min = inst->operand[0];
+            if (inst->operand[0] > body->label_max)
+                body->label_max = inst->operand[0];
+        }
+        body->insts[body->count++] = *inst;
+    }
+    body->next = cmmc_ctx->inline_bodies;
+    cmmc_ctx->inline_bodies = body;
+}
+
+// the body of the CALL at insts[c] in place of it and its ARGs
+void _inline_expand(ir_function *func, ir_inst *insts, uint32_t *count, uint32_t c, inline_body *body) {
+    ir_inst *call = &func->insts[c], *inst;
+    int *params = malloc(sizeof(int) * (body->param_count + 1));
+    int base, label_base = 0, end, mask;
+    uint32_t i, j, k;
+
+    base = ir_new_variable(body->frame_size) - body->frame_size;
+    for (j = 0; j < body->param_count; j++)
+        params[j] = body->params[j] > 0 ? body->params[j] + base : ir_new_temp_val(4);
+    if (body->label_min <= body->label_max) {
+        label_base = ir_new_label();
+        for (i = body->label_min + 1; i <= (uint32_t)body->label_max; i++)
+            ir_new_label();
+    }
+    end = ir_new_label();
+
+    // args come last one first
+    for (j = 0; j < body->param_count; j++) {
+        inst = &insts[(*count)++];
+        *inst = func->insts[c - body->param_count + j];
+        inst->op = IR_EXP_OP_ASSIGN;
+        inst->mode[0] = IR_MODE_V | IR_MODE_NORMAL;
+        inst->operand[0] = params[body->param_count - 1 - j];
+    }
+    for (i = 0; i < body->count; i++) {
+        inst = &insts[(*count)++];
+        *inst = body->insts[i];
+        if (_inline_is_jump(inst)) {
+            inst->operand[0] = label_base + inst->operand[0] - body->label_min;
+        }
+        else if (inst->op == IR_OP_CALL) {
+            inst->operand[1] = ir_function_add_name(func, body->names[inst->operand[1]]);
+        }
+        mask = ir_inst_reads(inst) | ir_inst_writes(inst);
+        for (k = 0; k < 3; k++) {
+            if (!(mask & (1 << k)) || (IR_INST_MODE(inst, k) != IR_MODE_T && IR_INST_MODE(inst, k) != IR_MODE_V))
+                continue;
+            if (inst->operand[k] > 0) {
+                inst->operand[k] += base;
+                continue;
+            }
+            for (j = 0; j < body->param_count && body->params[j] != inst->operand[k]; j++)
+                ;
+            if (j < body->param_count)
+                inst->operand[k] = params[j];
+        }
+        if (inst->op == IR_OP_RETURN) {
+            inst->op = IR_EXP_OP_ASSIGN;
+            inst->mode[0] = call->mode[0];
+            inst->operand[0] = call->operand[0];
+            if (i + 1 < body->count) {
+                inst = &insts[(*count)++];
+                memset(inst, 0, sizeof(ir_inst));
+                inst->op = IR_OP_GOTO;
+                inst->operand[0] = end;
+            }
+        }
+    }
+    inst = &insts[(*count)++];
+    memset(inst, 0, sizeof(ir_inst));
+    inst->op = IR_OP_LABEL;
+    inst->operand[0] = end;
+    free(params);
+}
+
+void inline_run(ir_function *func) {
+    inline_body *body, **site;
+    ir_inst *insts;
+    uint32_t i, j, count = 0, capacity = func->count;
+    int budget = _INLINE_GROWTH * cmmc_ctx->args.inline_limit;
+
+    if (cmmc_ctx->args.inline_limit <= 0 || cmmc_ctx->inline_bodies == NULL)
+        return;
+    site = calloc(func->count, sizeof(inline_body *));
+    for (i = 0; i < func->count; i++) {
+        if (func->insts[i].op != IR_OP_CALL)
+            continue;
+        body = _inline_find(func->names[func->insts[i].operand[1]]);
+        if (body == NULL || body->param_count != (uint32_t)func->insts[i].operand[2] || i < body->param_count
+            || (int)body->count > budget)
+            continue;
+        for (j = i - body->param_count; j < i && func->insts[j].op == IR_OP_ARG; j++)
+            ;
+        if (j < i)
+            continue;
+        site[i] = body;
+        budget -= body->count;
+        capacity += 2 * body->count + 1;
+    }
+    if (capacity == func->count) {
+        free(site);
+        return;
+    }
+
+    insts = arena_alloc(&cmmc_ctx->ir_arena, sizeof(ir_inst) * capacity);
+    for (i = 0; i < func->count; i++) {
+        if (site[i] != NULL) {
+            count -= site[i]->param_count;
+            _inline_expand(func, insts, &count, i, site[i]);
+        }
+        else {
+            insts[count++] = func->insts[i];
+        }
+    }
+    // the frame takes in the frames of the bodies
+    for (i = 0; i < count; i++) {
+        if (insts[i].op == IR_OP_DEC)
+            insts[i].operand[1] = ir_stack_size();
+    }
+    func->insts = insts;
+    func->count = count;
+    func->capacity = capacity;
+    cfg_invalidate(func);
+    free(site);
+}
@@ -0,0 +1,38 @@
+/*
+    C-- Compiler Back End
+    Copyright (C) 2019 NSKernel. All rights reserved.
+
+    A lab of Compilers at Nanjing University
+
+    inline.h
+    Inlining of small functions compiled earlier
+*/
+
+#include <stdint.h>
+
+#include <ir.h>
+
+#ifndef INLINE_H
+#define INLINE_H
+
+typedef struct inline_body_t inline_body;
+
+// a function kept after its optimization for the callers coming after
+// it, without its FUNC, PARAMs and DEC. ids are those of its own frame
+struct inline_body_t {
+    const char *name;
+    ir_inst *insts;
+    uint32_t count;
+    char **names;           // of its CALLs
+    int *params;            // ids of the params, in order
+    uint32_t param_count;
+    int frame_size;
+    int label_min;          // labels it uses are label_min
+    int label_max;          // up to label_max, both included
+    inline_body *next;
+};
+
+void inline_run(ir_function *func);
+void inline_record(ir_function *func);
+
+#endif
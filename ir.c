@@ -11,396 +11,95 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdint.h>
+#include <string.h>
 
 #include <ir.h>
+#include <arena.h>
+#include <context.h>
 #include <debug.h>
 #include <global.h>
+#include <emit.h>
 
-int _ir_variable_offset = 0;
-// uint32_t _ir_temp_val_count = 0;
-uint32_t _ir_label_count = 0;
-
-void _ir_print_3(ir *ir_content) {
-    // print first
-    switch (ir_content->mode.op1) {
-        case IR_MODE_ADDR:
-            fprintf(output_file, "&");
-            break;
-        case IR_MODE_STAR:
-            fprintf(output_file, "*");
-            break;
+void _ir_print_placeholder(int num, uint8_t mode) {
+    if ((mode & 0xF0) == IR_MODE_ADDR) {
+        emit_char('&');
     }
-    switch (ir_content->mode.mode1) {
-        case IR_MODE_T:
-            fprintf(output_file, "t%d := ", ir_content->temp_id);
-            break;
-        case IR_MODE_V:
-            fprintf(output_file, "v%d := ", ir_content->var_id);
-            break;
+    else if ((mode & 0xF0) == IR_MODE_STAR) {
+        emit_char('*');
     }
-    switch (ir_content->mode.op2) {
-        case IR_MODE_ADDR:
-            fprintf(output_file, "&");
-            break;
-        case IR_MODE_STAR:
-            fprintf(output_file, "*");
-            break;
-    }
-    switch (ir_content->mode.mode2) {
+    switch (mode & 0x0F) {
         case IR_MODE_I:
-            fprintf(output_file, "#%d", ir_content->int_val1);
+            emit_char('#');
             break;
         case IR_MODE_T:
-            fprintf(output_file, "t%d", ir_content->temp_id1);
+            emit_char('t');
             break;
         case IR_MODE_V:
-            fprintf(output_file, "v%d", ir_content->var_id1);
-            break;
-    }
-    switch (ir_content->op) {
-        case IR_EXP_OP_ADD:
-            fprintf(output_file, " + ");
-            break;
-        case IR_EXP_OP_AND:
-            fprintf(output_file, " && ");
-            break;
-        case IR_EXP_OP_DIV:
-            fprintf(output_file, " / ");
-            break;
-        case IR_EXP_OP_EQ:
-            fprintf(output_file, " == ");
-            break;
-        case IR_EXP_OP_GE:
-            fprintf(output_file, " >= ");
-            break;
-        case IR_EXP_OP_GT:
-            fprintf(output_file, " > ");
-            break;
-        case IR_EXP_OP_LE:
-            fprintf(output_file, " <= ");
-            break;
-        case IR_EXP_OP_LT:
-            fprintf(output_file, " < ");
-            break;
-        case IR_EXP_OP_MINUS:
-            fprintf(output_file, " - ");
-            break;
-        case IR_EXP_OP_MUL:
-            fprintf(output_file, " * ");
-            break;
-        case IR_EXP_OP_NEQ:
-            fprintf(output_file, " != ");
-            break;
-        case IR_EXP_OP_OR:
-            fprintf(output_file, " || ");
-            break;
-    }
-    switch (ir_content->mode.op3) {
-        case IR_MODE_ADDR:
-            fprintf(output_file, "&");
+            emit_char('v');
             break;
-        case IR_MODE_STAR:
-            fprintf(output_file, "*");
+        case IR_MODE_S:
+            emit_char('s');
             break;
     }
-    switch (ir_content->mode.mode3) {
-        case IR_MODE_I:
-            fprintf(output_file, "#%d", ir_content->int_val2);
-            break;
-        case IR_MODE_T:
-            fprintf(output_file, "t%d", ir_content->temp_id2);
-            break;
-        case IR_MODE_V:
-            fprintf(output_file, "v%d", ir_content->var_id2);
-            break;
-    }
-    fprintf(output_file, "\n");
+    emit_int(num);
 }
 
-void _ir_print_2(ir *ir_content) {
-    switch (ir_content->mode.op1) {
-        case IR_MODE_ADDR:
-            fprintf(output_file, "&");
-            break;
-        case IR_MODE_STAR:
-            fprintf(output_file, "*");
-            break;
-    }
-    switch (ir_content->mode.mode1) {
-        case IR_MODE_T:
-            fprintf(output_file, "t%d := ", ir_content->temp_id);
-            break;
-        case IR_MODE_V:
-            fprintf(output_file, "v%d := ", ir_content->var_id);
-            break;
-    }
-    if (ir_content->op == IR_EXP_OP_NOT) {
-        fprintf(output_file, "!");
-    }
-    switch (ir_content->mode.op2) {
-        case IR_MODE_ADDR:
-            fprintf(output_file, "&");
-            break;
-        case IR_MODE_STAR:
-            fprintf(output_file, "*");
-            break;
-    }
-    switch (ir_content->mode.mode2) {
-        case IR_MODE_I:
-            fprintf(output_file, "#%d", ir_content->int_val1);
-            break;
-        case IR_MODE_T:
-            fprintf(output_file, "t%d", ir_content->temp_id1);
-            break;
-        case IR_MODE_V:
-            fprintf(output_file, "v%d", ir_content->var_id1);
-            break;
-    }
-    fprintf(output_file, "\n");
+void _ir_print_operand(ir_inst *inst, int k) {
+    _ir_print_placeholder(inst->operand[k], inst->mode[k]);
 }
 
-void _ir_print_placeholder(int num, char op, char mode) {
-    if (op == IR_MODE_ADDR) {
-        fprintf(output_file, "&");
-    }
-    else if (op == IR_MODE_STAR) {
-        fprintf(output_file, "*");
-    }
-    switch (mode) {
-        case IR_MODE_I:
-            fprintf(output_file, "#");
-            break;
-        case IR_MODE_T:
-            fprintf(output_file, "t");
-            break;
-        case IR_MODE_V:
-            fprintf(output_file, "v");
-            break;
-    }
-    fprintf(output_file, "%d", num);
-}
-
-void _ir_print_and(ir *ir_content) {
-    uint32_t goto_label;
-    uint32_t goto_label_end;
-    fprintf(output_file, "IF ");
-    switch (ir_content->mode.mode2) {
-        case IR_MODE_I:
-            _ir_print_placeholder(ir_content->int_val1, ir_content->mode.op2, ir_content->mode.mode2);
-            break;
-        case IR_MODE_T:
-             _ir_print_placeholder(ir_content->temp_id1, ir_content->mode.op2, ir_content->mode.mode2);
-            break;
-        case IR_MODE_V:
-            _ir_print_placeholder(ir_content->var_id1, ir_content->mode.op2, ir_content->mode.mode2);
-            break;
-    }
-    goto_label = ir_new_label();
-    fprintf(output_file, " == #0 GOTO label%d\n", goto_label);
-    fprintf(output_file, "IF ");
-    switch (ir_content->mode.mode3) {
-        case IR_MODE_I:
-            _ir_print_placeholder(ir_content->int_val2, ir_content->mode.op3, ir_content->mode.mode3);
-            break;
-        case IR_MODE_T:
-             _ir_print_placeholder(ir_content->temp_id2, ir_content->mode.op3, ir_content->mode.mode3);
-            break;
-        case IR_MODE_V:
-            _ir_print_placeholder(ir_content->var_id2, ir_content->mode.op3, ir_content->mode.mode3);
-            break;
-    }
-    fprintf(output_file, " == #0 GOTO label%d\n", goto_label);
-    switch (ir_content->mode.mode1) {
-        case IR_MODE_T:
-             _ir_print_placeholder(ir_content->temp_id, ir_content->mode.op1, ir_content->mode.mode1);
-            break;
-        case IR_MODE_V:
-            _ir_print_placeholder(ir_content->var_id, ir_content->mode.op1, ir_content->mode.mode1);
-            break;
-    }
-    fprintf(output_file, " := #1\n");
-    goto_label_end = ir_new_label();
-    fprintf(output_file, "GOTO label%d\n", goto_label_end);
-    fprintf(output_file, "LABEL label%d :\n", goto_label);
-    switch (ir_content->mode.mode1) {
-        case IR_MODE_T:
-             _ir_print_placeholder(ir_content->temp_id, ir_content->mode.op1, ir_content->mode.mode1);
-            break;
-        case IR_MODE_V:
-            _ir_print_placeholder(ir_content->var_id, ir_content->mode.op1, ir_content->mode.mode1);
-            break;
-    }
-    fprintf(output_file, " := #0\n");
-    fprintf(output_file, "LABEL label%d :\n", goto_label_end);
-}
-
-void _ir_print_or(ir *ir_content) {
-    uint32_t goto_label;
-    uint32_t goto_label_end;
-    fprintf(output_file, "IF ");
-    switch (ir_content->mode.mode2) {
-        case IR_MODE_I:
-            _ir_print_placeholder(ir_content->int_val1, ir_content->mode.op2, ir_content->mode.mode2);
-            break;
-        case IR_MODE_T:
-             _ir_print_placeholder(ir_content->temp_id1, ir_content->mode.op2, ir_content->mode.mode2);
-            break;
-        case IR_MODE_V:
-            _ir_print_placeholder(ir_content->var_id1, ir_content->mode.op2, ir_content->mode.mode2);
-            break;
-    }
-    goto_label = ir_new_label();
-    fprintf(output_file, " != #0 GOTO label%d\n", goto_label);
-    fprintf(output_file, "IF ");
-    switch (ir_content->mode.mode3) {
-        case IR_MODE_I:
-            _ir_print_placeholder(ir_content->int_val2, ir_content->mode.op3, ir_content->mode.mode3);
-            break;
-        case IR_MODE_T:
-             _ir_print_placeholder(ir_content->temp_id2, ir_content->mode.op3, ir_content->mode.mode3);
-            break;
-        case IR_MODE_V:
-            _ir_print_placeholder(ir_content->var_id2, ir_content->mode.op3, ir_content->mode.mode3);
-            break;
-    }
-    fprintf(output_file, " != #0 GOTO label%d\n", goto_label);
-    switch (ir_content->mode.mode1) {
-        case IR_MODE_T:
-             _ir_print_placeholder(ir_content->temp_id, ir_content->mode.op1, ir_content->mode.mode1);
-            break;
-        case IR_MODE_V:
-            _ir_print_placeholder(ir_content->var_id, ir_content->mode.op1, ir_content->mode.mode1);
-            break;
-    }
-    fprintf(output_file, " := #0\n");
-    goto_label_end = ir_new_label();
-    fprintf(output_file, "GOTO label%d\n", goto_label_end);
-    fprintf(output_file, "LABEL label%d :\n", goto_label);
-    switch (ir_content->mode.mode1) {
-        case IR_MODE_T:
-             _ir_print_placeholder(ir_content->temp_id, ir_content->mode.op1, ir_content->mode.mode1);
-            break;
-        case IR_MODE_V:
-            _ir_print_placeholder(ir_content->var_id, ir_content->mode.op1, ir_content->mode.mode1);
-            break;
-    }
-    fprintf(output_file, " := #1\n");
-    fprintf(output_file, "LABEL label%d :\n", goto_label_end);
-}
-
-void _ir_print_relop(ir *ir_content) {
-    uint32_t goto_label;
-    uint32_t goto_label_end;
-    fprintf(output_file, "IF ");
-    switch (ir_content->mode.mode2) {
-        case IR_MODE_I:
-            _ir_print_placeholder(ir_content->int_val1, ir_content->mode.op2, ir_content->mode.mode2);
-            break;
-        case IR_MODE_T:
-             _ir_print_placeholder(ir_content->temp_id1, ir_content->mode.op2, ir_content->mode.mode2);
-            break;
-        case IR_MODE_V:
-            _ir_print_placeholder(ir_content->var_id1, ir_content->mode.op2, ir_content->mode.mode2);
-            break;
-    }
-    switch (ir_content->op) {
+const char *_ir_op_symbol(uint8_t op) {
+    switch (op) {
+        case IR_EXP_OP_ADD:
+            return " + ";
+        case IR_EXP_OP_MINUS:
+            return " - ";
+        case IR_EXP_OP_MUL:
+            return " * ";
+        case IR_EXP_OP_DIV:
+            return " / ";
         case IR_EXP_OP_EQ:
-            fprintf(output_file, " == ");
-            break;
+            return " == ";
         case IR_EXP_OP_GE:
-            fprintf(output_file, " >= ");
-            break;
+            return " >= ";
         case IR_EXP_OP_GT:
-            fprintf(output_file, " > ");
-            break;
+            return " > ";
         case IR_EXP_OP_LE:
-            fprintf(output_file, " <= ");
-            break;
+            return " <= ";
         case IR_EXP_OP_LT:
-            fprintf(output_file, " < ");
-            break;
+            return " < ";
         case IR_EXP_OP_NEQ:
-            fprintf(output_file, " != ");
-            break;
+            return " != ";
     }
-    switch (ir_content->mode.mode3) {
-        case IR_MODE_I:
-            _ir_print_placeholder(ir_content->int_val2, ir_content->mode.op3, ir_content->mode.mode3);
-            break;
-        case IR_MODE_T:
-             _ir_print_placeholder(ir_content->temp_id2, ir_content->mode.op3, ir_content->mode.mode3);
-            break;
-        case IR_MODE_V:
-            _ir_print_placeholder(ir_content->var_id2, ir_content->mode.op3, ir_content->mode.mode3);
-            break;
-    }
-    goto_label = ir_new_label();
-    fprintf(output_file, " GOTO label%d\n", goto_label);
-    switch (ir_content->mode.mode1) {
-        case IR_MODE_T:
-             _ir_print_placeholder(ir_content->temp_id, ir_content->mode.op1, ir_content->mode.mode1);
-            break;
-        case IR_MODE_V:
-            _ir_print_placeholder(ir_content->var_id, ir_content->mode.op1, ir_content->mode.mode1);
-            break;
-    }
-    fprintf(output_file, " := #0\n");
-    goto_label_end = ir_new_label();
-    fprintf(output_file, "GOTO label%d\n", goto_label_end);
-    fprintf(output_file, "LABEL label%d :\n", goto_label);
-    switch (ir_content->mode.mode1) {
-        case IR_MODE_T:
-             _ir_print_placeholder(ir_content->temp_id, ir_content->mode.op1, ir_content->mode.mode1);
-            break;
-        case IR_MODE_V:
-            _ir_print_placeholder(ir_content->var_id, ir_content->mode.op1, ir_content->mode.mode1);
-            break;
-    }
-    fprintf(output_file, " := #1\n");
-    fprintf(output_file, "LABEL label%d :\n", goto_label_end);
+    return " ? ";
 }
 
-void _ir_print_not(ir *ir_content) {
-    uint32_t goto_label = ir_new_label();
+// the textual ir has no boolean operators, they are expanded into
+// branches. false_first tells which value the fall through path gets
+void _ir_print_bool(ir_inst *inst, uint32_t goto_label, char false_first) {
     uint32_t goto_label_end = ir_new_label();
-    fprintf(output_file, "IF ");
-    switch (ir_content->mode.mode2) {
-        case IR_MODE_T:
-             _ir_print_placeholder(ir_content->temp_id1, ir_content->mode.op2, ir_content->mode.mode2);
-            break;
-        case IR_MODE_V:
-            _ir_print_placeholder(ir_content->var_id1, ir_content->mode.op2, ir_content->mode.mode2);
-            break;
-    }
-    
-    fprintf(output_file, " == #0 GOTO label%d\n", goto_label);
-    switch (ir_content->mode.mode1) {
-        case IR_MODE_T:
-             _ir_print_placeholder(ir_content->temp_id, ir_content->mode.op1, ir_content->mode.mode1);
-            break;
-        case IR_MODE_V:
-            _ir_print_placeholder(ir_content->var_id, ir_content->mode.op1, ir_content->mode.mode1);
-            break;
-    }
-    fprintf(output_file, " := #0\nGOTO label%d\nLABEL label%d :\n", goto_label_end, goto_label);
-    switch (ir_content->mode.mode1) {
-        case IR_MODE_T:
-             _ir_print_placeholder(ir_content->temp_id, ir_content->mode.op1, ir_content->mode.mode1);
-            break;
-        case IR_MODE_V:
-            _ir_print_placeholder(ir_content->var_id, ir_content->mode.op1, ir_content->mode.mode1);
-            break;
-    }
-    fprintf(output_file, " := #1\nLABEL label%d :\n", goto_label_end);
+    _ir_print_operand(inst, 0);
+    emit_fmt(" := #%d\n", false_first ? 0 : 1);
+    emit_fmt("GOTO label%d\n", goto_label_end);
+    emit_fmt("LABEL label%d :\n", goto_label);
+    _ir_print_operand(inst, 0);
+    emit_fmt(" := #%d\n", false_first ? 1 : 0);
+    emit_fmt("LABEL label%d :\n", goto_label_end);
 }
 
-void _ir_print_ir(ir *ir_content) {
-    switch (ir_content->op) {
+void _ir_print_inst(ir_function *func, ir_inst *inst) {
+    uint32_t goto_label;
+    switch (inst->op) {
         case IR_EXP_OP_ADD:
         case IR_EXP_OP_DIV:
         case IR_EXP_OP_MINUS:
         case IR_EXP_OP_MUL:
-            _ir_print_3(ir_content);
+            _ir_print_operand(inst, 0);
+            emit_str(" := ");
+            _ir_print_operand(inst, 1);
+            emit_str(_ir_op_symbol(inst->op));
+            _ir_print_operand(inst, 2);
+            emit_str("\n");
             break;
         case IR_EXP_OP_EQ:
         case IR_EXP_OP_GE:
@@ -408,227 +107,280 @@ void _ir_print_ir(ir *ir_content) {
         case IR_EXP_OP_LE:
         case IR_EXP_OP_LT:
         case IR_EXP_OP_NEQ:
-            _ir_print_relop(ir_content);
+            emit_str("IF ");
+            _ir_print_operand(inst, 1);
+            emit_str(_ir_op_symbol(inst->op));
+            _ir_print_operand(inst, 2);
+            emit_fmt(" GOTO label%d\n", goto_label = ir_new_label());
+            _ir_print_bool(inst, goto_label, 1);
             break;
         case IR_EXP_OP_AND:
-            _ir_print_and(ir_content);
-            break;
         case IR_EXP_OP_OR:
-            _ir_print_or(ir_content);
+            goto_label = ir_new_label();
+            emit_str("IF ");
+            _ir_print_operand(inst, 1);
+            emit_fmt(" %s #0 GOTO label%d\n", inst->op == IR_EXP_OP_AND ? "==" : "!=", goto_label);
+            emit_str("IF ");
+            _ir_print_operand(inst, 2);
+            emit_fmt(" %s #0 GOTO label%d\n", inst->op == IR_EXP_OP_AND ? "==" : "!=", goto_label);
+            _ir_print_bool(inst, goto_label, inst->op == IR_EXP_OP_OR);
             break;
         case IR_EXP_OP_ASSIGN:
-            _ir_print_2(ir_content);
-            break;    
+            _ir_print_operand(inst, 0);
+            emit_str(" := ");
+            _ir_print_operand(inst, 1);
+            emit_str("\n");
+            break;
         case IR_EXP_OP_NOT:
-            _ir_print_not(ir_content);
+            emit_str("IF ");
+            _ir_print_operand(inst, 1);
+            emit_fmt(" == #0 GOTO label%d\n", goto_label = ir_new_label());
+            _ir_print_bool(inst, goto_label, 1);
             break;
         case IR_OP_ARG:
-            fprintf(output_file, "ARG ");
-            switch (ir_content->mode.mode1) {
-                case IR_MODE_I:
-                    _ir_print_placeholder(ir_content->int_val1, ir_content->mode.op1, ir_content->mode.mode1);
-                    break;
-                case IR_MODE_T:
-                    _ir_print_placeholder(ir_content->temp_id, ir_content->mode.op1, ir_content->mode.mode1);
-                    break;
-                case IR_MODE_V:
-                    _ir_print_placeholder(ir_content->var_id, ir_content->mode.op1, ir_content->mode.mode1);
-                    break;
-            }
-            fprintf(output_file, "\n");
+            emit_str("ARG ");
+            _ir_print_operand(inst, 1);
+            emit_str("\n");
             break;
         case IR_OP_CALL:
-            switch(ir_content->mode.mode1) {
-                case IR_MODE_T:
-                    _ir_print_placeholder(ir_content->temp_id, ir_content->mode.op1, ir_content->mode.mode1);
-                    break;
-                case IR_MODE_V:
-                    _ir_print_placeholder(ir_content->var_id, ir_content->mode.op1, ir_content->mode.mode1);
-                    break;
-            }
-            fprintf(output_file, " := CALL %s\n", ir_content->func_name);
+            _ir_print_operand(inst, 0);
+            emit_fmt(" := CALL %s\n", func->names[inst->operand[1]]);
             break;
         case IR_OP_DEC:
-            fprintf(output_file, "DEC v%d %d\n", ir_content->var_id, ir_content->size);
+            emit_fmt("DEC %d\n", inst->operand[1]);
             break;
         case IR_OP_FUNC:
-            fprintf(output_file, "FUNCTION %s :\n", ir_content->func_name);
+            emit_fmt("FUNCTION %s :\n", func->names[inst->operand[1]]);
             break;
         case IR_OP_GOTO:
-            fprintf(output_file, "GOTO label%d\n", ir_content->goto_label);
+            emit_fmt("GOTO label%d\n", inst->operand[0]);
             break;
         case IR_OP_IF:
-            fprintf(output_file, "IF ");
-            switch (ir_content->mode.mode1) {
-                case IR_MODE_T:
-                    _ir_print_placeholder(ir_content->temp_id, ir_content->mode.op1, ir_content->mode.mode1);
-                    break;
-                case IR_MODE_V:
-                    _ir_print_placeholder(ir_content->var_id, ir_content->mode.op1, ir_content->mode.mode1);
-                    break;
-            }
-            fprintf(output_file, " == #0 GOTO label%d\n", ir_content->goto_label);
-            break;
         case IR_OP_IF_POSITIVE:
-            fprintf(output_file, "IF ");
-            switch (ir_content->mode.mode1) {
-                case IR_MODE_T:
-                    _ir_print_placeholder(ir_content->temp_id, ir_content->mode.op1, ir_content->mode.mode1);
-                    break;
-                case IR_MODE_V:
-                    _ir_print_placeholder(ir_content->var_id, ir_content->mode.op1, ir_content->mode.mode1);
-                    break;
-            }
-            fprintf(output_file, " != #0 GOTO label%d\n", ir_content->goto_label);
+            emit_str("IF ");
+            _ir_print_operand(inst, 1);
+            emit_fmt(" %s #0 GOTO label%d\n", inst->op == IR_OP_IF ? "==" : "!=", inst->operand[0]);
             break;
         case IR_OP_IF_IMME:
-            fprintf(output_file, "IF ");
-            switch (ir_content->immediate_ir->mode.mode2) {
-                case IR_MODE_I:
-                    _ir_print_placeholder(ir_content->immediate_ir->int_val1, ir_content->immediate_ir->mode.op2, ir_content->immediate_ir->mode.mode2);
-                    break;
-                case IR_MODE_T:
-                    _ir_print_placeholder(ir_content->immediate_ir->temp_id1, ir_content->immediate_ir->mode.op2, ir_content->immediate_ir->mode.mode2);
-                    break;
-                case IR_MODE_V:
-                    _ir_print_placeholder(ir_content->immediate_ir->var_id1, ir_content->immediate_ir->mode.op2, ir_content->immediate_ir->mode.mode2);
-                    break;
-            }
-            switch (ir_content->immediate_ir->op) {
-                case IR_EXP_OP_EQ:
-                    fprintf(output_file, " == ");
-                    break;
-                case IR_EXP_OP_GE:
-                    fprintf(output_file, " >= ");
-                    break;
-                case IR_EXP_OP_GT:
-                    fprintf(output_file, " > ");
-                    break;
-                case IR_EXP_OP_LE:
-                    fprintf(output_file, " <= ");
-                    break;
-                case IR_EXP_OP_LT:
-                    fprintf(output_file, " < ");
-                    break;
-                case IR_EXP_OP_NEQ:
-                    fprintf(output_file, " != ");
-                    break;
-                default:
-                    fprintf(output_file, " 0x%X ", ir_content->op);
-            }
-            switch (ir_content->immediate_ir->mode.mode3) {
-                case IR_MODE_I:
-                    _ir_print_placeholder(ir_content->immediate_ir->int_val2, ir_content->immediate_ir->mode.op3, ir_content->immediate_ir->mode.mode3);
-                    break;
-                case IR_MODE_T:
-                    _ir_print_placeholder(ir_content->immediate_ir->temp_id2, ir_content->immediate_ir->mode.op3, ir_content->immediate_ir->mode.mode3);
-                    break;
-                case IR_MODE_V:
-                    _ir_print_placeholder(ir_content->immediate_ir->var_id2, ir_content->immediate_ir->mode.op3, ir_content->immediate_ir->mode.mode3);
-                    break;
-            }
-            fprintf(output_file, "  GOTO label%d\n", ir_content->goto_label);
+            emit_str("IF ");
+            _ir_print_operand(inst, 1);
+            emit_str(_ir_op_symbol(inst->mode[0]));
+            _ir_print_operand(inst, 2);
+            emit_fmt(" GOTO label%d\n", inst->operand[0]);
             break;
         case IR_OP_LABEL:
-            fprintf(output_file, "LABEL label%d :\n", ir_content->goto_label);
+            emit_fmt("LABEL label%d :\n", inst->operand[0]);
             break;
         case IR_OP_PARAM:
-            fprintf(output_file, "PARAM v%d\n", ir_content->var_id);
+            emit_fmt("PARAM v%d\n", inst->operand[0]);
             break;
         case IR_OP_RETURN:
-            fprintf(output_file, "RETURN ");
-            switch (ir_content->mode.mode1) {
-                case IR_MODE_I:
-                    _ir_print_placeholder(ir_content->int_val1, ir_content->mode.op1, ir_content->mode.mode1);
-                    break;
-                case IR_MODE_T:
-                    _ir_print_placeholder(ir_content->temp_id, ir_content->mode.op1, ir_content->mode.mode1);
-                    break;
-                case IR_MODE_V:
-                    _ir_print_placeholder(ir_content->var_id, ir_content->mode.op1, ir_content->mode.mode1);
-                    break;
-            }
-            fprintf(output_file, "\n");
+            emit_str("RETURN ");
+            _ir_print_operand(inst, 1);
+            emit_str("\n");
             break;
         case IR_OP_READ:
-            fprintf(output_file, "READ ");
-            switch (ir_content->mode.mode1) {
-                case IR_MODE_T:
-                    _ir_print_placeholder(ir_content->temp_id, ir_content->mode.op1, ir_content->mode.mode1);
-                    break;
-                case IR_MODE_V:
-                    _ir_print_placeholder(ir_content->var_id, ir_content->mode.op1, ir_content->mode.mode1);
-                    break;
-            }
-            fprintf(output_file, "\n");
+            emit_str("READ ");
+            _ir_print_operand(inst, 0);
+            emit_str("\n");
             break;
         case IR_OP_WRITE:
-            fprintf(output_file, "WRITE ");
-            switch (ir_content->mode.mode1) {
-                case IR_MODE_I:
-                    _ir_print_placeholder(ir_content->int_val1, ir_content->mode.op1, ir_content->mode.mode1);
-                    break;
-                case IR_MODE_T:
-                    _ir_print_placeholder(ir_content->temp_id, ir_content->mode.op1, ir_content->mode.mode1);
-                    break;
-                case IR_MODE_V:
-                    _ir_print_placeholder(ir_content->var_id, ir_content->mode.op1, ir_content->mode.mode1);
-                    break;
-            }
-            fprintf(output_file, "\n");
+            emit_str("WRITE ");
+            _ir_print_operand(inst, 1);
+            emit_str("\n");
             break;
         default:
-            fprintf(output_file, "SHIT HAPPENS, %d\n", ir_content->op);
-            printf("SHIT HAPPENS, %d\n", ir_content->op);
+            emit_fmt("SHIT HAPPENS, %d\n", inst->op);
+            printf("SHIT HAPPENS, %d\n", inst->op);
             break;
     }
-    
+}
+
+void ir_print_function(ir_function *func) {
+    uint32_t i;
+    for (i = 0; i < func->count; i++)
+        _ir_print_inst(func, &func->insts[i]);
 }
 
 void ir_add_node_to_buffer(ir_list *buffer, ir *ir_content) {
-    ir_node *newnode = malloc(sizeof(ir_node));
-//#ifdef DEBUG
-    //_ir_print_ir(ir_content);
-//#endif
-    newnode->next = NULL;
-    newnode->content = ir_content;
-    if (buffer->head == NULL) {
-        buffer->head = buffer->tail = newnode;
+    ir_chunk *chunk = buffer->tail;
+    uint32_t capacity;
+    if (chunk == NULL || chunk->count == chunk->capacity) {
+        capacity = chunk == NULL ? IR_CHUNK_MIN : chunk->capacity * 2;
+        if (capacity > IR_CHUNK_MAX)
+            capacity = IR_CHUNK_MAX;
+        chunk = arena_alloc(&cmmc_ctx->ir_arena, sizeof(ir_chunk) + sizeof(ir *) * capacity);
+        chunk->next = NULL;
+        chunk->count = 0;
+        chunk->capacity = capacity;
+        if (buffer->head == NULL) {
+            buffer->head = buffer->tail = chunk;
+        }
+        else {
+            buffer->tail->next = chunk;
+            buffer->tail = chunk;
+        }
     }
-    else {
-        buffer->tail->next = newnode;
-        buffer->tail = newnode;
+    chunk->content[chunk->count++] = ir_content;
+}
+
+// take the last instruction off the list, the list must not be empty
+ir *ir_list_pop_tail(ir_list *buffer) {
+    ir_chunk *iterator;
+    ir *ret_content;
+    // merged chains may end in a chunk with nothing left in it
+    while (buffer->tail->count == 0) {
+        for (iterator = buffer->head; iterator->next != buffer->tail; iterator = iterator->next);
+        iterator->next = NULL;
+        buffer->tail = iterator;
+    }
+    ret_content = buffer->tail->content[--buffer->tail->count];
+    if (buffer->head == buffer->tail && buffer->tail->count == 0)
+        buffer->head = buffer->tail = NULL;
+    return ret_content;
+}
+
+// grow an array living in the ir arena, the old one is left
+// behind for arena_release
+void *_ir_grow(void *old, uint32_t count, uint32_t *capacity, size_t element_size) {
+    void *ret;
+    *capacity = *capacity ? *capacity * 2 : 16;
+    ret = arena_alloc(&cmmc_ctx->ir_arena, element_size * *capacity);
+    if (count)
+        memcpy(ret, old, element_size * count);
+    return ret;
+}
+
+ir_inst *ir_function_append(ir_function *func) {
+    if (func->count == func->capacity)
+        func->insts = _ir_grow(func->insts, func->count, &func->capacity, sizeof(ir_inst));
+    func->cfg = NULL;
+    return &func->insts[func->count++];
+}
+
+uint32_t ir_function_add_name(ir_function *func, char *name) {
+    if (func->name_count == func->name_capacity)
+        func->names = _ir_grow(func->names, func->name_count, &func->name_capacity, sizeof(char *));
+    func->names[func->name_count] = name;
+    return func->name_count++;
+}
+
+void _ir_pack_operand(ir_inst *inst, int k, char mode, char op, int value) {
+    inst->mode[k] = mode | op;
+    inst->operand[k] = value;
+}
+
+void _ir_pack(ir_function *func, ir *content, ir_inst *inst) {
+    inst->op = content->op;
+    inst->mode[0] = inst->mode[1] = inst->mode[2] = IR_MODE_I;
+    inst->operand[0] = inst->operand[1] = inst->operand[2] = 0;
+    switch (content->op) {
+        case IR_EXP_OP_ADD:
+        case IR_EXP_OP_MINUS:
+        case IR_EXP_OP_MUL:
+        case IR_EXP_OP_DIV:
+        case IR_EXP_OP_GT:
+        case IR_EXP_OP_GE:
+        case IR_EXP_OP_EQ:
+        case IR_EXP_OP_LE:
+        case IR_EXP_OP_LT:
+        case IR_EXP_OP_NEQ:
+        case IR_EXP_OP_OR:
+        case IR_EXP_OP_AND:
+            _ir_pack_operand(inst, 2, content->mode.mode3, content->mode.op3, ir_operand3(content));
+        case IR_EXP_OP_NOT:
+        case IR_EXP_OP_ASSIGN:
+            _ir_pack_operand(inst, 1, content->mode.mode2, content->mode.op2, ir_operand2(content));
+        case IR_OP_READ:
+            _ir_pack_operand(inst, 0, content->mode.mode1, content->mode.op1, ir_operand1(content));
+            break;
+        case IR_OP_CALL:
+            _ir_pack_operand(inst, 0, content->mode.mode1, content->mode.op1, ir_operand1(content));
+            inst->operand[1] = ir_function_add_name(func, content->func_name);
+            inst->operand[2] = content->param_count;
+            break;
+        case IR_OP_PARAM:
+            _ir_pack_operand(inst, 0, IR_MODE_V, IR_MODE_NORMAL, content->var_id);
+            break;
+        case IR_OP_ARG:
+        case IR_OP_RETURN:
+        case IR_OP_WRITE:
+            _ir_pack_operand(inst, 1, content->mode.mode1, content->mode.op1, ir_operand1(content));
+            break;
+        case IR_OP_DEC:
+            inst->operand[1] = content->size;
+            break;
+        case IR_OP_FUNC:
+            // names[0] was taken by the caller
+            break;
+        case IR_OP_IF:
+        case IR_OP_IF_POSITIVE:
+            _ir_pack_operand(inst, 1, content->mode.mode1, content->mode.op1, ir_operand1(content));
+        case IR_OP_GOTO:
+        case IR_OP_LABEL:
+            inst->operand[0] = content->goto_label;
+            break;
+        case IR_OP_IF_IMME:
+            inst->mode[0] = content->immediate_ir->op;
+            inst->operand[0] = content->goto_label;
+            _ir_pack_operand(inst, 1, content->immediate_ir->mode.mode2, content->immediate_ir->mode.op2, ir_operand2(content->immediate_ir));
+            _ir_pack_operand(inst, 2, content->immediate_ir->mode.mode3, content->immediate_ir->mode.op3, ir_operand3(content->immediate_ir));
+            break;
+        default:
+            break;
     }
 }
 
-void ir_print_list(ir_list *buffer) {
-    ir_node *iterator = buffer->head;
-    while (iterator != NULL) {
-        _ir_print_ir(iterator->content);
-        iterator = iterator->next;
+// turn the list built by the semantic pass into one flat array,
+// the list starts with the FUNC of the function
+ir_function *ir_pack_function(ir_list *buffer) {
+    ir_function *func = arena_alloc(&cmmc_ctx->ir_arena, sizeof(ir_function));
+    ir_chunk *iterator;
+    uint32_t i;
+    uint32_t count = 0;
+    uint32_t call_count = 0;
+    for (iterator = buffer->head; iterator != NULL; iterator = iterator->next) {
+        count += iterator->count;
+        for (i = 0; i < iterator->count; i++) {
+            if (iterator->content[i]->op == IR_OP_CALL)
+                call_count++;
+        }
     }
+    func->count = 0;
+    func->capacity = count;
+    func->cfg = NULL;
+    func->insts = arena_alloc(&cmmc_ctx->ir_arena, sizeof(ir_inst) * count);
+    func->name_count = 0;
+    func->name_capacity = call_count + 1;
+    func->names = arena_alloc(&cmmc_ctx->ir_arena, sizeof(char *) * func->name_capacity);
+    ir_function_add_name(func, buffer->head->content[0]->func_name);
+    for (iterator = buffer->head; iterator != NULL; iterator = iterator->next) {
+        for (i = 0; i < iterator->count; i++)
+            _ir_pack(func, iterator->content[i], &func->insts[func->count++]);
+    }
+    return func;
 }
 
 int ir_new_variable(int size) {
-    _ir_variable_offset += size;
-    return _ir_variable_offset;
+    cmmc_ctx->ir_variable_offset += size;
+    return cmmc_ctx->ir_variable_offset;
 }
 
 int ir_new_temp_val(int size) {
-    _ir_variable_offset += size;
-    return _ir_variable_offset;
+    cmmc_ctx->ir_variable_offset += size;
+    return cmmc_ctx->ir_variable_offset;
 }
 
 uint32_t ir_new_label() {
-    return _ir_label_count++;
+    return cmmc_ctx->ir_label_count++;
 }
 
 int ir_stack_size() {
-    return _ir_variable_offset;
+    return cmmc_ctx->ir_variable_offset;
 }
 
 void ir_reset_counter() {
-    _ir_variable_offset = 0;
+    cmmc_ctx->ir_variable_offset = 0;
 }
 
 ir *ir_simplify_maccess(ir *old_ir, ir_list *ret_ir) {
@@ -642,7 +394,7 @@ ir *ir_simplify_maccess(ir *old_ir, ir_list *ret_ir) {
         old_ir->mode.mode1 = IR_MODE_T;
         old_ir->mode.op1 = IR_MODE_NORMAL;
         ir_add_node_to_buffer(ret_ir, old_ir);
-        ret_entry = malloc(sizeof(ir));
+        ret_entry = arena_alloc(&cmmc_ctx->ir_arena, sizeof(ir));
         ret_entry->op = IR_EXP_OP_MACCESS;
         ret_entry->temp_id1 = temp_var_reg;
         ret_entry->mode.mode2 = IR_MODE_T;
@@ -662,7 +414,7 @@ ir *ir_simplify_maccess(ir *old_ir, ir_list *ret_ir) {
             old_ir->mode.mode1 = IR_MODE_T;
             old_ir->mode.op1 = IR_MODE_NORMAL;
             ir_add_node_to_buffer(ret_ir, old_ir);
-            old_ir = malloc(sizeof(ir));
+            old_ir = arena_alloc(&cmmc_ctx->ir_arena, sizeof(ir));
             old_ir->op = IR_EXP_OP_MACCESS;
             old_ir->temp_id1 = temp_var_reg;
             old_ir->mode.mode2 = IR_MODE_T;
@@ -46,6 +46,7 @@
 #define IR_MODE_I         0x00
 #define IR_MODE_T         0x01
 #define IR_MODE_V         0x02
+#define IR_MODE_S         0x03    // ssa value, see ssa.h
 #define IR_MODE_NORMAL    0x00
 #define IR_MODE_STAR      0x10
 #define IR_MODE_ADDR      0x20
@@ -54,11 +55,15 @@
 #define IR_CONSTANT       0x01
 #define IR_UNDECIDED      0x02
 
+#define IR_CHUNK_MIN      4
+#define IR_CHUNK_MAX      64
+
 typedef struct ir_t ir;
-typedef struct ir_node_t ir_node;
+typedef struct ir_chunk_t ir_chunk;
 typedef struct ir_list_t ir_list;
-typedef struct ir_func_list_t ir_func_list;
 typedef struct ir_mode_t ir_mode;
+typedef struct ir_inst_t ir_inst;
+typedef struct ir_function_t ir_function;
 
 struct ir_mode_t {
     char mode1;
@@ -69,6 +74,8 @@ struct ir_mode_t {
     char op3;
 };
 
+// record built by the semantic pass, packed into ir_inst once the
+// function is complete
 struct ir_t {
     uint32_t op;
     uint32_t temp_id;
@@ -93,22 +100,116 @@ struct ir_t {
     uint32_t param_count;
 };
 
-struct ir_node_t {
-    ir *content;
-    ir_node *next;
+// lists are chains of arrays, a chunk is twice as big as the one
+// before it up to IR_CHUNK_MAX, so that the many tiny lists built for
+// expressions stay small. merging two lists links the chains
+struct ir_chunk_t {
+    ir_chunk *next;
+    uint32_t count;
+    uint32_t capacity;
+    ir *content[];
 };
 
 struct ir_list_t {
-    ir_node *head;
-    ir_node *tail;
+    ir_chunk *head;
+    ir_chunk *tail;
     uint8_t constant_status;
 };
 
-struct ir_func_list_t {
-    ir_list *func_content;
-    ir_func_list *next;
+// packed instruction, 16 bytes. each mode is IR_MODE_I/T/V or'ed with
+// IR_MODE_NORMAL/STAR/ADDR
+//
+//   op                   operand[0]    operand[1]    operand[2]
+//   ADD ... AND          dest          src1          src2
+//   ASSIGN, NOT          dest          src
+//   CALL                 dest          #name index   #param count
+//   READ                 dest
+//   PARAM                var
+//   ARG, RETURN, WRITE                 src
+//   DEC                                #frame size
+//   FUNC                               #name index
+//   GOTO, LABEL          label
+//   IF, IF_POSITIVE      label         cond
+//   IF_IMME              label         src1          src2
+//
+// mode[0] of IF_IMME is the relop it tests
+struct ir_inst_t {
+    uint8_t op;
+    uint8_t mode[3];
+    int32_t operand[3];
+};
+
+#define IR_INST_MODE(inst, k) ((inst)->mode[k] & 0x0F)
+#define IR_INST_OP(inst, k)   ((inst)->mode[k] & 0xF0)
+
+// instructions of one function, indices into insts stay valid until
+// an instruction is inserted or removed. names[0] is the function
+// itself, CALLs refer to the others. cfg is kept by cfg_get, a pass
+// that changes insts calls cfg_invalidate
+struct ir_function_t {
+    ir_inst *insts;
+    uint32_t count;
+    uint32_t capacity;
+    char **names;
+    uint32_t name_count;
+    uint32_t name_capacity;
+    struct cfg_t *cfg;
 };
 
+// operand[0] of these is a destination, a star one stores through the
+// pointer it holds
+static inline int ir_inst_writes(ir_inst *inst)
+{
+    return (inst->op >= IR_EXP_OP_ADD && inst->op <= IR_EXP_OP_ASSIGN)
+        || inst->op == IR_OP_CALL || inst->op == IR_OP_READ || inst->op == IR_OP_PARAM;
+}
+
+// operands read by an instruction, bit k for operand[k]
+static inline int ir_inst_reads(ir_inst *inst)
+{
+    int star = ir_inst_writes(inst) && IR_INST_OP(inst, 0) == IR_MODE_STAR;
+    switch (inst->op) {
+        case IR_EXP_OP_NOT:
+        case IR_EXP_OP_ASSIGN:
+            return 0x2 | star;
+        case IR_OP_IF_IMME:
+            return 0x6;
+        case IR_OP_ARG:
+        case IR_OP_RETURN:
+        case IR_OP_WRITE:
+        case IR_OP_IF:
+        case IR_OP_IF_POSITIVE:
+            return 0x2;
+        case IR_OP_CALL:
+        case IR_OP_READ:
+        case IR_OP_PARAM:
+            return star;
+    }
+    if (inst->op >= IR_EXP_OP_ADD && inst->op <= IR_EXP_OP_AND)
+        return 0x6 | star;
+    return 0;
+}
+
+// 1 if the function takes the address of something in its own frame,
+// the address may then be passed on and outlive the frame
+static inline int ir_function_takes_address(ir_function *func)
+{
+    ir_inst *inst;
+    uint32_t i;
+    int k, mask;
+
+    for (i = 0; i < func->count; i++) {
+        inst = &func->insts[i];
+        mask = ir_inst_reads(inst);
+        for (k = 0; k < 3; k++) {
+            if ((mask & (1 << k)) && IR_INST_OP(inst, k) == IR_MODE_ADDR && inst->operand[k] > 0
+                && (IR_INST_MODE(inst, k) == IR_MODE_T || IR_INST_MODE(inst, k) == IR_MODE_V))
+                return 1;
+        }
+    }
+    return 0;
+}
+
 static inline void ir_merge_buffer(ir_list *buffer1, ir_list *buffer2)
 {
     if (buffer1->tail != NULL) {
@@ -123,15 +224,56 @@ static inline void ir_merge_buffer(ir_list *buffer1, ir_list *buffer2)
     }
 }
 
+// operand helpers: pick the id or immediate that the mode of each slot
+// refers to, slot 1 being the destination (or the only operand)
+static inline int ir_operand1(ir *content)
+{
+    switch (content->mode.mode1) {
+        case IR_MODE_T:
+            return content->temp_id;
+        case IR_MODE_V:
+            return content->var_id;
+        default:
+            return content->int_val1;
+    }
+}
+
+static inline int ir_operand2(ir *content)
+{
+    switch (content->mode.mode2) {
+        case IR_MODE_T:
+            return content->temp_id1;
+        case IR_MODE_V:
+            return content->var_id1;
+        default:
+            return content->int_val1;
+    }
+}
+
+static inline int ir_operand3(ir *content)
+{
+    switch (content->mode.mode3) {
+        case IR_MODE_T:
+            return content->temp_id2;
+        case IR_MODE_V:
+            return content->var_id2;
+        default:
+            return content->int_val2;
+    }
+}
+
 void ir_add_node_to_buffer(ir_list *buffer, ir *ir_content);
+ir *ir_list_pop_tail(ir_list *buffer);
+ir_function *ir_pack_function(ir_list *buffer);
+ir_inst *ir_function_append(ir_function *func);
+uint32_t ir_function_add_name(ir_function *func, char *name);
 int ir_new_variable(int size);
 int ir_new_temp_val(int size);
 uint32_t ir_new_label();
 void ir_reset_counter();
 ir *ir_simplify_maccess(ir *old_ir, ir_list *ret_ir);
-void ir_print_list(ir_list *buffer);
-void ir_compress_label(ir_list *ir_content);
-void _ir_print_ir(ir *ir_content);
+void ir_print_function(ir_function *func);
+void ir_compress_label(ir_function *func);
 int ir_stack_size();
 
 #endif
@@ -0,0 +1,885 @@
+/*
+    C-- Compiler Back End
+    Copyright (C) 2019 NSKernel. All rights reserved.
+
+    A lab of Compilers at Nanjing University
+
+    isel_mips.c
+    Tree pattern instruction selection for the MIPS back end
+*/
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <global.h>
+#include <ir.h>
+#include <backend.h>
+#include <mips.h>
+#include <context.h>
+
+// a temp written once and read once, by the instruction right after
+// the ones making up its own tree, is computed where it is read rather
+// than into its own register or slot. the trees of a block are then
+// covered bottom up at the least cost, counted in instructions with a
+// mul and a div weighing as much as the cycles they take:
+//
+//   t1 := i * 4                    sll $t0, $i, 2
+//   t2 := &a + t1                  add $t0, $fp, $t0
+//   x := *t2                       lw $x, -40($t0)
+//
+// a node is covered either as a value in a register or as an address,
+// a register plus a displacement folded into the lw or sw using it.
+// constants go into the immediate of addi, slti, sltiu, xori and sll
+// when they fit, and a * or / by a constant becomes shifts and adds,
+// or for / a multiply by a magic number keeping the high word.
+// nothing but the folded temps is written from where a tree starts
+// to its root, so every leaf still holds its value there
+//
+// a tree of constants and frame addresses alone reads nothing that
+// may change, it is folded from anywhere before in the same block
+//
+// the registers of a tree come out of $t0, $t1 and $v0, least used
+// first. a tree is folded only when it needs no more than these
+
+#define _CG_MIPS_ISEL_REG       0   // a value in a register
+#define _CG_MIPS_ISEL_ADDR      1   // an address, a register plus a displacement
+
+#define _CG_MIPS_ISEL_OP        0   // the op on two registers
+#define _CG_MIPS_ISEL_IMM2      1   // operand 2 is an immediate
+#define _CG_MIPS_ISEL_IMM1      2   // operand 1 is an immediate
+#define _CG_MIPS_ISEL_COPY      3   // ASSIGN, its operand as is
+#define _CG_MIPS_ISEL_FROM      4   // the other cover of the same node
+#define _CG_MIPS_ISEL_INDEX2    5   // address of operand 1 plus register operand 2
+#define _CG_MIPS_ISEL_INDEX1    6   // and the other way around
+
+#define _CG_MIPS_ISEL_INF       0x3FFFFFFF
+#define _CG_MIPS_ISEL_MUL       3
+#define _CG_MIPS_ISEL_DIV       20
+
+#define _CG_MIPS_ISEL_SCRATCH   ((1u << MIPS_REG_T0) | (1u << MIPS_REG_T1) | (1u << MIPS_REG_V0))
+
+typedef struct _cg_mips_isel_cover_t {
+    int cost[2];
+    int need[2];                    // registers taken while computing it
+    int disp;                       // of the address
+} _cg_mips_isel_cover;
+
+typedef struct _cg_mips_isel_node_t {
+    _cg_mips_isel_cover cover;
+    uint8_t rule[2];
+    char constant;                  // made of constants and frame addresses only
+} _cg_mips_isel_node;
+
+struct cg_mips_isel_t {
+    ir_function *func;
+    int32_t (*kid)[3];              // instruction folded into operand k, -1 for none
+    char *folded;
+    _cg_mips_isel_node *nodes;
+};
+
+static int _cg_mips_isel_fits(long imm) {
+    return imm >= -32768 && imm <= 32767;
+}
+
+// registers for two children, one after the other
+static int _cg_mips_isel_su(int need1, int need2) {
+    if (need1 == need2)
+        return need1 + 1;
+    return need1 > need2 ? need1 : need2;
+}
+
+static int _cg_mips_isel_max(int a, int b) {
+    return a > b ? a : b;
+}
+
+static int _cg_mips_isel_log2(uint32_t imm) {
+    int k = 0;
+    if (imm == 0 || (imm & (imm - 1)))
+        return -1;
+    while ((1u << k) != imm)
+        k++;
+    return k;
+}
+
+// x * imm by shifts with an add or sub, a second register holds one of
+// the shifted terms. INF when it takes more than two of them
+static int _cg_mips_isel_mul_imm_cost(int imm, int *need) {
+    uint32_t u = imm, low = u & -u;
+
+    int k;
+
+    *need = 1;
+    if (_cg_mips_isel_log2(u) >= 0)
+        return 1;
+    if ((k = _cg_mips_isel_log2(-u)) >= 0)
+        return 1 + (k != 0);
+    *need = 2;
+    if (_cg_mips_isel_log2(u - low) >= 0 || _cg_mips_isel_log2(u + low) >= 0)
+        return low == 1 ? 2 : 3;
+    return _CG_MIPS_ISEL_INF;
+}
+
+// the magic number and shift of Granlund and Montgomery for a signed
+// x / imm, the high word of x * magic shifted right is the quotient
+// rounded down, give or take x, and one more when it is negative
+static void _cg_mips_isel_magic(int imm, int32_t *magic, int *shift) {
+    const uint32_t two31 = 0x80000000u;
+    uint32_t ad = imm < 0 ? -(uint32_t)imm : (uint32_t)imm;
+    uint32_t t = two31 + ((uint32_t)imm >> 31);
+    uint32_t anc = t - 1 - t % ad;
+    uint32_t q1 = two31 / anc, r1 = two31 - q1 * anc;
+    uint32_t q2 = two31 / ad, r2 = two31 - q2 * ad, delta;
+    int p = 31;
+
+    do {
+        p++;
+        q1 *= 2;
+        r1 *= 2;
+        if (r1 >= anc) {
+            q1++;
+            r1 -= anc;
+        }
+        q2 *= 2;
+        r2 *= 2;
+        if (r2 >= ad) {
+            q2++;
+            r2 -= ad;
+        }
+        delta = ad - r2;
+    } while (q1 < delta || (q1 == delta && r1 == 0));
+    *magic = (int32_t)(imm < 0 ? -(q2 + 1) : q2 + 1);
+    *shift = p - 32;
+}
+
+// x / imm rounded toward zero without a div. a power of two adds
+// 2^k - 1 to a negative x before the shift
+static int _cg_mips_isel_div_imm_cost(int imm, int *need) {
+    int32_t magic;
+    int shift, k;
+
+    *need = 1;
+    if (imm == 1 || imm == -1)
+        return 1;
+    if (imm == 0 || imm == INT32_MIN)
+        return _CG_MIPS_ISEL_INF;
+    *need = 2;
+    k = _cg_mips_isel_log2(imm < 0 ? -imm : imm);
+    if (k >= 0)
+        return (k == 1 ? 3 : 4) + (imm < 0);
+    _cg_mips_isel_magic(imm, &magic, &shift);
+    return 4 + _CG_MIPS_ISEL_MUL + ((imm > 0 && magic < 0) || (imm < 0 && magic > 0)) + (shift != 0);
+}
+
+static int _cg_mips_isel_allocated(uint8_t mode, int num) {
+    if (mode != IR_MODE_T && mode != IR_MODE_V)
+        return 0;
+    return cg_mips_regalloc_query(cmmc_ctx->cg_mips_alloc, num);
+}
+
+static char _cg_mips_isel_is_node(uint32_t op) {
+    return (op >= IR_EXP_OP_ADD && op <= IR_EXP_OP_NEQ) || op == IR_EXP_OP_ASSIGN;
+}
+
+// c op x is x op' c
+static uint32_t _cg_mips_isel_swap(uint32_t op) {
+    switch (op) {
+        case IR_EXP_OP_GT:
+            return IR_EXP_OP_LT;
+        case IR_EXP_OP_GE:
+            return IR_EXP_OP_LE;
+        case IR_EXP_OP_LT:
+            return IR_EXP_OP_GT;
+        case IR_EXP_OP_LE:
+            return IR_EXP_OP_GE;
+    }
+    return op;
+}
+
+// operand k of inst is a constant
+static char _cg_mips_isel_imm(cg_mips_isel *sel, uint32_t u, int k, int *imm) {
+    ir_inst *inst = &sel->func->insts[u];
+    if (sel->kid[u][k] >= 0 || inst->mode[k] != (IR_MODE_I | IR_MODE_NORMAL))
+        return 0;
+    *imm = inst->operand[k];
+    return 1;
+}
+
+// x op c into one register, INF when c does not fit
+static int _cg_mips_isel_relop_imm_cost(uint32_t op, int imm) {
+    switch (op) {
+        case IR_EXP_OP_LT:
+            return _cg_mips_isel_fits(imm) ? 1 : _CG_MIPS_ISEL_INF;
+        case IR_EXP_OP_GE:
+            return _cg_mips_isel_fits(imm) ? 2 : _CG_MIPS_ISEL_INF;
+        case IR_EXP_OP_LE:
+            return _cg_mips_isel_fits((long)imm + 1) ? 1 : _CG_MIPS_ISEL_INF;
+        case IR_EXP_OP_GT:
+            return _cg_mips_isel_fits((long)imm + 1) ? 2 : _CG_MIPS_ISEL_INF;
+        case IR_EXP_OP_EQ:
+        case IR_EXP_OP_NEQ:
+            if (imm == 0)
+                return 1;
+            return (imm > 0 && imm <= 0xFFFF) || _cg_mips_isel_fits(-(long)imm) ? 2 : _CG_MIPS_ISEL_INF;
+    }
+    return _CG_MIPS_ISEL_INF;
+}
+
+// the cover of operand k of the instruction at u, for a star dest
+// that of the address it stores to
+static void _cg_mips_isel_operand_cover(cg_mips_isel *sel, uint32_t u, int k, _cg_mips_isel_cover *cover) {
+    ir_inst *inst = &sel->func->insts[u];
+    uint8_t mode = IR_INST_MODE(inst, k);
+    uint8_t op = IR_INST_OP(inst, k);
+    int32_t kid = sel->kid[u][k];
+
+    if (kid >= 0 && (op == IR_MODE_NORMAL || k == 0)) {
+        *cover = sel->nodes[kid].cover;
+        if (k == 0) {
+            cover->cost[_CG_MIPS_ISEL_REG] = _CG_MIPS_ISEL_INF;
+            cover->need[_CG_MIPS_ISEL_REG] = cover->need[_CG_MIPS_ISEL_ADDR];
+        }
+        return;
+    }
+    cover->disp = 0;
+    if (kid >= 0) {
+        // lw through the address the kid covers
+        cover->cost[_CG_MIPS_ISEL_REG] = sel->nodes[kid].cover.cost[_CG_MIPS_ISEL_ADDR] + 1;
+        cover->need[_CG_MIPS_ISEL_REG] = _cg_mips_isel_max(sel->nodes[kid].cover.need[_CG_MIPS_ISEL_ADDR], 1);
+    }
+    else if (k == 0 || op == IR_MODE_NORMAL) {
+        if (mode == IR_MODE_I)
+            cover->cost[_CG_MIPS_ISEL_REG] = inst->operand[k] != 0;
+        else
+            cover->cost[_CG_MIPS_ISEL_REG] = !_cg_mips_isel_allocated(mode, inst->operand[k]);
+        cover->need[_CG_MIPS_ISEL_REG] = cover->cost[_CG_MIPS_ISEL_REG];
+    }
+    else if (op == IR_MODE_ADDR) {
+        cover->cost[_CG_MIPS_ISEL_REG] = 1;
+        cover->need[_CG_MIPS_ISEL_REG] = 1;
+        cover->cost[_CG_MIPS_ISEL_ADDR] = 0;
+        cover->need[_CG_MIPS_ISEL_ADDR] = 0;
+        cover->disp = -cg_mips_frame_home(cmmc_ctx->cg_mips_frame, inst->operand[k]);
+        return;
+    }
+    else {
+        cover->cost[_CG_MIPS_ISEL_REG] = _cg_mips_isel_allocated(mode, inst->operand[k]) ? 1 : 2;
+        cover->need[_CG_MIPS_ISEL_REG] = 1;
+    }
+    cover->cost[_CG_MIPS_ISEL_ADDR] = cover->cost[_CG_MIPS_ISEL_REG];
+    cover->need[_CG_MIPS_ISEL_ADDR] = cover->need[_CG_MIPS_ISEL_REG];
+}
+
+static void _cg_mips_isel_try(_cg_mips_isel_node *node, int nt, uint8_t rule, int cost, int need, int disp) {
+    if (cost >= node->cover.cost[nt])
+        return;
+    node->cover.cost[nt] = cost;
+    node->cover.need[nt] = need;
+    node->rule[nt] = rule;
+    if (nt == _CG_MIPS_ISEL_ADDR)
+        node->cover.disp = disp;
+}
+
+// operand k of the instruction at u reads nothing that may change
+static char _cg_mips_isel_constant(cg_mips_isel *sel, uint32_t u, int k) {
+    ir_inst *inst = &sel->func->insts[u];
+    if (sel->kid[u][k] >= 0)
+        return IR_INST_OP(inst, k) == IR_MODE_NORMAL && sel->nodes[sel->kid[u][k]].constant;
+    return inst->mode[k] == (IR_MODE_I | IR_MODE_NORMAL)
+        || (IR_INST_MODE(inst, k) != IR_MODE_I && IR_INST_OP(inst, k) == IR_MODE_ADDR);
+}
+
+// picks the cheapest rule of the instruction at u for either cover
+static void _cg_mips_isel_label(cg_mips_isel *sel, uint32_t u) {
+    ir_inst *inst = &sel->func->insts[u];
+    _cg_mips_isel_node *node = &sel->nodes[u];
+    _cg_mips_isel_cover a, b;
+    int imm, cost, need;
+    const int R = _CG_MIPS_ISEL_REG, A = _CG_MIPS_ISEL_ADDR;
+
+    node->constant = _cg_mips_isel_constant(sel, u, 1)
+        && (inst->op == IR_EXP_OP_ASSIGN || _cg_mips_isel_constant(sel, u, 2));
+    node->cover.cost[R] = node->cover.cost[A] = _CG_MIPS_ISEL_INF;
+    node->cover.need[R] = node->cover.need[A] = 0;
+    node->cover.disp = 0;
+    _cg_mips_isel_operand_cover(sel, u, 1, &a);
+    if (inst->op != IR_EXP_OP_ASSIGN)
+        _cg_mips_isel_operand_cover(sel, u, 2, &b);
+    switch (inst->op) {
+        case IR_EXP_OP_ASSIGN:
+            _cg_mips_isel_try(node, R, _CG_MIPS_ISEL_COPY, a.cost[R], a.need[R], 0);
+            _cg_mips_isel_try(node, A, _CG_MIPS_ISEL_COPY, a.cost[A], a.need[A], a.disp);
+            break;
+        case IR_EXP_OP_ADD:
+            _cg_mips_isel_try(node, R, _CG_MIPS_ISEL_OP, a.cost[R] + b.cost[R] + 1, _cg_mips_isel_su(a.need[R], b.need[R]), 0);
+            _cg_mips_isel_try(node, A, _CG_MIPS_ISEL_INDEX2, a.cost[A] + b.cost[R] + 1, _cg_mips_isel_su(a.need[A], b.need[R]), a.disp);
+            _cg_mips_isel_try(node, A, _CG_MIPS_ISEL_INDEX1, b.cost[A] + a.cost[R] + 1, _cg_mips_isel_su(b.need[A], a.need[R]), b.disp);
+            if (_cg_mips_isel_imm(sel, u, 2, &imm)) {
+                if (_cg_mips_isel_fits(imm))
+                    _cg_mips_isel_try(node, R, _CG_MIPS_ISEL_IMM2, a.cost[R] + 1, _cg_mips_isel_max(a.need[R], 1), 0);
+                if (_cg_mips_isel_fits((long)a.disp + imm))
+                    _cg_mips_isel_try(node, A, _CG_MIPS_ISEL_IMM2, a.cost[A], a.need[A], a.disp + imm);
+            }
+            if (_cg_mips_isel_imm(sel, u, 1, &imm)) {
+                if (_cg_mips_isel_fits(imm))
+                    _cg_mips_isel_try(node, R, _CG_MIPS_ISEL_IMM1, b.cost[R] + 1, _cg_mips_isel_max(b.need[R], 1), 0);
+                if (_cg_mips_isel_fits((long)b.disp + imm))
+                    _cg_mips_isel_try(node, A, _CG_MIPS_ISEL_IMM1, b.cost[A], b.need[A], b.disp + imm);
+            }
+            break;
+        case IR_EXP_OP_MINUS:
+            _cg_mips_isel_try(node, R, _CG_MIPS_ISEL_OP, a.cost[R] + b.cost[R] + 1, _cg_mips_isel_su(a.need[R], b.need[R]), 0);
+            if (_cg_mips_isel_imm(sel, u, 2, &imm)) {
+                if (_cg_mips_isel_fits(-(long)imm))
+                    _cg_mips_isel_try(node, R, _CG_MIPS_ISEL_IMM2, a.cost[R] + 1, _cg_mips_isel_max(a.need[R], 1), 0);
+                if (_cg_mips_isel_fits((long)a.disp - imm))
+                    _cg_mips_isel_try(node, A, _CG_MIPS_ISEL_IMM2, a.cost[A], a.need[A], a.disp - imm);
+            }
+            break;
+        case IR_EXP_OP_MUL:
+            _cg_mips_isel_try(node, R, _CG_MIPS_ISEL_OP, a.cost[R] + b.cost[R] + _CG_MIPS_ISEL_MUL, _cg_mips_isel_su(a.need[R], b.need[R]), 0);
+            if (_cg_mips_isel_imm(sel, u, 2, &imm) && (cost = _cg_mips_isel_mul_imm_cost(imm, &need)) < _CG_MIPS_ISEL_INF)
+                _cg_mips_isel_try(node, R, _CG_MIPS_ISEL_IMM2, a.cost[R] + cost, _cg_mips_isel_max(a.need[R], need), 0);
+            if (_cg_mips_isel_imm(sel, u, 1, &imm) && (cost = _cg_mips_isel_mul_imm_cost(imm, &need)) < _CG_MIPS_ISEL_INF)
+                _cg_mips_isel_try(node, R, _CG_MIPS_ISEL_IMM1, b.cost[R] + cost, _cg_mips_isel_max(b.need[R], need), 0);
+            break;
+        case IR_EXP_OP_DIV:
+            _cg_mips_isel_try(node, R, _CG_MIPS_ISEL_OP, a.cost[R] + b.cost[R] + _CG_MIPS_ISEL_DIV, _cg_mips_isel_su(a.need[R], b.need[R]), 0);
+            if (_cg_mips_isel_imm(sel, u, 2, &imm) && (cost = _cg_mips_isel_div_imm_cost(imm, &need)) < _CG_MIPS_ISEL_INF)
+                _cg_mips_isel_try(node, R, _CG_MIPS_ISEL_IMM2, a.cost[R] + cost, _cg_mips_isel_max(a.need[R], need), 0);
+            break;
+        default:
+            // relops, < and > take one instruction on registers, the rest two
+            cost = (inst->op == IR_EXP_OP_LT || inst->op == IR_EXP_OP_GT) ? 1 : 2;
+            _cg_mips_isel_try(node, R, _CG_MIPS_ISEL_OP, a.cost[R] + b.cost[R] + cost, _cg_mips_isel_su(a.need[R], b.need[R]), 0);
+            if (_cg_mips_isel_imm(sel, u, 2, &imm))
+                _cg_mips_isel_try(node, R, _CG_MIPS_ISEL_IMM2, a.cost[R] + _cg_mips_isel_relop_imm_cost(inst->op, imm), _cg_mips_isel_max(a.need[R], 1), 0);
+            if (_cg_mips_isel_imm(sel, u, 1, &imm))
+                _cg_mips_isel_try(node, R, _CG_MIPS_ISEL_IMM1, b.cost[R] + _cg_mips_isel_relop_imm_cost(_cg_mips_isel_swap(inst->op), imm), _cg_mips_isel_max(b.need[R], 1), 0);
+            break;
+    }
+    // an address is a register too, and the other way around
+    cost = node->cover.cost[A] + (node->cover.disp != 0);
+    if (cost < node->cover.cost[R])
+        _cg_mips_isel_try(node, R, _CG_MIPS_ISEL_FROM, cost, _cg_mips_isel_max(node->cover.need[A], node->cover.disp != 0), 0);
+    if (node->cover.cost[R] < node->cover.cost[A])
+        _cg_mips_isel_try(node, A, _CG_MIPS_ISEL_FROM, node->cover.cost[R], node->cover.need[R], 0);
+}
+
+// registers taken by the operands of the instruction at u, and by the
+// address a star dest stores to
+static void _cg_mips_isel_root_need(cg_mips_isel *sel, uint32_t u, int *need, int *store_need) {
+    ir_inst *inst = &sel->func->insts[u];
+    _cg_mips_isel_cover a, b;
+    int reads = ir_inst_reads(inst);
+
+    *need = 0;
+    *store_need = 0;
+    if (reads & 0x1) {
+        _cg_mips_isel_operand_cover(sel, u, 0, &a);
+        *store_need = a.need[_CG_MIPS_ISEL_ADDR];
+    }
+    if (_cg_mips_isel_is_node(inst->op)) {
+        *need = sel->nodes[u].cover.need[_CG_MIPS_ISEL_REG];
+        return;
+    }
+    if (reads & 0x2) {
+        _cg_mips_isel_operand_cover(sel, u, 1, &a);
+        *need = a.need[_CG_MIPS_ISEL_REG];
+    }
+    if (reads & 0x4) {
+        _cg_mips_isel_operand_cover(sel, u, 2, &b);
+        *need = _cg_mips_isel_su(*need, b.need[_CG_MIPS_ISEL_REG]);
+    }
+}
+
+// nothing from after the instruction at d up to the one at u starts
+// a block or ends one
+static char _cg_mips_isel_same_block(ir_function *func, uint32_t d, uint32_t u) {
+    uint32_t i;
+    for (i = d + 1; i < u; i++) {
+        switch (func->insts[i].op) {
+            case IR_OP_LABEL:
+            case IR_OP_GOTO:
+            case IR_OP_IF:
+            case IR_OP_IF_POSITIVE:
+            case IR_OP_IF_IMME:
+            case IR_OP_RETURN:
+                return 0;
+        }
+    }
+    return 1;
+}
+
+cg_mips_isel *cg_mips_isel_function(ir_function *func) {
+    cg_mips_isel *sel;
+    ir_inst *inst;
+    int *uses, *defs, *def_at, *start;
+    int min_id = 0, max_id = -1, slot, need, store_need, reads;
+    uint32_t u, id_count;
+    int32_t d;
+    int k;
+    char fold = cmmc_ctx->args.opt_level >= 1;
+
+    sel = malloc(sizeof(cg_mips_isel));
+    sel->func = func;
+    sel->kid = malloc(sizeof(int32_t) * 3 * func->count);
+    sel->folded = calloc(func->count, 1);
+    sel->nodes = malloc(sizeof(_cg_mips_isel_node) * func->count);
+
+    // count the reads and writes of each temp
+    for (u = 0; u < func->count; u++) {
+        inst = &func->insts[u];
+        for (k = 0; k < 3; k++) {
+            if (IR_INST_MODE(inst, k) != IR_MODE_T || !((ir_inst_reads(inst) | ir_inst_writes(inst)) & (1 << k)))
+                continue;
+            if (max_id < min_id || inst->operand[k] < min_id)
+                min_id = inst->operand[k];
+            if (inst->operand[k] > max_id)
+                max_id = inst->operand[k];
+        }
+    }
+    id_count = max_id >= min_id ? (max_id - min_id) / 4 + 1 : 1;
+    uses = calloc(id_count, sizeof(int));
+    defs = calloc(id_count, sizeof(int));
+    def_at = malloc(sizeof(int) * id_count);
+    start = malloc(sizeof(int) * func->count);
+    for (u = 0; u < func->count; u++) {
+        inst = &func->insts[u];
+        reads = ir_inst_reads(inst);
+        for (k = 0; k < 3; k++) {
+            if (IR_INST_MODE(inst, k) != IR_MODE_T || !((reads | ir_inst_writes(inst)) & (1 << k)))
+                continue;
+            slot = (inst->operand[k] - min_id) / 4;
+            if (reads & (1 << k) || IR_INST_OP(inst, k) == IR_MODE_ADDR)
+                uses[slot]++;
+            else if (k == 0 && ir_inst_writes(inst)) {
+                defs[slot]++;
+                def_at[slot] = u;
+            }
+        }
+    }
+
+    for (u = 0; u < func->count; u++) {
+        inst = &func->insts[u];
+        sel->kid[u][0] = sel->kid[u][1] = sel->kid[u][2] = -1;
+        start[u] = u;
+        reads = ir_inst_reads(inst);
+        // a call or read stores its result after $t and $a are gone
+        if (inst->op == IR_OP_CALL || inst->op == IR_OP_READ)
+            reads = 0;
+        // the last operand is computed last, right before u
+        for (k = 2; fold && k >= 0; k--) {
+            if (!(reads & (1 << k)) || IR_INST_MODE(inst, k) != IR_MODE_T || IR_INST_OP(inst, k) == IR_MODE_ADDR)
+                continue;
+            slot = (inst->operand[k] - min_id) / 4;
+            if (uses[slot] != 1 || defs[slot] != 1)
+                continue;
+            d = def_at[slot];
+            if ((uint32_t)d >= u || !_cg_mips_isel_is_node(func->insts[d].op) || func->insts[d].mode[0] != (IR_MODE_T | IR_MODE_NORMAL)
+                || (d != start[u] - 1 && !(sel->nodes[d].constant && _cg_mips_isel_same_block(func, d, start[u]))))
+                continue;
+            sel->kid[u][k] = d;
+            if (_cg_mips_isel_is_node(inst->op))
+                _cg_mips_isel_label(sel, u);
+            _cg_mips_isel_root_need(sel, u, &need, &store_need);
+            if (need > 3 || store_need > 2) {
+                sel->kid[u][k] = -1;
+                continue;
+            }
+            sel->folded[d] = 1;
+            if (d == start[u] - 1)
+                start[u] = start[d];
+        }
+        if (_cg_mips_isel_is_node(inst->op))
+            _cg_mips_isel_label(sel, u);
+    }
+    free(uses);
+    free(defs);
+    free(def_at);
+    free(start);
+    return sel;
+}
+
+void cg_mips_isel_free(cg_mips_isel *sel) {
+    if (sel == NULL)
+        return;
+    free(sel->kid);
+    free(sel->folded);
+    free(sel->nodes);
+    free(sel);
+}
+
+char cg_mips_isel_folded(cg_mips_isel *sel, uint32_t i) {
+    return sel != NULL && sel->folded[i];
+}
+
+// load a leaf operand into reg
+static void _cg_mips_isel_load(uint8_t mode, uint8_t op, int num, int reg) {
+    int allocated = _cg_mips_isel_allocated(mode, num);
+    int home = cg_mips_frame_home(cmmc_ctx->cg_mips_frame, num);
+    switch (op)
+    {
+        case IR_MODE_NORMAL:
+            switch (mode) {
+                case IR_MODE_T:
+                case IR_MODE_V:
+                    if (allocated) {
+                        if (allocated != reg)
+                            mips_rr(MIPS_MOVE, reg, allocated);
+                    }
+                    else {
+                        // frame pointer - home is the offset
+                        mips_mem(MIPS_LW, reg, -home, MIPS_REG_FP);
+                    }
+                    break;
+                case IR_MODE_I:
+                    mips_ri(MIPS_LI, reg, num);
+                    break;
+                default:
+                    printf("Unexpected\n");
+                    break;
+
+            }
+            break;
+        case IR_MODE_ADDR:
+            // all addresses are static!
+            switch (mode) {
+                case IR_MODE_T:
+                case IR_MODE_V:
+                    // frame pointer - home is the offset
+                    mips_rri(MIPS_ADDI, reg, MIPS_REG_FP, -home);
+                    break;
+                case IR_MODE_I:
+                default:
+                    printf("Unexpected\n");
+                    break;
+            }
+            break;
+        case IR_MODE_STAR:
+            switch (mode) {
+                case IR_MODE_T:
+                case IR_MODE_V:
+                    if (allocated) {
+                        mips_mem(MIPS_LW, reg, 0, allocated);
+                    }
+                    else {
+                        // frame pointer - home is the offset
+                        mips_mem(MIPS_LW, reg, -home, MIPS_REG_FP);
+                        mips_mem(MIPS_LW, reg, 0, reg);
+                    }
+                    break;
+                case IR_MODE_I:
+                    mips_ri(MIPS_LI, reg, num);
+                    mips_mem(MIPS_LW, reg, 0, reg);
+                    break;
+                default:
+                    printf("Unexpected\n");
+                    break;
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+static int _cg_mips_isel_lowest(uint32_t scratch, int reg) {
+    int i;
+    if (scratch & (1u << reg))
+        return reg;
+    for (i = 0; i < 32; i++) {
+        if (scratch & (1u << i))
+            return i;
+    }
+    return reg;
+}
+
+static int _cg_mips_isel_emit(cg_mips_isel *sel, uint32_t d, int nt, int reg, uint32_t scratch, int *disp);
+
+// operand k of the instruction at u, computed into reg when it is not
+// sitting in a register already. scratch is what may be written to
+// besides reg
+static int _cg_mips_isel_operand(cg_mips_isel *sel, uint32_t u, int k, int nt, int reg, uint32_t scratch, int *disp) {
+    ir_inst *inst = &sel->func->insts[u];
+    uint8_t mode = IR_INST_MODE(inst, k);
+    uint8_t op = IR_INST_OP(inst, k);
+    int32_t kid = sel->kid[u][k];
+    int allocated, base;
+
+    *disp = 0;
+    if (kid >= 0 && (op == IR_MODE_NORMAL || k == 0))
+        return _cg_mips_isel_emit(sel, kid, k == 0 ? _CG_MIPS_ISEL_ADDR : nt, reg, scratch, disp);
+    if (kid >= 0) {
+        base = _cg_mips_isel_emit(sel, kid, _CG_MIPS_ISEL_ADDR, reg, scratch, disp);
+        mips_mem(MIPS_LW, reg, *disp, base);
+        *disp = 0;
+        return reg;
+    }
+    if (k == 0)
+        op = IR_MODE_NORMAL;
+    if (nt == _CG_MIPS_ISEL_ADDR && op == IR_MODE_ADDR && mode != IR_MODE_I) {
+        *disp = -cg_mips_frame_home(cmmc_ctx->cg_mips_frame, inst->operand[k]);
+        return MIPS_REG_FP;
+    }
+    if (op == IR_MODE_NORMAL && mode == IR_MODE_I && inst->operand[k] == 0)
+        return MIPS_REG_ZERO;
+    if (op == IR_MODE_NORMAL && (allocated = _cg_mips_isel_allocated(mode, inst->operand[k])) != 0)
+        return allocated;
+    _cg_mips_isel_load(mode, op, inst->operand[k], reg);
+    return reg;
+}
+
+// both operands of the instruction at u, the one taking more registers
+// first. ask names the cover wanted of each and pref the registers to
+// put them in, if they are free
+static void _cg_mips_isel_operands(cg_mips_isel *sel, uint32_t u, const int ask[3], const int pref[3], uint32_t scratch, int reg[3], int disp[3]) {
+    _cg_mips_isel_cover a, b;
+    int order[2] = { 1, 2 }, i, k;
+
+    _cg_mips_isel_operand_cover(sel, u, 1, &a);
+    _cg_mips_isel_operand_cover(sel, u, 2, &b);
+    if (b.need[ask[2]] > a.need[ask[1]]) {
+        order[0] = 2;
+        order[1] = 1;
+    }
+    for (i = 0; i < 2; i++) {
+        k = order[i];
+        reg[k] = _cg_mips_isel_operand(sel, u, k, ask[k], _cg_mips_isel_lowest(scratch, pref[k]), scratch, &disp[k]);
+        scratch &= ~(1u << reg[k]);
+    }
+}
+
+// reg := r1 op r2, the operands are only read by the first instruction
+static void _cg_mips_isel_emit_op(uint32_t op, int reg, int r1, int r2) {
+    switch (op) {
+        case IR_EXP_OP_ADD:
+            mips_rrr(MIPS_ADD, reg, r1, r2);
+            break;
+        case IR_EXP_OP_MINUS:
+            mips_rrr(MIPS_SUB, reg, r1, r2);
+            break;
+        case IR_EXP_OP_MUL:
+            mips_rrr(MIPS_MUL, reg, r1, r2);
+            break;
+        case IR_EXP_OP_DIV:
+            mips_rr(MIPS_DIV, r1, r2);
+            mips_r(MIPS_MFLO, reg);
+            break;
+        case IR_EXP_OP_LT:
+        case IR_EXP_OP_GE:
+            mips_rrr(MIPS_SLT, reg, r1, r2);
+            break;
+        case IR_EXP_OP_GT:
+        case IR_EXP_OP_LE:
+            mips_rrr(MIPS_SLT, reg, r2, r1);
+            break;
+        case IR_EXP_OP_EQ:
+            mips_rrr(MIPS_XOR, reg, r1, r2);
+            mips_rri(MIPS_SLTIU, reg, reg, 1);
+            break;
+        case IR_EXP_OP_NEQ:
+            mips_rrr(MIPS_XOR, reg, r1, r2);
+            mips_rrr(MIPS_SLTU, reg, MIPS_REG_ZERO, reg);
+            break;
+    }
+    if (op == IR_EXP_OP_GE || op == IR_EXP_OP_LE)
+        mips_rri(MIPS_XORI, reg, reg, 1);
+}
+
+// reg := x * imm with x in r, s is free for a shifted term
+static void _cg_mips_isel_emit_mul_imm(int reg, int r, int imm, int s) {
+    uint32_t u = imm, low = u & -u;
+    int k;
+
+    if ((k = _cg_mips_isel_log2(u)) >= 0) {
+        mips_rri(MIPS_SLL, reg, r, k);
+    }
+    else if ((k = _cg_mips_isel_log2(-u)) >= 0) {
+        if (k != 0) {
+            mips_rri(MIPS_SLL, reg, r, k);
+            r = reg;
+        }
+        mips_rrr(MIPS_SUB, reg, MIPS_REG_ZERO, r);
+    }
+    else {
+        // 2^a + 2^b or 2^a - 2^b
+        k = _cg_mips_isel_log2(u - low);
+        mips_rri(MIPS_SLL, s, r, k >= 0 ? k : _cg_mips_isel_log2(u + low));
+        if (low != 1) {
+            mips_rri(MIPS_SLL, reg, r, _cg_mips_isel_log2(low));
+            r = reg;
+        }
+        mips_rrr(k >= 0 ? MIPS_ADD : MIPS_SUB, reg, s, r);
+    }
+}
+
+// reg := x / imm with x in r, rounded toward zero. s is free
+static void _cg_mips_isel_emit_div_imm(int reg, int r, int imm, int s) {
+    int32_t magic;
+    int shift, k;
+
+    if (imm == 1 || imm == -1) {
+        if (imm == 1 && reg != r)
+            mips_rr(MIPS_MOVE, reg, r);
+        else if (imm == -1)
+            mips_rrr(MIPS_SUB, reg, MIPS_REG_ZERO, r);
+        return;
+    }
+    k = _cg_mips_isel_log2(imm < 0 ? -imm : imm);
+    if (k >= 0) {
+        // s := x < 0 ? 2^k - 1 : 0
+        if (k == 1) {
+            mips_rri(MIPS_SRL, s, r, 31);
+        }
+        else {
+            mips_rri(MIPS_SRA, s, r, 31);
+            mips_rri(MIPS_SRL, s, s, 32 - k);
+        }
+        mips_rrr(MIPS_ADD, s, r, s);
+        mips_rri(MIPS_SRA, reg, s, k);
+        if (imm < 0)
+            mips_rrr(MIPS_SUB, reg, MIPS_REG_ZERO, reg);
+        return;
+    }
+    _cg_mips_isel_magic(imm, &magic, &shift);
+    mips_ri(MIPS_LI, s, magic);
+    mips_rr(MIPS_MULT, r, s);
+    mips_r(MIPS_MFHI, s);
+    if (imm > 0 && magic < 0)
+        mips_rrr(MIPS_ADD, s, s, r);
+    else if (imm < 0 && magic > 0)
+        mips_rrr(MIPS_SUB, s, s, r);
+    if (shift != 0)
+        mips_rri(MIPS_SRA, s, s, shift);
+    mips_rri(MIPS_SRL, reg, s, 31);
+    mips_rrr(MIPS_ADD, reg, s, reg);
+}
+
+// reg := r op imm, as picked by the labeler. scratch is what may be
+// written to besides reg
+static void _cg_mips_isel_emit_imm(uint32_t op, int reg, int r, int imm, uint32_t scratch) {
+    int s = _cg_mips_isel_lowest(scratch & ~(1u << reg) & ~(1u << r), MIPS_REG_T0);
+
+    switch (op) {
+        case IR_EXP_OP_ADD:
+            mips_rri(MIPS_ADDI, reg, r, imm);
+            break;
+        case IR_EXP_OP_MINUS:
+            mips_rri(MIPS_ADDI, reg, r, -imm);
+            break;
+        case IR_EXP_OP_MUL:
+            _cg_mips_isel_emit_mul_imm(reg, r, imm, s);
+            break;
+        case IR_EXP_OP_DIV:
+            _cg_mips_isel_emit_div_imm(reg, r, imm, s);
+            break;
+        case IR_EXP_OP_LT:
+        case IR_EXP_OP_GE:
+            mips_rri(MIPS_SLTI, reg, r, imm);
+            break;
+        case IR_EXP_OP_GT:
+        case IR_EXP_OP_LE:
+            mips_rri(MIPS_SLTI, reg, r, imm + 1);
+            break;
+        case IR_EXP_OP_EQ:
+        case IR_EXP_OP_NEQ:
+            if (imm != 0) {
+                if (imm > 0 && imm <= 0xFFFF)
+                    mips_rri(MIPS_XORI, reg, r, imm);
+                else
+                    mips_rri(MIPS_ADDI, reg, r, -imm);
+                r = reg;
+            }
+            if (op == IR_EXP_OP_EQ)
+                mips_rri(MIPS_SLTIU, reg, r, 1);
+            else
+                mips_rrr(MIPS_SLTU, reg, MIPS_REG_ZERO, r);
+            break;
+    }
+    if (op == IR_EXP_OP_GE || op == IR_EXP_OP_GT)
+        mips_rri(MIPS_XORI, reg, reg, 1);
+}
+
+// the instruction at d covered as nt, computed into reg when there is
+// anything to compute. returns the register holding it, the base
+// register for an address with the displacement in disp
+static int _cg_mips_isel_emit(cg_mips_isel *sel, uint32_t d, int nt, int reg, uint32_t scratch, int *disp) {
+    ir_inst *inst = &sel->func->insts[d];
+    _cg_mips_isel_node *node = &sel->nodes[d];
+    int ask[3] = { 0, _CG_MIPS_ISEL_REG, _CG_MIPS_ISEL_REG };
+    int pref[3] = { 0, reg, reg };
+    int regs[3], disps[3], r;
+
+    *disp = 0;
+    switch (node->rule[nt]) {
+        case _CG_MIPS_ISEL_COPY:
+            return _cg_mips_isel_operand(sel, d, 1, nt, reg, scratch, disp);
+        case _CG_MIPS_ISEL_FROM:
+            if (nt == _CG_MIPS_ISEL_ADDR)
+                return _cg_mips_isel_emit(sel, d, _CG_MIPS_ISEL_REG, reg, scratch, disp);
+            r = _cg_mips_isel_emit(sel, d, _CG_MIPS_ISEL_ADDR, reg, scratch, disp);
+            if (*disp == 0)
+                return r;
+            mips_rri(MIPS_ADDI, reg, r, *disp);
+            *disp = 0;
+            return reg;
+        case _CG_MIPS_ISEL_IMM2:
+            r = _cg_mips_isel_operand(sel, d, 1, nt, reg, scratch, disp);
+            if (nt == _CG_MIPS_ISEL_ADDR) {
+                *disp = node->cover.disp;
+                return r;
+            }
+            _cg_mips_isel_emit_imm(inst->op, reg, r, inst->operand[2], scratch);
+            return reg;
+        case _CG_MIPS_ISEL_IMM1:
+            r = _cg_mips_isel_operand(sel, d, 2, nt, reg, scratch, disp);
+            if (nt == _CG_MIPS_ISEL_ADDR) {
+                *disp = node->cover.disp;
+                return r;
+            }
+            _cg_mips_isel_emit_imm(_cg_mips_isel_swap(inst->op), reg, r, inst->operand[1], scratch);
+            return reg;
+        case _CG_MIPS_ISEL_INDEX2:
+        case _CG_MIPS_ISEL_INDEX1:
+            ask[node->rule[nt] == _CG_MIPS_ISEL_INDEX2 ? 1 : 2] = _CG_MIPS_ISEL_ADDR;
+            _cg_mips_isel_operands(sel, d, ask, pref, scratch, regs, disps);
+            mips_rrr(MIPS_ADD, reg, regs[1], regs[2]);
+            *disp = node->cover.disp;
+            return reg;
+        default:
+            _cg_mips_isel_operands(sel, d, ask, pref, scratch, regs, disps);
+            _cg_mips_isel_emit_op(inst->op, reg, regs[1], regs[2]);
+            return reg;
+    }
+}
+
+int cg_mips_isel_operand(ir_inst *content, int k, int reg) {
+    cg_mips_isel *sel = cmmc_ctx->cg_mips_isel;
+    int disp;
+    return _cg_mips_isel_operand(sel, content - sel->func->insts, k, _CG_MIPS_ISEL_REG, reg, _CG_MIPS_ISEL_SCRATCH, &disp);
+}
+
+void cg_mips_isel_operands(ir_inst *content, int *reg1, int *reg2) {
+    cg_mips_isel *sel = cmmc_ctx->cg_mips_isel;
+    const int ask[3] = { 0, _CG_MIPS_ISEL_REG, _CG_MIPS_ISEL_REG };
+    const int pref[3] = { 0, MIPS_REG_T0, MIPS_REG_T1 };
+    int regs[3], disps[3];
+    _cg_mips_isel_operands(sel, content - sel->func->insts, ask, pref, _CG_MIPS_ISEL_SCRATCH, regs, disps);
+    *reg1 = regs[1];
+    *reg2 = regs[2];
+}
+
+void cg_mips_isel_exp(ir_inst *content, int reg) {
+    cg_mips_isel *sel = cmmc_ctx->cg_mips_isel;
+    int disp;
+    int r = _cg_mips_isel_emit(sel, content - sel->func->insts, _CG_MIPS_ISEL_REG, reg, _CG_MIPS_ISEL_SCRATCH, &disp);
+    if (r != reg)
+        mips_rr(MIPS_MOVE, reg, r);
+}
+
+int cg_mips_isel_address(ir_inst *content, int reg, int *disp) {
+    cg_mips_isel *sel = cmmc_ctx->cg_mips_isel;
+    uint32_t scratch = ((1u << MIPS_REG_T0) | (1u << MIPS_REG_T1)) & ~(1u << reg);
+    return _cg_mips_isel_operand(sel, content - sel->func->insts, 0, _CG_MIPS_ISEL_ADDR, _cg_mips_isel_lowest(scratch, MIPS_REG_T1), scratch, disp);
+}
@@ -0,0 +1,549 @@
+/*
+    C-- Compiler Back End
+    Copyright (C) 2019 NSKernel. All rights reserved.
+
+    A lab of Compilers at Nanjing University
+
+    ivsr.c
+    Induction variable strength reduction
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include <ir.h>
+#include <cfg.h>
+#include <live.h>
+#include <opt.h>
+#include <edit.h>
+
+// a basic induction variable is written once in a loop, by i := i + c.
+// a variable written once in the loop from one, as j := x * k, x + y
+// or x - y with k and c constants and y not changing in the loop, is
+// derived: it always holds scale * i + base + offset. one that is read
+// for more than computing other derived variables and went through a
+// multiplication gets a new variable of its own, set before the loop
+// and stepped by scale * c right after i is, and its computation
+// becomes a copy of it. the rest of the derived computations go.
+//
+// a test of i against a constant then tests one of the new variables
+// against the constant scaled the same way, which leaves i dead unless
+// something else reads it or it is live after the loop, and its own
+// step goes too. loops go inner first, a round at a time as in licm
+
+typedef struct _ivsr_iv_t {
+    uint32_t basic;     // the basic variable it derives from, LIVE_NONE
+                        // for a variable that is no induction variable
+    int32_t scale;
+    int32_t offset;
+    uint8_t base_mode;  // IR_MODE_I for no base, which is invariant
+    int32_t base;
+    uint32_t def;       // the instruction writing it in the loop
+    uint32_t block;     // and its block
+    uint32_t from;      // variable it is computed from
+    int32_t step;       // c, for a basic one
+    int reduced;        // id of its new variable, 0 if none
+    char removed;
+    char needed;
+} _ivsr_iv;
+
+typedef struct _ivsr_state_t {
+    ir_function *func;
+    cfg *graph;
+    live_info *live;
+    edit *edit;
+    char *in_loop;
+    uint32_t *def_count;
+    _ivsr_iv *iv;
+    uint32_t *order;        // derived variables, each after what it
+    uint32_t order_count;   // derives from
+    uint32_t *exit_to;
+    uint32_t exit_count;
+} _ivsr_state;
+
+// variable read by operand k, LIVE_NONE unless a plain read
+uint32_t _ivsr_var(_ivsr_state *state, ir_inst *inst, int k) {
+    if (IR_INST_MODE(inst, k) == IR_MODE_I || IR_INST_OP(inst, k) != IR_MODE_NORMAL)
+        return LIVE_NONE;
+    return live_var(state->live, inst, k);
+}
+
+int _ivsr_invariant(_ivsr_state *state, ir_inst *inst, int k) {
+    uint32_t n;
+    if (IR_INST_MODE(inst, k) == IR_MODE_I || IR_INST_OP(inst, k) == IR_MODE_ADDR)
+        return 1;
+    n = _ivsr_var(state, inst, k);
+    return n != LIVE_NONE && state->def_count[n] == 0;
+}
+
+int _ivsr_live_out(_ivsr_state *state, uint32_t n) {
+    live_info *live = state->live;
+    uint32_t e;
+    for (e = 0; e < state->exit_count; e++) {
+        if (LIVE_TEST(&live->live_in[state->exit_to[e] * live->words], n))
+            return 1;
+    }
+    return 0;
+}
+
+void _ivsr_scan(_ivsr_state *state, cfg_loop *loop) {
+    cfg *graph = state->graph;
+    ir_inst *inst;
+    uint32_t j, i, n, b;
+    int s;
+
+    state->exit_count = 0;
+    for (j = 0; j < loop->block_count; j++) {
+        b = loop->blocks[j];
+        for (i = graph->blocks[b].first; i < graph->blocks[b].last; i++) {
+            inst = &state->func->insts[i];
+            if (!ir_inst_writes(inst) || IR_INST_OP(inst, 0) != IR_MODE_NORMAL)
+                continue;
+            n = live_var(state->live, inst, 0);
+            if (n != LIVE_NONE) {
+                state->def_count[n]++;
+                state->iv[n].def = i;
+                state->iv[n].block = b;
+            }
+        }
+        for (s = 0; s < (int)graph->blocks[b].succ_count; s++) {
+            if (!state->in_loop[graph->blocks[b].succ[s]])
+                state->exit_to[state->exit_count++] = graph->blocks[b].succ[s];
+        }
+    }
+}
+
+// 1 if inst computes n + c, c + n or n - c, step set to c
+int _ivsr_step(_ivsr_state *state, ir_inst *inst, uint32_t n, int32_t *step) {
+    int k;
+    if (inst->op != IR_EXP_OP_ADD && inst->op != IR_EXP_OP_MINUS)
+        return 0;
+    for (k = 1; k < 3; k++) {
+        if (_ivsr_var(state, inst, k) == n && IR_INST_MODE(inst, 3 - k) == IR_MODE_I
+            && (k == 1 || inst->op == IR_EXP_OP_ADD))
+            break;
+    }
+    if (k == 3)
+        return 0;
+    *step = inst->op == IR_EXP_OP_ADD ? inst->operand[3 - k] : (int32_t)(0u - (uint32_t)inst->operand[2]);
+    return 1;
+}
+
+// i := i + c, or i := t with t := i + c before it on every way there
+// as gvn leaves it when i + c is also read elsewhere
+void _ivsr_basic(_ivsr_state *state, cfg_loop *loop) {
+    cfg_block *block;
+    ir_inst *inst;
+    _ivsr_iv *iv;
+    uint32_t j, i, n, t;
+    int32_t step;
+    int found;
+
+    for (j = 0; j < loop->block_count; j++) {
+        block = &state->graph->blocks[loop->blocks[j]];
+        for (i = block->first; i < block->last; i++) {
+            inst = &state->func->insts[i];
+            if (!ir_inst_writes(inst) || IR_INST_OP(inst, 0) != IR_MODE_NORMAL)
+                continue;
+            n = live_var(state->live, inst, 0);
+            if (n == LIVE_NONE || state->def_count[n] != 1)
+                continue;
+            if (inst->op == IR_EXP_OP_ASSIGN) {
+                t = _ivsr_var(state, inst, 1);
+                found = t != LIVE_NONE && state->def_count[t] == 1
+                    && (state->iv[t].block == loop->blocks[j] ? state->iv[t].def < i
+                        : cfg_dominates(state->graph, state->iv[t].block, loop->blocks[j]))
+                    && _ivsr_step(state, &state->func->insts[state->iv[t].def], n, &step);
+            }
+            else {
+                found = _ivsr_step(state, inst, n, &step);
+            }
+            if (!found)
+                continue;
+            iv = &state->iv[n];
+            iv->basic = n;
+            iv->scale = 1;
+            iv->offset = 0;
+            iv->base_mode = IR_MODE_I;
+            iv->from = n;
+            iv->step = step;
+        }
+    }
+}
+
+// 1 if insts[i] of block b derives a variable from another
+int _ivsr_derive(_ivsr_state *state, uint32_t b, uint32_t i) {
+    ir_inst *inst = &state->func->insts[i];
+    _ivsr_iv *iv, *x;
+    uint32_t n, from;
+    int k, y;
+
+    if ((inst->op != IR_EXP_OP_ADD && inst->op != IR_EXP_OP_MINUS && inst->op != IR_EXP_OP_MUL)
+        || IR_INST_OP(inst, 0) != IR_MODE_NORMAL)
+        return 0;
+    n = live_var(state->live, inst, 0);
+    if (n == LIVE_NONE || state->def_count[n] != 1 || state->iv[n].basic != LIVE_NONE)
+        return 0;
+    for (k = 1; k < 3; k++) {
+        from = _ivsr_var(state, inst, k);
+        if (from != LIVE_NONE && state->iv[from].basic != LIVE_NONE)
+            break;
+    }
+    if (k == 3 || (k == 2 && inst->op == IR_EXP_OP_MINUS))
+        return 0;
+    y = 3 - k;
+    x = &state->iv[from];
+    // a derived one is read where it holds what it holds now, written
+    // earlier in the block and not since its basic variable stepped
+    if (x->basic != from && (x->def < state->graph->blocks[b].first || x->def > i
+        || (state->iv[x->basic].def > x->def && state->iv[x->basic].def < i)))
+        return 0;
+    if (!_ivsr_invariant(state, inst, y))
+        return 0;
+
+    iv = &state->iv[n];
+    iv->scale = x->scale;
+    iv->offset = x->offset;
+    iv->base_mode = x->base_mode;
+    iv->base = x->base;
+    if (inst->op == IR_EXP_OP_MUL) {
+        if (IR_INST_MODE(inst, y) != IR_MODE_I || x->base_mode != IR_MODE_I)
+            return 0;
+        iv->scale = (int32_t)((uint32_t)x->scale * (uint32_t)inst->operand[y]);
+        iv->offset = (int32_t)((uint32_t)x->offset * (uint32_t)inst->operand[y]);
+        if (iv->scale == 0)
+            return 0;
+    }
+    else if (IR_INST_MODE(inst, y) == IR_MODE_I) {
+        if (inst->op == IR_EXP_OP_ADD)
+            iv->offset = (int32_t)((uint32_t)x->offset + (uint32_t)inst->operand[y]);
+        else
+            iv->offset = (int32_t)((uint32_t)x->offset - (uint32_t)inst->operand[y]);
+    }
+    else {
+        if (inst->op != IR_EXP_OP_ADD || x->base_mode != IR_MODE_I)
+            return 0;
+        iv->base_mode = inst->mode[y];
+        iv->base = inst->operand[y];
+    }
+    iv->basic = x->basic;
+    iv->from = from;
+    state->order[state->order_count++] = n;
+    return 1;
+}
+
+// which derived variables get a new one, which go
+void _ivsr_select(_ivsr_state *state, cfg_loop *loop) {
+    live_info *live = state->live;
+    ir_inst *inst;
+    _ivsr_iv *iv;
+    uint32_t j, i, n, o;
+    int k;
+
+    for (j = 0; j < loop->block_count; j++) {
+        for (i = state->graph->blocks[loop->blocks[j]].first; i < state->graph->blocks[loop->blocks[j]].last; i++) {
+            inst = &state->func->insts[i];
+            for (k = 0; k < 3; k++) {
+                if (!(ir_inst_reads(inst) & (1 << k)))
+                    continue;
+                n = live_var(live, inst, k);
+                if (n == LIVE_NONE || state->iv[n].basic == LIVE_NONE || state->iv[n].basic == n)
+                    continue;
+                // computing another derived variable from it is not
+                // a read that needs it
+                o = live_var(live, inst, 0);
+                if (k == 0 || IR_INST_OP(inst, 0) != IR_MODE_NORMAL || o == LIVE_NONE
+                    || state->iv[o].basic == LIVE_NONE || state->iv[o].def != i || state->iv[o].from != n
+                    || state->iv[o].basic == o)
+                    state->iv[n].needed = 1;
+            }
+        }
+    }
+    for (o = state->order_count; o > 0; o--) {
+        n = state->order[o - 1];
+        iv = &state->iv[n];
+        if (LIVE_TEST(&live->live_in[loop->header * live->words], n) || _ivsr_live_out(state, n))
+            iv->needed = 1;
+        // one addition to what stays anyway costs no more than a step
+        if (!iv->needed)
+            iv->removed = 1;
+        else if (state->func->insts[iv->def].op != IR_EXP_OP_MUL && state->iv[iv->from].needed)
+            continue;
+        else if (iv->scale != 1)
+            iv->reduced = -1;
+        else
+            state->iv[iv->from].needed = 1;
+    }
+}
+
+ir_inst *_ivsr_emit(ir_inst *inst, uint8_t op, int id, uint8_t mode1, int32_t src1, uint8_t mode2, int32_t src2) {
+    inst->op = op;
+    inst->mode[0] = IR_MODE_T | IR_MODE_NORMAL;
+    inst->operand[0] = id;
+    inst->mode[1] = mode1;
+    inst->operand[1] = src1;
+    inst->mode[2] = mode2;
+    inst->operand[2] = src2;
+    return inst;
+}
+
+// 1 if the basic variable n is set to a constant right before the
+// loop, on the only way into it
+int _ivsr_entry(_ivsr_state *state, cfg_loop *loop, uint32_t n, int32_t *value) {
+    cfg *graph = state->graph;
+    cfg_block *header = &graph->blocks[loop->header];
+    ir_inst *inst;
+    uint32_t p, i, from = CFG_NONE;
+
+    for (p = 0; p < header->pred_count; p++) {
+        if (cfg_dominates(graph, loop->header, header->pred[p]))
+            continue;
+        if (from != CFG_NONE)
+            return 0;
+        from = header->pred[p];
+    }
+    if (from == CFG_NONE)
+        return 0;
+    for (i = graph->blocks[from].last; i > graph->blocks[from].first; i--) {
+        inst = &state->func->insts[i - 1];
+        if (!ir_inst_writes(inst) || IR_INST_OP(inst, 0) != IR_MODE_NORMAL || live_var(state->live, inst, 0) != n)
+            continue;
+        if (inst->op != IR_EXP_OP_ASSIGN || IR_INST_MODE(inst, 1) != IR_MODE_I)
+            return 0;
+        *value = inst->operand[1];
+        return 1;
+    }
+    return 0;
+}
+
+// the new variable of n, shared by all those with the same value
+int _ivsr_reduce(_ivsr_state *state, cfg_loop *loop, uint32_t n) {
+    live_info *live = state->live;
+    _ivsr_iv *iv = &state->iv[n], *other;
+    uint32_t o;
+    uint8_t mode = live->var_mode[iv->basic] | IR_MODE_NORMAL;
+    int id = live->var_id[iv->basic];
+    int32_t value;
+
+    for (o = 0; o < state->order_count; o++) {
+        other = &state->iv[state->order[o]];
+        if (other->reduced > 0 && other->basic == iv->basic && other->scale == iv->scale
+            && other->offset == iv->offset && other->base_mode == iv->base_mode
+            && (other->base_mode == IR_MODE_I || other->base == iv->base))
+            return iv->reduced = other->reduced;
+    }
+    iv->reduced = ir_new_temp_val(4);
+    if (_ivsr_entry(state, loop, iv->basic, &value)) {
+        value = (int32_t)((uint32_t)value * (uint32_t)iv->scale + (uint32_t)iv->offset);
+        if (iv->base_mode != IR_MODE_I)
+            _ivsr_emit(edit_preheader(state->edit, loop->header), IR_EXP_OP_ADD, iv->reduced,
+                iv->base_mode, iv->base, IR_MODE_I, value);
+        else
+            _ivsr_emit(edit_preheader(state->edit, loop->header), IR_EXP_OP_ASSIGN, iv->reduced,
+                IR_MODE_I, value, IR_MODE_I, 0);
+    }
+    else {
+        if (iv->scale != 1) {
+            _ivsr_emit(edit_preheader(state->edit, loop->header), IR_EXP_OP_MUL, iv->reduced,
+                mode, id, IR_MODE_I, iv->scale);
+            mode = IR_MODE_T | IR_MODE_NORMAL;
+            id = iv->reduced;
+        }
+        if (iv->base_mode != IR_MODE_I) {
+            _ivsr_emit(edit_preheader(state->edit, loop->header), IR_EXP_OP_ADD, iv->reduced,
+                iv->base_mode, iv->base, mode, id);
+            mode = IR_MODE_T | IR_MODE_NORMAL;
+            id = iv->reduced;
+        }
+        if (iv->offset != 0 || id != iv->reduced)
+            _ivsr_emit(edit_preheader(state->edit, loop->header), IR_EXP_OP_ADD, iv->reduced,
+                mode, id, IR_MODE_I, iv->offset);
+    }
+    _ivsr_emit(edit_after(state->edit, state->iv[iv->basic].def), IR_EXP_OP_ADD, iv->reduced,
+        IR_MODE_T | IR_MODE_NORMAL, iv->reduced, IR_MODE_I,
+        (int32_t)((uint32_t)state->iv[iv->basic].step * (uint32_t)iv->scale));
+    return iv->reduced;
+}
+
+// i against a constant becomes a new variable of i against the
+// constant scaled. the scale must keep the order, and both the bound
+// and where i starts must stay far from wrapping around. a base that
+// is an address may sit anywhere, the test then stays on i
+void _ivsr_test(_ivsr_state *state, cfg_loop *loop, ir_inst *inst) {
+    _ivsr_iv *iv;
+    uint32_t n, o;
+    int64_t bound, start;
+    int32_t value;
+    int k, i_slot = 0;
+
+    for (k = 1; k < 3; k++) {
+        n = _ivsr_var(state, inst, k);
+        if (n != LIVE_NONE && state->iv[n].basic == n && IR_INST_MODE(inst, 3 - k) == IR_MODE_I)
+            i_slot = k;
+    }
+    if (i_slot == 0)
+        return;
+    n = _ivsr_var(state, inst, i_slot);
+    for (o = 0; o < state->order_count; o++) {
+        iv = &state->iv[state->order[o]];
+        if (iv->reduced <= 0 || iv->basic != n || iv->scale <= 0 || iv->base_mode != IR_MODE_I)
+            continue;
+        bound = (int64_t)inst->operand[3 - i_slot] * iv->scale + iv->offset;
+        if (bound < -0x40000000 || bound > 0x40000000 || !_ivsr_entry(state, loop, n, &value))
+            continue;
+        start = (int64_t)value * iv->scale + iv->offset;
+        if (start < -0x40000000 || start > 0x40000000)
+            continue;
+        inst->operand[3 - i_slot] = (int32_t)bound;
+        inst->mode[i_slot] = IR_MODE_T | IR_MODE_NORMAL;
+        inst->operand[i_slot] = iv->reduced;
+        return;
+    }
+}
+
+// 1 if anything in the loop changes
+int _ivsr_loop(_ivsr_state *state, cfg_loop *loop) {
+    cfg *graph = state->graph;
+    live_info *live = state->live;
+    ir_inst *inst, *copy;
+    _ivsr_iv *iv;
+    uint32_t *blocks, j, i, n, b, o;
+    int k, id, changed = 1, reduced = 0;
+
+    if (!edit_can_preheader(state->edit, loop->header))
+        return 0;
+    for (j = 0; j < loop->block_count; j++)
+        state->in_loop[loop->blocks[j]] = 1;
+    memset(state->def_count, 0, sizeof(uint32_t) * live->var_count);
+    memset(state->iv, 0, sizeof(_ivsr_iv) * live->var_count);
+    for (n = 0; n < live->var_count; n++)
+        state->iv[n].basic = LIVE_NONE;
+    state->order_count = 0;
+    _ivsr_scan(state, loop);
+    _ivsr_basic(state, loop);
+
+    blocks = malloc(sizeof(uint32_t) * loop->block_count);
+    for (j = 0; j < loop->block_count; j++)
+        blocks[j] = loop->blocks[j];
+    for (j = 1; j < loop->block_count; j++) {
+        for (b = blocks[j], i = j; i > 0 && blocks[i - 1] > b; i--)
+            blocks[i] = blocks[i - 1];
+        blocks[i] = b;
+    }
+    while (changed) {
+        changed = 0;
+        for (j = 0; j < loop->block_count; j++) {
+            for (i = graph->blocks[blocks[j]].first; i < graph->blocks[blocks[j]].last; i++)
+                changed |= _ivsr_derive(state, blocks[j], i);
+        }
+    }
+    free(blocks);
+    _ivsr_select(state, loop);
+
+    for (o = 0; o < state->order_count; o++) {
+        n = state->order[o];
+        iv = &state->iv[n];
+        if (iv->reduced == 0 && !iv->removed)
+            continue;
+        edit_remove(state->edit, iv->def);
+        if (iv->removed)
+            continue;
+        id = _ivsr_reduce(state, loop, n);
+        copy = edit_after(state->edit, iv->def);
+        copy->op = IR_EXP_OP_ASSIGN;
+        copy->mode[0] = live->var_mode[n] | IR_MODE_NORMAL;
+        copy->operand[0] = live->var_id[n];
+        copy->mode[1] = IR_MODE_T | IR_MODE_NORMAL;
+        copy->operand[1] = id;
+        reduced = 1;
+    }
+    if (!reduced) {
+        for (j = 0; j < loop->block_count; j++)
+            state->in_loop[loop->blocks[j]] = 0;
+        return 0;
+    }
+
+    // the tests, then the basic variables nothing reads any more
+    for (j = 0; j < loop->block_count; j++) {
+        i = graph->blocks[loop->blocks[j]].last - 1;
+        if (state->func->insts[i].op == IR_OP_IF_IMME)
+            _ivsr_test(state, loop, &state->func->insts[i]);
+    }
+    for (j = 0; j < loop->block_count; j++) {
+        for (i = graph->blocks[loop->blocks[j]].first; i < graph->blocks[loop->blocks[j]].last; i++) {
+            inst = &state->func->insts[i];
+            o = live_var(live, inst, 0);
+            if (ir_inst_writes(inst) && IR_INST_OP(inst, 0) == IR_MODE_NORMAL && o != LIVE_NONE
+                && state->iv[o].basic != LIVE_NONE && state->iv[o].def == i
+                && (state->iv[o].removed || state->iv[o].reduced))
+                continue;
+            for (k = 0; k < 3; k++) {
+                if (!(ir_inst_reads(inst) & (1 << k)))
+                    continue;
+                n = live_var(live, inst, k);
+                if (n != LIVE_NONE && state->iv[n].basic == n && state->iv[n].def != i)
+                    state->iv[n].needed = 1;
+            }
+        }
+    }
+    for (n = 0; n < live->var_count; n++) {
+        if (state->iv[n].basic == n && !state->iv[n].needed && !_ivsr_live_out(state, n))
+            edit_remove(state->edit, state->iv[n].def);
+    }
+    for (j = 0; j < loop->block_count; j++)
+        state->in_loop[loop->blocks[j]] = 0;
+    return 1;
+}
+
+void ivsr_run(ir_function *func) {
+    _ivsr_state state;
+    cfg_loop *loop;
+    char *blocked;
+    uint32_t l, p, i;
+    int stack_size = ir_stack_size(), moved = 1;
+
+    while (moved) {
+        moved = 0;
+        state.func = func;
+        state.live = live_compute(func);
+        state.graph = state.live->graph;
+        if (state.graph->loop_count == 0 || state.live->var_count == 0) {
+            live_destroy(state.live);
+            break;
+        }
+        state.edit = edit_begin(func, state.graph);
+        state.in_loop = calloc(state.graph->block_count, 1);
+        state.def_count = malloc(sizeof(uint32_t) * state.live->var_count);
+        state.iv = malloc(sizeof(_ivsr_iv) * state.live->var_count);
+        state.order = malloc(sizeof(uint32_t) * state.live->var_count);
+        state.exit_to = malloc(sizeof(uint32_t) * state.graph->block_count * 2);
+        blocked = calloc(state.graph->loop_count, 1);
+
+        for (l = state.graph->loop_count; l > 0; l--) {
+            loop = &state.graph->loops[l - 1];
+            if (blocked[l - 1] || !_ivsr_loop(&state, loop))
+                continue;
+            moved = 1;
+            for (p = loop->parent; p != CFG_NONE; p = state.graph->loops[p].parent)
+                blocked[p] = 1;
+        }
+        edit_commit(state.edit);
+
+        free(state.in_loop);
+        free(state.def_count);
+        free(state.iv);
+        free(state.order);
+        free(state.exit_to);
+        free(blocked);
+        live_destroy(state.live);
+    }
+
+    // new slots make the frame bigger
+    if (ir_stack_size() != stack_size) {
+        for (i = 0; i < func->count; i++) {
+            if (func->insts[i].op == IR_OP_DEC)
+                func->insts[i].operand[1] = ir_stack_size();
+        }
+    }
+}
@@ -1,54 +1,54 @@
 #include <stdlib.h>
 
 #include <ir.h>
+#include <context.h>
+#include <cfg.h>
 
-extern uint32_t _ir_label_count;
-
-uint32_t _ir_label_last_max = 0;
-
-void ir_compress_label(ir_list *ir_content) {
+void ir_compress_label(ir_function *func) {
     int *map;
     int i;
+    uint32_t from, to;
     char changed = 0;
-    int local_label_count = _ir_label_count - _ir_label_last_max;
-    ir_node *iterator = ir_content->head;
-    ir_node *free_node;
+    int local_label_count = cmmc_ctx->ir_label_count - cmmc_ctx->ir_label_last_max;
+    ir_inst *inst;
     if (local_label_count == 0) {
         // no labels at all
         return;
     }
     map = malloc(sizeof(int) * local_label_count);
     for (i = 0; i < local_label_count; i++) {
-        map[i] = _ir_label_last_max + i;
+        map[i] = cmmc_ctx->ir_label_last_max + i;
     }
-    while (iterator != NULL) {
-        if (iterator->content->op == IR_OP_LABEL) {
-            if (iterator->next != NULL) {
-                if (iterator->next->content->op == IR_OP_LABEL) {
-                    // drop next
-                    // map next to this
-                    changed = 1;
-                    map[iterator->next->content->goto_label - _ir_label_last_max] = iterator->content->goto_label;
-                    free_node = iterator->next;
-                    iterator->next = iterator->next->next;
-                    free(free_node->content);
-                    free(free_node);
-                    continue;
-                }
-            }
+    // compact the array in place, a label right after
+    // another one is dropped and mapped to it
+    for (from = 0, to = 0; from < func->count; from++) {
+        inst = &func->insts[from];
+        if (inst->op == IR_OP_LABEL && to > 0 && func->insts[to - 1].op == IR_OP_LABEL) {
+            changed = 1;
+            map[inst->operand[0] - cmmc_ctx->ir_label_last_max] = func->insts[to - 1].operand[0];
+            continue;
         }
-        iterator = iterator->next;
+        if (to != from)
+            func->insts[to] = *inst;
+        to++;
     }
+    func->count = to;
+    cfg_invalidate(func);
     if (changed) {
         // scan for usage
-        iterator = ir_content->head;
-        while (iterator != NULL) {
-            if (iterator->content->goto_label >= _ir_label_last_max && iterator->content->goto_label < _ir_label_count) {
-                iterator->content->goto_label = map[iterator->content->goto_label - _ir_label_last_max];
+        for (from = 0; from < func->count; from++) {
+            inst = &func->insts[from];
+            switch (inst->op) {
+                case IR_OP_GOTO:
+                case IR_OP_IF:
+                case IR_OP_IF_POSITIVE:
+                case IR_OP_IF_IMME:
+                    if (inst->operand[0] >= (int)cmmc_ctx->ir_label_last_max && inst->operand[0] < (int)cmmc_ctx->ir_label_count)
+                        inst->operand[0] = map[inst->operand[0] - cmmc_ctx->ir_label_last_max];
+                    break;
             }
-            iterator = iterator->next;
         }
     }
-    _ir_label_last_max = _ir_label_count;
+    cmmc_ctx->ir_label_last_max = cmmc_ctx->ir_label_count;
     free(map);
-}
\ No newline at end of file
+}
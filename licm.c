@@ -0,0 +1,220 @@
+/*
+    C-- Compiler Back End
+    Copyright (C) 2019 NSKernel. All rights reserved.
+
+    A lab of Compilers at Nanjing University
+
+    licm.c
+    Loop invariant code motion
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include <ir.h>
+#include <cfg.h>
+#include <live.h>
+#include <opt.h>
+#include <edit.h>
+
+// a computation inside a loop whose operands do not change while the
+// loop runs moves to a preheader, a block put right before the header
+// that only the edges coming from outside go through. its destination
+// must be written nowhere else in the loop and must not be read before
+// it in the loop. unless its block runs on every way out of the loop,
+// the destination must also be dead after the loop. a load moves only
+// if nothing in the loop writes memory and its block runs on every way
+// out, so that it never reads what the loop would not have read.
+//
+// a loop is done only once the loops inside it are, hoisting out of an
+// inner loop puts code in the outer one. each round handles the loops
+// whose inner loops had nothing to hoist, until nothing moves
+
+typedef struct _licm_state_t {
+    ir_function *func;
+    cfg *graph;
+    live_info *live;
+    char *in_loop;          // blocks of the loop at hand
+    uint32_t *def_count;    // writes of each variable in the loop
+    char *invariant;        // variables written by a hoisted instruction
+    char *hoisted;          // instructions leaving their loop
+    edit *edit;             // puts them in the preheaders, in the order
+                            // they were found
+    uint32_t *exit_from;    // edges leaving the loop at hand
+    uint32_t *exit_to;
+    uint32_t exit_count;
+} _licm_state;
+
+int _licm_operand(_licm_state *state, ir_inst *inst, int k, char memory_ok) {
+    uint32_t n;
+    if (IR_INST_MODE(inst, k) == IR_MODE_I || IR_INST_OP(inst, k) == IR_MODE_ADDR)
+        return 1;
+    n = live_var(state->live, inst, k);
+    if (n == LIVE_NONE)
+        return memory_ok;
+    if (state->def_count[n] != 0 && !state->invariant[n])
+        return 0;
+    return IR_INST_OP(inst, k) == IR_MODE_NORMAL || memory_ok;
+}
+
+// 1 if the loop writes memory, counts the writes to each variable
+int _licm_scan(_licm_state *state, cfg_loop *loop) {
+    ir_inst *inst;
+    uint32_t j, i, n;
+    int memory = 0;
+    for (j = 0; j < loop->block_count; j++) {
+        for (i = state->graph->blocks[loop->blocks[j]].first; i < state->graph->blocks[loop->blocks[j]].last; i++) {
+            inst = &state->func->insts[i];
+            if (inst->op == IR_OP_CALL)
+                memory = 1;
+            if (!ir_inst_writes(inst))
+                continue;
+            n = live_var(state->live, inst, 0);
+            if (IR_INST_OP(inst, 0) != IR_MODE_NORMAL || n == LIVE_NONE)
+                memory = 1;
+            else
+                state->def_count[n]++;
+        }
+    }
+    return memory;
+}
+
+// whether block b runs on every way out of the loop, and whether
+// variable n is dead on all of them
+void _licm_exits(_licm_state *state, uint32_t b, uint32_t n, int *dominates, int *dead) {
+    live_info *live = state->live;
+    uint32_t e;
+    *dominates = 1;
+    *dead = 1;
+    for (e = 0; e < state->exit_count; e++) {
+        if (!cfg_dominates(state->graph, b, state->exit_from[e]))
+            *dominates = 0;
+        if (LIVE_TEST(&live->live_in[state->exit_to[e] * live->words], n))
+            *dead = 0;
+    }
+}
+
+// 1 if anything in the loop moves
+int _licm_loop(_licm_state *state, cfg_loop *loop) {
+    cfg *graph = state->graph;
+    live_info *live = state->live;
+    ir_inst *inst;
+    uint32_t *blocks, j, i, n, b;
+    int memory, dominates, dead, k, mask, ok, moved = 0;
+    char changed = 1;
+
+    if (!edit_can_preheader(state->edit, loop->header))
+        return 0;
+    for (j = 0; j < loop->block_count; j++)
+        state->in_loop[loop->blocks[j]] = 1;
+    memset(state->def_count, 0, sizeof(uint32_t) * live->var_count);
+    memset(state->invariant, 0, live->var_count);
+    memory = _licm_scan(state, loop);
+    state->exit_count = 0;
+    for (j = 0; j < loop->block_count; j++) {
+        b = loop->blocks[j];
+        for (k = 0; k < (int)graph->blocks[b].succ_count; k++) {
+            if (state->in_loop[graph->blocks[b].succ[k]])
+                continue;
+            state->exit_from[state->exit_count] = b;
+            state->exit_to[state->exit_count++] = graph->blocks[b].succ[k];
+        }
+    }
+
+    // blocks in layout order, so that what an instruction reads is
+    // mostly hoisted before it in the same sweep
+    blocks = malloc(sizeof(uint32_t) * loop->block_count);
+    for (j = 0; j < loop->block_count; j++)
+        blocks[j] = loop->blocks[j];
+    for (j = 1; j < loop->block_count; j++) {
+        for (b = blocks[j], i = j; i > 0 && blocks[i - 1] > b; i--)
+            blocks[i] = blocks[i - 1];
+        blocks[i] = b;
+    }
+    while (changed) {
+        changed = 0;
+        for (j = 0; j < loop->block_count; j++) {
+            b = blocks[j];
+            for (i = graph->blocks[b].first; i < graph->blocks[b].last; i++) {
+                inst = &state->func->insts[i];
+                if (state->hoisted[i] || inst->op < IR_EXP_OP_ADD || inst->op > IR_EXP_OP_ASSIGN
+                    || inst->op == IR_EXP_OP_MACCESS || IR_INST_OP(inst, 0) != IR_MODE_NORMAL)
+                    continue;
+                n = live_var(live, inst, 0);
+                if (n == LIVE_NONE || state->def_count[n] != 1
+                    || LIVE_TEST(&live->live_in[loop->header * live->words], n))
+                    continue;
+                _licm_exits(state, b, n, &dominates, &dead);
+                // a division by zero or a load through a bad pointer
+                // must not happen where the loop would not have done it
+                if ((!dominates && !dead) || (!dominates && inst->op == IR_EXP_OP_DIV))
+                    continue;
+                mask = ir_inst_reads(inst);
+                ok = 1;
+                for (k = 1; k < 3 && ok; k++) {
+                    if (mask & (1 << k))
+                        ok = _licm_operand(state, inst, k, !memory && dominates);
+                }
+                if (!ok)
+                    continue;
+                state->hoisted[i] = 1;
+                state->invariant[n] = 1;
+                *edit_preheader(state->edit, loop->header) = *inst;
+                edit_remove(state->edit, i);
+                changed = moved = 1;
+            }
+        }
+    }
+    free(blocks);
+    for (j = 0; j < loop->block_count; j++)
+        state->in_loop[loop->blocks[j]] = 0;
+    return moved;
+}
+
+void licm_run(ir_function *func) {
+    _licm_state state;
+    cfg_loop *loop;
+    char *blocked;
+    uint32_t l, p;
+    int moved = 1;
+
+    while (moved) {
+        moved = 0;
+        state.func = func;
+        state.live = live_compute(func);
+        state.graph = state.live->graph;
+        if (state.graph->loop_count == 0 || state.live->var_count == 0) {
+            live_destroy(state.live);
+            return;
+        }
+        state.in_loop = calloc(state.graph->block_count, 1);
+        state.def_count = malloc(sizeof(uint32_t) * state.live->var_count);
+        state.invariant = malloc(state.live->var_count);
+        state.hoisted = calloc(func->count, 1);
+        state.edit = edit_begin(func, state.graph);
+        state.exit_from = malloc(sizeof(uint32_t) * state.graph->block_count * 2);
+        state.exit_to = malloc(sizeof(uint32_t) * state.graph->block_count * 2);
+        blocked = calloc(state.graph->loop_count, 1);
+
+        // inner loops come after the loops around them
+        for (l = state.graph->loop_count; l > 0; l--) {
+            loop = &state.graph->loops[l - 1];
+            if (blocked[l - 1] || !_licm_loop(&state, loop))
+                continue;
+            moved = 1;
+            for (p = loop->parent; p != CFG_NONE; p = state.graph->loops[p].parent)
+                blocked[p] = 1;
+        }
+        edit_commit(state.edit);
+
+        free(state.in_loop);
+        free(state.def_count);
+        free(state.invariant);
+        free(state.hoisted);
+        free(state.exit_from);
+        free(state.exit_to);
+        free(blocked);
+        live_destroy(state.live);
+    }
+}
@@ -0,0 +1,184 @@
+/*
+    C-- Compiler Back End
+    Copyright (C) 2019 NSKernel. All rights reserved.
+
+    A lab of Compilers at Nanjing University
+
+    live.c
+    Liveness of the variables of a function
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <limits.h>
+
+#include <ir.h>
+#include <cfg.h>
+#include <live.h>
+
+void _live_find_vars(live_info *live) {
+    ir_function *func = live->func;
+    ir_inst *inst;
+    int min_id = INT_MAX, max_id = INT_MIN;
+    uint32_t i, k, slot;
+
+    for (i = 0; i < func->count; i++) {
+        inst = &func->insts[i];
+        for (k = 0; k < 3; k++) {
+            if (IR_INST_MODE(inst, k) != IR_MODE_T && IR_INST_MODE(inst, k) != IR_MODE_V)
+                continue;
+            if (!((ir_inst_reads(inst) | ir_inst_writes(inst)) & (1 << k)))
+                continue;
+            if (inst->operand[k] < min_id)
+                min_id = inst->operand[k];
+            if (inst->operand[k] > max_id)
+                max_id = inst->operand[k];
+        }
+    }
+    live->var_count = 0;
+    if (min_id > max_id) {
+        live->min_id = 0;
+        live->slot_count = 0;
+        live->var_of = NULL;
+        live->var_id = NULL;
+        live->var_mode = NULL;
+        return;
+    }
+    min_id &= ~3;
+    live->min_id = min_id;
+    live->slot_count = ((max_id - min_id) >> 2) + 1;
+    live->var_of = malloc(sizeof(uint32_t) * live->slot_count);
+    live->var_id = malloc(sizeof(int) * live->slot_count);
+    live->var_mode = malloc(live->slot_count);
+    for (slot = 0; slot < live->slot_count; slot++)
+        live->var_of[slot] = 0;
+    // 1 for a slot that is used, 2 once its address is taken
+    for (i = 0; i < func->count; i++) {
+        inst = &func->insts[i];
+        for (k = 0; k < 3; k++) {
+            if (IR_INST_MODE(inst, k) != IR_MODE_T && IR_INST_MODE(inst, k) != IR_MODE_V)
+                continue;
+            if (!((ir_inst_reads(inst) | ir_inst_writes(inst)) & (1 << k)) || (inst->operand[k] & 3))
+                continue;
+            slot = (inst->operand[k] - min_id) >> 2;
+            if (IR_INST_OP(inst, k) == IR_MODE_ADDR)
+                live->var_of[slot] = 2;
+            else if (live->var_of[slot] == 0)
+                live->var_of[slot] = 1;
+            live->var_mode[slot] = IR_INST_MODE(inst, k);
+        }
+    }
+    for (slot = 0; slot < live->slot_count; slot++) {
+        if (live->var_of[slot] != 1) {
+            live->var_of[slot] = LIVE_NONE;
+            continue;
+        }
+        live->var_id[live->var_count] = min_id + (int)(slot << 2);
+        live->var_mode[live->var_count] = live->var_mode[slot];
+        live->var_of[slot] = live->var_count++;
+    }
+}
+
+uint32_t live_var(live_info *live, ir_inst *inst, int k) {
+    int id = inst->operand[k];
+    if (IR_INST_MODE(inst, k) != IR_MODE_T && IR_INST_MODE(inst, k) != IR_MODE_V)
+        return LIVE_NONE;
+    if (IR_INST_OP(inst, k) == IR_MODE_ADDR || (id & 3) || id < live->min_id)
+        return LIVE_NONE;
+    if ((uint32_t)((id - live->min_id) >> 2) >= live->slot_count)
+        return LIVE_NONE;
+    return live->var_of[(id - live->min_id) >> 2];
+}
+
+// set goes from what is live after inst to what is live before it
+void live_step(live_info *live, ir_inst *inst, uint32_t *set) {
+    uint32_t n;
+    int k, reads = ir_inst_reads(inst);
+    if (ir_inst_writes(inst) && IR_INST_OP(inst, 0) == IR_MODE_NORMAL) {
+        n = live_var(live, inst, 0);
+        if (n != LIVE_NONE)
+            LIVE_CLEAR(set, n);
+    }
+    for (k = 0; k < 3; k++) {
+        if (!(reads & (1 << k)))
+            continue;
+        n = live_var(live, inst, k);
+        if (n != LIVE_NONE)
+            LIVE_SET(set, n);
+    }
+}
+
+live_info *live_compute(ir_function *func) {
+    live_info *live = malloc(sizeof(live_info));
+    cfg *graph;
+    cfg_block *block;
+    uint32_t *gen, *kill, *set, *in, *out;
+    uint32_t b, i, s, w, word;
+    char changed = 1;
+
+    live->func = func;
+    live->graph = graph = cfg_get(func);
+    _live_find_vars(live);
+    live->words = (live->var_count + 31) >> 5;
+    live->live_in = calloc((size_t)graph->block_count * live->words + 1, sizeof(uint32_t));
+    live->live_out = calloc((size_t)graph->block_count * live->words + 1, sizeof(uint32_t));
+    if (live->var_count == 0)
+        return live;
+
+    // what each block reads before writing it, and what it writes
+    gen = calloc((size_t)graph->block_count * live->words, sizeof(uint32_t));
+    kill = calloc((size_t)graph->block_count * live->words, sizeof(uint32_t));
+    set = malloc(sizeof(uint32_t) * live->words);
+    for (b = 0; b < graph->block_count; b++) {
+        block = &graph->blocks[b];
+        for (i = block->last; i > block->first; i--) {
+            memset(set, 0, sizeof(uint32_t) * live->words);
+            live_step(live, &func->insts[i - 1], set);
+            if (ir_inst_writes(&func->insts[i - 1]) && IR_INST_OP(&func->insts[i - 1], 0) == IR_MODE_NORMAL) {
+                s = live_var(live, &func->insts[i - 1], 0);
+                if (s != LIVE_NONE) {
+                    LIVE_CLEAR(&gen[b * live->words], s);
+                    LIVE_SET(&kill[b * live->words], s);
+                }
+            }
+            for (w = 0; w < live->words; w++)
+                gen[b * live->words + w] |= set[w];
+        }
+    }
+
+    // blocks are mostly laid out in order, going backwards over them
+    // settles in a few rounds
+    while (changed) {
+        changed = 0;
+        for (b = graph->block_count; b > 0; b--) {
+            block = &graph->blocks[b - 1];
+            in = &live->live_in[(b - 1) * live->words];
+            out = &live->live_out[(b - 1) * live->words];
+            for (s = 0; s < block->succ_count; s++) {
+                for (w = 0; w < live->words; w++)
+                    out[w] |= live->live_in[block->succ[s] * live->words + w];
+            }
+            for (w = 0; w < live->words; w++) {
+                word = gen[(b - 1) * live->words + w] | (out[w] & ~kill[(b - 1) * live->words + w]);
+                if (word != in[w]) {
+                    in[w] = word;
+                    changed = 1;
+                }
+            }
+        }
+    }
+    free(gen);
+    free(kill);
+    free(set);
+    return live;
+}
+
+void live_destroy(live_info *live) {
+    free(live->var_of);
+    free(live->var_id);
+    free(live->var_mode);
+    free(live->live_in);
+    free(live->live_out);
+    free(live);
+}
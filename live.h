@@ -0,0 +1,49 @@
+/*
+    C-- Compiler Back End
+    Copyright (C) 2019 NSKernel. All rights reserved.
+
+    A lab of Compilers at Nanjing University
+
+    live.h
+    Liveness of the variables of a function
+*/
+
+#include <stdint.h>
+
+#include <ir.h>
+#include <cfg.h>
+
+#ifndef LIVE_H
+#define LIVE_H
+
+#define LIVE_NONE 0xFFFFFFFF
+
+typedef struct live_info_t live_info;
+
+// a variable is a t or v whose address is never taken, anything else
+// is memory and always live. sets are bit vectors of words words,
+// bit n standing for var_id[n]
+struct live_info_t {
+    ir_function *func;
+    cfg *graph;
+    int min_id;
+    uint32_t slot_count;
+    uint32_t *var_of;       // variable of frame slot (id - min_id) / 4
+    int *var_id;
+    uint8_t *var_mode;      // IR_MODE_T or IR_MODE_V
+    uint32_t var_count;
+    uint32_t words;
+    uint32_t *live_in;      // [b * words] for block b
+    uint32_t *live_out;
+};
+
+#define LIVE_TEST(set, n)  ((set)[(n) >> 5] & (1u << ((n) & 31)))
+#define LIVE_SET(set, n)   ((set)[(n) >> 5] |= 1u << ((n) & 31))
+#define LIVE_CLEAR(set, n) ((set)[(n) >> 5] &= ~(1u << ((n) & 31)))
+
+live_info *live_compute(ir_function *func);
+void live_destroy(live_info *live);
+uint32_t live_var(live_info *live, ir_inst *inst, int k);
+void live_step(live_info *live, ir_inst *inst, uint32_t *set);
+
+#endif
@@ -0,0 +1,324 @@
+/*
+    C-- Compiler Back End
+    Copyright (C) 2019 NSKernel. All rights reserved.
+
+    A lab of Compilers at Nanjing University
+
+    lvn.c
+    Local value numbering
+*/
+
+#include <stdlib.h>
+#include <stdint.h>
+
+#include <ir.h>
+#include <cfg.h>
+#include <live.h>
+#include <opt.h>
+
+// within a block, a computation on values already computed is a copy
+// of the variable still holding the earlier result. unlike gvn this
+// also sees through memory: a load is keyed on its pointer and on how
+// many times memory was written so far in the block, so a store through
+// a pointer, a call or a write to a variable whose address is taken
+// starts over. a store makes the value stored the one loaded next
+
+#define _LVN_CONST 0x40     // #a
+#define _LVN_ADDR  0x41     // &a
+#define _LVN_LOAD  0x42     // *a, b is the memory epoch
+#define _LVN_MEM   0x43     // variable a whose address is taken
+
+typedef struct _lvn_entry_t {
+    uint8_t op;
+    int32_t a;
+    int32_t b;
+    uint32_t value;
+    uint32_t next;
+} _lvn_entry;
+
+typedef struct _lvn_state_t {
+    live_info *live;
+    uint32_t *bucket;
+    uint32_t mask;
+    _lvn_entry *entries;
+    uint32_t entry_count;
+    uint32_t *var_value;    // value each variable holds
+    uint32_t *var_block;    // block var_value was set in, plus 1
+    uint32_t *holder;       // variable holding each value, LIVE_NONE if none
+    uint8_t *constant;      // whether a value is a constant
+    int32_t *constant_value;
+    uint32_t value_count;
+    int32_t epoch;
+    uint32_t block;
+} _lvn_state;
+
+uint32_t _lvn_new_value(_lvn_state *state) {
+    state->holder[state->value_count] = LIVE_NONE;
+    state->constant[state->value_count] = 0;
+    return state->value_count++;
+}
+
+uint32_t _lvn_hash(uint8_t op, int32_t a, int32_t b, uint32_t mask) {
+    uint32_t h = op;
+    h = h * 31 + (uint32_t)a;
+    h = h * 31 + (uint32_t)b;
+    return (h ^ (h >> 13)) & mask;
+}
+
+// value of a key, a new one if it has none yet and found set to 0
+uint32_t _lvn_lookup(_lvn_state *state, uint8_t op, int32_t a, int32_t b, int *found) {
+    uint32_t h = _lvn_hash(op, a, b, state->mask), e;
+    _lvn_entry *entry;
+    for (e = state->bucket[h]; e != LIVE_NONE; e = entry->next) {
+        entry = &state->entries[e];
+        if (entry->op == op && entry->a == a && entry->b == b) {
+            *found = 1;
+            return entry->value;
+        }
+    }
+    *found = 0;
+    entry = &state->entries[state->entry_count];
+    entry->op = op;
+    entry->a = a;
+    entry->b = b;
+    entry->value = _lvn_new_value(state);
+    entry->next = state->bucket[h];
+    state->bucket[h] = state->entry_count++;
+    return entry->value;
+}
+
+// make key stand for value
+void _lvn_bind(_lvn_state *state, uint8_t op, int32_t a, int32_t b, uint32_t value) {
+    uint32_t h = _lvn_hash(op, a, b, state->mask);
+    _lvn_entry *entry = &state->entries[state->entry_count];
+    entry->op = op;
+    entry->a = a;
+    entry->b = b;
+    entry->value = value;
+    entry->next = state->bucket[h];
+    state->bucket[h] = state->entry_count++;
+}
+
+void _lvn_clear(_lvn_state *state) {
+    while (state->entry_count > 0) {
+        state->entry_count--;
+        state->bucket[_lvn_hash(state->entries[state->entry_count].op, state->entries[state->entry_count].a,
+            state->entries[state->entry_count].b, state->mask)] = LIVE_NONE;
+    }
+}
+
+uint32_t _lvn_var(_lvn_state *state, uint32_t n) {
+    if (state->var_block[n] != state->block + 1) {
+        state->var_block[n] = state->block + 1;
+        state->var_value[n] = _lvn_new_value(state);
+        state->holder[state->var_value[n]] = n;
+    }
+    return state->var_value[n];
+}
+
+int _lvn_holds(_lvn_state *state, uint32_t value) {
+    uint32_t n = state->holder[value];
+    return n != LIVE_NONE && state->var_block[n] == state->block + 1 && state->var_value[n] == value;
+}
+
+// value read by operand k
+uint32_t _lvn_operand(_lvn_state *state, ir_inst *inst, int k) {
+    uint32_t n, value;
+    int found;
+    if (IR_INST_MODE(inst, k) == IR_MODE_I) {
+        value = _lvn_lookup(state, _LVN_CONST, inst->operand[k], 0, &found);
+        state->constant[value] = 1;
+        state->constant_value[value] = inst->operand[k];
+        return value;
+    }
+    if (IR_INST_OP(inst, k) == IR_MODE_ADDR)
+        return _lvn_lookup(state, _LVN_ADDR, inst->operand[k], 0, &found);
+    n = live_var(state->live, inst, k);
+    if (n != LIVE_NONE)
+        value = _lvn_var(state, n);
+    else
+        value = _lvn_lookup(state, _LVN_MEM, inst->operand[k], state->epoch, &found);
+    if (IR_INST_OP(inst, k) == IR_MODE_STAR)
+        value = _lvn_lookup(state, _LVN_LOAD, (int32_t)value, state->epoch, &found);
+    return value;
+}
+
+// the write of inst, value is what it writes
+void _lvn_write(_lvn_state *state, ir_inst *inst, uint32_t value) {
+    uint32_t n, pointer;
+    int found;
+    if (IR_INST_OP(inst, 0) == IR_MODE_STAR) {
+        n = live_var(state->live, inst, 0);
+        if (n != LIVE_NONE)
+            pointer = _lvn_var(state, n);
+        else
+            pointer = _lvn_lookup(state, _LVN_MEM, inst->operand[0], state->epoch, &found);
+        state->epoch++;
+        _lvn_bind(state, _LVN_LOAD, (int32_t)pointer, state->epoch, value);
+        return;
+    }
+    n = live_var(state->live, inst, 0);
+    if (n == LIVE_NONE) {
+        state->epoch++;
+        _lvn_bind(state, _LVN_MEM, inst->operand[0], state->epoch, value);
+        return;
+    }
+    state->var_block[n] = state->block + 1;
+    state->var_value[n] = value;
+    if (!_lvn_holds(state, value))
+        state->holder[value] = n;
+}
+
+void _lvn_key(ir_inst *inst, uint32_t *a, uint32_t *b, uint8_t *op) {
+    uint32_t swap;
+    *op = inst->op;
+    switch (inst->op) {
+        case IR_EXP_OP_GT:
+            *op = IR_EXP_OP_LT;
+            break;
+        case IR_EXP_OP_GE:
+            *op = IR_EXP_OP_LE;
+            break;
+        case IR_EXP_OP_ADD:
+        case IR_EXP_OP_MUL:
+        case IR_EXP_OP_EQ:
+        case IR_EXP_OP_NEQ:
+        case IR_EXP_OP_AND:
+        case IR_EXP_OP_OR:
+            if (*a <= *b)
+                return;
+            break;
+        default:
+            return;
+    }
+    swap = *a;
+    *a = *b;
+    *b = swap;
+}
+
+// make operand k read value from the variable holding it, or as an
+// immediate. 0 if neither is at hand
+int _lvn_reuse(_lvn_state *state, ir_inst *inst, int k, uint32_t value) {
+    uint32_t h;
+    if (_lvn_holds(state, value)) {
+        h = state->holder[value];
+        inst->mode[k] = state->live->var_mode[h] | IR_MODE_NORMAL;
+        inst->operand[k] = state->live->var_id[h];
+        return 1;
+    }
+    if (state->constant[value]) {
+        inst->mode[k] = IR_MODE_I;
+        inst->operand[k] = state->constant_value[value];
+        return 1;
+    }
+    return 0;
+}
+
+// value of operand k, a load of something already at hand is replaced
+// with it
+uint32_t _lvn_read(_lvn_state *state, ir_inst *inst, int k) {
+    uint32_t value = _lvn_operand(state, inst, k);
+    if (IR_INST_MODE(inst, k) != IR_MODE_I && IR_INST_OP(inst, k) != IR_MODE_ADDR
+        && (IR_INST_OP(inst, k) == IR_MODE_STAR || live_var(state->live, inst, k) == LIVE_NONE))
+        _lvn_reuse(state, inst, k, value);
+    return value;
+}
+
+void _lvn_block(_lvn_state *state, cfg_block *block) {
+    ir_function *func = state->live->func;
+    ir_inst *inst;
+    uint32_t i, a, b, value;
+    uint8_t op;
+    int k, found;
+
+    _lvn_clear(state);
+    state->epoch = 0;
+    for (i = block->first; i < block->last; i++) {
+        inst = &func->insts[i];
+        if (inst->op >= IR_EXP_OP_ADD && inst->op <= IR_EXP_OP_ASSIGN && inst->op != IR_EXP_OP_MACCESS) {
+            a = _lvn_read(state, inst, 1);
+            if (inst->op == IR_EXP_OP_ASSIGN) {
+                value = a;
+            }
+            else {
+                b = inst->op == IR_EXP_OP_NOT ? 0 : _lvn_read(state, inst, 2);
+                _lvn_key(inst, &a, &b, &op);
+                value = _lvn_lookup(state, op, (int32_t)a, (int32_t)b, &found);
+                if (found && _lvn_reuse(state, inst, 1, value)) {
+                    inst->op = IR_EXP_OP_ASSIGN;
+                    inst->mode[2] = IR_MODE_I;
+                    inst->operand[2] = 0;
+                }
+            }
+            _lvn_write(state, inst, value);
+            continue;
+        }
+        switch (inst->op) {
+            case IR_OP_CALL:
+                // the callee may write anything it has a pointer to
+                state->epoch++;
+            case IR_OP_READ:
+            case IR_OP_PARAM:
+                _lvn_write(state, inst, _lvn_new_value(state));
+                break;
+            default:
+                for (k = 1; k < 3; k++) {
+                    if (ir_inst_reads(inst) & (1 << k))
+                        _lvn_read(state, inst, k);
+                }
+        }
+    }
+}
+
+void lvn_run(ir_function *func) {
+    _lvn_state state;
+    cfg *graph;
+    ir_inst *inst;
+    uint32_t size = 16, b, from, to;
+
+    state.live = live_compute(func);
+    graph = state.live->graph;
+    while (size < func->count * 4)
+        size *= 2;
+    state.mask = size - 1;
+    state.bucket = malloc(sizeof(uint32_t) * size);
+    for (b = 0; b < size; b++)
+        state.bucket[b] = LIVE_NONE;
+    // two keys for each of three operands and one for the result, and
+    // a value for each variable read on top of that
+    state.entries = malloc(sizeof(_lvn_entry) * (func->count * 7 + 1));
+    state.entry_count = 0;
+    state.holder = malloc(sizeof(uint32_t) * (func->count * 10 + 1));
+    state.constant = malloc(func->count * 10 + 1);
+    state.constant_value = malloc(sizeof(int32_t) * (func->count * 10 + 1));
+    state.value_count = 0;
+    state.var_value = malloc(sizeof(uint32_t) * (state.live->var_count + 1));
+    state.var_block = calloc(state.live->var_count + 1, sizeof(uint32_t));
+    for (b = 0; b < graph->block_count; b++) {
+        state.block = b;
+        _lvn_block(&state, &graph->blocks[b]);
+    }
+    // a load into the variable already holding it is left as a copy
+    // to itself
+    for (from = 0, to = 0; from < func->count; from++) {
+        inst = &func->insts[from];
+        if (inst->op == IR_EXP_OP_ASSIGN && inst->mode[0] == inst->mode[1] && inst->operand[0] == inst->operand[1]
+            && IR_INST_OP(inst, 0) == IR_MODE_NORMAL)
+            continue;
+        if (to != from)
+            func->insts[to] = *inst;
+        to++;
+    }
+    if (to != func->count) {
+        func->count = to;
+        cfg_invalidate(func);
+    }
+    free(state.bucket);
+    free(state.entries);
+    free(state.holder);
+    free(state.constant);
+    free(state.constant_value);
+    free(state.var_value);
+    free(state.var_block);
+    live_destroy(state.live);
+}
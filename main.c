@@ -9,14 +9,17 @@
 */
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <getopt.h>
+#include <string.h>
 #include <stdint.h>
+#include <pthread.h>
 
 #include <ast.h>
-#include <semantics.h>
 #include <global.h>
+#include <context.h>
 
-static const char *opt_string = "vV";
+static const char *opt_string = "vVf:j:o:O::";
 static const struct option long_opts[] = {
     { "verbose", no_argument, NULL, 'v' },
     { "version", no_argument, NULL, 'V' },
@@ -26,12 +29,23 @@ static const struct option long_opts[] = {
 char spaces[100];
 int space_count = 0;
 
+struct global_args_t global_args;
 
-extern FILE *yyin;
-extern int yylex();
-extern int yyparse(void);
-extern char error_flag;
-extern ast_node *root_node;
+// files handed out to the workers of compile_files
+struct compile_queue_t {
+    char **inputs;
+    char **outputs;
+    char **diags;           // what each file reported, printed in input order
+    size_t *diag_sizes;
+    char **reports;         // -ftime-report and -fmem-report, likewise
+    size_t *report_sizes;
+    int *results;
+    char *done;
+    int count;
+    int next;
+    pthread_mutex_t lock;
+    pthread_cond_t finished;
+} compile_queue;
 
 #ifdef DEBUG
 extern char yydebug;
@@ -40,37 +54,39 @@ extern char yydebug;
 void print_ast(ast_node *current_node)
 {
 	int iterator;
-	printf("%s%s (%d)\n", spaces, current_node->name, current_node->line_number);
+	ast_node *child;
+	printf("%s%s (%d)\n", spaces, ast_kind_names[current_node->kind], current_node->line_number);
 	for (iterator = 0; iterator < current_node->children_count; iterator++)
 	{
 		spaces[space_count] = ' ';
 		spaces[space_count + 1] = ' ';
 		space_count += 2;
-		if (current_node->children[iterator] != NULL)
+		child = current_node->children[iterator];
+		if (child != NULL)
 		{
-			if (current_node->children[iterator]->is_terminal)
+			if (AST_IS_TERMINAL(child->kind))
 			{
-
-				if (current_node->children[iterator]->terminal_type == T_ID_TYPE)
-				{
-					printf("%s%s: %s\n", spaces, current_node->children[iterator]->name, current_node->children[iterator]->string_value);
-				}
-				else if (current_node->children[iterator]->terminal_type == T_INT)
-				{
-					printf("%s%s: %d\n", spaces, current_node->children[iterator]->name, current_node->children[iterator]->int_value);
-				}
-				else if (current_node->children[iterator]->terminal_type == T_FLOAT)
-				{
-					printf("%s%s: %f\n", spaces, current_node->children[iterator]->name, current_node->children[iterator]->float_value);
-				}
-				else
+				switch (child->kind)
 				{
-					printf("%s%s\n", spaces, current_node->children[iterator]->name);
+					case AST_ID:
+						printf("%s%s: %s\n", spaces, ast_kind_names[child->kind], child->string_value);
+						break;
+					case AST_TYPE:
+						printf("%s%s: %s\n", spaces, ast_kind_names[child->kind], child->subkind == AST_TYPE_INT ? "int" : "float");
+						break;
+					case AST_INT:
+						printf("%s%s: %d\n", spaces, ast_kind_names[child->kind], child->int_value);
+						break;
+					case AST_FLOAT:
+						printf("%s%s: %f\n", spaces, ast_kind_names[child->kind], child->float_value);
+						break;
+					default:
+						printf("%s%s\n", spaces, ast_kind_names[child->kind]);
 				}
 			}
 			else
 			{
-				print_ast(current_node->children[iterator]);
+				print_ast(child);
 			}
 		}
 		
@@ -81,14 +97,125 @@ void print_ast(ast_node *current_node)
 	
 }
 
+// outdir/name.s for outdir/../name.cmm
+char *output_path(const char *dir, const char *input) {
+    const char *name = strrchr(input, '/');
+    const char *dot;
+    char *ret;
+    size_t name_length;
+    name = name ? name + 1 : input;
+    dot = strrchr(name, '.');
+    name_length = dot && dot != name ? (size_t)(dot - name) : strlen(name);
+    ret = malloc(strlen(dir) + name_length + 4);
+    sprintf(ret, "%s/%.*s.s", dir, (int)name_length, name);
+    return ret;
+}
+
+void *compile_worker(void *arg) {
+    cmmc_context *ctx = cmmc_context_new(&global_args);
+    int i;
+    for (;;) {
+        pthread_mutex_lock(&compile_queue.lock);
+        i = compile_queue.next++;
+        pthread_mutex_unlock(&compile_queue.lock);
+        if (i >= compile_queue.count)
+            break;
+        ctx->diag_file = open_memstream(&compile_queue.diags[i], &compile_queue.diag_sizes[i]);
+        ctx->report_file = open_memstream(&compile_queue.reports[i], &compile_queue.report_sizes[i]);
+        compile_queue.results[i] = cmmc_compile(ctx, compile_queue.inputs[i], compile_queue.outputs[i]);
+        fclose(ctx->diag_file);
+        fclose(ctx->report_file);
+        pthread_mutex_lock(&compile_queue.lock);
+        compile_queue.done[i] = 1;
+        pthread_cond_signal(&compile_queue.finished);
+        pthread_mutex_unlock(&compile_queue.lock);
+    }
+    cmmc_context_free(ctx);
+    return NULL;
+}
+
+// compile every input into the output directory on a pool of jobs
+// threads, each with its own context. diagnostics are collected per
+// file and printed in input order as soon as the files before are done
+int compile_files(char **inputs, int count, int jobs) {
+    pthread_t *workers;
+    int i;
+    int failed = 0;
+
+    if (jobs < 1)
+        jobs = 1;
+    if (jobs > count)
+        jobs = count;
+    compile_queue.inputs = inputs;
+    compile_queue.outputs = malloc(sizeof(char *) * count);
+    compile_queue.diags = calloc(count, sizeof(char *));
+    compile_queue.diag_sizes = calloc(count, sizeof(size_t));
+    compile_queue.reports = calloc(count, sizeof(char *));
+    compile_queue.report_sizes = calloc(count, sizeof(size_t));
+    compile_queue.results = calloc(count, sizeof(int));
+    compile_queue.done = calloc(count, sizeof(char));
+    compile_queue.count = count;
+    compile_queue.next = 0;
+    pthread_mutex_init(&compile_queue.lock, NULL);
+    pthread_cond_init(&compile_queue.finished, NULL);
+    for (i = 0; i < count; i++)
+        compile_queue.outputs[i] = output_path(global_args.output_dir, inputs[i]);
+
+    workers = malloc(sizeof(pthread_t) * jobs);
+    for (i = 0; i < jobs; i++)
+        pthread_create(&workers[i], NULL, compile_worker, NULL);
+    for (i = 0; i < count; i++) {
+        pthread_mutex_lock(&compile_queue.lock);
+        while (!compile_queue.done[i])
+            pthread_cond_wait(&compile_queue.finished, &compile_queue.lock);
+        pthread_mutex_unlock(&compile_queue.lock);
+        if (compile_queue.diag_sizes[i] > 0) {
+            if (count > 1)
+                printf("%s:\n", inputs[i]);
+            fwrite(compile_queue.diags[i], 1, compile_queue.diag_sizes[i], stdout);
+        }
+        fflush(stdout);
+        fwrite(compile_queue.reports[i], 1, compile_queue.report_sizes[i], stderr);
+        if (compile_queue.results[i] < 0)
+            failed = 1;
+        free(compile_queue.diags[i]);
+        free(compile_queue.reports[i]);
+        free(compile_queue.outputs[i]);
+    }
+    for (i = 0; i < jobs; i++)
+        pthread_join(workers[i], NULL);
+
+    pthread_cond_destroy(&compile_queue.finished);
+    pthread_mutex_destroy(&compile_queue.lock);
+    free(workers);
+    free(compile_queue.outputs);
+    free(compile_queue.diags);
+    free(compile_queue.diag_sizes);
+    free(compile_queue.reports);
+    free(compile_queue.report_sizes);
+    free(compile_queue.results);
+    free(compile_queue.done);
+    return failed;
+}
+
 int main(int argc, char** argv)
 {
     int opt;
     int long_index;
+    int ret;
+    cmmc_context *ctx;
 
     // parse arguments
     global_args.print_version = 0;
     global_args.verbose = 0;
+    global_args.no_regalloc = 0;
+    global_args.no_peephole = 0;
+    global_args.time_report = REPORT_OFF;
+    global_args.mem_report = REPORT_OFF;
+    global_args.opt_level = 1;
+    global_args.inline_limit = 24;
+    global_args.jobs = 1;
+    global_args.output_dir = NULL;
 
     opt = getopt_long(argc, argv, opt_string, long_opts, &long_index);
     while (opt != -1) {
@@ -98,6 +225,56 @@ int main(int argc, char** argv)
               break;
             case 'v':
               global_args.verbose = 1;
+              break;
+            case 'f':
+              if (!strcmp(optarg, "no-regalloc")) {
+                  // keep everything on the stack
+                  global_args.no_regalloc = 1;
+              }
+              else if (!strcmp(optarg, "regalloc")) {
+                  global_args.no_regalloc = 0;
+              }
+              else if (!strcmp(optarg, "no-peephole")) {
+                  global_args.no_peephole = 1;
+              }
+              else if (!strcmp(optarg, "peephole")) {
+                  global_args.no_peephole = 0;
+              }
+              else if (!strncmp(optarg, "inline-limit=", 13)) {
+                  global_args.inline_limit = atoi(optarg + 13);
+              }
+              else if (!strcmp(optarg, "no-inline")) {
+                  global_args.inline_limit = 0;
+              }
+              else if (!strcmp(optarg, "time-report")) {
+                  global_args.time_report = REPORT_TABLE;
+              }
+              else if (!strcmp(optarg, "time-report=json")) {
+                  global_args.time_report = REPORT_JSON;
+              }
+              else if (!strcmp(optarg, "mem-report")) {
+                  global_args.mem_report = REPORT_TABLE;
+              }
+              else if (!strcmp(optarg, "mem-report=json")) {
+                  global_args.mem_report = REPORT_JSON;
+              }
+              else {
+                  printf("cmmc: warning: unknown option -f%s\n", optarg);
+              }
+              break;
+            case 'O':
+              global_args.opt_level = optarg ? atoi(optarg) : 1;
+              break;
+            case 'j':
+              global_args.jobs = atoi(optarg);
+              if (global_args.jobs < 1) {
+                  printf("cmmc: warning: bad job count -j%s, using 1\n", optarg);
+                  global_args.jobs = 1;
+              }
+              break;
+            case 'o':
+              global_args.output_dir = optarg;
+              break;
             default:
               /* You won't actually get here. */
               break;
@@ -111,16 +288,17 @@ int main(int argc, char** argv)
         return 0;
     }
 
-    if (argc - optind > 1) {
+    if (global_args.output_dir != NULL && argc - optind > 0) {
+        return compile_files(argv + optind, argc - optind, global_args.jobs);
+    }
+    else if (global_args.output_dir == NULL && argc - optind > 1) {
         global_args.input_file = argv[optind];
         global_args.output_file = argv[optind + 1];
-        output_file = fopen(global_args.output_file, "w+");
-        if (output_file == NULL) {
-            printf("cmmc: \033[0;31merror\033[0m: cannot write file %s\n", global_args.output_file);
-        }
     }
     else {
-        printf("Usage: cmmc <file_path> <output_path>\n");
+        printf("Usage: cmmc [-O0|-O1] [-f...] <file_path> <output_path>\n");
+        printf("       cmmc [-O0|-O1] [-f...] [-j N] <file_path>... -o <output_dir>\n");
+        printf("  -fno-regalloc, -fno-peephole, -finline-limit=N, -fno-inline, -ftime-report[=json], -fmem-report[=json]\n");
         return -1;
     }
 
@@ -128,22 +306,11 @@ int main(int argc, char** argv)
         printf("cmmc: warning: ignoring extra arguments\n");
     }
 
-    if (argc > 1)
-        if(!(yyin = fopen(global_args.input_file, "r")))
-		{
-            printf("cmmc: \033[0;31merror\033[0m: cannot open file %s\n", global_args.input_file);
-            return 1;
-        }
 #ifdef PRINT_BISON_DEBUG_INFO
     yydebug = 1;
 #endif
-    yyparse();
-	if (!error_flag)
-	{
-		memset(spaces, 0, 100 * sizeof(char));
-		//print_ast(root_node);
-        sem_validate(root_node);
-	}
-    fclose(output_file);
-	return 0;
-}
\ No newline at end of file
+    ctx = cmmc_context_new(&global_args);
+    ret = cmmc_compile(ctx, global_args.input_file, global_args.output_file);
+    cmmc_context_free(ctx);
+	return ret < 0 ? 1 : 0;
+}
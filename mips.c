@@ -0,0 +1,254 @@
+/*
+    C-- Compiler Back End
+    Copyright (C) 2019 NSKernel. All rights reserved.
+
+    A lab of Compilers at Nanjing University
+
+    mips.c
+    MIPS instructions of the function being generated
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include <mips.h>
+#include <emit.h>
+#include <context.h>
+
+#define _MIPS_FORM_LABEL    0   // labelN:
+#define _MIPS_FORM_FUNC     1   // _name :
+#define _MIPS_FORM_RRR      2   // add $rd, $rs, $rt
+#define _MIPS_FORM_RRI      3   // addi $rt, $rs, imm
+#define _MIPS_FORM_RR       4   // move $rd, $rs
+#define _MIPS_FORM_RI       5   // li $rt, imm
+#define _MIPS_FORM_R        6   // jr $rs
+#define _MIPS_FORM_MEM      7   // lw $rt, imm($base)
+#define _MIPS_FORM_BRANCH   8   // beq $rs, $rt, labelN
+#define _MIPS_FORM_JUMP     9   // j labelN or j _name
+
+const char *mips_reg_names[32] = {
+    "zero", "at", "v0", "v1", "a0", "a1", "a2", "a3",
+    "t0", "t1", "t2", "t3", "t4", "t5", "t6", "t7",
+    "s0", "s1", "s2", "s3", "s4", "s5", "s6", "s7",
+    "t8", "t9", "k0", "k1", "gp", "sp", "fp", "ra"
+};
+
+const struct {
+    const char *name;
+    uint8_t form;
+} _mips_ops[MIPS_OP_COUNT] = {
+    [MIPS_LABEL]    = { "",      _MIPS_FORM_LABEL },
+    [MIPS_FUNC]     = { "",      _MIPS_FORM_FUNC },
+    [MIPS_ADD]      = { "add",   _MIPS_FORM_RRR },
+    [MIPS_SUB]      = { "sub",   _MIPS_FORM_RRR },
+    [MIPS_MUL]      = { "mul",   _MIPS_FORM_RRR },
+    [MIPS_DIV]      = { "div",   _MIPS_FORM_RR },
+    [MIPS_MFLO]     = { "mflo",  _MIPS_FORM_R },
+    [MIPS_MOVE]     = { "move",  _MIPS_FORM_RR },
+    [MIPS_LI]       = { "li",    _MIPS_FORM_RI },
+    [MIPS_ADDI]     = { "addi",  _MIPS_FORM_RRI },
+    [MIPS_LW]       = { "lw",    _MIPS_FORM_MEM },
+    [MIPS_SW]       = { "sw",    _MIPS_FORM_MEM },
+    [MIPS_BEQ]      = { "beq",   _MIPS_FORM_BRANCH },
+    [MIPS_BNE]      = { "bne",   _MIPS_FORM_BRANCH },
+    [MIPS_BGE]      = { "bge",   _MIPS_FORM_BRANCH },
+    [MIPS_BGT]      = { "bgt",   _MIPS_FORM_BRANCH },
+    [MIPS_BLT]      = { "blt",   _MIPS_FORM_BRANCH },
+    [MIPS_BLE]      = { "ble",   _MIPS_FORM_BRANCH },
+    [MIPS_J]        = { "j",     _MIPS_FORM_JUMP },
+    [MIPS_JAL]      = { "jal",   _MIPS_FORM_JUMP },
+    [MIPS_JR]       = { "jr",    _MIPS_FORM_R },
+    [MIPS_SLT]      = { "slt",   _MIPS_FORM_RRR },
+    [MIPS_SLTU]     = { "sltu",  _MIPS_FORM_RRR },
+    [MIPS_XOR]      = { "xor",   _MIPS_FORM_RRR },
+    [MIPS_AND]      = { "and",   _MIPS_FORM_RRR },
+    [MIPS_OR]       = { "or",    _MIPS_FORM_RRR },
+    [MIPS_XORI]     = { "xori",  _MIPS_FORM_RRI },
+    [MIPS_SLTIU]    = { "sltiu", _MIPS_FORM_RRI },
+    [MIPS_SLTI]     = { "slti",  _MIPS_FORM_RRI },
+    [MIPS_SLL]      = { "sll",   _MIPS_FORM_RRI },
+    [MIPS_SRA]      = { "sra",   _MIPS_FORM_RRI },
+    [MIPS_SRL]      = { "srl",   _MIPS_FORM_RRI },
+    [MIPS_MULT]     = { "mult",  _MIPS_FORM_RR },
+    [MIPS_MFHI]     = { "mfhi",  _MIPS_FORM_R },
+};
+
+mips_inst *_mips_append(uint8_t op) {
+    mips_inst *inst;
+    if (cmmc_ctx->cg_mips_count == cmmc_ctx->cg_mips_capacity) {
+        cmmc_ctx->cg_mips_capacity = cmmc_ctx->cg_mips_capacity ? 2 * cmmc_ctx->cg_mips_capacity : 256;
+        cmmc_ctx->cg_mips_insts = realloc(cmmc_ctx->cg_mips_insts, sizeof(mips_inst) * cmmc_ctx->cg_mips_capacity);
+    }
+    inst = &cmmc_ctx->cg_mips_insts[cmmc_ctx->cg_mips_count++];
+    memset(inst, 0, sizeof(mips_inst));
+    inst->op = op;
+    return inst;
+}
+
+void mips_rrr(uint8_t op, int rd, int rs, int rt) {
+    mips_inst *inst = _mips_append(op);
+    inst->reg[0] = rd;
+    inst->reg[1] = rs;
+    inst->reg[2] = rt;
+}
+
+void mips_rri(uint8_t op, int rt, int rs, int imm) {
+    mips_inst *inst = _mips_append(op);
+    inst->reg[0] = rt;
+    inst->reg[1] = rs;
+    inst->imm = imm;
+}
+
+void mips_rr(uint8_t op, int rd, int rs) {
+    mips_inst *inst = _mips_append(op);
+    inst->reg[0] = rd;
+    inst->reg[1] = rs;
+}
+
+void mips_ri(uint8_t op, int rt, int imm) {
+    mips_inst *inst = _mips_append(op);
+    inst->reg[0] = rt;
+    inst->imm = imm;
+}
+
+void mips_r(uint8_t op, int rs) {
+    mips_inst *inst = _mips_append(op);
+    inst->reg[0] = rs;
+}
+
+void mips_mem(uint8_t op, int rt, int offset, int base) {
+    mips_inst *inst = _mips_append(op);
+    inst->reg[0] = rt;
+    inst->reg[1] = base;
+    inst->imm = offset;
+}
+
+void mips_branch(uint8_t op, int rs, int rt, int label) {
+    mips_inst *inst = _mips_append(op);
+    inst->reg[0] = rs;
+    inst->reg[1] = rt;
+    inst->imm = label;
+}
+
+void mips_jump(uint8_t op, int label) {
+    mips_inst *inst = _mips_append(op);
+    inst->imm = label;
+}
+
+void mips_call(uint8_t op, const char *name) {
+    mips_inst *inst = _mips_append(op);
+    inst->name = name;
+}
+
+void mips_label(int label) {
+    mips_inst *inst = _mips_append(MIPS_LABEL);
+    inst->imm = label;
+}
+
+void mips_func(const char *name) {
+    mips_inst *inst = _mips_append(MIPS_FUNC);
+    inst->name = name;
+}
+
+// whether inst writes to or reads reg, calls are taken to do both
+// with every register
+int mips_writes(mips_inst *inst, int reg) {
+    switch (_mips_ops[inst->op].form) {
+        case _MIPS_FORM_RRR:
+        case _MIPS_FORM_RRI:
+        case _MIPS_FORM_RI:
+            return inst->reg[0] == reg;
+        case _MIPS_FORM_RR:
+            // div and mult write hi and lo only
+            return inst->op != MIPS_DIV && inst->op != MIPS_MULT && inst->reg[0] == reg;
+        case _MIPS_FORM_R:
+            return (inst->op == MIPS_MFLO || inst->op == MIPS_MFHI) && inst->reg[0] == reg;
+        case _MIPS_FORM_MEM:
+            return inst->op == MIPS_LW && inst->reg[0] == reg;
+        case _MIPS_FORM_JUMP:
+            return inst->op == MIPS_JAL;
+    }
+    return 0;
+}
+
+int mips_reads(mips_inst *inst, int reg) {
+    switch (_mips_ops[inst->op].form) {
+        case _MIPS_FORM_RRR:
+            return inst->reg[1] == reg || inst->reg[2] == reg;
+        case _MIPS_FORM_RRI:
+            return inst->reg[1] == reg;
+        case _MIPS_FORM_RR:
+            return inst->reg[1] == reg || ((inst->op == MIPS_DIV || inst->op == MIPS_MULT) && inst->reg[0] == reg);
+        case _MIPS_FORM_R:
+            return inst->op == MIPS_JR && inst->reg[0] == reg;
+        case _MIPS_FORM_MEM:
+            return inst->reg[1] == reg || (inst->op == MIPS_SW && inst->reg[0] == reg);
+        case _MIPS_FORM_BRANCH:
+            return inst->reg[0] == reg || inst->reg[1] == reg;
+        case _MIPS_FORM_JUMP:
+            return inst->op == MIPS_JAL;
+    }
+    return 0;
+}
+
+// functions other than main get an underscore, read and write are ours
+void _mips_print_symbol(const char *name) {
+    if (strcmp(name, "main") && strcmp(name, "read") && strcmp(name, "write"))
+        emit_char('_');
+    emit_str(name);
+}
+
+void _mips_print(mips_inst *inst) {
+    const char *name = _mips_ops[inst->op].name;
+    const char **regs = mips_reg_names;
+    switch (_mips_ops[inst->op].form) {
+        case _MIPS_FORM_LABEL:
+            emit_fmt("label%d:\n", inst->imm);
+            break;
+        case _MIPS_FORM_FUNC:
+            if (!strcmp(inst->name, "main"))
+                emit_str("main:\n");
+            else
+                emit_fmt("_%s :\n", inst->name);
+            break;
+        case _MIPS_FORM_RRR:
+            emit_fmt("  %s $%s, $%s, $%s\n", name, regs[inst->reg[0]], regs[inst->reg[1]], regs[inst->reg[2]]);
+            break;
+        case _MIPS_FORM_RRI:
+            emit_fmt("  %s $%s, $%s, %d\n", name, regs[inst->reg[0]], regs[inst->reg[1]], inst->imm);
+            break;
+        case _MIPS_FORM_RR:
+            emit_fmt("  %s $%s, $%s\n", name, regs[inst->reg[0]], regs[inst->reg[1]]);
+            break;
+        case _MIPS_FORM_RI:
+            emit_fmt("  %s $%s, %d\n", name, regs[inst->reg[0]], inst->imm);
+            break;
+        case _MIPS_FORM_R:
+            emit_fmt("  %s $%s\n", name, regs[inst->reg[0]]);
+            break;
+        case _MIPS_FORM_MEM:
+            emit_fmt("  %s $%s, %d($%s)\n", name, regs[inst->reg[0]], inst->imm, regs[inst->reg[1]]);
+            break;
+        case _MIPS_FORM_BRANCH:
+            emit_fmt("  %s $%s, $%s, label%d\n", name, regs[inst->reg[0]], regs[inst->reg[1]], inst->imm);
+            break;
+        case _MIPS_FORM_JUMP:
+            emit_fmt("  %s ", name);
+            if (inst->name != NULL)
+                _mips_print_symbol(inst->name);
+            else
+                emit_fmt("label%d", inst->imm);
+            emit_char('\n');
+            break;
+    }
+}
+
+void mips_flush() {
+    uint32_t i;
+    if (cmmc_ctx->args.opt_level >= 1 && !cmmc_ctx->args.no_peephole)
+        cmmc_ctx->cg_mips_count = peephole_run(cmmc_ctx->cg_mips_insts, cmmc_ctx->cg_mips_count);
+    for (i = 0; i < cmmc_ctx->cg_mips_count; i++)
+        _mips_print(&cmmc_ctx->cg_mips_insts[i]);
+    cmmc_ctx->cg_mips_count = 0;
+}
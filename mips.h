@@ -0,0 +1,97 @@
+/*
+    C-- Compiler Back End
+    Copyright (C) 2019 NSKernel. All rights reserved.
+
+    A lab of Compilers at Nanjing University
+
+    mips.h
+    MIPS instructions of the function being generated
+*/
+
+#include <stdint.h>
+
+#ifndef MIPS_H
+#define MIPS_H
+
+#define MIPS_REG_ZERO   0
+#define MIPS_REG_V0     2
+#define MIPS_REG_A0     4
+#define MIPS_REG_T0     8
+#define MIPS_REG_T1     9
+#define MIPS_REG_S0     16
+#define MIPS_REG_SP     29
+#define MIPS_REG_FP     30
+#define MIPS_REG_RA     31
+
+#define MIPS_LABEL      0x00    // labelN:
+#define MIPS_FUNC       0x01    // _name : or main:
+#define MIPS_ADD        0x02
+#define MIPS_SUB        0x03
+#define MIPS_MUL        0x04
+#define MIPS_DIV        0x05
+#define MIPS_MFLO       0x06
+#define MIPS_MOVE       0x07
+#define MIPS_LI         0x08
+#define MIPS_ADDI       0x09
+#define MIPS_LW         0x0A
+#define MIPS_SW         0x0B
+#define MIPS_BEQ        0x0C
+#define MIPS_BNE        0x0D
+#define MIPS_BGE        0x0E
+#define MIPS_BGT        0x0F
+#define MIPS_BLT        0x10
+#define MIPS_BLE        0x11
+#define MIPS_J          0x12
+#define MIPS_JAL        0x13
+#define MIPS_JR         0x14
+#define MIPS_SLT        0x15
+#define MIPS_SLTU       0x16
+#define MIPS_XOR        0x17
+#define MIPS_AND        0x18
+#define MIPS_OR         0x19
+#define MIPS_XORI       0x1A
+#define MIPS_SLTIU      0x1B
+#define MIPS_SLTI       0x1C
+#define MIPS_SLL        0x1D
+#define MIPS_SRA        0x1E
+#define MIPS_SRL        0x1F
+#define MIPS_MULT       0x20
+#define MIPS_MFHI       0x21
+#define MIPS_OP_COUNT   0x22
+
+typedef struct mips_inst_t mips_inst;
+
+// registers are in the order they are written in, the destination
+// first. lw and sw keep the base in reg[1] and the displacement in imm,
+// branches and jumps their label in imm unless they go to a function
+struct mips_inst_t {
+    uint8_t op;
+    uint8_t reg[3];
+    int32_t imm;
+    const char *name;       // function of a FUNC, or of a J or JAL to one
+};
+
+extern const char *mips_reg_names[32];
+
+// append to the instructions of the current function
+void mips_rrr(uint8_t op, int rd, int rs, int rt);
+void mips_rri(uint8_t op, int rt, int rs, int imm);
+void mips_rr(uint8_t op, int rd, int rs);
+void mips_ri(uint8_t op, int rt, int imm);
+void mips_r(uint8_t op, int rs);
+void mips_mem(uint8_t op, int rt, int offset, int base);
+void mips_branch(uint8_t op, int rs, int rt, int label);
+void mips_jump(uint8_t op, int label);
+void mips_call(uint8_t op, const char *name);
+void mips_label(int label);
+void mips_func(const char *name);
+
+// runs the peephole pass when optimizing and writes the function out
+void mips_flush();
+
+int mips_writes(mips_inst *inst, int reg);
+int mips_reads(mips_inst *inst, int reg);
+// returns the new instruction count
+uint32_t peephole_run(mips_inst *insts, uint32_t count);
+
+#endif
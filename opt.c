@@ -0,0 +1,41 @@
+/*
+    C-- Compiler Back End
+    Copyright (C) 2019 NSKernel. All rights reserved.
+
+    A lab of Compilers at Nanjing University
+
+    opt.c
+    Runs the optimization passes on a function
+*/
+
+#include <stdlib.h>
+
+#include <ir.h>
+#include <ssa.h>
+#include <opt.h>
+#include <inline.h>
+#include <context.h>
+
+void opt_function(ir_function *func) {
+    ssa_form *form;
+    if (cmmc_ctx->args.opt_level < 1)
+        return;
+    inline_run(func);
+    tre_run(func);
+    form = ssa_build(func);
+    sccp_run(form);
+    simplify_run(form);
+    gvn_run(form);
+    ssa_destroy(form);
+    lvn_run(func);
+    copyprop_run(func);
+    dce_run(func);
+    licm_run(func);
+    ivsr_run(func);
+    copyprop_run(func);
+    dce_run(func);
+    fuse_run(func);
+    coalesce_run(func);
+    frame_compact(func);
+    inline_record(func);
+}
@@ -0,0 +1,35 @@
+/*
+    C-- Compiler Back End
+    Copyright (C) 2019 NSKernel. All rights reserved.
+
+    A lab of Compilers at Nanjing University
+
+    opt.h
+    Optimization passes over the intermediate code
+*/
+
+#include <ir.h>
+#include <ssa.h>
+
+#ifndef OPT_H
+#define OPT_H
+
+void opt_function(ir_function *func);
+
+// on the instructions themselves
+void tre_run(ir_function *func);
+void dce_run(ir_function *func);
+void lvn_run(ir_function *func);
+void copyprop_run(ir_function *func);
+void licm_run(ir_function *func);
+void ivsr_run(ir_function *func);
+void fuse_run(ir_function *func);
+void coalesce_run(ir_function *func);
+void frame_compact(ir_function *func);
+
+// on ssa form
+void sccp_run(ssa_form *form);
+void simplify_run(ssa_form *form);
+void gvn_run(ssa_form *form);
+
+#endif
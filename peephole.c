@@ -0,0 +1,181 @@
+/*
+    C-- Compiler Back End
+    Copyright (C) 2019 NSKernel. All rights reserved.
+
+    A lab of Compilers at Nanjing University
+
+    peephole.c
+    Peephole optimization of the generated MIPS code
+*/
+
+#include <stdlib.h>
+#include <stdint.h>
+
+#include <mips.h>
+
+// instructions are taken one by one onto the end of the kept ones and
+// the rules are tried on the last few of those until none applies, so
+// what one rule leaves behind is looked at again by all of them. a rule
+// sees a window of its size, rewrites it in place and returns how many
+// instructions are left of it, or -1 when it does not match. no rule
+// makes its window any longer
+
+typedef struct _peephole_rule_t {
+    uint32_t size;
+    int (*apply)(mips_inst *w);
+} _peephole_rule;
+
+int _peephole_same_slot(mips_inst *a, mips_inst *b) {
+    return a->reg[1] == b->reg[1] && a->imm == b->imm;
+}
+
+int _peephole_is_jump(mips_inst *inst) {
+    return inst->op == MIPS_J || inst->op == MIPS_JR;
+}
+
+int _peephole_is_branch(mips_inst *inst) {
+    return inst->op >= MIPS_BEQ && inst->op <= MIPS_BLE;
+}
+
+// a straight line instruction, not a label, branch, jump or call
+int _peephole_is_plain(mips_inst *inst) {
+    return inst->op != MIPS_LABEL && inst->op != MIPS_FUNC && inst->op != MIPS_JAL
+        && !_peephole_is_jump(inst) && !_peephole_is_branch(inst);
+}
+
+// move $a, $a and addi $a, $a, 0
+int _peephole_nop(mips_inst *w) {
+    if (w[0].op == MIPS_MOVE && w[0].reg[0] == w[0].reg[1])
+        return 0;
+    if (w[0].op == MIPS_ADDI && w[0].reg[0] == w[0].reg[1] && w[0].imm == 0)
+        return 0;
+    return -1;
+}
+
+// nothing falls into what follows a jump before the next label
+int _peephole_unreachable(mips_inst *w) {
+    if (!_peephole_is_jump(&w[0]) || w[1].op == MIPS_LABEL || w[1].op == MIPS_FUNC)
+        return -1;
+    return 1;
+}
+
+// j labelN or a branch right before labelN:
+int _peephole_jump_next(mips_inst *w) {
+    if (w[1].op != MIPS_LABEL || w[0].imm != w[1].imm)
+        return -1;
+    if (!(w[0].op == MIPS_J && w[0].name == NULL) && !_peephole_is_branch(&w[0]))
+        return -1;
+    w[0] = w[1];
+    return 1;
+}
+
+// move $a, $b then move $b, $a
+int _peephole_move_back(mips_inst *w) {
+    if (w[0].op != MIPS_MOVE || w[1].op != MIPS_MOVE
+        || w[0].reg[0] != w[1].reg[1] || w[0].reg[1] != w[1].reg[0])
+        return -1;
+    return 1;
+}
+
+// sw $a, d($b) then lw $c, d($b), the load takes $a instead
+int _peephole_store_load(mips_inst *w) {
+    if (w[0].op != MIPS_SW || w[1].op != MIPS_LW || !_peephole_same_slot(&w[0], &w[1]))
+        return -1;
+    if (w[1].reg[0] == w[0].reg[0])
+        return 1;
+    w[1].op = MIPS_MOVE;
+    w[1].reg[1] = w[0].reg[0];
+    w[1].imm = 0;
+    return 2;
+}
+
+// lw $a, d($b) then lw $c, d($b), unless the first one changed $b
+int _peephole_load_load(mips_inst *w) {
+    if (w[0].op != MIPS_LW || w[1].op != MIPS_LW || !_peephole_same_slot(&w[0], &w[1])
+        || w[0].reg[0] == w[0].reg[1])
+        return -1;
+    if (w[1].reg[0] == w[0].reg[0])
+        return 1;
+    w[1].op = MIPS_MOVE;
+    w[1].reg[1] = w[0].reg[0];
+    w[1].imm = 0;
+    return 2;
+}
+
+// lw $a, d($b) then sw $a, d($b) stores what is there already
+int _peephole_load_store(mips_inst *w) {
+    if (w[0].op != MIPS_LW || w[1].op != MIPS_SW || !_peephole_same_slot(&w[0], &w[1])
+        || w[0].reg[0] != w[1].reg[0] || w[0].reg[0] == w[0].reg[1])
+        return -1;
+    return 1;
+}
+
+// sw $a, d($b) then sw $c, d($b), the first one is never seen
+int _peephole_store_store(mips_inst *w) {
+    if (w[0].op != MIPS_SW || w[1].op != MIPS_SW || !_peephole_same_slot(&w[0], &w[1]))
+        return -1;
+    w[0] = w[1];
+    return 1;
+}
+
+int _peephole_fits(int imm) {
+    return imm >= -32768 && imm <= 32767;
+}
+
+// addi $a, $a, x then addi $a, $a, y
+int _peephole_addi(mips_inst *w) {
+    if (w[0].op != MIPS_ADDI || w[1].op != MIPS_ADDI || w[0].reg[0] != w[0].reg[1]
+        || w[1].reg[0] != w[0].reg[0] || w[1].reg[1] != w[0].reg[0] || !_peephole_fits(w[0].imm + w[1].imm))
+        return -1;
+    w[0].imm += w[1].imm;
+    return 1;
+}
+
+// the same with something in between that leaves $a alone, as when
+// the stack args of one call are popped and those of the next pushed
+int _peephole_addi_over(mips_inst *w) {
+    mips_inst first = w[0];
+    if (w[0].op != MIPS_ADDI || w[2].op != MIPS_ADDI || w[0].reg[0] != w[0].reg[1]
+        || w[2].reg[0] != w[0].reg[0] || w[2].reg[1] != w[0].reg[0] || !_peephole_fits(w[0].imm + w[2].imm)
+        || !_peephole_is_plain(&w[1]) || mips_reads(&w[1], w[0].reg[0]) || mips_writes(&w[1], w[0].reg[0]))
+        return -1;
+    w[0] = w[1];
+    w[1] = first;
+    w[1].imm += w[2].imm;
+    return 2;
+}
+
+const _peephole_rule _peephole_rules[] = {
+    { 1, _peephole_nop },
+    { 2, _peephole_unreachable },
+    { 2, _peephole_jump_next },
+    { 2, _peephole_move_back },
+    { 2, _peephole_store_load },
+    { 2, _peephole_load_load },
+    { 2, _peephole_load_store },
+    { 2, _peephole_store_store },
+    { 2, _peephole_addi },
+    { 3, _peephole_addi_over },
+};
+
+#define _PEEPHOLE_RULE_COUNT (sizeof(_peephole_rules) / sizeof(_peephole_rule))
+
+uint32_t peephole_run(mips_inst *insts, uint32_t count) {
+    uint32_t i, r, n = 0;
+    int left;
+    for (i = 0; i < count; i++) {
+        insts[n++] = insts[i];
+        r = 0;
+        while (r < _PEEPHOLE_RULE_COUNT) {
+            if (n < _peephole_rules[r].size
+                || (left = _peephole_rules[r].apply(&insts[n - _peephole_rules[r].size])) < 0) {
+                r++;
+                continue;
+            }
+            // start over on what is left
+            n = n - _peephole_rules[r].size + left;
+            r = 0;
+        }
+    }
+    return n;
+}
@@ -0,0 +1,429 @@
+/*
+    C-- Compiler Back End
+    Copyright (C) 2019 NSKernel. All rights reserved.
+
+    A lab of Compilers at Nanjing University
+
+    regalloc_mips.c
+    Linear scan register allocation for the MIPS back end
+*/
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+
+#include <global.h>
+#include <ir.h>
+#include <backend.h>
+
+// $t0 and $t1 are kept as scratch registers for operands living on the
+// stack, $v0 and $a0-$a3 are used by calls, read and write. the first
+// four params may stay in the $a register they come in
+static const uint8_t _cg_mips_ra_caller_saved[] = { 10, 11, 12, 13, 14, 15, 24, 25 };
+static const uint8_t _cg_mips_ra_callee_saved[] = { 16, 17, 18, 19, 20, 21, 22, 23 };
+
+#define _CG_MIPS_RA_NOT_CANDIDATE -1
+#define _CG_MIPS_RA_ADDR_TAKEN    -2
+
+typedef struct _cg_mips_ra_operands_t {
+    int uses[3];
+    int use_count;
+    int def;
+    char has_def;
+    int addrs[3];
+    int addr_count;
+} _cg_mips_ra_operands;
+
+typedef struct _cg_mips_ra_block_t {
+    int first;
+    int last;
+    int succ[2];
+    int succ_count;
+} _cg_mips_ra_block;
+
+static void _cg_mips_ra_add_operand(_cg_mips_ra_operands *operands, ir_inst *content, int k, char is_dest) {
+    uint8_t mode = IR_INST_MODE(content, k);
+    uint8_t op = IR_INST_OP(content, k);
+    int id = content->operand[k];
+    if (mode != IR_MODE_T && mode != IR_MODE_V)
+        return;
+    if (op == IR_MODE_ADDR) {
+        operands->addrs[operands->addr_count++] = id;
+    }
+    else if (is_dest && op == IR_MODE_NORMAL) {
+        operands->def = id;
+        operands->has_def = 1;
+    }
+    else {
+        // a star destination reads the pointer
+        operands->uses[operands->use_count++] = id;
+    }
+}
+
+static void _cg_mips_ra_scan(ir_inst *content, _cg_mips_ra_operands *operands) {
+    operands->use_count = 0;
+    operands->addr_count = 0;
+    operands->has_def = 0;
+    switch (content->op) {
+        case IR_EXP_OP_ADD:
+        case IR_EXP_OP_MINUS:
+        case IR_EXP_OP_MUL:
+        case IR_EXP_OP_DIV:
+        case IR_EXP_OP_GT:
+        case IR_EXP_OP_GE:
+        case IR_EXP_OP_EQ:
+        case IR_EXP_OP_LE:
+        case IR_EXP_OP_LT:
+        case IR_EXP_OP_NEQ:
+        case IR_EXP_OP_OR:
+        case IR_EXP_OP_AND:
+            _cg_mips_ra_add_operand(operands, content, 2, 0);
+        case IR_EXP_OP_NOT:
+        case IR_EXP_OP_ASSIGN:
+            _cg_mips_ra_add_operand(operands, content, 1, 0);
+        case IR_OP_CALL:
+        case IR_OP_READ:
+        case IR_OP_PARAM:
+            _cg_mips_ra_add_operand(operands, content, 0, 1);
+            break;
+        case IR_OP_IF_IMME:
+            _cg_mips_ra_add_operand(operands, content, 2, 0);
+        case IR_OP_ARG:
+        case IR_OP_RETURN:
+        case IR_OP_WRITE:
+        case IR_OP_IF:
+        case IR_OP_IF_POSITIVE:
+            _cg_mips_ra_add_operand(operands, content, 1, 0);
+            break;
+        default:
+            break;
+    }
+}
+
+static char _cg_mips_ra_is_branch(uint32_t op) {
+    return op == IR_OP_GOTO || op == IR_OP_IF || op == IR_OP_IF_POSITIVE || op == IR_OP_IF_IMME;
+}
+
+// qsort has no way to pass this along
+static __thread int *_cg_mips_ra_start;
+
+static int _cg_mips_ra_compare_start(const void *a, const void *b) {
+    int x = _cg_mips_ra_start[*(const int *)a];
+    int y = _cg_mips_ra_start[*(const int *)b];
+    if (x != y)
+        return x < y ? -1 : 1;
+    return *(const int *)a - *(const int *)b;
+}
+
+cg_mips_regalloc *cg_mips_regalloc_function(ir_function *func) {
+    cg_mips_regalloc *ret_alloc;
+    ir_inst *insts;
+    _cg_mips_ra_operands *operands;
+    _cg_mips_ra_block *blocks;
+    int *block_of, *label_at, *cand_of, *cand_id, *start, *end, *order, *active;
+    int *param_of, *clobbers;
+    char *crosses_call;
+    uint32_t *use_set, *def_set, *in_set, *out_set;
+    int inst_count = 0, block_count = 0, cand_count = 0, active_count = 0, param_count = 0;
+    int min_id = INT_MAX, max_id = INT_MIN, max_label = -1;
+    int slot_count, words;
+    int i, j, k, b;
+    char changed;
+    uint8_t reg_free[32];
+
+    if (func == NULL || func->count == 0)
+        return NULL;
+
+    insts = func->insts;
+    inst_count = func->count;
+    operands = malloc(sizeof(_cg_mips_ra_operands) * inst_count);
+    for (i = 0; i < inst_count; i++) {
+        _cg_mips_ra_scan(&insts[i], &operands[i]);
+        for (j = 0; j < operands[i].use_count; j++) {
+            if (operands[i].uses[j] < min_id) min_id = operands[i].uses[j];
+            if (operands[i].uses[j] > max_id) max_id = operands[i].uses[j];
+        }
+        for (j = 0; j < operands[i].addr_count; j++) {
+            if (operands[i].addrs[j] < min_id) min_id = operands[i].addrs[j];
+            if (operands[i].addrs[j] > max_id) max_id = operands[i].addrs[j];
+        }
+        if (operands[i].has_def) {
+            if (operands[i].def < min_id) min_id = operands[i].def;
+            if (operands[i].def > max_id) max_id = operands[i].def;
+        }
+        if ((insts[i].op == IR_OP_LABEL || _cg_mips_ra_is_branch(insts[i].op)) && insts[i].operand[0] > max_label)
+            max_label = insts[i].operand[0];
+    }
+
+    ret_alloc = malloc(sizeof(cg_mips_regalloc));
+    ret_alloc->saved_mask = 0;
+    ret_alloc->saved_count = 0;
+    if (min_id > max_id) {
+        // nothing to allocate
+        ret_alloc->min_id = 0;
+        ret_alloc->max_id = -1;
+        ret_alloc->reg = NULL;
+        free(operands);
+        return ret_alloc;
+    }
+    min_id &= ~3;
+    ret_alloc->min_id = min_id;
+    ret_alloc->max_id = max_id;
+    slot_count = ((max_id - min_id) >> 2) + 1;
+    ret_alloc->reg = calloc(slot_count, sizeof(uint8_t));
+
+    // find out the candidates, anything whose address is taken stays
+    // on the stack since it may be accessed through a pointer
+    cand_of = malloc(sizeof(int) * slot_count);
+    for (i = 0; i < slot_count; i++)
+        cand_of[i] = _CG_MIPS_RA_NOT_CANDIDATE;
+    for (i = 0; i < inst_count; i++) {
+        for (j = 0; j < operands[i].addr_count; j++)
+            cand_of[(operands[i].addrs[j] - min_id) >> 2] = _CG_MIPS_RA_ADDR_TAKEN;
+    }
+    cand_id = malloc(sizeof(int) * slot_count);
+    for (i = 0; i < inst_count; i++) {
+        for (j = -1; j < operands[i].use_count; j++) {
+            if (j == -1 && !operands[i].has_def)
+                continue;
+            k = j == -1 ? operands[i].def : operands[i].uses[j];
+            if (k & 3)
+                continue;
+            if (cand_of[(k - min_id) >> 2] == _CG_MIPS_RA_NOT_CANDIDATE) {
+                cand_of[(k - min_id) >> 2] = cand_count;
+                cand_id[cand_count++] = k;
+            }
+        }
+    }
+    // rewrite the operands as candidate numbers, -1 for the rest
+    for (i = 0; i < inst_count; i++) {
+        for (j = 0; j < operands[i].use_count; j++) {
+            k = operands[i].uses[j];
+            operands[i].uses[j] = (k & 3) ? -1 : cand_of[(k - min_id) >> 2];
+        }
+        if (operands[i].has_def) {
+            k = operands[i].def;
+            operands[i].def = (k & 3) ? -1 : cand_of[(k - min_id) >> 2];
+        }
+    }
+
+    // split into basic blocks
+    label_at = malloc(sizeof(int) * (max_label + 1));
+    block_of = malloc(sizeof(int) * inst_count);
+    blocks = malloc(sizeof(_cg_mips_ra_block) * inst_count);
+    for (i = 0; i < inst_count; i++) {
+        if (i == 0 || insts[i].op == IR_OP_LABEL || _cg_mips_ra_is_branch(insts[i - 1].op) || insts[i - 1].op == IR_OP_RETURN) {
+            if (block_count > 0)
+                blocks[block_count - 1].last = i - 1;
+            blocks[block_count].first = i;
+            block_count++;
+        }
+        block_of[i] = block_count - 1;
+        if (insts[i].op == IR_OP_LABEL)
+            label_at[insts[i].operand[0]] = i;
+    }
+    blocks[block_count - 1].last = inst_count - 1;
+    for (b = 0; b < block_count; b++) {
+        ir_inst *last = &insts[blocks[b].last];
+        blocks[b].succ_count = 0;
+        if (_cg_mips_ra_is_branch(last->op))
+            blocks[b].succ[blocks[b].succ_count++] = block_of[label_at[last->operand[0]]];
+        if (last->op != IR_OP_GOTO && last->op != IR_OP_RETURN && b + 1 < block_count)
+            blocks[b].succ[blocks[b].succ_count++] = b + 1;
+    }
+
+    // liveness on blocks
+    words = (cand_count + 31) / 32;
+    if (words == 0)
+        words = 1;
+    use_set = calloc(block_count * words, sizeof(uint32_t));
+    def_set = calloc(block_count * words, sizeof(uint32_t));
+    in_set = calloc(block_count * words, sizeof(uint32_t));
+    out_set = calloc(block_count * words, sizeof(uint32_t));
+    for (b = 0; b < block_count; b++) {
+        uint32_t *use_b = use_set + b * words;
+        uint32_t *def_b = def_set + b * words;
+        for (i = blocks[b].first; i <= blocks[b].last; i++) {
+            for (j = 0; j < operands[i].use_count; j++) {
+                k = operands[i].uses[j];
+                if (k >= 0 && !(def_b[k >> 5] & (1u << (k & 31))))
+                    use_b[k >> 5] |= 1u << (k & 31);
+            }
+            if (operands[i].has_def && operands[i].def >= 0)
+                def_b[operands[i].def >> 5] |= 1u << (operands[i].def & 31);
+        }
+    }
+    do {
+        changed = 0;
+        for (b = block_count - 1; b >= 0; b--) {
+            uint32_t *out_b = out_set + b * words;
+            uint32_t *in_b = in_set + b * words;
+            for (k = 0; k < words; k++) {
+                uint32_t new_out = 0, new_in;
+                for (j = 0; j < blocks[b].succ_count; j++)
+                    new_out |= in_set[blocks[b].succ[j] * words + k];
+                new_in = use_set[b * words + k] | (new_out & ~def_set[b * words + k]);
+                if (new_out != out_b[k] || new_in != in_b[k]) {
+                    out_b[k] = new_out;
+                    in_b[k] = new_in;
+                    changed = 1;
+                }
+            }
+        }
+    } while (changed);
+
+    // build the intervals: live in/out covers block boundaries and every
+    // def or use covers its own position, the hull covers the rest
+    start = malloc(sizeof(int) * (cand_count + 1));
+    end = malloc(sizeof(int) * (cand_count + 1));
+    for (k = 0; k < cand_count; k++) {
+        start[k] = INT_MAX;
+        end[k] = -1;
+    }
+#define _CG_MIPS_RA_COVER(c, pos) do { \
+        if ((pos) < start[c]) start[c] = (pos); \
+        if ((pos) > end[c]) end[c] = (pos); \
+    } while (0)
+    for (b = 0; b < block_count; b++) {
+        for (k = 0; k < cand_count; k++) {
+            if (in_set[b * words + (k >> 5)] & (1u << (k & 31)))
+                _CG_MIPS_RA_COVER(k, blocks[b].first);
+            if (out_set[b * words + (k >> 5)] & (1u << (k & 31)))
+                _CG_MIPS_RA_COVER(k, blocks[b].last);
+        }
+        for (i = blocks[b].first; i <= blocks[b].last; i++) {
+            for (j = 0; j < operands[i].use_count; j++) {
+                if (operands[i].uses[j] >= 0)
+                    _CG_MIPS_RA_COVER(operands[i].uses[j], i);
+            }
+            if (operands[i].has_def && operands[i].def >= 0)
+                _CG_MIPS_RA_COVER(operands[i].def, i);
+        }
+    }
+#undef _CG_MIPS_RA_COVER
+
+    // anything alive across a call can only use callee saved registers
+    crosses_call = calloc(cand_count + 1, sizeof(char));
+    for (i = 0; i < inst_count; i++) {
+        if (insts[i].op != IR_OP_CALL)
+            continue;
+        for (k = 0; k < cand_count; k++) {
+            if (start[k] < i && end[k] > i)
+                crosses_call[k] = 1;
+        }
+    }
+
+    // params that come in $a0-$a3 can stay there as long as no call,
+    // argument, read or write happens while they are alive
+    clobbers = malloc(sizeof(int) * (inst_count + 1));
+    clobbers[0] = 0;
+    param_of = malloc(sizeof(int) * (cand_count + 1));
+    for (k = 0; k < cand_count; k++)
+        param_of[k] = -1;
+    for (i = 0; i < inst_count; i++) {
+        uint32_t op = insts[i].op;
+        clobbers[i + 1] = clobbers[i] + (op == IR_OP_CALL || op == IR_OP_ARG || op == IR_OP_READ || op == IR_OP_WRITE);
+        if (op == IR_OP_PARAM) {
+            if (operands[i].def >= 0 && param_count < 4)
+                param_of[operands[i].def] = param_count;
+            param_count++;
+        }
+    }
+
+    // linear scan
+    order = malloc(sizeof(int) * (cand_count + 1));
+    for (k = 0; k < cand_count; k++)
+        order[k] = k;
+    _cg_mips_ra_start = start;
+    qsort(order, cand_count, sizeof(int), _cg_mips_ra_compare_start);
+    active = malloc(sizeof(int) * 32);
+    memset(reg_free, 0, sizeof(reg_free));
+    for (i = 0; i < 8; i++) {
+        reg_free[_cg_mips_ra_caller_saved[i]] = 1;
+        reg_free[_cg_mips_ra_callee_saved[i]] = 1;
+    }
+    for (i = 0; i < cand_count; i++) {
+        int current = order[i];
+        int current_slot = (cand_id[current] - min_id) >> 2;
+        int reg = 0;
+        if (start[current] == INT_MAX)
+            continue;
+        if (param_of[current] >= 0 && clobbers[end[current] + 1] == clobbers[start[current]]) {
+            ret_alloc->reg[current_slot] = 4 + param_of[current];
+            continue;
+        }
+        // expire old intervals, active is sorted by end
+        while (active_count > 0 && end[active[0]] < start[current]) {
+            reg_free[ret_alloc->reg[(cand_id[active[0]] - min_id) >> 2]] = 1;
+            memmove(active, active + 1, sizeof(int) * (--active_count));
+        }
+        if (!crosses_call[current]) {
+            for (j = 0; j < 8 && reg == 0; j++) {
+                if (reg_free[_cg_mips_ra_caller_saved[j]])
+                    reg = _cg_mips_ra_caller_saved[j];
+            }
+        }
+        for (j = 0; j < 8 && reg == 0; j++) {
+            if (reg_free[_cg_mips_ra_callee_saved[j]])
+                reg = _cg_mips_ra_callee_saved[j];
+        }
+        if (reg == 0) {
+            // spill whoever ends last among those holding a usable register
+            int victim = -1;
+            for (j = active_count - 1; j >= 0; j--) {
+                int victim_reg = ret_alloc->reg[(cand_id[active[j]] - min_id) >> 2];
+                if (!crosses_call[current] || (victim_reg >= 16 && victim_reg <= 23)) {
+                    victim = j;
+                    break;
+                }
+            }
+            if (victim == -1 || end[active[victim]] <= end[current])
+                continue;
+            reg = ret_alloc->reg[(cand_id[active[victim]] - min_id) >> 2];
+            ret_alloc->reg[(cand_id[active[victim]] - min_id) >> 2] = 0;
+            memmove(active + victim, active + victim + 1, sizeof(int) * (active_count - victim - 1));
+            active_count--;
+        }
+        reg_free[reg] = 0;
+        ret_alloc->reg[current_slot] = reg;
+        // insert into active keeping the order
+        for (j = active_count; j > 0 && end[active[j - 1]] > end[current]; j--)
+            active[j] = active[j - 1];
+        active[j] = current;
+        active_count++;
+    }
+    for (k = 0; k < cand_count; k++) {
+        int reg = ret_alloc->reg[(cand_id[k] - min_id) >> 2];
+        if (reg >= 16 && reg <= 23 && !(ret_alloc->saved_mask & (1u << (reg - 16)))) {
+            ret_alloc->saved_mask |= 1u << (reg - 16);
+            ret_alloc->saved_count++;
+        }
+    }
+
+    free(operands);
+    free(cand_of);
+    free(cand_id);
+    free(label_at);
+    free(block_of);
+    free(blocks);
+    free(use_set);
+    free(def_set);
+    free(in_set);
+    free(out_set);
+    free(start);
+    free(end);
+    free(crosses_call);
+    free(order);
+    free(active);
+    free(param_of);
+    free(clobbers);
+    return ret_alloc;
+}
+
+void cg_mips_regalloc_free(cg_mips_regalloc *alloc) {
+    if (alloc == NULL)
+        return;
+    free(alloc->reg);
+    free(alloc);
+}
@@ -0,0 +1,209 @@
+/*
+    C-- Compiler Front/Back End
+    Copyright (C) 2019 NSKernel. All rights reserved.
+
+    A lab of Compilers at Nanjing University
+
+    report.c
+    Time and memory report (-ftime-report, -fmem-report)
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/resource.h>
+
+#include <context.h>
+#include <report.h>
+
+static const char *_report_phase_names[REPORT_PHASE_COUNT] = {
+    "parse", "semantics", "label compression", "optimization", "register allocation", "code generation"
+};
+
+void _report_now(report_time *t) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    t->wall = ts.tv_sec + ts.tv_nsec / 1e9;
+    // per thread so that -j does not mix up the files
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    t->cpu = ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// charge the time since the last mark to the innermost phase
+void _report_charge(report *r) {
+    report_time now;
+    _report_now(&now);
+    if (r->depth > 0) {
+        r->phase[r->stack[r->depth - 1]].wall += now.wall - r->mark.wall;
+        r->phase[r->stack[r->depth - 1]].cpu += now.cpu - r->mark.cpu;
+    }
+    r->mark = now;
+}
+
+void report_push(int phase) {
+    report *r = &cmmc_ctx->report;
+    if (!cmmc_ctx->args.time_report)
+        return;
+    _report_charge(r);
+    if (r->depth < REPORT_MAX_DEPTH)
+        r->stack[r->depth] = phase;
+    r->depth++;
+}
+
+void report_pop() {
+    report *r = &cmmc_ctx->report;
+    if (!cmmc_ctx->args.time_report)
+        return;
+    _report_charge(r);
+    r->depth--;
+}
+
+void report_function_begin() {
+    if (!cmmc_ctx->args.time_report && !cmmc_ctx->args.mem_report)
+        return;
+    _report_now(&cmmc_ctx->report.function_start);
+    cmmc_ctx->report.inst_count = 0;
+    cmmc_ctx->report.frame_before = 0;
+    cmmc_ctx->report.frame_after = 0;
+}
+
+void report_function_end(const char *name) {
+    report *r = &cmmc_ctx->report;
+    report_function *function;
+    report_time now;
+    if (!cmmc_ctx->args.time_report && !cmmc_ctx->args.mem_report)
+        return;
+    _report_now(&now);
+    if (r->function_count == r->function_capacity) {
+        r->function_capacity = r->function_capacity ? r->function_capacity * 2 : 16;
+        r->functions = realloc(r->functions, sizeof(report_function) * r->function_capacity);
+    }
+    function = &r->functions[r->function_count++];
+    function->name = strdup(name);
+    function->time.wall = now.wall - r->function_start.wall;
+    function->time.cpu = now.cpu - r->function_start.cpu;
+    function->inst_count = r->inst_count;
+    function->frame_before = r->frame_before;
+    function->frame_after = r->frame_after;
+}
+
+void report_reset(report *r) {
+    uint32_t i;
+    for (i = 0; i < r->function_count; i++)
+        free(r->functions[i].name);
+    free(r->functions);
+    memset(r, 0, sizeof(report));
+}
+
+void _report_print_time_table(FILE *f, report *r) {
+    report_time sum = { 0, 0 };
+    uint32_t i;
+    for (i = 0; i < REPORT_PHASE_COUNT; i++) {
+        sum.wall += r->phase[i].wall;
+        sum.cpu += r->phase[i].cpu;
+    }
+    fprintf(f, "Time report for %s\n", cmmc_ctx->args.input_file);
+    fprintf(f, "  %-22s %12s %12s\n", "phase", "wall (ms)", "cpu (ms)");
+    for (i = 0; i < REPORT_PHASE_COUNT; i++)
+        fprintf(f, "  %-22s %12.3f %12.3f\n", _report_phase_names[i], r->phase[i].wall * 1e3, r->phase[i].cpu * 1e3);
+    fprintf(f, "  %-22s %12.3f %12.3f\n", "total", sum.wall * 1e3, sum.cpu * 1e3);
+    fprintf(f, "  %-22s %12s %12s %8s\n", "function", "wall (ms)", "cpu (ms)", "ir");
+    for (i = 0; i < r->function_count; i++)
+        fprintf(f, "  %-22s %12.3f %12.3f %8u\n", r->functions[i].name, r->functions[i].time.wall * 1e3, r->functions[i].time.cpu * 1e3, r->functions[i].inst_count);
+}
+
+void _report_print_time_json(FILE *f, report *r) {
+    uint32_t i;
+    fprintf(f, "\"time\":{\"phases\":{");
+    for (i = 0; i < REPORT_PHASE_COUNT; i++)
+        fprintf(f, "%s\"%s\":{\"wall\":%.6f,\"cpu\":%.6f}", i ? "," : "", _report_phase_names[i], r->phase[i].wall, r->phase[i].cpu);
+    fprintf(f, "},\"functions\":[");
+    for (i = 0; i < r->function_count; i++)
+        fprintf(f, "%s{\"name\":\"%s\",\"wall\":%.6f,\"cpu\":%.6f,\"ir\":%u}", i ? "," : "", r->functions[i].name, r->functions[i].time.wall, r->functions[i].time.cpu, r->functions[i].inst_count);
+    fprintf(f, "]}");
+}
+
+typedef struct _report_memory_row_t {
+    const char *name;
+    size_t count;
+    size_t bytes;
+    size_t peak;
+} _report_memory_row;
+
+#define _REPORT_MEMORY_ROWS 5
+
+void _report_memory_rows(_report_memory_row *rows) {
+    cmmc_context *ctx = cmmc_ctx;
+    rows[0] = (_report_memory_row){ "ast", ctx->ast_arena.count, ctx->ast_arena.total, ctx->ast_arena.peak };
+    // the hash table of names is the only thing not in an arena
+    rows[1] = (_report_memory_row){ "symbol table", ctx->symbol_arena.count + (ctx->symtable_names != NULL),
+        ctx->symbol_arena.total + ctx->symtable_name_capacity * sizeof(symtable_name *),
+        ctx->symbol_arena.peak + ctx->symtable_name_capacity * sizeof(symtable_name *) };
+    rows[2] = (_report_memory_row){ "semantic types", ctx->function_arena.count, ctx->function_arena.total, ctx->function_arena.peak };
+    rows[3] = (_report_memory_row){ "ir", ctx->ir_arena.count, ctx->ir_arena.total, ctx->ir_arena.peak };
+    rows[4] = (_report_memory_row){ "inline bodies", ctx->inline_arena.count, ctx->inline_arena.total, ctx->inline_arena.peak };
+}
+
+long _report_peak_rss() {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+    return usage.ru_maxrss / 1024;
+#else
+    return usage.ru_maxrss;
+#endif
+}
+
+void _report_print_memory_table(FILE *f, report *r) {
+    _report_memory_row rows[_REPORT_MEMORY_ROWS];
+    int i;
+    _report_memory_rows(rows);
+    fprintf(f, "Memory report for %s\n", cmmc_ctx->args.input_file);
+    fprintf(f, "  %-22s %12s %12s %12s\n", "subsystem", "allocations", "bytes", "peak bytes");
+    for (i = 0; i < _REPORT_MEMORY_ROWS; i++)
+        fprintf(f, "  %-22s %12zu %12zu %12zu\n", rows[i].name, rows[i].count, rows[i].bytes, rows[i].peak);
+    fprintf(f, "  %-22s %12u %12zu %12d\n", "emitter (writes)", r->emit_writes, r->emit_bytes, EMIT_BUFFER_SIZE);
+    fprintf(f, "  peak rss: %ld KB\n", _report_peak_rss());
+    fprintf(f, "  %-22s %12s %12s\n", "frame", "before", "after");
+    for (i = 0; i < (int)r->function_count; i++)
+        fprintf(f, "  %-22s %12d %12d\n", r->functions[i].name, r->functions[i].frame_before, r->functions[i].frame_after);
+}
+
+void _report_print_memory_json(FILE *f, report *r) {
+    _report_memory_row rows[_REPORT_MEMORY_ROWS];
+    int i;
+    _report_memory_rows(rows);
+    fprintf(f, "\"memory\":{");
+    for (i = 0; i < _REPORT_MEMORY_ROWS; i++)
+        fprintf(f, "\"%s\":{\"allocations\":%zu,\"bytes\":%zu,\"peak\":%zu},", rows[i].name, rows[i].count, rows[i].bytes, rows[i].peak);
+    fprintf(f, "\"emitter\":{\"writes\":%u,\"bytes\":%zu,\"buffer\":%d},", r->emit_writes, r->emit_bytes, EMIT_BUFFER_SIZE);
+    fprintf(f, "\"peak_rss_kb\":%ld,\"frames\":[", _report_peak_rss());
+    for (i = 0; i < (int)r->function_count; i++)
+        fprintf(f, "%s{\"name\":\"%s\",\"before\":%d,\"after\":%d}", i ? "," : "", r->functions[i].name, r->functions[i].frame_before, r->functions[i].frame_after);
+    fprintf(f, "]}");
+}
+
+// one table per report asked for, or a single json object
+// on one line when any of them asked for json
+void report_print(FILE *f) {
+    report *r = &cmmc_ctx->report;
+    struct global_args_t *args = &cmmc_ctx->args;
+    if (args->time_report == REPORT_JSON || args->mem_report == REPORT_JSON) {
+        fprintf(f, "{\"file\":\"%s\"", args->input_file);
+        if (args->time_report) {
+            fprintf(f, ",");
+            _report_print_time_json(f, r);
+        }
+        if (args->mem_report) {
+            fprintf(f, ",");
+            _report_print_memory_json(f, r);
+        }
+        fprintf(f, "}\n");
+        return;
+    }
+    if (args->time_report)
+        _report_print_time_table(f, r);
+    if (args->mem_report)
+        _report_print_memory_table(f, r);
+}
@@ -0,0 +1,73 @@
+/*
+    C-- Compiler Front/Back End
+    Copyright (C) 2019 NSKernel. All rights reserved.
+
+    A lab of Compilers at Nanjing University
+
+    report.h
+    Time and memory report (-ftime-report, -fmem-report)
+*/
+
+#include <stdint.h>
+#include <stdio.h>
+
+#ifndef REPORT_H
+#define REPORT_H
+
+#define REPORT_PHASE_PARSE      0
+#define REPORT_PHASE_SEMANTICS  1
+#define REPORT_PHASE_LABELS     2
+#define REPORT_PHASE_OPTIMIZE   3
+#define REPORT_PHASE_REGALLOC   4
+#define REPORT_PHASE_CODEGEN    5
+#define REPORT_PHASE_COUNT      6
+
+#define REPORT_OFF              0
+#define REPORT_TABLE            1
+#define REPORT_JSON             2
+
+#define REPORT_MAX_DEPTH        8
+
+typedef struct report_time_t report_time;
+typedef struct report_function_t report_function;
+typedef struct report_t report;
+
+// seconds
+struct report_time_t {
+    double wall;
+    double cpu;
+};
+
+struct report_function_t {
+    char *name;
+    report_time time;
+    uint32_t inst_count;
+    int frame_before;           // bytes of locals before and after
+    int frame_after;            // stack slot coloring
+};
+
+// phases nest, time is charged to the innermost one only
+struct report_t {
+    report_time phase[REPORT_PHASE_COUNT];
+    int stack[REPORT_MAX_DEPTH];
+    int depth;
+    report_time mark;
+    report_time function_start;
+    report_function *functions;
+    uint32_t function_count;
+    uint32_t function_capacity;
+    uint32_t inst_count;        // of the function being generated
+    int frame_before;
+    int frame_after;
+    size_t emit_bytes;
+    uint32_t emit_writes;
+};
+
+void report_push(int phase);
+void report_pop();
+void report_function_begin();
+void report_function_end(const char *name);
+void report_print(FILE *f);
+void report_reset(report *r);
+
+#endif
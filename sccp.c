@@ -0,0 +1,293 @@
+/*
+    C-- Compiler Back End
+    Copyright (C) 2019 NSKernel. All rights reserved.
+
+    A lab of Compilers at Nanjing University
+
+    sccp.c
+    Sparse conditional constant propagation
+*/
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <limits.h>
+
+#include <ssa.h>
+#include <opt.h>
+#include <cfg.h>
+#include <ir.h>
+
+// Wegman and Zadeck. a value is TOP until something is known about it,
+// then a constant, then BOTTOM when it may be anything. only blocks
+// reached through edges known to be taken are looked at, so branches
+// on constants cut off what they skip
+
+#define _SCCP_TOP       0
+#define _SCCP_CONSTANT  1
+#define _SCCP_BOTTOM    2
+
+typedef struct _sccp_state_t {
+    ssa_form *form;
+    uint8_t *state;
+    int32_t *constant;
+    uint32_t *block_of;     // block of each instruction
+    uint32_t *value_work;   // a value drops at most twice
+    uint32_t value_top;
+    uint32_t *block_work;   // a block becomes live once
+    uint32_t block_top;
+} _sccp_state;
+
+uint8_t _sccp_operand(_sccp_state *sccp, uint8_t mode, int32_t operand, int32_t *value) {
+    // anything behind a star or an address is out of reach
+    if (mode == IR_MODE_I) {
+        *value = operand;
+        return _SCCP_CONSTANT;
+    }
+    if (mode == IR_MODE_S) {
+        *value = sccp->constant[operand];
+        return sccp->state[operand];
+    }
+    *value = 0;
+    return _SCCP_BOTTOM;
+}
+
+// fold op, a zero on one side of * or && and a non zero on one side
+// of || decide it whatever the other side is
+uint8_t _sccp_fold(uint8_t op, uint8_t state1, int32_t a, uint8_t state2, int32_t b, int32_t *result) {
+    if ((op == IR_EXP_OP_MUL || op == IR_EXP_OP_AND) && ((state1 == _SCCP_CONSTANT && a == 0) || (state2 == _SCCP_CONSTANT && b == 0))) {
+        *result = 0;
+        return _SCCP_CONSTANT;
+    }
+    if (op == IR_EXP_OP_OR && ((state1 == _SCCP_CONSTANT && a != 0) || (state2 == _SCCP_CONSTANT && b != 0))) {
+        *result = 1;
+        return _SCCP_CONSTANT;
+    }
+    if (state1 == _SCCP_BOTTOM || state2 == _SCCP_BOTTOM)
+        return _SCCP_BOTTOM;
+    if (state1 == _SCCP_TOP || state2 == _SCCP_TOP)
+        return _SCCP_TOP;
+    // arithmetic wraps around like the machine does
+    switch (op) {
+        case IR_EXP_OP_ADD:
+            *result = (int32_t)((uint32_t)a + (uint32_t)b);
+            break;
+        case IR_EXP_OP_MINUS:
+            *result = (int32_t)((uint32_t)a - (uint32_t)b);
+            break;
+        case IR_EXP_OP_MUL:
+            *result = (int32_t)((uint32_t)a * (uint32_t)b);
+            break;
+        case IR_EXP_OP_DIV:
+            if (b == 0 || (a == INT_MIN && b == -1))
+                return _SCCP_BOTTOM;
+            *result = a / b;
+            break;
+        case IR_EXP_OP_GT:
+            *result = a > b;
+            break;
+        case IR_EXP_OP_GE:
+            *result = a >= b;
+            break;
+        case IR_EXP_OP_EQ:
+            *result = a == b;
+            break;
+        case IR_EXP_OP_LE:
+            *result = a <= b;
+            break;
+        case IR_EXP_OP_LT:
+            *result = a < b;
+            break;
+        case IR_EXP_OP_NEQ:
+            *result = a != b;
+            break;
+        case IR_EXP_OP_NOT:
+            *result = a == 0;
+            break;
+        case IR_EXP_OP_OR:
+            *result = a || b;
+            break;
+        case IR_EXP_OP_AND:
+            *result = a && b;
+            break;
+        case IR_EXP_OP_ASSIGN:
+            *result = a;
+            break;
+        default:
+            return _SCCP_BOTTOM;
+    }
+    return _SCCP_CONSTANT;
+}
+
+void _sccp_set(_sccp_state *sccp, uint32_t value, uint8_t state, int32_t constant) {
+    if (sccp->state[value] == _SCCP_BOTTOM || state == _SCCP_TOP)
+        return;
+    if (state == _SCCP_CONSTANT && sccp->state[value] == _SCCP_CONSTANT) {
+        if (sccp->constant[value] == constant)
+            return;
+        state = _SCCP_BOTTOM;
+    }
+    sccp->state[value] = state;
+    sccp->constant[value] = constant;
+    sccp->value_work[sccp->value_top++] = value;
+}
+
+void _sccp_visit_phi(_sccp_state *sccp, uint32_t p) {
+    ssa_form *form = sccp->form;
+    ssa_phi *phi = &form->phis[p];
+    cfg_block *block = &form->graph->blocks[phi->block];
+    uint8_t state = _SCCP_TOP, arg_state;
+    int32_t constant = 0, arg;
+    uint32_t j;
+
+    if (phi->value == CFG_NONE)
+        return;
+    for (j = 0; j < block->pred_count && state != _SCCP_BOTTOM; j++) {
+        if (!ssa_edge_live(form, block->pred[j], phi->block))
+            continue;
+        arg_state = _sccp_operand(sccp, phi->arg_mode[j], phi->arg[j], &arg);
+        if (arg_state == _SCCP_TOP)
+            continue;
+        if (arg_state == _SCCP_BOTTOM || (state == _SCCP_CONSTANT && arg != constant)) {
+            state = _SCCP_BOTTOM;
+        }
+        else {
+            state = _SCCP_CONSTANT;
+            constant = arg;
+        }
+    }
+    _sccp_set(sccp, phi->value, state, constant);
+}
+
+void _sccp_visit_block(_sccp_state *sccp, uint32_t b);
+
+void _sccp_take_edge(_sccp_state *sccp, uint32_t b, uint32_t k) {
+    ssa_form *form = sccp->form;
+    uint32_t succ = form->graph->blocks[b].succ[k], p;
+    if (form->edge_live[b * 2 + k])
+        return;
+    form->edge_live[b * 2 + k] = 1;
+    if (!form->block_live[succ]) {
+        form->block_live[succ] = 1;
+        sccp->block_work[sccp->block_top++] = succ;
+        return;
+    }
+    // only the phis see the new edge
+    for (p = form->block_phi[succ]; p != CFG_NONE; p = form->phis[p].next)
+        _sccp_visit_phi(sccp, p);
+}
+
+void _sccp_visit_inst(_sccp_state *sccp, uint32_t i) {
+    ssa_form *form = sccp->form;
+    ir_inst *inst = &form->func->insts[i];
+    cfg_block *block = &form->graph->blocks[sccp->block_of[i]];
+    uint8_t state1, state2 = _SCCP_CONSTANT, state;
+    int32_t a = 0, b = 0, result = 0;
+    uint32_t b_index = sccp->block_of[i];
+
+    if (inst->op == SSA_DELETED)
+        return;
+    if (ir_inst_writes(inst) && inst->mode[0] == IR_MODE_S) {
+        if (inst->op >= IR_EXP_OP_ADD && inst->op <= IR_EXP_OP_ASSIGN) {
+            state1 = _sccp_operand(sccp, inst->mode[1], inst->operand[1], &a);
+            if (ir_inst_reads(inst) & 0x4)
+                state2 = _sccp_operand(sccp, inst->mode[2], inst->operand[2], &b);
+            state = _sccp_fold(inst->op, state1, a, state2, b, &result);
+        }
+        else {
+            state = _SCCP_BOTTOM;
+        }
+        _sccp_set(sccp, inst->operand[0], state, result);
+    }
+    if (i != block->last - 1)
+        return;
+    // the way out of the block, succ[0] is where an IF jumps to
+    switch (inst->op) {
+        case IR_OP_IF:
+        case IR_OP_IF_POSITIVE:
+            state = _sccp_operand(sccp, inst->mode[1], inst->operand[1], &a);
+            result = inst->op == IR_OP_IF ? a == 0 : a != 0;
+            break;
+        case IR_OP_IF_IMME:
+            state1 = _sccp_operand(sccp, inst->mode[1], inst->operand[1], &a);
+            state2 = _sccp_operand(sccp, inst->mode[2], inst->operand[2], &b);
+            state = _sccp_fold(inst->mode[0], state1, a, state2, b, &result);
+            break;
+        default:
+            if (block->succ_count > 0)
+                _sccp_take_edge(sccp, b_index, 0);
+            return;
+    }
+    if (state == _SCCP_TOP)
+        return;
+    if (state == _SCCP_BOTTOM || result || block->succ_count == 1)
+        _sccp_take_edge(sccp, b_index, 0);
+    if (block->succ_count == 2 && (state == _SCCP_BOTTOM || !result))
+        _sccp_take_edge(sccp, b_index, 1);
+}
+
+void _sccp_visit_block(_sccp_state *sccp, uint32_t b) {
+    ssa_form *form = sccp->form;
+    uint32_t p, i;
+    for (p = form->block_phi[b]; p != CFG_NONE; p = form->phis[p].next)
+        _sccp_visit_phi(sccp, p);
+    for (i = form->graph->blocks[b].first; i < form->graph->blocks[b].last; i++)
+        _sccp_visit_inst(sccp, i);
+}
+
+void sccp_run(ssa_form *form) {
+    cfg *graph = form->graph;
+    _sccp_state sccp;
+    uint32_t b, i, v, u;
+
+    ssa_link_users(form);
+    sccp.form = form;
+    sccp.state = malloc(form->value_count + 1);
+    sccp.constant = malloc(sizeof(int32_t) * (form->value_count + 1));
+    sccp.block_of = malloc(sizeof(uint32_t) * (form->func->count + 1));
+    sccp.value_work = malloc(sizeof(uint32_t) * (2 * form->value_count + 1));
+    sccp.value_top = 0;
+    sccp.block_work = malloc(sizeof(uint32_t) * graph->block_count);
+    sccp.block_top = 0;
+    for (v = 0; v < form->value_count; v++) {
+        // never written, may hold anything
+        sccp.state[v] = form->values[v].def == CFG_NONE ? _SCCP_BOTTOM : _SCCP_TOP;
+        sccp.constant[v] = 0;
+    }
+    for (b = 0; b < graph->block_count; b++) {
+        for (i = graph->blocks[b].first; i < graph->blocks[b].last; i++)
+            sccp.block_of[i] = b;
+        form->block_live[b] = 0;
+        form->edge_live[b * 2] = form->edge_live[b * 2 + 1] = 0;
+    }
+
+    form->block_live[0] = 1;
+    sccp.block_work[sccp.block_top++] = 0;
+    while (sccp.block_top > 0 || sccp.value_top > 0) {
+        if (sccp.block_top > 0) {
+            _sccp_visit_block(&sccp, sccp.block_work[--sccp.block_top]);
+            continue;
+        }
+        v = sccp.value_work[--sccp.value_top];
+        for (u = form->user_start[v]; u < form->user_start[v + 1]; u++) {
+            i = form->users[u];
+            if (i & SSA_PHI) {
+                if (form->block_live[form->phis[i & ~SSA_PHI].block])
+                    _sccp_visit_phi(&sccp, i & ~SSA_PHI);
+            }
+            else if (form->block_live[sccp.block_of[i]]) {
+                _sccp_visit_inst(&sccp, i);
+            }
+        }
+    }
+
+    for (v = 0; v < form->value_count; v++) {
+        if (sccp.state[v] == _SCCP_CONSTANT)
+            ssa_replace(form, v, IR_MODE_I, sccp.constant[v]);
+    }
+    ssa_apply(form);
+    free(sccp.state);
+    free(sccp.constant);
+    free(sccp.block_of);
+    free(sccp.value_work);
+    free(sccp.block_work);
+}
@@ -19,15 +19,18 @@
 #include <semantics.h>
 #include <ir.h>
 #include <backend.h>
+#include <arena.h>
+#include <context.h>
+#include <opt.h>
 
-void _sem_validate_ext_def_list(ast_node *node, ir_func_list *ret_ir);
-void _sem_validate_ext_def(ast_node *node, ir_func_list *ret_ir);
+void _sem_validate_ext_def_list(ast_node *node);
+void _sem_validate_ext_def(ast_node *node);
 int _sem_validate_specifier(ast_node *node, struct_specifier **struct_specifier, int context, int do_not_free);
 void _sem_validate_ext_dec_list(ast_node *node, int type, struct_specifier *struct_specifier, ir_list *ret_ir);
 symbol_entry *_sem_validate_var_dec(ast_node *node);
 struct_specifier *_sem_validate_struct_specifier(ast_node *node, int context, int do_not_free);
 symbol_entry *_sem_validate_fun_dec(ast_node *node, int type, struct_specifier *struct_specifier, ir_list *ret_ir);
-int _sem_validate_var_list(ast_node *node, symbol_list **param_list, ir_list *ret_ir, int offset);
+int _sem_validate_var_list(ast_node *node, symbol_list **param_list, ir_list *ret_ir, int index);
 symbol_entry *_sem_validate_param_dec(ast_node *node);
 void _sem_validate_def_list(ast_node *node, int context, char no_optimization, ir_list *ret_ir);
 void _sem_validate_def(ast_node *node, int context, char no_optimization, ir_list *ret_ir);
@@ -37,6 +40,9 @@ char _sem_type_matching_with_symbol(symbol_entry *se, _sem_exp_type *et);
 void _sem_validate_comp_st(ast_node *node, int context, _sem_exp_type *return_type, char no_optimization, ir_list *ret_ir);
 void _sem_validate_stmt_list(ast_node *node, int context, _sem_exp_type *return_type, char no_optimization, ir_list *ret_ir);
 void _sem_validate_stmt(ast_node *node, int context, _sem_exp_type *return_type, char no_optimization, ir_list *ret_ir);
+void _sem_add_branch(_sem_exp_type *exp_type, uint32_t label, char jump_if, ir_list *ret_ir);
+char _sem_is_logical(ast_node *node);
+_sem_exp_type *_sem_validate_cond(ast_node *node, uint32_t label, char jump_if, char no_optimization, ir_list *ret_ir);
 
 
 // helpers from semantics_struct_helper
@@ -47,78 +53,57 @@ extern symbol_entry *_sem_validate_dec_for_struct(ast_node *node, int type, stru
 extern _sem_exp_type *_sem_validate_exp(ast_node *node, char no_optimization, ir_list *ret_ir);
 extern char _sem_type_matching(_sem_exp_type *t1, _sem_exp_type *t2);
 
-char _sem_error = 0;
-int _sem_unnamed_struct_count = 0;
-
 void _sem_report_error(const char *fmt, ...) {
     va_list args;
     va_start(args, fmt);
-    vprintf(fmt, args);
-    printf("\n");
+    vfprintf(cmmc_ctx->diag_file, fmt, args);
+    fprintf(cmmc_ctx->diag_file, "\n");
     va_end(args);
-    _sem_error = 1;
+    cmmc_ctx->sem_error = 1;
 }
 
 char sem_validate(ast_node *root) {
-    ir_func_list *root_ir = malloc(sizeof(ir_func_list));
-    root_ir->func_content = NULL;
-    root_ir->next = NULL;
     symtable_init();
     // Current node: Program
     if (root->children[0] != NULL) {
-        _sem_validate_ext_def_list(root->children[0], root_ir);
-        cg_mips_generate(root_ir);
+        cg_mips_generate_header();
+        _sem_validate_ext_def_list(root->children[0]);
     }
     // else {
     //     empty program!
     //}
     symtable_ensure_defined();
-    return _sem_error;
+    return cmmc_ctx->sem_error;
 }
 
-void _sem_validate_ext_def_list(ast_node *node, ir_func_list *ret_ir) {
-    if (node == NULL) {
-        // empty def list
-        return;
-    }
-    ir_func_list *sec_ir;
-    assert(node->children_count == 2);
-    assert(node->children[0] != NULL);
-    assert(!strcmp(node->children[0]->name, "ExtDef"));
-
-    _sem_validate_ext_def(node->children[0], ret_ir);
-    if (ret_ir->func_content == NULL) {
-        _sem_validate_ext_def_list(node->children[1], ret_ir);
-        return;
-    }
-    else {
-        sec_ir = malloc(sizeof(ir_func_list));
-        sec_ir->func_content = NULL;
-        sec_ir->next = NULL;
-        _sem_validate_ext_def_list(node->children[1], sec_ir);
-        if (sec_ir->func_content == NULL) {
-            // nothing to do
-            ret_ir->next = NULL;
-            free(sec_ir);
-        }
-        else {
-            ret_ir->next = sec_ir;
-        }
-        return;
+void _sem_validate_ext_def_list(ast_node *node) {
+    while (node != NULL) {
+        assert(node->children_count == 2);
+        assert(node->children[0] != NULL);
+        assert(node->children[0]->kind == AST_EXT_DEF);
+
+        _sem_validate_ext_def(node->children[0]);
+        // the function has been emitted, everything it
+        // allocated for semantics and ir goes away at once
+        arena_release(&cmmc_ctx->function_arena);
+        arena_release(&cmmc_ctx->ir_arena);
+        node = node->children[1];
     }
 } 
 
-void _sem_validate_ext_def(ast_node *node, ir_func_list *ret_ir) {
+void _sem_validate_ext_def(ast_node *node) {
     assert(node->children_count >= 2);
     assert(node->children[0] != NULL);
     assert(node->children[1] != NULL);
-    assert(!strcmp(node->children[0]->name, "Specifier"));
+    assert(node->children[0]->kind == AST_SPECIFIER);
 
     int type;
     struct_specifier *struct_specifier = NULL;
     symbol_entry *func_entry;
     _sem_exp_type return_type;
+    ir_list *func_header;
     ir_list *func_contents;
+    ir_function *func_ir;
     ir *ir_dec;
     type = _sem_validate_specifier(node->children[0], &struct_specifier, 0, 0);
     if (type == SYMBOL_T_ERROR) {
@@ -126,77 +111,87 @@ void _sem_validate_ext_def(ast_node *node, ir_func_list *ret_ir) {
         return;
     }
     
-    if (!strcmp(node->children[1]->name, "ExtDecList")) {
-        assert(node->children_count == 3);
-        assert(node->children[2] != NULL);
-
-        _sem_validate_ext_dec_list(node->children[1], type, struct_specifier, NULL);
-        // ignore ret_ir! global variables are unused
-    }
-    else if (!strcmp(node->children[1]->name, "SEMI")) {
-        assert(node->children_count == 2);
-        // if it is just a specifier
-        // then nothing happens
-        // if it is a struct definition
-        // then we have already inserted the symbol
-        // into the symbol table during the validation
-        // of struct_specifier
-        // thus still nothing happens
-        return;
-    }
-    else if (!strcmp(node->children[1]->name, "FunDec")) {
-        assert(node->children_count == 3);
-        ir_list *func_header = malloc(sizeof(ir_list));
-        func_header->head = NULL;
-        func_header->tail = NULL;
-        func_entry = _sem_validate_fun_dec(node->children[1], type, struct_specifier, func_header);
-        if (!strcmp(node->children[2]->name, "SEMI")) {
-            // declaration
-            func_entry->is_function_dec = 1;
-            // we are not using these!
-            if (func_entry->param_count)
-                symtable_pop_context_without_free(1);
-            symtable_insert(func_entry, 0, 0, 0, 0);
-            // No need to generate ir
-        }
-        else {
-            // CompSt
-            func_entry->is_function_dec = 0;
-            return_type.type = type;
-            return_type.is_array = 0;
-            return_type.is_lvalue = 0;
-            return_type.array_dimension = 0;
-            return_type.struct_specifier = struct_specifier;
-            if (symtable_insert(func_entry, 0, 0, 0, 0) == -1) { // Insert here to make recursion possible
-                return; // error, no need to generate ir
-            }
-            // in comp_st, symtable will pop symbols
-            // at level 1 but those without free will remain
-            func_contents = malloc(sizeof(ir_list));
-            func_contents->head = NULL;
-            func_contents->tail = NULL;
-            // reset the offset
+    switch (node->children[1]->kind) {
+        case AST_EXT_DEC_LIST:
+            assert(node->children_count == 3);
+            assert(node->children[2] != NULL);
+
+            _sem_validate_ext_dec_list(node->children[1], type, struct_specifier, NULL);
+            // ignore ret_ir! global variables are unused
+            break;
+        case AST_SEMI:
+            assert(node->children_count == 2);
+            // if it is just a specifier
+            // then nothing happens
+            // if it is a struct definition
+            // then we have already inserted the symbol
+            // into the symbol table during the validation
+            // of struct_specifier
+            // thus still nothing happens
+            return;
+        case AST_FUN_DEC:
+            assert(node->children_count == 3);
+            func_header = arena_alloc(&cmmc_ctx->ir_arena, sizeof(ir_list));
+            func_header->head = NULL;
+            func_header->tail = NULL;
+            // reset the offset, params passed in registers live in the frame
             ir_reset_counter();
-            _sem_validate_comp_st(node->children[2], 0, &return_type, 0, func_contents);
-            if (func_contents->head == NULL) {
-                // error
-                free(func_contents);
-                return;
+            func_entry = _sem_validate_fun_dec(node->children[1], type, struct_specifier, func_header);
+            if (node->children[2]->kind == AST_SEMI) {
+                // declaration
+                func_entry->is_function_dec = 1;
+                // we are not using these!
+                if (func_entry->param_count)
+                    symtable_pop_context_without_free(1);
+                symtable_insert(func_entry, 0, 0, 0, 0);
+                // No need to generate ir
             }
-            // add a dec
-            ir_dec = malloc(sizeof(ir));
-            ir_dec->op = IR_OP_DEC;
-            ir_dec->size = ir_stack_size();
-            ir_add_node_to_buffer(func_header, ir_dec);
-            ir_merge_buffer(func_header, func_contents);
-            ir_compress_label(func_header);
-            //ir_print_list(func_header);
-            ret_ir->func_content = func_header;
-        }
-    }
-    else {
-        // should not be here
-        assert(0);
+            else {
+                // CompSt
+                func_entry->is_function_dec = 0;
+                return_type.type = type;
+                return_type.is_array = 0;
+                return_type.is_lvalue = 0;
+                return_type.array_dimension = 0;
+                return_type.struct_specifier = struct_specifier;
+                if (symtable_insert(func_entry, 0, 0, 0, 0) == -1) { // Insert here to make recursion possible
+                    return; // error, no need to generate ir
+                }
+                // in comp_st, symtable will pop symbols
+                // at level 1 but those without free will remain
+                func_contents = arena_alloc(&cmmc_ctx->ir_arena, sizeof(ir_list));
+                func_contents->head = NULL;
+                func_contents->tail = NULL;
+                report_function_begin();
+                _sem_validate_comp_st(node->children[2], 0, &return_type, 0, func_contents);
+                if (func_contents->head == NULL) {
+                    // error
+                    return;
+                }
+                // add a dec
+                ir_dec = arena_alloc(&cmmc_ctx->ir_arena, sizeof(ir));
+                ir_dec->op = IR_OP_DEC;
+                ir_dec->size = ir_stack_size();
+                ir_add_node_to_buffer(func_header, ir_dec);
+                ir_merge_buffer(func_header, func_contents);
+                func_ir = ir_pack_function(func_header);
+                report_push(REPORT_PHASE_LABELS);
+                ir_compress_label(func_ir);
+                report_pop();
+                report_push(REPORT_PHASE_OPTIMIZE);
+                opt_function(func_ir);
+                report_pop();
+                cmmc_ctx->report.inst_count = func_ir->count;
+                //ir_print_function(func_ir);
+                report_push(REPORT_PHASE_CODEGEN);
+                cg_mips_generate_function(func_ir);
+                report_pop();
+                report_function_end(func_ir->names[0]);
+            }
+            break;
+        default:
+            // should not be here
+            assert(0);
     }
 }
 
@@ -216,399 +211,430 @@ void _sem_validate_stmt_list(ast_node *node, int context, _sem_exp_type *return_
     _sem_validate_stmt_list(node->children[1], context, return_type, no_optimization, ret_ir);
 }
 
-void _sem_validate_stmt(ast_node *node, int context, _sem_exp_type *return_type, char no_optimization, ir_list *ret_ir) {
-    _sem_exp_type *exp_type;
-    ir *ir_entry;
-    ir_list *ir_list_local = malloc(sizeof(ir_list));
-    uint32_t goto_label;
-    uint32_t goto_label_end;
-
-    ir_list_local->head = NULL;
-    ir_list_local->tail = NULL;
+// branches to label when the value of exp_type is true (jump_if 1)
+// or false (jump_if 0), falls through otherwise
+void _sem_add_branch(_sem_exp_type *exp_type, uint32_t label, char jump_if, ir_list *ret_ir) {
+    ir *ir_entry = arena_alloc(&cmmc_ctx->ir_arena, sizeof(ir));
+    uint32_t op = jump_if ? IR_OP_IF_POSITIVE : IR_OP_IF;
 
-    if (!strcmp(node->children[0]->name, "Exp")) {
-        if ((exp_type = _sem_validate_exp(node->children[0], no_optimization, ir_list_local)) == NULL) {
-            free(ir_list_local);
+    if (exp_type->constant_exp_status == SEM_CONSTANT_YES) {
+        if ((exp_type->int_val != 0) != jump_if)
             return;
-        }
-        if (exp_type->constant_exp_status == SEM_CONSTANT_IMMEDIATE) {
-            // not all can be safely ignored!
-            // expression like x + y will make no effect
-            // but CALL will!
-            if (exp_type->immediate_ir->op == IR_OP_CALL) {
-                // assign a dummy to it
-                exp_type->immediate_ir->temp_id = ir_new_temp_val(4);
-                exp_type->immediate_ir->mode.mode1 = IR_MODE_T;
-                exp_type->immediate_ir->mode.op1 = IR_MODE_NORMAL;
-                ir_add_node_to_buffer(ir_list_local, exp_type->immediate_ir);
-            }
-        }
-
-        ir_merge_buffer(ret_ir, ir_list_local);
-        free(ir_list_local);
-    }
-    if (!strcmp(node->children[0]->name, "CompSt")) {
-        _sem_validate_comp_st(node->children[0], context, return_type, no_optimization, ret_ir);
+        ir_entry->op = IR_OP_GOTO;
+        ir_entry->goto_label = label;
+        ir_add_node_to_buffer(ret_ir, ir_entry);
+        return;
     }
-    if (!strcmp(node->children[0]->name, "RETURN")) {
-        exp_type = _sem_validate_exp(node->children[1], no_optimization, ir_list_local);
-        if (exp_type == NULL) {
-            _sem_report_error("Error type 8 at Line %d: Returned an expression with error", node->children[1]->line_number);
-            return;
-        }
-        if (!_sem_type_matching(exp_type, return_type)) {
-            _sem_report_error("Error type 8 at Line %d: Return type mismatched", node->children[1]->line_number);
-        }
-        ir_entry = malloc(sizeof(ir));
-        ir_entry->op = IR_OP_RETURN;
-        // when no optimization is on
-        // exp_type will not be constant
-        // unless it does not involve any variables
-        if (exp_type->constant_exp_status == SEM_CONSTANT_IMMEDIATE) {
-            ir_merge_buffer(ret_ir, ir_list_local);
-            if (exp_type->immediate_ir->op == IR_EXP_OP_MACCESS) {
-                exp_type->immediate_ir = ir_simplify_maccess(exp_type->immediate_ir, ret_ir);
-                ir_entry->temp_id = exp_type->immediate_ir->temp_id1;
-                ir_entry->var_id = exp_type->immediate_ir->var_id1;
-                ir_entry->mode.mode1 = exp_type->immediate_ir->mode.mode2;
-                ir_entry->mode.op1 = exp_type->immediate_ir->mode.op2;
-            }
-            else {
-                exp_type->immediate_ir->temp_id = ir_new_temp_val(4);
-                exp_type->immediate_ir->mode.mode1 = IR_MODE_T;
-                exp_type->immediate_ir->mode.op1 = IR_MODE_NORMAL;
-                ir_add_node_to_buffer(ret_ir, exp_type->immediate_ir);
-                ir_entry->temp_id = exp_type->immediate_ir->temp_id;
+    if (exp_type->constant_exp_status == SEM_CONSTANT_IMMEDIATE) {
+        ir_entry->immediate_ir = exp_type->immediate_ir;
+        ir_entry->op = IR_OP_IF_IMME;
+        switch(ir_entry->immediate_ir->op) {
+            case IR_EXP_OP_EQ:
+                if (!jump_if)
+                    ir_entry->immediate_ir->op = IR_EXP_OP_NEQ;
+                break;
+            case IR_EXP_OP_NEQ:
+                if (!jump_if)
+                    ir_entry->immediate_ir->op = IR_EXP_OP_EQ;
+                break;
+            case IR_EXP_OP_LT:
+                if (!jump_if)
+                    ir_entry->immediate_ir->op = IR_EXP_OP_GE;
+                break;
+            case IR_EXP_OP_LE:
+                if (!jump_if)
+                    ir_entry->immediate_ir->op = IR_EXP_OP_GT;
+                break;
+            case IR_EXP_OP_GE:
+                if (!jump_if)
+                    ir_entry->immediate_ir->op = IR_EXP_OP_LT;
+                break;
+            case IR_EXP_OP_GT:
+                if (!jump_if)
+                    ir_entry->immediate_ir->op = IR_EXP_OP_LE;
+                break;
+            case IR_EXP_OP_MACCESS:
+                // the element ends up as the source of the access
+                ir_entry->immediate_ir = ir_simplify_maccess(ir_entry->immediate_ir, ret_ir);
+                ir_entry->op = op;
+                ir_entry->var_id = ir_entry->immediate_ir->var_id1;
+                ir_entry->temp_id = ir_entry->immediate_ir->temp_id1;
+                ir_entry->mode.mode1 = ir_entry->immediate_ir->mode.mode2;
+                ir_entry->mode.op1 = ir_entry->immediate_ir->mode.op2;
+                break;
+            default:
+                // generate new temp var
+                ir_entry->op = op;
+                ir_entry->immediate_ir->temp_id = ir_new_temp_val(4);
+                ir_entry->immediate_ir->mode.mode1 = IR_MODE_T;
+                ir_entry->immediate_ir->mode.op1 = IR_MODE_NORMAL;
+                ir_add_node_to_buffer(ret_ir, ir_entry->immediate_ir);
+                ir_entry->temp_id = ir_entry->immediate_ir->temp_id;
                 ir_entry->mode.mode1 = IR_MODE_T;
                 ir_entry->mode.op1 = IR_MODE_NORMAL;
-            }
-        }
-        else if (exp_type->constant_exp_status == SEM_CONSTANT_YES) {
-            ir_entry->mode.mode1 = IR_MODE_I;
-            ir_entry->mode.op1 = IR_MODE_NORMAL;
-            if (exp_type->type == SYMBOL_T_INT) {
-                ir_entry->int_val1 = exp_type->int_val;
-            }
-            if (exp_type->type == SYMBOL_T_FLOAT) {
-                ir_entry->float_val1 = exp_type->float_val;
-            }
-            if (exp_type->type == SYMBOL_T_STRUCT) {
-                ir_entry->int_val1 = exp_type->int_val;
-            }
-            // do not merge ir_list_local
-            // as the exp is constant
-            free(ir_list_local);
+                ir_entry->immediate_ir = NULL;
         }
-        else {
+    }
+    else {
+        // non constant
+        ir_entry->op = op;
+        ir_entry->immediate_ir = NULL;
+        if (exp_type->type_mode == SEM_TYPE_MODE_T) {
+            ir_entry->mode.mode1 = IR_MODE_T;
             ir_entry->temp_id = exp_type->ir_temp_val_id;
+        }
+        else if (exp_type->type_mode == SEM_TYPE_MODE_V) {
+            ir_entry->mode.mode1 = IR_MODE_V;
             ir_entry->var_id = exp_type->ir_var_id;
-            if (exp_type->type_mode_op == SEM_TYPE_MODE_NORMAL)
-                ir_entry->mode.op1 = IR_MODE_NORMAL;
-            else if (exp_type->type_mode_op == SEM_TYPE_MODE_STAR)
-                ir_entry->mode.op1 = IR_MODE_STAR;
-            else if (exp_type->type_mode_op == SEM_TYPE_MODE_ADDR)
-                ir_entry->mode.op1 = IR_MODE_ADDR;
-            if (exp_type->type_mode == SEM_TYPE_MODE_T)
-                ir_entry->mode.mode1 = IR_MODE_T;
-            else if (exp_type->type_mode == SEM_TYPE_MODE_V)
-                ir_entry->mode.mode1 = IR_MODE_V;
-            ir_merge_buffer(ret_ir, ir_list_local);
         }
-        ir_add_node_to_buffer(ret_ir, ir_entry);
-        free(exp_type);
-        return;
-    }
-    if (!strcmp(node->children[0]->name, "IF")) {
-        // IF LP Exp RP Stmt // ELSE Stmt
-        exp_type = _sem_validate_exp(node->children[2], no_optimization, ir_list_local);
-        if (exp_type == NULL) {
-            // _sem_report_error("Error type 8 at Line %d: Expression with error", node->children[1]->line_number);
-            free(ir_list_local);
+
+        if (exp_type->type_mode_op == SEM_TYPE_MODE_NORMAL) {
+            ir_entry->mode.op1 = IR_MODE_NORMAL;
         }
-        else {
-            if (exp_type->type != SYMBOL_T_INT || exp_type->is_array) {
-                _sem_report_error("Error type 8 at Line %d: INT required in IF statement", node->children[1]->line_number);
-            }
+        else if (exp_type->type_mode_op == SEM_TYPE_MODE_STAR) {
+            ir_entry->mode.op1 = IR_MODE_STAR;
         }
-        // first we check if the expr is constant
-        // only exp without variables can be real constant
-        // when no optimization is on
-        if (exp_type->constant_exp_status == SEM_CONSTANT_YES) {
-            if (exp_type->int_val) {
-                // always true
-                _sem_validate_stmt(node->children[4], context, return_type, 1, ret_ir);
-                if (node->children_count == 7) {
-                    // if there is an else ELSE Stmt
-                    // yet still need to validate!
-                    _sem_validate_stmt(node->children[6], context, return_type, 1, ir_list_local);
-                }
-                free(exp_type);
-                free(ir_list_local);
+        else if (exp_type->type_mode_op == SEM_TYPE_MODE_ADDR) {
+            ir_entry->mode.op1 = IR_MODE_ADDR;
+        }
+    }
+    ir_entry->goto_label = label;
+    ir_add_node_to_buffer(ret_ir, ir_entry);
+}
+
+// whether a condition is an &&, || or !, maybe in parentheses
+char _sem_is_logical(ast_node *node) {
+    while (node->children_count == 3 && node->children[0]->kind == AST_LP)
+        node = node->children[1];
+    if (node->children_count == 2 && node->children[0]->kind == AST_NOT)
+        return 1;
+    return node->children_count == 3 && (node->children[1]->kind == AST_AND || node->children[1]->kind == AST_OR);
+}
+
+// jumping code for a condition, goes to label when it is jump_if and
+// falls through otherwise. && and || never make a value:
+//
+//   a && b, jump if false      a jump if false, b jump if false
+//   a && b, jump if true       a jump if false to skip, b jump if true, skip:
+//
+// and || the other way around, ! only turns jump_if over. the right
+// operand is skipped when the left one already decides
+_sem_exp_type *_sem_validate_cond(ast_node *node, uint32_t label, char jump_if, char no_optimization, ir_list *ret_ir) {
+    _sem_exp_type *exp_type, *left, *right;
+    ir *ir_entry;
+    uint32_t skip;
+    char is_and;
+
+    if (node->children_count == 3 && node->children[0]->kind == AST_LP)
+        return _sem_validate_cond(node->children[1], label, jump_if, no_optimization, ret_ir);
+    if (node->children_count == 2 && node->children[0]->kind == AST_NOT) {
+        exp_type = _sem_validate_cond(node->children[1], label, !jump_if, no_optimization, ret_ir);
+        if (exp_type != NULL && (exp_type->type != SYMBOL_T_INT || exp_type->is_array)) {
+            _sem_report_error("Error type 7 at Line %d: Type mismatched for operator. INT expected.", node->children[1]->line_number);
+            return NULL;
+        }
+        return exp_type;
+    }
+    if (!_sem_is_logical(node)) {
+        exp_type = _sem_validate_exp(node, no_optimization, ret_ir);
+        if (exp_type != NULL && exp_type->type == SYMBOL_T_INT && !exp_type->is_array)
+            _sem_add_branch(exp_type, label, jump_if, ret_ir);
+        return exp_type;
+    }
+
+    is_and = (node->children[1]->kind == AST_AND);
+    skip = is_and != jump_if ? label : ir_new_label();
+    left = _sem_validate_cond(node->children[0], skip, is_and != jump_if ? jump_if : !jump_if, no_optimization, ret_ir);
+    right = NULL;
+    if (left != NULL && left->type == SYMBOL_T_INT)
+        right = _sem_validate_cond(node->children[2], label, jump_if, no_optimization, ret_ir);
+    // the left operand may have jumped here even if the right one failed
+    if (skip != label) {
+        ir_entry = arena_alloc(&cmmc_ctx->ir_arena, sizeof(ir));
+        ir_entry->op = IR_OP_LABEL;
+        ir_entry->goto_label = skip;
+        ir_add_node_to_buffer(ret_ir, ir_entry);
+    }
+    if (left == NULL || (left->type == SYMBOL_T_INT && right == NULL)) {
+        return NULL;
+    }
+    if (left->type != SYMBOL_T_INT || right->type != SYMBOL_T_INT) {
+        _sem_report_error("Error type 7 at Line %d: Type mismatched for operator. INT expected.", node->children[1]->line_number);
+        return NULL;
+    }
+
+    exp_type = arena_alloc(&cmmc_ctx->function_arena, sizeof(_sem_exp_type));
+    exp_type->type = SYMBOL_T_INT;
+    exp_type->is_array = 0;
+    exp_type->constant_exp_status = SEM_CONSTANT_NO;
+    return exp_type;
+}
+
+void _sem_validate_stmt(ast_node *node, int context, _sem_exp_type *return_type, char no_optimization, ir_list *ret_ir) {
+    _sem_exp_type *exp_type;
+    ir *ir_entry;
+    ir_list *ir_list_local = arena_alloc(&cmmc_ctx->ir_arena, sizeof(ir_list));
+    uint32_t goto_label;
+    uint32_t goto_label_end;
+
+    ir_list_local->head = NULL;
+    ir_list_local->tail = NULL;
+
+    switch (node->children[0]->kind) {
+        case AST_EXP:
+            if ((exp_type = _sem_validate_exp(node->children[0], no_optimization, ir_list_local)) == NULL) {
                 return;
             }
-            else {
-                // always false
-                // still need to validate
-                _sem_validate_stmt(node->children[4], context, return_type, 1, ir_list_local);
-                if (node->children_count == 7) {
-                    // if there is an else ELSE Stmt
-                    _sem_validate_stmt(node->children[6], context, return_type, 1, ret_ir);
+            if (exp_type->constant_exp_status == SEM_CONSTANT_IMMEDIATE) {
+                // not all can be safely ignored!
+                // expression like x + y will make no effect
+                // but CALL will!
+                if (exp_type->immediate_ir->op == IR_OP_CALL) {
+                    // assign a dummy to it
+                    exp_type->immediate_ir->temp_id = ir_new_temp_val(4);
+                    exp_type->immediate_ir->mode.mode1 = IR_MODE_T;
+                    exp_type->immediate_ir->mode.op1 = IR_MODE_NORMAL;
+                    ir_add_node_to_buffer(ir_list_local, exp_type->immediate_ir);
                 }
-                // if there is no else stmt
-                // then the whole branch is ignored
-                free(exp_type);
-                free(ir_list_local);
-                return;
             }
-        }
 
-        ir_merge_buffer(ret_ir, ir_list_local);
-        ir_entry = malloc(sizeof(ir));
-        // now do the inverse of the exp to get to the false branch
-        if (exp_type->constant_exp_status == SEM_CONSTANT_IMMEDIATE) {
-            ir_entry->immediate_ir = exp_type->immediate_ir;
-            ir_entry->op = IR_OP_IF_IMME;
-            switch(ir_entry->immediate_ir->op) {
-                case IR_EXP_OP_EQ:
-                    ir_entry->immediate_ir->op = IR_EXP_OP_NEQ;
-                    break;
-                case IR_EXP_OP_NEQ:
-                    ir_entry->immediate_ir->op = IR_EXP_OP_EQ;
-                    break;
-                case IR_EXP_OP_LT:
-                    ir_entry->immediate_ir->op = IR_EXP_OP_GE;
-                    break;
-                case IR_EXP_OP_LE:
-                    ir_entry->immediate_ir->op = IR_EXP_OP_GT;
-                    break;
-                case IR_EXP_OP_GE:
-                    ir_entry->immediate_ir->op = IR_EXP_OP_LT;
-                    break;
-                case IR_EXP_OP_GT:
-                    ir_entry->immediate_ir->op = IR_EXP_OP_LE;
-                    break;
-                case IR_EXP_OP_MACCESS:
+            ir_merge_buffer(ret_ir, ir_list_local);
+            break;
+        case AST_COMP_ST:
+            _sem_validate_comp_st(node->children[0], context, return_type, no_optimization, ret_ir);
+            break;
+        case AST_RETURN:
+            exp_type = _sem_validate_exp(node->children[1], no_optimization, ir_list_local);
+            if (exp_type == NULL) {
+                _sem_report_error("Error type 8 at Line %d: Returned an expression with error", node->children[1]->line_number);
+                return;
+            }
+            if (!_sem_type_matching(exp_type, return_type)) {
+                _sem_report_error("Error type 8 at Line %d: Return type mismatched", node->children[1]->line_number);
+            }
+            ir_entry = arena_alloc(&cmmc_ctx->ir_arena, sizeof(ir));
+            ir_entry->op = IR_OP_RETURN;
+            // when no optimization is on
+            // exp_type will not be constant
+            // unless it does not involve any variables
+            if (exp_type->constant_exp_status == SEM_CONSTANT_IMMEDIATE) {
+                ir_merge_buffer(ret_ir, ir_list_local);
+                if (exp_type->immediate_ir->op == IR_EXP_OP_MACCESS) {
                     exp_type->immediate_ir = ir_simplify_maccess(exp_type->immediate_ir, ret_ir);
-                    ir_entry->op = IR_OP_IF;
-                    ir_entry->var_id = exp_type->immediate_ir->var_id;
+                    ir_entry->temp_id = exp_type->immediate_ir->temp_id1;
+                    ir_entry->var_id = exp_type->immediate_ir->var_id1;
+                    ir_entry->mode.mode1 = exp_type->immediate_ir->mode.mode2;
+                    ir_entry->mode.op1 = exp_type->immediate_ir->mode.op2;
+                }
+                else {
+                    exp_type->immediate_ir->temp_id = ir_new_temp_val(4);
+                    exp_type->immediate_ir->mode.mode1 = IR_MODE_T;
+                    exp_type->immediate_ir->mode.op1 = IR_MODE_NORMAL;
+                    ir_add_node_to_buffer(ret_ir, exp_type->immediate_ir);
                     ir_entry->temp_id = exp_type->immediate_ir->temp_id;
-                    ir_entry->mode.mode1 = exp_type->immediate_ir->mode.mode1;
-                    ir_entry->mode.op1 = exp_type->immediate_ir->mode.op1;
-                    break;
-                default:
-                    // generate new temp var
-                    ir_entry->op = IR_OP_IF;
-                    ir_entry->immediate_ir->temp_id = ir_new_temp_val(4);
-                    ir_entry->immediate_ir->mode.mode1 = IR_MODE_T;
-                    ir_entry->immediate_ir->mode.op1 = IR_MODE_NORMAL;
-                    ir_add_node_to_buffer(ret_ir, ir_entry->immediate_ir);
-                    ir_entry->temp_id = ir_entry->immediate_ir->temp_id;
                     ir_entry->mode.mode1 = IR_MODE_T;
                     ir_entry->mode.op1 = IR_MODE_NORMAL;
-                    ir_entry->immediate_ir = NULL;
-            }
-        }
-        else {
-            // non constant
-            if (exp_type->type_mode == SEM_TYPE_MODE_T) {
-                ir_entry->op = IR_OP_IF;
-                ir_entry->mode.mode1 = IR_MODE_T;
-                ir_entry->immediate_ir = NULL;
-                ir_entry->temp_id = exp_type->ir_temp_val_id;
-            }
-            else if (exp_type->type_mode == SEM_TYPE_MODE_V) {
-                ir_entry->op = IR_OP_IF;
-                ir_entry->mode.mode1 = IR_MODE_V;
-                ir_entry->immediate_ir = NULL;
-                ir_entry->var_id = exp_type->ir_var_id;
+                }
             }
-
-            if (exp_type->type_mode_op == SEM_TYPE_MODE_NORMAL) {
+            else if (exp_type->constant_exp_status == SEM_CONSTANT_YES) {
+                ir_entry->mode.mode1 = IR_MODE_I;
                 ir_entry->mode.op1 = IR_MODE_NORMAL;
+                if (exp_type->type == SYMBOL_T_INT) {
+                    ir_entry->int_val1 = exp_type->int_val;
+                }
+                if (exp_type->type == SYMBOL_T_FLOAT) {
+                    ir_entry->float_val1 = exp_type->float_val;
+                }
+                if (exp_type->type == SYMBOL_T_STRUCT) {
+                    ir_entry->int_val1 = exp_type->int_val;
+                }
+                // do not merge ir_list_local
+                // as the exp is constant
             }
-            else if (exp_type->type_mode_op == SEM_TYPE_MODE_STAR) {
-                ir_entry->mode.op1 = IR_MODE_STAR;
-            }
-            else if (exp_type->type_mode_op == SEM_TYPE_MODE_ADDR) {
-                ir_entry->mode.op1 = IR_MODE_ADDR;
+            else {
+                ir_entry->temp_id = exp_type->ir_temp_val_id;
+                ir_entry->var_id = exp_type->ir_var_id;
+                if (exp_type->type_mode_op == SEM_TYPE_MODE_NORMAL)
+                    ir_entry->mode.op1 = IR_MODE_NORMAL;
+                else if (exp_type->type_mode_op == SEM_TYPE_MODE_STAR)
+                    ir_entry->mode.op1 = IR_MODE_STAR;
+                else if (exp_type->type_mode_op == SEM_TYPE_MODE_ADDR)
+                    ir_entry->mode.op1 = IR_MODE_ADDR;
+                if (exp_type->type_mode == SEM_TYPE_MODE_T)
+                    ir_entry->mode.mode1 = IR_MODE_T;
+                else if (exp_type->type_mode == SEM_TYPE_MODE_V)
+                    ir_entry->mode.mode1 = IR_MODE_V;
+                ir_merge_buffer(ret_ir, ir_list_local);
             }
-        }
-        goto_label = ir_new_label();
-        ir_entry->goto_label = goto_label;
-        ir_add_node_to_buffer(ret_ir, ir_entry);
-
-
-        _sem_validate_stmt(node->children[4], context, return_type, 1, ret_ir);
-        if (node->children_count == 7) {
-            // ELSE Stmt
-            // add a goto to the end
-            ir_entry = malloc(sizeof(ir));
-            ir_entry->op = IR_OP_GOTO;
-            ir_entry->goto_label = ir_new_label();
-            goto_label_end = ir_entry->goto_label;
-            ir_add_node_to_buffer(ret_ir, ir_entry);
-            // add the else label
-            ir_entry = malloc(sizeof(ir));
-            ir_entry->op = IR_OP_LABEL;
-            ir_entry->goto_label = goto_label;
-            ir_add_node_to_buffer(ret_ir, ir_entry);
-            _sem_validate_stmt(node->children[6], context, return_type, 1, ret_ir);
-            // add the end label
-            ir_entry = malloc(sizeof(ir));
-            ir_entry->op = IR_OP_LABEL;
-            ir_entry->goto_label = goto_label_end;
-            ir_add_node_to_buffer(ret_ir, ir_entry);
-        }
-        else {
-            // add the end label
-            ir_entry = malloc(sizeof(ir));
-            ir_entry->op = IR_OP_LABEL;
-            ir_entry->goto_label = goto_label;
             ir_add_node_to_buffer(ret_ir, ir_entry);
-        }
-        return;
-    }
-    if (!strcmp(node->children[0]->name, "WHILE")) {
-        // WHILE LP Exp RP Stmt
-        // set no optimization to 1
-        exp_type = _sem_validate_exp(node->children[2], 1, ir_list_local);
-        if (exp_type == NULL) {
-            // _sem_report_error("Error type 8 at Line %d:  Expression with error", node->children[1]->line_number);
-        }
-        else {
-            if (exp_type->type != SYMBOL_T_INT || exp_type->is_array) {
-                _sem_report_error("Error type 8 at Line %d: INT required in WHILE statement", node->children[1]->line_number);
+            return;
+        case AST_IF:
+            // IF LP Exp RP Stmt // ELSE Stmt
+            if (_sem_is_logical(node->children[2])) {
+                // && || and ! jump straight to the false branch
+                goto_label = ir_new_label();
+                exp_type = _sem_validate_cond(node->children[2], goto_label, 0, no_optimization, ret_ir);
+                if (exp_type != NULL && (exp_type->type != SYMBOL_T_INT || exp_type->is_array)) {
+                    _sem_report_error("Error type 8 at Line %d: INT required in IF statement", node->children[1]->line_number);
+                }
             }
-            free(exp_type);
-        }
+            else {
+                exp_type = _sem_validate_exp(node->children[2], no_optimization, ir_list_local);
+                if (exp_type == NULL) {
+                    // _sem_report_error("Error type 8 at Line %d: Expression with error", node->children[1]->line_number);
+                }
+                else {
+                    if (exp_type->type != SYMBOL_T_INT || exp_type->is_array) {
+                        _sem_report_error("Error type 8 at Line %d: INT required in IF statement", node->children[1]->line_number);
+                    }
+                }
+                // first we check if the expr is constant
+                // only exp without variables can be real constant
+                // when no optimization is on
+                if (exp_type->constant_exp_status == SEM_CONSTANT_YES) {
+                    if (exp_type->int_val) {
+                        // always true
+                        _sem_validate_stmt(node->children[4], context, return_type, 1, ret_ir);
+                        if (node->children_count == 7) {
+                            // if there is an else ELSE Stmt
+                            // yet still need to validate!
+                            _sem_validate_stmt(node->children[6], context, return_type, 1, ir_list_local);
+                        }
+                        return;
+                    }
+                    else {
+                        // always false
+                        // still need to validate
+                        _sem_validate_stmt(node->children[4], context, return_type, 1, ir_list_local);
+                        if (node->children_count == 7) {
+                            // if there is an else ELSE Stmt
+                            _sem_validate_stmt(node->children[6], context, return_type, 1, ret_ir);
+                        }
+                        // if there is no else stmt
+                        // then the whole branch is ignored
+                        return;
+                    }
+                }
 
-        if (exp_type->constant_exp_status == SEM_CONSTANT_YES) {
-            // a real dead loop or a real unused loop is detected
-            // we only deal with unused loop
-            if (!exp_type->int_val) {
-                // nothing will be added
-                // the loop will be ignored
-                // however considering while (x = y - 1)
-                // we have to add the ir_list_local to the ret_ir
                 ir_merge_buffer(ret_ir, ir_list_local);
-                ir_list_local->head = NULL;
-                ir_list_local->tail = NULL;
-                // validate
-                _sem_validate_stmt(node->children[4], context, return_type, 1, ir_list_local);
-                return;
+                // jump to the false branch
+                goto_label = ir_new_label();
+                _sem_add_branch(exp_type, goto_label, 0, ret_ir);
+            }
+
+
+            _sem_validate_stmt(node->children[4], context, return_type, 1, ret_ir);
+            if (node->children_count == 7) {
+                // ELSE Stmt
+                // add a goto to the end
+                ir_entry = arena_alloc(&cmmc_ctx->ir_arena, sizeof(ir));
+                ir_entry->op = IR_OP_GOTO;
+                ir_entry->goto_label = ir_new_label();
+                goto_label_end = ir_entry->goto_label;
+                ir_add_node_to_buffer(ret_ir, ir_entry);
+                // add the else label
+                ir_entry = arena_alloc(&cmmc_ctx->ir_arena, sizeof(ir));
+                ir_entry->op = IR_OP_LABEL;
+                ir_entry->goto_label = goto_label;
+                ir_add_node_to_buffer(ret_ir, ir_entry);
+                _sem_validate_stmt(node->children[6], context, return_type, 1, ret_ir);
+                // add the end label
+                ir_entry = arena_alloc(&cmmc_ctx->ir_arena, sizeof(ir));
+                ir_entry->op = IR_OP_LABEL;
+                ir_entry->goto_label = goto_label_end;
+                ir_add_node_to_buffer(ret_ir, ir_entry);
             }
             else {
-                // don't have to generate anything but a label
-                ir_merge_buffer(ret_ir, ir_list_local);
-                // label comes after the merge buffer because
-                // if it is constan then the action will always be the same
-                ir_entry = malloc(sizeof(ir));
+                // add the end label
+                ir_entry = arena_alloc(&cmmc_ctx->ir_arena, sizeof(ir));
+                ir_entry->op = IR_OP_LABEL;
+                ir_entry->goto_label = goto_label;
+                ir_add_node_to_buffer(ret_ir, ir_entry);
+            }
+            return;
+        case AST_WHILE:
+            // WHILE LP Exp RP Stmt
+            // set no optimization to 1
+            if (_sem_is_logical(node->children[2])) {
+                // && || and ! jump straight out of the loop
+                ir_entry = arena_alloc(&cmmc_ctx->ir_arena, sizeof(ir));
                 ir_entry->op = IR_OP_LABEL;
                 goto_label = ir_new_label();
                 ir_entry->goto_label = goto_label;
                 ir_add_node_to_buffer(ret_ir, ir_entry);
                 goto_label_end = ir_new_label();
-                free(ir_list_local);
-            }
-        }
-        else {
-            // add the first label
-            ir_entry = malloc(sizeof(ir));
-            ir_entry->op = IR_OP_LABEL;
-            goto_label = ir_new_label();
-            ir_entry->goto_label = goto_label;
-            ir_add_node_to_buffer(ret_ir, ir_entry);
-
-            // merge the exp
-            ir_merge_buffer(ret_ir, ir_list_local);
-            free(ir_list_local);
-
-            ir_entry = malloc(sizeof(ir));
-            if (exp_type->constant_exp_status == SEM_CONSTANT_IMMEDIATE) {
-                ir_entry->immediate_ir = exp_type->immediate_ir;
-                ir_entry->op = IR_OP_IF_IMME;
-                switch(ir_entry->immediate_ir->op) {
-                    case IR_EXP_OP_EQ:
-                        ir_entry->immediate_ir->op = IR_EXP_OP_NEQ;
-                        break;
-                    case IR_EXP_OP_NEQ:
-                        ir_entry->immediate_ir->op = IR_EXP_OP_EQ;
-                        break;
-                    case IR_EXP_OP_LT:
-                        ir_entry->immediate_ir->op = IR_EXP_OP_GE;
-                        break;
-                    case IR_EXP_OP_LE:
-                        ir_entry->immediate_ir->op = IR_EXP_OP_GT;
-                        break;
-                    case IR_EXP_OP_GE:
-                        ir_entry->immediate_ir->op = IR_EXP_OP_LT;
-                        break;
-                    case IR_EXP_OP_GT:
-                        ir_entry->immediate_ir->op = IR_EXP_OP_LE;
-                        break;
-                    case IR_EXP_OP_MACCESS:
-                        ir_entry->immediate_ir = ir_simplify_maccess(ir_entry->immediate_ir, ret_ir);
-                        ir_entry->op = IR_OP_IF;
-                        ir_entry->var_id = ir_entry->immediate_ir->var_id1;
-                        ir_entry->temp_id = ir_entry->immediate_ir->temp_id1;
-                        ir_entry->mode.mode1 = ir_entry->immediate_ir->mode.mode2;
-                        ir_entry->mode.op1 = ir_entry->immediate_ir->mode.op2;
-                        break;
-                    default:
-                        // generate new temp var
-                        ir_entry->op = IR_OP_IF;
-                        ir_entry->immediate_ir->temp_id = ir_new_temp_val(4);
-                        ir_entry->immediate_ir->mode.mode1 = IR_MODE_T;
-                        ir_entry->immediate_ir->mode.op1 = IR_MODE_NORMAL;
-                        ir_add_node_to_buffer(ret_ir, ir_entry->immediate_ir);
-                        ir_entry->temp_id = ir_entry->immediate_ir->temp_id;
-                        ir_entry->mode.mode1 = IR_MODE_T;
-                        ir_entry->mode.op1 = IR_MODE_NORMAL;
-                        ir_entry->immediate_ir = NULL;
+                exp_type = _sem_validate_cond(node->children[2], goto_label_end, 0, 1, ret_ir);
+                if (exp_type != NULL && (exp_type->type != SYMBOL_T_INT || exp_type->is_array)) {
+                    _sem_report_error("Error type 8 at Line %d: INT required in WHILE statement", node->children[1]->line_number);
                 }
             }
             else {
-                // non constant
-                if (exp_type->type_mode == SEM_TYPE_MODE_T) {
-                    ir_entry->op = IR_OP_IF;
-                    ir_entry->mode.mode1 = IR_MODE_T;
-                    ir_entry->immediate_ir = NULL;
-                    ir_entry->temp_id = exp_type->ir_temp_val_id;
+                exp_type = _sem_validate_exp(node->children[2], 1, ir_list_local);
+                if (exp_type == NULL) {
+                    // _sem_report_error("Error type 8 at Line %d:  Expression with error", node->children[1]->line_number);
                 }
-                else if (exp_type->type_mode == SEM_TYPE_MODE_V) {
-                    ir_entry->op = IR_OP_IF;
-                    ir_entry->mode.mode1 = IR_MODE_V;
-                    ir_entry->immediate_ir = NULL;
-                    ir_entry->var_id = exp_type->ir_var_id;
+                else {
+                    if (exp_type->type != SYMBOL_T_INT || exp_type->is_array) {
+                        _sem_report_error("Error type 8 at Line %d: INT required in WHILE statement", node->children[1]->line_number);
+                    }
                 }
 
-                if (exp_type->type_mode_op == SEM_TYPE_MODE_NORMAL) {
-                    ir_entry->mode.op1 = IR_MODE_NORMAL;
-                }
-                else if (exp_type->type_mode_op == SEM_TYPE_MODE_STAR) {
-                    ir_entry->mode.op1 = IR_MODE_STAR;
+                if (exp_type->constant_exp_status == SEM_CONSTANT_YES) {
+                    // a real dead loop or a real unused loop is detected
+                    // we only deal with unused loop
+                    if (!exp_type->int_val) {
+                        // nothing will be added
+                        // the loop will be ignored
+                        // however considering while (x = y - 1)
+                        // we have to add the ir_list_local to the ret_ir
+                        ir_merge_buffer(ret_ir, ir_list_local);
+                        ir_list_local->head = NULL;
+                        ir_list_local->tail = NULL;
+                        // validate
+                        _sem_validate_stmt(node->children[4], context, return_type, 1, ir_list_local);
+                        return;
+                    }
+                    else {
+                        // don't have to generate anything but a label
+                        ir_merge_buffer(ret_ir, ir_list_local);
+                        // label comes after the merge buffer because
+                        // if it is constan then the action will always be the same
+                        ir_entry = arena_alloc(&cmmc_ctx->ir_arena, sizeof(ir));
+                        ir_entry->op = IR_OP_LABEL;
+                        goto_label = ir_new_label();
+                        ir_entry->goto_label = goto_label;
+                        ir_add_node_to_buffer(ret_ir, ir_entry);
+                        goto_label_end = ir_new_label();
+                    }
                 }
-                else if (exp_type->type_mode_op == SEM_TYPE_MODE_ADDR) {
-                    ir_entry->mode.op1 = IR_MODE_ADDR;
+                else {
+                    // add the first label
+                    ir_entry = arena_alloc(&cmmc_ctx->ir_arena, sizeof(ir));
+                    ir_entry->op = IR_OP_LABEL;
+                    goto_label = ir_new_label();
+                    ir_entry->goto_label = goto_label;
+                    ir_add_node_to_buffer(ret_ir, ir_entry);
+
+                    // merge the exp
+                    ir_merge_buffer(ret_ir, ir_list_local);
+
+                    goto_label_end = ir_new_label();
+                    _sem_add_branch(exp_type, goto_label_end, 0, ret_ir);
                 }
             }
-            goto_label_end = ir_new_label();
+
+            // do not optimize
+            _sem_validate_stmt(node->children[4], context, return_type, 1, ret_ir);
+            // add goto the top
+            ir_entry = arena_alloc(&cmmc_ctx->ir_arena, sizeof(ir));
+            ir_entry->op = IR_OP_GOTO;
+            ir_entry->goto_label = goto_label;
+            ir_add_node_to_buffer(ret_ir, ir_entry);
+            ir_entry = arena_alloc(&cmmc_ctx->ir_arena, sizeof(ir));
+            ir_entry->op = IR_OP_LABEL;
             ir_entry->goto_label = goto_label_end;
             ir_add_node_to_buffer(ret_ir, ir_entry);
-        }
-
-        // do not optimize
-        _sem_validate_stmt(node->children[4], context, return_type, 1, ret_ir);
-        // add goto the top
-        ir_entry = malloc(sizeof(ir));
-        ir_entry->op = IR_OP_GOTO;
-        ir_entry->goto_label = goto_label;
-        ir_add_node_to_buffer(ret_ir, ir_entry);
-        ir_entry = malloc(sizeof(ir));
-        ir_entry->op = IR_OP_LABEL;
-        ir_entry->goto_label = goto_label_end;
-        ir_add_node_to_buffer(ret_ir, ir_entry);
-        return;
+            return;
     }
 }
 
@@ -617,28 +643,26 @@ void _sem_validate_stmt(ast_node *node, int context, _sem_exp_type *return_type,
 int _sem_validate_specifier(ast_node *node, struct_specifier **struct_specifier, int context, int do_not_free) {
     assert(node->children_count == 1);
 
-    if (!strcmp(node->children[0]->name, "StructSpecifier")) {
-        // parse struct specifier
-        *struct_specifier = _sem_validate_struct_specifier(node->children[0], context, do_not_free);
-        if (*struct_specifier == NULL)
+    switch (node->children[0]->kind) {
+        case AST_STRUCT_SPECIFIER:
+            // parse struct specifier
+            *struct_specifier = _sem_validate_struct_specifier(node->children[0], context, do_not_free);
+            if (*struct_specifier == NULL)
+                return SYMBOL_T_ERROR;
+            return SYMBOL_T_STRUCT;
+        case AST_TYPE:
+            *struct_specifier = NULL;
+            if (node->children[0]->subkind == AST_TYPE_INT)
+                return SYMBOL_T_INT;
+            return SYMBOL_T_FLOAT;
+        default:
+            assert(0);
             return SYMBOL_T_ERROR;
-        return SYMBOL_T_STRUCT;
-    }
-    else if (!strcmp(node->children[0]->string_value, "int")) {
-        *struct_specifier = NULL;
-        return SYMBOL_T_INT;
-    } else if (!strcmp(node->children[0]->string_value, "float")) {
-        *struct_specifier = NULL;
-        return SYMBOL_T_FLOAT;
-    }
-    else {
-        assert(0);
-        return SYMBOL_T_ERROR;
     }
 }
 
 void _sem_validate_ext_dec_list(ast_node *node, int type, struct_specifier *struct_specifier, ir_list *ret_ir) {
-    assert(!strcmp(node->name, "ExtDecList"));
+    assert(node->kind == AST_EXT_DEC_LIST);
     symbol_entry *ins_entry;
     ir *ir_entry;
     int i = 0;
@@ -658,7 +682,7 @@ void _sem_validate_ext_dec_list(ast_node *node, int type, struct_specifier *stru
     // we do not have ext dec and ir does not support ext dec
     // so we will not generate code for it
     /*
-    ir_entry = malloc(sizeof(ir));
+    ir_entry = arena_alloc(&cmmc_ctx->ir_arena, sizeof(ir));
     ir_entry->op = IR_OP_DEC;
     ir_entry->var_id = ins_entry->ir_variable_id;
     ir_entry->size = ins_entry->size;
@@ -671,7 +695,6 @@ void _sem_validate_ext_dec_list(ast_node *node, int type, struct_specifier *stru
     ins_entry->size = ir_entry->int_val1;*/
     //ir_add_node_to_buffer(ret_ir, ir_entry);
     if (symtable_insert(ins_entry, 0, 0, 0, 0)) {
-        free(ins_entry);
         // failed to insert
         // but should not stop
     }
@@ -682,11 +705,11 @@ void _sem_validate_ext_dec_list(ast_node *node, int type, struct_specifier *stru
 
 // return a symbol_entry with its id and array information initialized
 symbol_entry *_sem_validate_var_dec(ast_node *node) {
-    symbol_entry *ret_entry = malloc(sizeof(symbol_entry));
+    symbol_entry *ret_entry = arena_alloc(&cmmc_ctx->symbol_arena, sizeof(symbol_entry));
     symbol_entry *sub_entry;
 
     if (node->children_count == 1) { // ID
-        assert(!strcmp(node->children[0]->name, "ID"));
+        assert(node->children[0]->kind == AST_ID);
         ret_entry->is_array = 0;
         ret_entry->array_dimention = 0;
         ret_entry->is_function = 0;
@@ -699,15 +722,14 @@ symbol_entry *_sem_validate_var_dec(ast_node *node) {
         return ret_entry;
     }
     else if (node->children_count == 4) { // VarDec LB INT RB
-        assert(!strcmp(node->children[0]->name, "VarDec"));
-        assert(!strcmp(node->children[2]->name, "INT"));
+        assert(node->children[0]->kind == AST_VAR_DEC);
+        assert(node->children[2]->kind == AST_INT);
         sub_entry = _sem_validate_var_dec(node->children[0]);
         ret_entry->is_array = 1;
         ret_entry->array_dimention = sub_entry->array_dimention + 1;
-        ret_entry->array_size = malloc(ret_entry->array_dimention * sizeof(int));
+        ret_entry->array_size = arena_alloc(&cmmc_ctx->symbol_arena, ret_entry->array_dimention * sizeof(int));
         if (sub_entry->is_array) {
             memcpy(&(ret_entry->array_size[1]), sub_entry->array_size, sub_entry->array_dimention * sizeof(int));
-            free(sub_entry->array_size);
         }
         ret_entry->is_function = 0;
         ret_entry->is_function_dec = 0;
@@ -716,7 +738,6 @@ symbol_entry *_sem_validate_var_dec(ast_node *node) {
         ret_entry->line_no_def = node->line_number;
         ret_entry->id = sub_entry->id;
         ret_entry->array_size[0] = node->children[2]->int_value;
-        free(sub_entry);
         return ret_entry;
     }
     else {
@@ -727,12 +748,12 @@ symbol_entry *_sem_validate_var_dec(ast_node *node) {
 
 // return a struct specifier; return NULL on error
 struct_specifier *_sem_validate_struct_specifier(ast_node *node, int context, int do_not_free) {
-    struct_specifier *ret_specifier = malloc(sizeof(struct_specifier));
+    struct_specifier *ret_specifier = arena_alloc(&cmmc_ctx->symbol_arena, sizeof(struct_specifier));
     symbol_entry *ins_specifier_symbol;
     uint32_t struct_size = 0;
     symbol_list *size_iterator;
 
-    assert(!strcmp(node->children[0]->name, "STRUCT"));
+    assert(node->children[0]->kind == AST_STRUCT);
     // STRUCT OptTag LC DefList RC
     if (node->children_count == 5) {
         // here fully defines a struct
@@ -746,8 +767,8 @@ struct_specifier *_sem_validate_struct_specifier(ast_node *node, int context, in
             // name it with a number thus
             // no one can access it but yet still can be managed
             // by the symbol table
-            char *unnamed_tag_id = malloc(100 * sizeof(char));
-            snprintf(unnamed_tag_id, 100, "%d", _sem_unnamed_struct_count++);
+            char *unnamed_tag_id = arena_alloc(&cmmc_ctx->symbol_arena, 100 * sizeof(char));
+            snprintf(unnamed_tag_id, 100, "%d", cmmc_ctx->sem_unnamed_struct_count++);
             ret_specifier->struct_tag = unnamed_tag_id;
         }
         // can be considered as a new context created by {}
@@ -758,7 +779,6 @@ struct_specifier *_sem_validate_struct_specifier(ast_node *node, int context, in
                                                         // since the symbols are still in use!
         if ((int)(ret_specifier->struct_contents) == -1) {
             // def list returned with error
-            free(ret_specifier);
             return NULL;
         }
 
@@ -773,7 +793,7 @@ struct_specifier *_sem_validate_struct_specifier(ast_node *node, int context, in
         ret_specifier->size = struct_size;
         
         // needs to be inserted into current symbol table
-        ins_specifier_symbol = malloc(sizeof(symbol_entry));
+        ins_specifier_symbol = arena_alloc(&cmmc_ctx->symbol_arena, sizeof(symbol_entry));
         ins_specifier_symbol->type = SYMBOL_T_STRUCT_DEFINE;
         ins_specifier_symbol->is_array = 0;
         ins_specifier_symbol->array_dimention = 0;
@@ -788,7 +808,6 @@ struct_specifier *_sem_validate_struct_specifier(ast_node *node, int context, in
         if (symtable_insert(ins_specifier_symbol, context, 0, do_not_free, 0)) { // it is not a field so we don't care
                                                                  // if it's in_struct
             // insertion error
-            symtable_free_symbol(ins_specifier_symbol);
             return NULL;
         }
         return ret_specifier;
@@ -808,7 +827,6 @@ struct_specifier *_sem_validate_struct_specifier(ast_node *node, int context, in
             _sem_report_error("Error type 17 at Line %d: Undefined structure \"%s\"", node->children[1]->line_number, node->children[1]->children[0]->string_value);
             return NULL;
         }
-        free(ret_specifier);
         return defined_tag->struct_specifier;
     } 
     else {
@@ -818,11 +836,9 @@ struct_specifier *_sem_validate_struct_specifier(ast_node *node, int context, in
 }
 
 symbol_entry *_sem_validate_fun_dec(ast_node *node, int type, struct_specifier *struct_specifier, ir_list *ret_ir) {
-    symbol_entry *ret_entry = malloc(sizeof(symbol_entry));
+    symbol_entry *ret_entry = arena_alloc(&cmmc_ctx->symbol_arena, sizeof(symbol_entry));
     symbol_list *param_list = NULL;
-    ir *ir_entry = malloc(sizeof(ir));
-    symbol_list *param_iterator;
-    int stack_offset = 12;
+    ir *ir_entry = arena_alloc(&cmmc_ctx->ir_arena, sizeof(ir));
 
     ret_entry->type = type;
     ret_entry->struct_specifier = struct_specifier;
@@ -855,16 +871,8 @@ symbol_entry *_sem_validate_fun_dec(ast_node *node, int type, struct_specifier *
         ret_entry->params = NULL;
     } 
     else if (node->children_count == 4) {
-        ret_entry->param_count = _sem_validate_var_list(node->children[2], &param_list, ret_ir, -12);
+        ret_entry->param_count = _sem_validate_var_list(node->children[2], &param_list, ret_ir, 0);
         ret_entry->params = param_list;
-        param_iterator = ret_entry->params;
-        while (param_iterator != NULL) {
-            // stack: | sp | fp | ra | ARG1 | ARG2  
-            //       fp    4    8   12
-            param_iterator->symbol->ir_variable_id = -stack_offset;
-            stack_offset += 4;
-            param_iterator = param_iterator->next;
-        }
     }
     else {
         assert(0);
@@ -874,20 +882,30 @@ symbol_entry *_sem_validate_fun_dec(ast_node *node, int type, struct_specifier *
     return ret_entry;
 }
 
-int _sem_validate_var_list(ast_node *node, symbol_list **param_list, ir_list *ret_ir, int offset) {
+int _sem_validate_var_list(ast_node *node, symbol_list **param_list, ir_list *ret_ir, int index) {
     symbol_list *ret_list;
-    ir *ir_entry = malloc(sizeof(ir));
+    ir *ir_entry = arena_alloc(&cmmc_ctx->ir_arena, sizeof(ir));
     int ret_val = 0;
     // ParamDec
     symbol_entry *current_entry = _sem_validate_param_dec(node->children[0]);
     ir_entry->op = IR_OP_PARAM;
-    ir_entry->var_id = offset;
+    if (index < 4) {
+        // passed in $a0-$a3, give it a home in the frame
+        ir_entry->var_id = ir_new_variable(4);
+    }
+    else {
+        // stack: | ARG5 | ARG6 | ...
+        //       fp     4      8
+        ir_entry->var_id = -4 * (index - 4);
+    }
+    if (current_entry != NULL)
+        current_entry->ir_variable_id = ir_entry->var_id;
     ir_entry->size = current_entry->size;
     ir_add_node_to_buffer(ret_ir, ir_entry);
 
     symbol_list *ret_list_tail = NULL;
     if (node->children_count == 3) {
-        ret_val = _sem_validate_var_list(node->children[2], &ret_list_tail, ret_ir, offset - 4);
+        ret_val = _sem_validate_var_list(node->children[2], &ret_list_tail, ret_ir, index + 1);
     }
     if (current_entry == NULL) {
         if (ret_val == 0) {
@@ -900,7 +918,7 @@ int _sem_validate_var_list(ast_node *node, symbol_list **param_list, ir_list *re
         }
     }
     else {
-        ret_list = malloc(sizeof(symbol_list));
+        ret_list = arena_alloc(&cmmc_ctx->symbol_arena, sizeof(symbol_list));
         ret_list->symbol = current_entry;
         ret_list->next = ret_list_tail;
         *param_list = ret_list;
@@ -945,11 +963,10 @@ symbol_entry *_sem_validate_param_dec(ast_node *node) {
             ret_entry->size *= ret_entry->array_size[iterator];
         }
     }
-    ret_entry->ir_variable_id = ir_new_variable(ret_entry->size);
+    // ir_variable_id is decided by the position in the param list
 
     // try to insert!
     if (symtable_insert(ret_entry, 1, 0, 1, 1)) {
-        symtable_free_symbol(ret_entry);
         return NULL;
     }
 
@@ -983,7 +1000,6 @@ void _sem_validate_dec_list(ast_node *node, int type, struct_specifier *struct_s
     if (ins_entry != NULL) {
         if (symtable_insert(ins_entry, context, 0, 0, 0)) {
             // Falied to insert
-            symtable_free_symbol(ins_entry);
         }
     }
     
@@ -1051,19 +1067,15 @@ symbol_entry *_sem_validate_dec(ast_node *node, int type, struct_specifier *pars
     }
 
     if (node->children_count == 3) { // VarDec ASSIGNOP Exp
-        ir_list_local = malloc(sizeof(ir_list));
+        ir_list_local = arena_alloc(&cmmc_ctx->ir_arena, sizeof(ir_list));
         ir_list_local->head = NULL;
         ir_list_local->tail = NULL;
         exp_type = _sem_validate_exp(node->children[2], no_optimization, ir_list_local);
         if (exp_type == NULL) {
-            free(ir_list_local);
             return NULL;
         }
         if (!_sem_type_matching_with_symbol(ret_entry, exp_type)) {
             // Exp does not match the type of Def
-            free(exp_type);
-            free(ret_entry);
-            free(ir_list_local);
             _sem_report_error("Error type 5 at Line %d: Type mismatched for assignment", node->children[1]->line_number);
             return NULL;
         }
@@ -1071,7 +1083,7 @@ symbol_entry *_sem_validate_dec(ast_node *node, int type, struct_specifier *pars
         if (exp_type->constant_exp_status == SEM_CONSTANT_YES) {
             if (type == SYMBOL_T_FLOAT) {
                 
-                ir_entry = malloc(sizeof(ir));
+                ir_entry = arena_alloc(&cmmc_ctx->ir_arena, sizeof(ir));
                 ir_entry->op = IR_EXP_OP_ASSIGN;
                 ir_entry->mode.mode1 = IR_MODE_V;
                 ir_entry->mode.op1 = IR_MODE_NORMAL;
@@ -1087,7 +1099,7 @@ symbol_entry *_sem_validate_dec(ast_node *node, int type, struct_specifier *pars
             }
             else { // all 4 byte
                 
-                ir_entry = malloc(sizeof(ir));
+                ir_entry = arena_alloc(&cmmc_ctx->ir_arena, sizeof(ir));
                 ir_entry->op = IR_EXP_OP_ASSIGN;
                 ir_entry->mode.mode1 = IR_MODE_V;
                 ir_entry->mode.op1 = IR_MODE_NORMAL;
@@ -1119,7 +1131,7 @@ symbol_entry *_sem_validate_dec(ast_node *node, int type, struct_specifier *pars
             //    int a = b = c + d
             // remember b will not be temp var!
             assert(exp_type->type_mode == SEM_TYPE_MODE_V);
-            ir_entry = malloc(sizeof(ir));
+            ir_entry = arena_alloc(&cmmc_ctx->ir_arena, sizeof(ir));
             ir_entry->op = IR_EXP_OP_ASSIGN;
             ir_entry->var_id = ret_entry->ir_variable_id;
             ir_entry->mode.mode1 = IR_MODE_V;
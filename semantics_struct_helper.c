@@ -17,6 +17,8 @@
 #include <ast.h>
 #include <symbol_table.h>
 #include <semantics.h>
+#include <arena.h>
+#include <context.h>
 
 symbol_list *_sem_validate_def_list_for_struct(ast_node *node, int context);
 symbol_list *_sem_validate_def_for_struct(ast_node *node, int context);
@@ -38,9 +40,6 @@ symbol_list *_sem_validate_def_list_for_struct(ast_node *node, int context) {
     }
     symbol_list *ret_list_tail = _sem_validate_def_list_for_struct(node->children[1], context);
     if ((int)(ret_list_tail) == -1 || (int)(ret_list_front) == -1) { // an error occoured
-        // clean up list front
-        if ((int)(ret_list_front) != -1)
-            symtable_free_symbol_list(ret_list_front);
         return (void*)(-1);
     }
     // cannot be empty!
@@ -76,19 +75,16 @@ symbol_list *_sem_validate_def_for_struct(ast_node *node, int context) {
 }
 
 symbol_list *_sem_validate_dec_list_for_struct(ast_node *node, int type, struct_specifier *struct_specifier, int context) {
-    symbol_list *ret_list = malloc(sizeof(symbol_list));
+    symbol_list *ret_list = arena_alloc(&cmmc_ctx->symbol_arena, sizeof(symbol_list));
     symbol_entry *ins_entry;
     symbol_list *ret_list_tail;
     if (node->children_count == 1) { // Dec
         ins_entry = _sem_validate_dec_for_struct(node->children[0], type, struct_specifier);
         if (ins_entry == NULL) {
-            free(ret_list);
             return (void*)(-1);
         }
         if (symtable_insert(ins_entry, context, 1, 1, 0)) {
             // Falied to insert
-            symtable_free_symbol(ins_entry);
-            free(ret_list);
             return (void*)(-1);
         }
         ret_list->symbol = ins_entry;
@@ -100,7 +96,6 @@ symbol_list *_sem_validate_dec_list_for_struct(ast_node *node, int type, struct_
         if (ins_entry != NULL) {
             if (symtable_insert(ins_entry, context, 1, 1, 0)) {
                 // Falied to insert
-                symtable_free_symbol(ins_entry);
                 ins_entry = NULL;
             }
             else {
@@ -110,9 +105,6 @@ symbol_list *_sem_validate_dec_list_for_struct(ast_node *node, int type, struct_
         }
         ret_list_tail = _sem_validate_dec_list_for_struct(node->children[2], type, struct_specifier, context);
         if ((int)(ret_list_tail) == -1 || ins_entry == NULL) {
-            if (ins_entry != NULL)
-                symtable_free_symbol(ins_entry);
-            free(ret_list);
             return (void*)(-1);
         }
         ret_list->next = ret_list_tail;
@@ -0,0 +1,223 @@
+/*
+    C-- Compiler Back End
+    Copyright (C) 2019 NSKernel. All rights reserved.
+
+    A lab of Compilers at Nanjing University
+
+    simplify.c
+    Algebraic simplification
+*/
+
+#include <stdlib.h>
+#include <stdint.h>
+
+#include <ssa.h>
+#include <opt.h>
+#include <cfg.h>
+#include <ir.h>
+
+// what sccp can not fold for only knowing one side, x + 0, x * 1,
+// x / 1 and x - x, or x on both sides of a relop. a constant on the
+// left of a commutative op goes to the right and x - c becomes
+// x + -c, so (x + 1) + 2, (x - 1) - 2 and 1 + (x + 2) all meet as
+// x + 3. * and / by constants are made shifts by isel, which is
+// where the shifts are
+
+#define _SIMPLIFY_IS(mode, value, c) ((mode) == IR_MODE_I && (value) == (c))
+
+char _simplify_commutative(uint8_t op) {
+    return op == IR_EXP_OP_ADD || op == IR_EXP_OP_MUL || op == IR_EXP_OP_EQ
+        || op == IR_EXP_OP_NEQ || op == IR_EXP_OP_AND || op == IR_EXP_OP_OR;
+}
+
+// the instruction computing value v as x op c, x a value or a
+// constant, with x read into mode and x. NULL if it is not one
+ir_inst *_simplify_def(ssa_form *form, int32_t v, uint8_t op, uint8_t *mode, int32_t *x) {
+    uint32_t def = form->values[v].def;
+    ir_inst *inst;
+
+    if (def == CFG_NONE || (def & SSA_PHI))
+        return NULL;
+    inst = &form->func->insts[def];
+    if (inst->op != op || inst->mode[0] != IR_MODE_S || inst->mode[2] != IR_MODE_I
+        || (inst->mode[1] != IR_MODE_S && inst->mode[1] != IR_MODE_I))
+        return NULL;
+    *mode = inst->mode[1];
+    *x = inst->operand[1];
+    ssa_resolve(form, mode, x);
+    return inst;
+}
+
+void _simplify_inst(ssa_form *form, ir_inst *inst) {
+    ir_inst *def;
+    uint8_t mode, op;
+    int32_t x, t;
+    int64_t product;
+    int k;
+
+    if (inst->op == SSA_DELETED || inst->op < IR_EXP_OP_ADD || inst->op > IR_EXP_OP_AND
+        || inst->op == IR_EXP_OP_NOT || inst->mode[0] != IR_MODE_S)
+        return;
+    for (k = 1; k <= 2; k++) {
+        if (inst->mode[k] != IR_MODE_S && inst->mode[k] != IR_MODE_I)
+            return;
+        ssa_resolve(form, &inst->mode[k], &inst->operand[k]);
+    }
+
+    for (;;) {
+        op = inst->op;
+        if (_simplify_commutative(op) && inst->mode[1] == IR_MODE_I && inst->mode[2] == IR_MODE_S) {
+            mode = inst->mode[1];
+            inst->mode[1] = inst->mode[2];
+            inst->mode[2] = mode;
+            t = inst->operand[1];
+            inst->operand[1] = inst->operand[2];
+            inst->operand[2] = t;
+        }
+        if (op == IR_EXP_OP_MINUS && inst->mode[2] == IR_MODE_I) {
+            inst->op = op = IR_EXP_OP_ADD;
+            inst->operand[2] = -(uint32_t)inst->operand[2];
+        }
+
+        if (op >= IR_EXP_OP_GT && op <= IR_EXP_OP_NEQ) {
+            if (inst->mode[1] == IR_MODE_S && inst->mode[2] == IR_MODE_S && inst->operand[1] == inst->operand[2])
+                ssa_replace(form, inst->operand[0], IR_MODE_I, op == IR_EXP_OP_GE || op == IR_EXP_OP_EQ || op == IR_EXP_OP_LE);
+            return;
+        }
+        if (inst->mode[1] == IR_MODE_I && inst->mode[2] == IR_MODE_I && op != IR_EXP_OP_DIV) {
+            // only left by the rewrites below, sccp folded the rest
+            switch (op) {
+                case IR_EXP_OP_ADD:
+                    t = (uint32_t)inst->operand[1] + (uint32_t)inst->operand[2];
+                    break;
+                case IR_EXP_OP_MINUS:
+                    t = (uint32_t)inst->operand[1] - (uint32_t)inst->operand[2];
+                    break;
+                case IR_EXP_OP_MUL:
+                    t = (uint32_t)inst->operand[1] * (uint32_t)inst->operand[2];
+                    break;
+                case IR_EXP_OP_AND:
+                    t = inst->operand[1] && inst->operand[2];
+                    break;
+                default:
+                    t = inst->operand[1] || inst->operand[2];
+                    break;
+            }
+            ssa_replace(form, inst->operand[0], IR_MODE_I, t);
+            return;
+        }
+
+        switch (op) {
+            case IR_EXP_OP_ADD:
+                if (_SIMPLIFY_IS(inst->mode[2], inst->operand[2], 0)) {
+                    ssa_replace(form, inst->operand[0], inst->mode[1], inst->operand[1]);
+                    return;
+                }
+                if (inst->mode[2] == IR_MODE_I && inst->mode[1] == IR_MODE_S
+                    && (def = _simplify_def(form, inst->operand[1], IR_EXP_OP_ADD, &mode, &x)) != NULL) {
+                    // (x + c1) + c2
+                    inst->mode[1] = mode;
+                    inst->operand[1] = x;
+                    inst->operand[2] = (uint32_t)inst->operand[2] + (uint32_t)def->operand[2];
+                    continue;
+                }
+                return;
+            case IR_EXP_OP_MINUS:
+                if (inst->mode[1] == IR_MODE_S && inst->mode[2] == IR_MODE_S && inst->operand[1] == inst->operand[2]) {
+                    ssa_replace(form, inst->operand[0], IR_MODE_I, 0);
+                    return;
+                }
+                if (inst->mode[1] == IR_MODE_I && inst->mode[2] == IR_MODE_S
+                    && (def = _simplify_def(form, inst->operand[2], IR_EXP_OP_ADD, &mode, &x)) != NULL) {
+                    // c2 - (x + c1)
+                    inst->operand[1] = (uint32_t)inst->operand[1] - (uint32_t)def->operand[2];
+                    inst->mode[2] = mode;
+                    inst->operand[2] = x;
+                    continue;
+                }
+                return;
+            case IR_EXP_OP_MUL:
+                if (_SIMPLIFY_IS(inst->mode[2], inst->operand[2], 0) || _SIMPLIFY_IS(inst->mode[2], inst->operand[2], 1)) {
+                    ssa_replace(form, inst->operand[0], inst->mode[inst->operand[2] ? 1 : 2], inst->operand[inst->operand[2] ? 1 : 2]);
+                    return;
+                }
+                if (_SIMPLIFY_IS(inst->mode[2], inst->operand[2], -1)) {
+                    // 0 - x
+                    inst->op = IR_EXP_OP_MINUS;
+                    inst->mode[2] = inst->mode[1];
+                    inst->operand[2] = inst->operand[1];
+                    inst->mode[1] = IR_MODE_I;
+                    inst->operand[1] = 0;
+                    continue;
+                }
+                if (inst->mode[2] == IR_MODE_I && inst->mode[1] == IR_MODE_S
+                    && (def = _simplify_def(form, inst->operand[1], IR_EXP_OP_MUL, &mode, &x)) != NULL) {
+                    // (x * c1) * c2
+                    inst->mode[1] = mode;
+                    inst->operand[1] = x;
+                    inst->operand[2] = (uint32_t)inst->operand[2] * (uint32_t)def->operand[2];
+                    continue;
+                }
+                return;
+            case IR_EXP_OP_DIV:
+                if (_SIMPLIFY_IS(inst->mode[2], inst->operand[2], 1)) {
+                    ssa_replace(form, inst->operand[0], inst->mode[1], inst->operand[1]);
+                    return;
+                }
+                if (_SIMPLIFY_IS(inst->mode[2], inst->operand[2], -1)) {
+                    inst->op = IR_EXP_OP_MINUS;
+                    inst->mode[2] = inst->mode[1];
+                    inst->operand[2] = inst->operand[1];
+                    inst->mode[1] = IR_MODE_I;
+                    inst->operand[1] = 0;
+                    continue;
+                }
+                if (inst->mode[2] == IR_MODE_I && inst->operand[2] > 0 && inst->mode[1] == IR_MODE_S
+                    && (def = _simplify_def(form, inst->operand[1], IR_EXP_OP_DIV, &mode, &x)) != NULL
+                    && def->operand[2] > 0) {
+                    // (x / c1) / c2 rounds toward zero twice as once
+                    product = (int64_t)inst->operand[2] * def->operand[2];
+                    if (product > INT32_MAX)
+                        return;
+                    inst->mode[1] = mode;
+                    inst->operand[1] = x;
+                    inst->operand[2] = (int32_t)product;
+                    continue;
+                }
+                return;
+            case IR_EXP_OP_AND:
+            case IR_EXP_OP_OR:
+                // x && c and x || c are x != 0 or c itself
+                if (inst->mode[2] != IR_MODE_I)
+                    return;
+                if ((op == IR_EXP_OP_AND) == (inst->operand[2] == 0)) {
+                    ssa_replace(form, inst->operand[0], IR_MODE_I, op == IR_EXP_OP_OR);
+                    return;
+                }
+                inst->op = IR_EXP_OP_NEQ;
+                inst->operand[2] = 0;
+                return;
+        }
+        return;
+    }
+}
+
+// defs before uses, dominators first
+void simplify_run(ssa_form *form) {
+    cfg *graph = form->graph;
+    uint32_t *stack = malloc(sizeof(uint32_t) * graph->block_count);
+    uint32_t top = 0, b, c, i;
+
+    stack[top++] = 0;
+    while (top > 0) {
+        b = stack[--top];
+        for (i = graph->blocks[b].first; i < graph->blocks[b].last; i++)
+            _simplify_inst(form, &form->func->insts[i]);
+        for (c = graph->blocks[b].dom_child; c != CFG_NONE; c = graph->blocks[c].dom_sibling) {
+            if (form->block_live[c])
+                stack[top++] = c;
+        }
+    }
+    ssa_apply(form);
+    free(stack);
+}
@@ -0,0 +1,1022 @@
+/*
+    C-- Compiler Back End
+    Copyright (C) 2019 NSKernel. All rights reserved.
+
+    A lab of Compilers at Nanjing University
+
+    ssa.c
+    Static single assignment form of a function
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <limits.h>
+
+#include <ssa.h>
+#include <cfg.h>
+#include <ir.h>
+#include <arena.h>
+#include <context.h>
+
+#define _SSA_NOT_CANDIDATE -1
+#define _SSA_ADDR_TAKEN    -2
+
+#define _SSA_BIT(set, n)   ((set)[(n) >> 5] & (1u << ((n) & 31)))
+
+typedef struct _ssa_builder_t {
+    int *var_of;            // candidate of each 4 byte slot of the frame
+    int min_id;
+    int slot_count;
+    uint32_t *current;      // value each candidate holds right now
+    uint32_t *undef;        // value read before anything was written
+    uint32_t *log_var;      // old currents to put back when leaving a
+    uint32_t *log_old;      // subtree of the dominator tree
+    uint32_t log_count;
+} _ssa_builder;
+
+typedef struct _ssa_lowering_t {
+    ir_inst *insts;
+    uint32_t count;
+    uint32_t capacity;
+    uint8_t *name_mode;     // frame id each value ends up in
+    int *name_id;
+    char *conflict;         // candidates whose values can not share a slot
+} _ssa_lowering;
+
+uint32_t _ssa_new_value(ssa_form *form, uint32_t var, uint32_t def) {
+    ssa_value *value;
+    if (form->value_count == form->value_capacity) {
+        form->value_capacity = form->value_capacity ? form->value_capacity * 2 : 64;
+        form->values = realloc(form->values, sizeof(ssa_value) * form->value_capacity);
+    }
+    value = &form->values[form->value_count];
+    value->var = var;
+    value->def = def;
+    value->replace_mode = SSA_KEEP;
+    value->replace = 0;
+    return form->value_count++;
+}
+
+void _ssa_new_phi(ssa_form *form, uint32_t block, uint32_t var) {
+    ssa_phi *phi;
+    uint32_t j, pred_count = form->graph->blocks[block].pred_count;
+    if (form->phi_count == form->phi_capacity) {
+        form->phi_capacity = form->phi_capacity ? form->phi_capacity * 2 : 16;
+        form->phis = realloc(form->phis, sizeof(ssa_phi) * form->phi_capacity);
+    }
+    phi = &form->phis[form->phi_count];
+    phi->value = _ssa_new_value(form, var, SSA_PHI | form->phi_count);
+    phi->block = block;
+    phi->next = form->block_phi[block];
+    phi->arg_mode = malloc(pred_count);
+    phi->arg = malloc(sizeof(int32_t) * pred_count);
+    for (j = 0; j < pred_count; j++) {
+        phi->arg_mode[j] = IR_MODE_I;
+        phi->arg[j] = 0;
+    }
+    form->block_phi[block] = form->phi_count++;
+}
+
+// candidate operand k of inst refers to, -1 if it is not one
+int _ssa_var(_ssa_builder *builder, ir_inst *inst, int k) {
+    uint8_t mode = IR_INST_MODE(inst, k);
+    int id = inst->operand[k];
+    if ((mode != IR_MODE_T && mode != IR_MODE_V) || (id & 3) || IR_INST_OP(inst, k) == IR_MODE_ADDR)
+        return -1;
+    id = builder->var_of[(id - builder->min_id) >> 2];
+    return id < 0 ? -1 : id;
+}
+
+// the candidates are the t and v whose address is never taken, those
+// can not be reached through a pointer
+void _ssa_find_candidates(ssa_form *form, _ssa_builder *builder) {
+    ir_function *func = form->func;
+    ir_inst *inst;
+    int min_id = INT_MAX, max_id = INT_MIN;
+    int slot, mask;
+    uint32_t i, k;
+
+    for (i = 0; i < func->count; i++) {
+        inst = &func->insts[i];
+        mask = ir_inst_reads(inst) | ir_inst_writes(inst);
+        for (k = 0; k < 3; k++) {
+            if (!(mask & (1 << k)) || (IR_INST_MODE(inst, k) != IR_MODE_T && IR_INST_MODE(inst, k) != IR_MODE_V))
+                continue;
+            if (inst->operand[k] < min_id)
+                min_id = inst->operand[k];
+            if (inst->operand[k] > max_id)
+                max_id = inst->operand[k];
+        }
+    }
+    form->var_count = 0;
+    if (min_id > max_id) {
+        builder->min_id = 0;
+        builder->slot_count = 0;
+        builder->var_of = NULL;
+        return;
+    }
+    min_id &= ~3;
+    builder->min_id = min_id;
+    builder->slot_count = ((max_id - min_id) >> 2) + 1;
+    builder->var_of = malloc(sizeof(int) * builder->slot_count);
+    for (slot = 0; slot < builder->slot_count; slot++)
+        builder->var_of[slot] = _SSA_NOT_CANDIDATE;
+    for (i = 0; i < func->count; i++) {
+        inst = &func->insts[i];
+        mask = ir_inst_reads(inst);
+        for (k = 0; k < 3; k++) {
+            if ((mask & (1 << k)) && IR_INST_OP(inst, k) == IR_MODE_ADDR && !(inst->operand[k] & 3))
+                builder->var_of[(inst->operand[k] - min_id) >> 2] = _SSA_ADDR_TAKEN;
+        }
+    }
+    form->var_id = malloc(sizeof(int) * builder->slot_count);
+    form->var_mode = malloc(builder->slot_count);
+    for (i = 0; i < func->count; i++) {
+        inst = &func->insts[i];
+        mask = ir_inst_reads(inst) | ir_inst_writes(inst);
+        for (k = 0; k < 3; k++) {
+            if (!(mask & (1 << k)) || (IR_INST_MODE(inst, k) != IR_MODE_T && IR_INST_MODE(inst, k) != IR_MODE_V))
+                continue;
+            if ((inst->operand[k] & 3) || IR_INST_OP(inst, k) == IR_MODE_ADDR)
+                continue;
+            slot = (inst->operand[k] - min_id) >> 2;
+            if (builder->var_of[slot] != _SSA_NOT_CANDIDATE)
+                continue;
+            builder->var_of[slot] = form->var_count;
+            form->var_id[form->var_count] = inst->operand[k];
+            form->var_mode[form->var_count] = IR_INST_MODE(inst, k);
+            form->var_count++;
+        }
+    }
+}
+
+// a candidate written in a block gets a phi at every block of the
+// iterated dominance frontier of the writes, as long as it is read
+// in some block before being written there (semi pruned form)
+void _ssa_place_phis(ssa_form *form, _ssa_builder *builder) {
+    cfg *graph = form->graph;
+    ir_function *func = form->func;
+    ir_inst *inst;
+    uint32_t *df_start, *df, *df_last, *def_start, *def_block, *stamp, *work, *has_phi, *in_work;
+    uint32_t b, p, runner, i, k, v, top, x, y;
+    int var, mask;
+    char *global;
+
+    // dominance frontiers, Cooper, Harvey and Kennedy again. counted
+    // first and filled in the second round
+    df_start = calloc(graph->block_count + 1, sizeof(uint32_t));
+    df_last = malloc(sizeof(uint32_t) * graph->block_count);
+    df = NULL;
+    for (k = 0; k < 2; k++) {
+        for (b = 0; b < graph->block_count; b++)
+            df_last[b] = CFG_NONE;
+        if (k == 1) {
+            for (b = 0; b < graph->block_count; b++)
+                df_start[b + 1] += df_start[b];
+            df = malloc(sizeof(uint32_t) * (df_start[graph->block_count] + 1));
+            for (b = graph->block_count; b > 0; b--)
+                df_start[b] = df_start[b - 1];
+            df_start[0] = 0;
+        }
+        for (b = 0; b < graph->block_count; b++) {
+            if (graph->blocks[b].rpo == CFG_NONE || graph->blocks[b].pred_count < 2)
+                continue;
+            for (i = 0; i < graph->blocks[b].pred_count; i++) {
+                p = graph->blocks[b].pred[i];
+                if (graph->blocks[p].rpo == CFG_NONE)
+                    continue;
+                for (runner = p; runner != graph->blocks[b].idom; runner = graph->blocks[runner].idom) {
+                    // b is handled in one go, so a repeat is always the last one
+                    if (df_last[runner] == b)
+                        continue;
+                    df_last[runner] = b;
+                    if (k == 0)
+                        df_start[runner + 1]++;
+                    else
+                        df[df_start[runner + 1]++] = b;
+                }
+            }
+        }
+    }
+
+    // blocks writing each candidate, and whether it is read before
+    // being written in some block
+    global = calloc(form->var_count + 1, 1);
+    stamp = malloc(sizeof(uint32_t) * (form->var_count + 1));
+    def_start = calloc(form->var_count + 2, sizeof(uint32_t));
+    def_block = NULL;
+    for (k = 0; k < 2; k++) {
+        if (k == 1) {
+            for (v = 0; v < form->var_count; v++)
+                def_start[v + 1] += def_start[v];
+            def_block = malloc(sizeof(uint32_t) * (def_start[form->var_count] + 1));
+            for (v = form->var_count; v > 0; v--)
+                def_start[v] = def_start[v - 1];
+            def_start[0] = 0;
+        }
+        for (v = 0; v < form->var_count; v++)
+            stamp[v] = CFG_NONE;
+        for (b = 0; b < graph->block_count; b++) {
+            if (graph->blocks[b].rpo == CFG_NONE)
+                continue;
+            for (i = graph->blocks[b].first; i < graph->blocks[b].last; i++) {
+                inst = &func->insts[i];
+                mask = ir_inst_reads(inst);
+                for (x = 0; x < 3; x++) {
+                    if ((mask & (1 << x)) && (var = _ssa_var(builder, inst, x)) >= 0 && stamp[var] != b)
+                        global[var] = 1;
+                }
+                if (ir_inst_writes(inst) && IR_INST_OP(inst, 0) == IR_MODE_NORMAL
+                    && (var = _ssa_var(builder, inst, 0)) >= 0 && stamp[var] != b) {
+                    stamp[var] = b;
+                    if (k == 0)
+                        def_start[var + 1]++;
+                    else
+                        def_block[def_start[var + 1]++] = b;
+                }
+            }
+        }
+    }
+
+    // Cytron et al., with the stamps telling candidates apart
+    work = malloc(sizeof(uint32_t) * (graph->block_count + def_start[form->var_count] + 1));
+    has_phi = malloc(sizeof(uint32_t) * graph->block_count);
+    in_work = malloc(sizeof(uint32_t) * graph->block_count);
+    for (b = 0; b < graph->block_count; b++)
+        has_phi[b] = in_work[b] = CFG_NONE;
+    for (v = 0; v < form->var_count; v++) {
+        if (!global[v])
+            continue;
+        top = 0;
+        for (i = def_start[v]; i < def_start[v + 1]; i++) {
+            in_work[def_block[i]] = v;
+            work[top++] = def_block[i];
+        }
+        while (top > 0) {
+            x = work[--top];
+            for (i = df_start[x]; i < df_start[x + 1]; i++) {
+                y = df[i];
+                if (has_phi[y] == v)
+                    continue;
+                _ssa_new_phi(form, y, v);
+                has_phi[y] = v;
+                if (in_work[y] != v) {
+                    in_work[y] = v;
+                    work[top++] = y;
+                }
+            }
+        }
+    }
+    free(df_start);
+    free(df_last);
+    free(df);
+    free(global);
+    free(stamp);
+    free(def_start);
+    free(def_block);
+    free(work);
+    free(has_phi);
+    free(in_work);
+}
+
+uint32_t _ssa_current(ssa_form *form, _ssa_builder *builder, uint32_t var) {
+    if (builder->current[var] != CFG_NONE)
+        return builder->current[var];
+    if (builder->undef[var] == CFG_NONE)
+        builder->undef[var] = _ssa_new_value(form, var, CFG_NONE);
+    return builder->undef[var];
+}
+
+void _ssa_define(_ssa_builder *builder, uint32_t var, uint32_t value) {
+    builder->log_var[builder->log_count] = var;
+    builder->log_old[builder->log_count++] = builder->current[var];
+    builder->current[var] = value;
+}
+
+void _ssa_rename_block(ssa_form *form, _ssa_builder *builder, uint32_t b) {
+    cfg_block *block = &form->graph->blocks[b];
+    cfg_block *succ;
+    ir_inst *inst;
+    uint32_t i, j, k, p;
+    int var, mask;
+
+    for (p = form->block_phi[b]; p != CFG_NONE; p = form->phis[p].next)
+        _ssa_define(builder, form->values[form->phis[p].value].var, form->phis[p].value);
+    for (i = block->first; i < block->last; i++) {
+        inst = &form->func->insts[i];
+        mask = ir_inst_reads(inst);
+        for (k = 0; k < 3; k++) {
+            if ((mask & (1 << k)) && (var = _ssa_var(builder, inst, k)) >= 0) {
+                inst->mode[k] = IR_MODE_S | IR_INST_OP(inst, k);
+                inst->operand[k] = _ssa_current(form, builder, var);
+            }
+        }
+        if (ir_inst_writes(inst) && IR_INST_OP(inst, 0) == IR_MODE_NORMAL && (var = _ssa_var(builder, inst, 0)) >= 0) {
+            inst->mode[0] = IR_MODE_S;
+            inst->operand[0] = _ssa_new_value(form, var, i);
+            _ssa_define(builder, var, inst->operand[0]);
+        }
+    }
+    for (k = 0; k < block->succ_count; k++) {
+        succ = &form->graph->blocks[block->succ[k]];
+        for (j = 0; j < succ->pred_count && succ->pred[j] != b; j++);
+        for (p = form->block_phi[block->succ[k]]; p != CFG_NONE; p = form->phis[p].next) {
+            form->phis[p].arg_mode[j] = IR_MODE_S;
+            form->phis[p].arg[j] = _ssa_current(form, builder, form->values[form->phis[p].value].var);
+        }
+    }
+}
+
+// walk the dominator tree, a block sees the values of its dominators
+void _ssa_rename(ssa_form *form, _ssa_builder *builder) {
+    cfg *graph = form->graph;
+    uint32_t *stack = malloc(sizeof(uint32_t) * graph->block_count);
+    uint32_t *height = malloc(sizeof(uint32_t) * graph->block_count);
+    uint32_t *cursor = malloc(sizeof(uint32_t) * graph->block_count);
+    uint32_t v, c;
+    int depth = 0;
+
+    builder->current = malloc(sizeof(uint32_t) * (form->var_count + 1));
+    builder->undef = malloc(sizeof(uint32_t) * (form->var_count + 1));
+    for (v = 0; v < form->var_count; v++)
+        builder->current[v] = builder->undef[v] = CFG_NONE;
+    builder->log_var = malloc(sizeof(uint32_t) * (form->func->count + form->phi_count + 1));
+    builder->log_old = malloc(sizeof(uint32_t) * (form->func->count + form->phi_count + 1));
+    builder->log_count = 0;
+
+    stack[0] = 0;
+    height[0] = 0;
+    _ssa_rename_block(form, builder, 0);
+    cursor[0] = graph->blocks[0].dom_child;
+    while (depth >= 0) {
+        c = cursor[depth];
+        if (c != CFG_NONE) {
+            cursor[depth] = graph->blocks[c].dom_sibling;
+            depth++;
+            stack[depth] = c;
+            height[depth] = builder->log_count;
+            _ssa_rename_block(form, builder, c);
+            cursor[depth] = graph->blocks[c].dom_child;
+        }
+        else {
+            while (builder->log_count > height[depth]) {
+                builder->log_count--;
+                builder->current[builder->log_var[builder->log_count]] = builder->log_old[builder->log_count];
+            }
+            depth--;
+        }
+    }
+    free(stack);
+    free(height);
+    free(cursor);
+    free(builder->current);
+    free(builder->undef);
+    free(builder->log_var);
+    free(builder->log_old);
+}
+
+ssa_form *ssa_build(ir_function *func) {
+    ssa_form *form = calloc(1, sizeof(ssa_form));
+    _ssa_builder builder;
+    cfg *graph;
+    uint32_t b, k;
+
+    form->func = func;
+    form->graph = graph = cfg_get(func);
+    form->block_phi = malloc(sizeof(uint32_t) * graph->block_count);
+    form->block_live = malloc(graph->block_count);
+    form->edge_live = malloc(graph->block_count * 2);
+    for (b = 0; b < graph->block_count; b++) {
+        form->block_phi[b] = CFG_NONE;
+        form->block_live[b] = graph->blocks[b].rpo != CFG_NONE;
+        for (k = 0; k < 2; k++)
+            form->edge_live[b * 2 + k] = form->block_live[b] && k < graph->blocks[b].succ_count;
+    }
+    _ssa_find_candidates(form, &builder);
+    if (form->var_count > 0) {
+        _ssa_place_phis(form, &builder);
+        _ssa_rename(form, &builder);
+    }
+    free(builder.var_of);
+    return form;
+}
+
+void ssa_resolve(ssa_form *form, uint8_t *mode, int32_t *value) {
+    while (*mode == IR_MODE_S && form->values[*value].replace_mode != SSA_KEEP) {
+        *mode = form->values[*value].replace_mode;
+        *value = form->values[*value].replace;
+    }
+}
+
+void ssa_replace(ssa_form *form, uint32_t value, uint8_t mode, int32_t with) {
+    ssa_resolve(form, &mode, &with);
+    if (mode == IR_MODE_S && (uint32_t)with == value)
+        return;
+    form->values[value].replace_mode = mode;
+    form->values[value].replace = with;
+}
+
+int ssa_edge_live(ssa_form *form, uint32_t from, uint32_t to) {
+    cfg_block *block = &form->graph->blocks[from];
+    uint32_t k;
+    for (k = 0; k < block->succ_count; k++) {
+        if (block->succ[k] == to && form->edge_live[from * 2 + k])
+            return 1;
+    }
+    return 0;
+}
+
+// rewrite every read of a replaced value
+void ssa_apply(ssa_form *form) {
+    ir_inst *inst;
+    ssa_phi *phi;
+    uint8_t mode;
+    int32_t value;
+    uint32_t i, j, k;
+    int mask;
+
+    for (i = 0; i < form->func->count; i++) {
+        inst = &form->func->insts[i];
+        mask = ir_inst_reads(inst);
+        for (k = 0; k < 3; k++) {
+            if (!(mask & (1 << k)) || IR_INST_MODE(inst, k) != IR_MODE_S)
+                continue;
+            mode = IR_MODE_S;
+            value = inst->operand[k];
+            ssa_resolve(form, &mode, &value);
+            inst->mode[k] = mode | IR_INST_OP(inst, k);
+            inst->operand[k] = value;
+        }
+    }
+    for (i = 0; i < form->phi_count; i++) {
+        phi = &form->phis[i];
+        if (phi->value == CFG_NONE)
+            continue;
+        for (j = 0; j < form->graph->blocks[phi->block].pred_count; j++)
+            ssa_resolve(form, &phi->arg_mode[j], &phi->arg[j]);
+    }
+}
+
+// plain computations of a value, removable once it is not read
+int _ssa_is_pure(ir_inst *inst) {
+    return inst->op >= IR_EXP_OP_ADD && inst->op <= IR_EXP_OP_ASSIGN && inst->op != IR_EXP_OP_MACCESS
+        && inst->mode[0] == IR_MODE_S;
+}
+
+void _ssa_mark(char *live, uint32_t *work, uint32_t *top, uint8_t mode, int32_t value) {
+    if (mode != IR_MODE_S || live[value])
+        return;
+    live[value] = 1;
+    work[(*top)++] = value;
+}
+
+// mark and sweep: what side effects read is live, and so is whatever
+// computes a live value. the rest goes away
+void ssa_sweep(ssa_form *form) {
+    cfg *graph = form->graph;
+    char *live = calloc(form->value_count + 1, 1);
+    uint32_t *work = malloc(sizeof(uint32_t) * (form->value_count + 1));
+    uint32_t top = 0;
+    uint32_t b, i, j, k, v, def;
+    ir_inst *inst;
+    ssa_phi *phi;
+    int mask;
+
+    for (b = 0; b < graph->block_count; b++) {
+        if (!form->block_live[b])
+            continue;
+        for (i = graph->blocks[b].first; i < graph->blocks[b].last; i++) {
+            inst = &form->func->insts[i];
+            if (inst->op == SSA_DELETED || _ssa_is_pure(inst))
+                continue;
+            mask = ir_inst_reads(inst);
+            for (k = 0; k < 3; k++) {
+                if (mask & (1 << k))
+                    _ssa_mark(live, work, &top, IR_INST_MODE(inst, k), inst->operand[k]);
+            }
+        }
+    }
+    while (top > 0) {
+        v = work[--top];
+        def = form->values[v].def;
+        if (def == CFG_NONE)
+            continue;
+        if (def & SSA_PHI) {
+            phi = &form->phis[def & ~SSA_PHI];
+            for (j = 0; j < graph->blocks[phi->block].pred_count; j++)
+                _ssa_mark(live, work, &top, phi->arg_mode[j], phi->arg[j]);
+        }
+        else {
+            inst = &form->func->insts[def];
+            mask = ir_inst_reads(inst);
+            for (k = 0; k < 3; k++) {
+                if (mask & (1 << k))
+                    _ssa_mark(live, work, &top, IR_INST_MODE(inst, k), inst->operand[k]);
+            }
+        }
+    }
+    for (i = 0; i < form->func->count; i++) {
+        inst = &form->func->insts[i];
+        if (inst->op != SSA_DELETED && _ssa_is_pure(inst) && !live[inst->operand[0]])
+            inst->op = SSA_DELETED;
+    }
+    for (i = 0; i < form->phi_count; i++) {
+        if (form->phis[i].value != CFG_NONE && !live[form->phis[i].value])
+            form->phis[i].value = CFG_NONE;
+    }
+    free(live);
+    free(work);
+}
+
+// instructions and phis reading each value, users[user_start[v] ..
+// user_start[v + 1]) holds instruction indices and SSA_PHI | phi
+void ssa_link_users(ssa_form *form) {
+    ir_inst *inst;
+    ssa_phi *phi;
+    uint32_t i, j, k, v, round;
+    int mask;
+
+    free(form->user_start);
+    free(form->users);
+    form->user_start = calloc(form->value_count + 2, sizeof(uint32_t));
+    form->users = NULL;
+    for (round = 0; round < 2; round++) {
+        if (round == 1) {
+            for (v = 0; v < form->value_count; v++)
+                form->user_start[v + 1] += form->user_start[v];
+            form->users = malloc(sizeof(uint32_t) * (form->user_start[form->value_count] + 1));
+            for (v = form->value_count; v > 0; v--)
+                form->user_start[v] = form->user_start[v - 1];
+            form->user_start[0] = 0;
+        }
+        for (i = 0; i < form->func->count; i++) {
+            inst = &form->func->insts[i];
+            if (inst->op == SSA_DELETED)
+                continue;
+            mask = ir_inst_reads(inst);
+            for (k = 0; k < 3; k++) {
+                if (!(mask & (1 << k)) || IR_INST_MODE(inst, k) != IR_MODE_S)
+                    continue;
+                if (round == 0)
+                    form->user_start[inst->operand[k] + 1]++;
+                else
+                    form->users[form->user_start[inst->operand[k] + 1]++] = i;
+            }
+        }
+        for (i = 0; i < form->phi_count; i++) {
+            phi = &form->phis[i];
+            if (phi->value == CFG_NONE)
+                continue;
+            for (j = 0; j < form->graph->blocks[phi->block].pred_count; j++) {
+                if (phi->arg_mode[j] != IR_MODE_S)
+                    continue;
+                if (round == 0)
+                    form->user_start[phi->arg[j] + 1]++;
+                else
+                    form->users[form->user_start[phi->arg[j] + 1]++] = SSA_PHI | i;
+            }
+        }
+    }
+}
+
+// index of from among the preds of to
+uint32_t _ssa_pred_index(cfg *graph, uint32_t from, uint32_t to) {
+    uint32_t j;
+    for (j = 0; j < graph->blocks[to].pred_count && graph->blocks[to].pred[j] != from; j++);
+    return j;
+}
+
+// liveness of the values, a phi reads its args at the end of the preds
+void _ssa_liveness(ssa_form *form, uint32_t words, uint32_t *live_in, uint32_t *live_out) {
+    cfg *graph = form->graph;
+    uint32_t *use = calloc(graph->block_count * words, sizeof(uint32_t));
+    uint32_t *def = calloc(graph->block_count * words, sizeof(uint32_t));
+    uint32_t *use_b, *def_b, *out_b, *in_b;
+    uint32_t b, i, j, k, n, p, s, v, w;
+    ir_inst *inst;
+    ssa_phi *phi;
+    char changed;
+    int mask;
+
+    for (b = 0; b < graph->block_count; b++) {
+        if (!form->block_live[b])
+            continue;
+        use_b = use + b * words;
+        def_b = def + b * words;
+        for (p = form->block_phi[b]; p != CFG_NONE; p = form->phis[p].next) {
+            if ((v = form->phis[p].value) != CFG_NONE)
+                def_b[v >> 5] |= 1u << (v & 31);
+        }
+        for (i = graph->blocks[b].first; i < graph->blocks[b].last; i++) {
+            inst = &form->func->insts[i];
+            if (inst->op == SSA_DELETED)
+                continue;
+            mask = ir_inst_reads(inst);
+            for (k = 0; k < 3; k++) {
+                if (!(mask & (1 << k)) || IR_INST_MODE(inst, k) != IR_MODE_S)
+                    continue;
+                v = inst->operand[k];
+                if (!_SSA_BIT(def_b, v))
+                    use_b[v >> 5] |= 1u << (v & 31);
+            }
+            if (ir_inst_writes(inst) && inst->mode[0] == IR_MODE_S)
+                def_b[inst->operand[0] >> 5] |= 1u << (inst->operand[0] & 31);
+        }
+    }
+    do {
+        changed = 0;
+        for (n = graph->rpo_count; n-- > 0;) {
+            b = graph->rpo[n];
+            if (!form->block_live[b])
+                continue;
+            out_b = live_out + b * words;
+            in_b = live_in + b * words;
+            for (k = 0; k < graph->blocks[b].succ_count; k++) {
+                if (!form->edge_live[b * 2 + k])
+                    continue;
+                s = graph->blocks[b].succ[k];
+                for (w = 0; w < words; w++) {
+                    if (live_in[s * words + w] & ~out_b[w]) {
+                        out_b[w] |= live_in[s * words + w];
+                        changed = 1;
+                    }
+                }
+                j = _ssa_pred_index(graph, b, s);
+                for (p = form->block_phi[s]; p != CFG_NONE; p = form->phis[p].next) {
+                    phi = &form->phis[p];
+                    if (phi->value == CFG_NONE || phi->arg_mode[j] != IR_MODE_S || _SSA_BIT(out_b, (uint32_t)phi->arg[j]))
+                        continue;
+                    out_b[phi->arg[j] >> 5] |= 1u << (phi->arg[j] & 31);
+                    changed = 1;
+                }
+            }
+            for (w = 0; w < words; w++) {
+                v = use[b * words + w] | (out_b[w] & ~def[b * words + w]);
+                if (v != in_b[w]) {
+                    in_b[w] = v;
+                    changed = 1;
+                }
+            }
+        }
+    } while (changed);
+    free(use);
+    free(def);
+}
+
+// values of a candidate may all go back to its frame slot if no two
+// of them are ever alive at once. a phi writes its slot at the end of
+// every pred, where the values alive are those alive into its block.
+// a conditional jump never reads anything after the copies, it is
+// either gone or the copies come after it
+void _ssa_find_conflicts(ssa_form *form, _ssa_lowering *lowering) {
+    cfg *graph = form->graph;
+    uint32_t words = (form->value_count + 31) / 32 + 1;
+    uint32_t *live_in = calloc(graph->block_count * words, sizeof(uint32_t));
+    uint32_t *live_out = calloc(graph->block_count * words, sizeof(uint32_t));
+    uint32_t *cur = malloc(sizeof(uint32_t) * words);
+    uint32_t *live_count = calloc(form->var_count + 1, sizeof(uint32_t));
+    uint32_t b, i, k, p, v, d;
+    ir_inst *inst;
+    int mask;
+
+    _ssa_liveness(form, words, live_in, live_out);
+    for (b = 0; b < graph->block_count; b++) {
+        if (!form->block_live[b])
+            continue;
+        memcpy(cur, live_out + b * words, sizeof(uint32_t) * words);
+        for (v = 0; v < form->value_count; v++) {
+            if (_SSA_BIT(cur, v))
+                live_count[form->values[v].var]++;
+        }
+        for (i = graph->blocks[b].last; i-- > graph->blocks[b].first;) {
+            inst = &form->func->insts[i];
+            if (inst->op == SSA_DELETED)
+                continue;
+            if (ir_inst_writes(inst) && inst->mode[0] == IR_MODE_S) {
+                d = inst->operand[0];
+                if (live_count[form->values[d].var] > (_SSA_BIT(cur, d) ? 1u : 0u))
+                    lowering->conflict[form->values[d].var] = 1;
+                if (_SSA_BIT(cur, d)) {
+                    cur[d >> 5] &= ~(1u << (d & 31));
+                    live_count[form->values[d].var]--;
+                }
+            }
+            mask = ir_inst_reads(inst);
+            for (k = 0; k < 3; k++) {
+                if (!(mask & (1 << k)) || IR_INST_MODE(inst, k) != IR_MODE_S)
+                    continue;
+                v = inst->operand[k];
+                if (!_SSA_BIT(cur, v)) {
+                    cur[v >> 5] |= 1u << (v & 31);
+                    live_count[form->values[v].var]++;
+                }
+            }
+        }
+        for (p = form->block_phi[b]; p != CFG_NONE; p = form->phis[p].next) {
+            d = form->phis[p].value;
+            if (d != CFG_NONE && live_count[form->values[d].var] > (_SSA_BIT(cur, d) ? 1u : 0u))
+                lowering->conflict[form->values[d].var] = 1;
+        }
+        for (v = 0; v < form->value_count; v++) {
+            if (_SSA_BIT(cur, v))
+                live_count[form->values[v].var]--;
+        }
+    }
+    free(live_in);
+    free(live_out);
+    free(cur);
+    free(live_count);
+}
+
+// where a value lives once out of ssa, its candidate's slot unless the
+// candidate has conflicts. params keep theirs since the prologue
+// stores them there
+void _ssa_name(ssa_form *form, _ssa_lowering *lowering, uint32_t value, uint8_t *mode, int *id) {
+    ssa_value *content = &form->values[value];
+    if (lowering->name_mode[value] == SSA_KEEP) {
+        if (!lowering->conflict[content->var] || content->def == CFG_NONE
+            || (!(content->def & SSA_PHI) && form->func->insts[content->def].op == IR_OP_PARAM)) {
+            lowering->name_mode[value] = form->var_mode[content->var];
+            lowering->name_id[value] = form->var_id[content->var];
+        }
+        else {
+            lowering->name_mode[value] = IR_MODE_T;
+            lowering->name_id[value] = ir_new_temp_val(4);
+        }
+    }
+    *mode = lowering->name_mode[value];
+    *id = lowering->name_id[value];
+}
+
+ir_inst *_ssa_emit(_ssa_lowering *lowering) {
+    if (lowering->count == lowering->capacity) {
+        lowering->capacity = lowering->capacity ? lowering->capacity * 2 : 64;
+        lowering->insts = realloc(lowering->insts, sizeof(ir_inst) * lowering->capacity);
+    }
+    return &lowering->insts[lowering->count++];
+}
+
+void _ssa_emit_jump(_ssa_lowering *lowering, uint8_t op, int label) {
+    ir_inst *inst = _ssa_emit(lowering);
+    inst->op = op;
+    inst->mode[0] = inst->mode[1] = inst->mode[2] = IR_MODE_I;
+    inst->operand[0] = label;
+    inst->operand[1] = inst->operand[2] = 0;
+}
+
+void _ssa_emit_copy(_ssa_lowering *lowering, uint8_t dest_mode, int dest, uint8_t src_mode, int src) {
+    ir_inst *inst = _ssa_emit(lowering);
+    inst->op = IR_EXP_OP_ASSIGN;
+    inst->mode[0] = dest_mode;
+    inst->operand[0] = dest;
+    inst->mode[1] = src_mode;
+    inst->operand[1] = src;
+    inst->mode[2] = IR_MODE_I;
+    inst->operand[2] = 0;
+}
+
+void _ssa_emit_inst(ssa_form *form, _ssa_lowering *lowering, ir_inst *content) {
+    ir_inst *inst;
+    uint8_t mode;
+    int id, k, mask;
+    int temp;
+    if (ir_inst_writes(content) && IR_INST_OP(content, 0) == IR_MODE_STAR && IR_INST_MODE(content, 0) == IR_MODE_I) {
+        // a pointer that turned out to be constant, stores need it in a slot
+        temp = ir_new_temp_val(4);
+        _ssa_emit_copy(lowering, IR_MODE_T, temp, IR_MODE_I, content->operand[0]);
+        content->mode[0] = IR_MODE_T | IR_MODE_STAR;
+        content->operand[0] = temp;
+    }
+    inst = _ssa_emit(lowering);
+    *inst = *content;
+    mask = ir_inst_reads(inst) | ir_inst_writes(inst);
+    for (k = 0; k < 3; k++) {
+        if (!(mask & (1 << k)) || IR_INST_MODE(inst, k) != IR_MODE_S)
+            continue;
+        _ssa_name(form, lowering, inst->operand[k], &mode, &id);
+        inst->mode[k] = mode | IR_INST_OP(inst, k);
+        inst->operand[k] = id;
+    }
+}
+
+// the phis of to read their args all at once, order the copies so
+// that nothing is overwritten before it is read, going through a new
+// temp to break cycles
+void _ssa_emit_phi_copies(ssa_form *form, _ssa_lowering *lowering, uint32_t from, uint32_t to) {
+    uint32_t j = _ssa_pred_index(form->graph, from, to);
+    uint32_t count = 0, p, i, n;
+    ssa_phi *phi;
+    uint8_t *dest_mode, *src_mode;
+    int *dest, *src;
+    int temp;
+
+    for (p = form->block_phi[to]; p != CFG_NONE; p = form->phis[p].next)
+        count++;
+    if (count == 0)
+        return;
+    dest_mode = malloc(count);
+    src_mode = malloc(count);
+    dest = malloc(sizeof(int) * count);
+    src = malloc(sizeof(int) * count);
+    count = 0;
+    for (p = form->block_phi[to]; p != CFG_NONE; p = form->phis[p].next) {
+        phi = &form->phis[p];
+        if (phi->value == CFG_NONE)
+            continue;
+        _ssa_name(form, lowering, phi->value, &dest_mode[count], &dest[count]);
+        if (phi->arg_mode[j] == IR_MODE_S) {
+            _ssa_name(form, lowering, phi->arg[j], &src_mode[count], &src[count]);
+            if (src[count] == dest[count])
+                continue;
+        }
+        else {
+            src_mode[count] = IR_MODE_I;
+            src[count] = phi->arg[j];
+        }
+        count++;
+    }
+    while (count > 0) {
+        // a copy whose destination no other copy still reads
+        for (i = 0; i < count; i++) {
+            for (n = 0; n < count; n++) {
+                if (n != i && src_mode[n] != IR_MODE_I && src[n] == dest[i])
+                    break;
+            }
+            if (n == count)
+                break;
+        }
+        if (i == count) {
+            temp = ir_new_temp_val(4);
+            _ssa_emit_copy(lowering, IR_MODE_T, temp, dest_mode[0], dest[0]);
+            for (n = 0; n < count; n++) {
+                if (src_mode[n] != IR_MODE_I && src[n] == dest[0]) {
+                    src_mode[n] = IR_MODE_T;
+                    src[n] = temp;
+                }
+            }
+            continue;
+        }
+        _ssa_emit_copy(lowering, dest_mode[i], dest[i], src_mode[i], src[i]);
+        count--;
+        dest_mode[i] = dest_mode[count];
+        dest[i] = dest[count];
+        src_mode[i] = src_mode[count];
+        src[i] = src[count];
+    }
+    free(dest_mode);
+    free(src_mode);
+    free(dest);
+    free(src);
+}
+
+int _ssa_has_phis(ssa_form *form, uint32_t block) {
+    uint32_t p;
+    for (p = form->block_phi[block]; p != CFG_NONE; p = form->phis[p].next) {
+        if (form->phis[p].value != CFG_NONE)
+            return 1;
+    }
+    return 0;
+}
+
+// lay the blocks out again in their old order, without what can not
+// run. copies for the phis go at the end of the preds, an edge from a
+// block with two ways out gets a block of its own if it needs any
+void _ssa_lower(ssa_form *form, _ssa_lowering *lowering) {
+    cfg *graph = form->graph;
+    ir_function *func = form->func;
+    ir_inst *last;
+    uint32_t *split_from, *split_to;
+    int *split_label, *split_target;
+    uint32_t split_count = 0;
+    uint32_t b, i, s, taken, fall;
+    int end_label, stack_size = ir_stack_size();
+    char taken_live, fall_live;
+
+    split_from = malloc(sizeof(uint32_t) * graph->block_count);
+    split_to = malloc(sizeof(uint32_t) * graph->block_count);
+    split_label = malloc(sizeof(int) * graph->block_count);
+    split_target = malloc(sizeof(int) * graph->block_count);
+    for (b = 0; b < graph->exit; b++) {
+        if (!form->block_live[b])
+            continue;
+        last = &func->insts[graph->blocks[b].last - 1];
+        for (i = graph->blocks[b].first; i < graph->blocks[b].last - 1; i++) {
+            if (func->insts[i].op != SSA_DELETED)
+                _ssa_emit_inst(form, lowering, &func->insts[i]);
+        }
+        switch (last->op) {
+            case IR_OP_IF:
+            case IR_OP_IF_POSITIVE:
+            case IR_OP_IF_IMME:
+                taken = graph->blocks[b].succ[0];
+                taken_live = form->edge_live[b * 2];
+                fall = graph->blocks[b].succ_count == 2 ? graph->blocks[b].succ[1] : taken;
+                fall_live = graph->blocks[b].succ_count == 2 ? form->edge_live[b * 2 + 1] : 0;
+                if (taken_live && fall_live) {
+                    if (_ssa_has_phis(form, taken)) {
+                        split_from[split_count] = b;
+                        split_to[split_count] = taken;
+                        split_target[split_count] = last->operand[0];
+                        split_label[split_count] = last->operand[0] = ir_new_label();
+                        split_count++;
+                    }
+                    _ssa_emit_inst(form, lowering, last);
+                    // nothing else falls into the copies, the label of fall follows
+                    _ssa_emit_phi_copies(form, lowering, b, fall);
+                }
+                else if (taken_live) {
+                    _ssa_emit_phi_copies(form, lowering, b, taken);
+                    if (graph->blocks[b].succ_count == 2)
+                        _ssa_emit_jump(lowering, IR_OP_GOTO, last->operand[0]);
+                }
+                else if (fall_live) {
+                    _ssa_emit_phi_copies(form, lowering, b, fall);
+                }
+                break;
+            case IR_OP_GOTO:
+                _ssa_emit_phi_copies(form, lowering, b, graph->blocks[b].succ[0]);
+                _ssa_emit_inst(form, lowering, last);
+                break;
+            case IR_OP_RETURN:
+                _ssa_emit_inst(form, lowering, last);
+                break;
+            default:
+                if (last->op != SSA_DELETED)
+                    _ssa_emit_inst(form, lowering, last);
+                _ssa_emit_phi_copies(form, lowering, b, graph->blocks[b].succ[0]);
+                break;
+        }
+    }
+    if (split_count > 0) {
+        end_label = -1;
+        if (lowering->count > 0 && lowering->insts[lowering->count - 1].op != IR_OP_GOTO
+            && lowering->insts[lowering->count - 1].op != IR_OP_RETURN) {
+            end_label = ir_new_label();
+            _ssa_emit_jump(lowering, IR_OP_GOTO, end_label);
+        }
+        for (s = 0; s < split_count; s++) {
+            _ssa_emit_jump(lowering, IR_OP_LABEL, split_label[s]);
+            _ssa_emit_phi_copies(form, lowering, split_from[s], split_to[s]);
+            _ssa_emit_jump(lowering, IR_OP_GOTO, split_target[s]);
+        }
+        if (end_label >= 0)
+            _ssa_emit_jump(lowering, IR_OP_LABEL, end_label);
+    }
+    free(split_from);
+    free(split_to);
+    free(split_label);
+    free(split_target);
+
+    // new slots make the frame bigger
+    if (ir_stack_size() != stack_size) {
+        for (i = 0; i < lowering->count; i++) {
+            if (lowering->insts[i].op == IR_OP_DEC)
+                lowering->insts[i].operand[1] = ir_stack_size();
+        }
+    }
+}
+
+// back to frame ids, dropping what the passes removed
+void ssa_destroy(ssa_form *form) {
+    ir_function *func = form->func;
+    _ssa_lowering lowering;
+    uint32_t i;
+
+    ssa_apply(form);
+    ssa_sweep(form);
+    lowering.insts = NULL;
+    lowering.count = lowering.capacity = 0;
+    lowering.name_mode = malloc(form->value_count + 1);
+    lowering.name_id = malloc(sizeof(int) * (form->value_count + 1));
+    lowering.conflict = calloc(form->var_count + 1, 1);
+    for (i = 0; i < form->value_count; i++)
+        lowering.name_mode[i] = SSA_KEEP;
+    _ssa_find_conflicts(form, &lowering);
+    _ssa_lower(form, &lowering);
+
+    func->capacity = lowering.count;
+    func->count = lowering.count;
+    func->insts = arena_alloc(&cmmc_ctx->ir_arena, sizeof(ir_inst) * lowering.count);
+    memcpy(func->insts, lowering.insts, sizeof(ir_inst) * lowering.count);
+    cfg_invalidate(func);
+
+    free(lowering.insts);
+    free(lowering.name_mode);
+    free(lowering.name_id);
+    free(lowering.conflict);
+    for (i = 0; i < form->phi_count; i++) {
+        free(form->phis[i].arg_mode);
+        free(form->phis[i].arg);
+    }
+    free(form->phis);
+    free(form->values);
+    free(form->var_id);
+    free(form->var_mode);
+    free(form->block_phi);
+    free(form->block_live);
+    free(form->edge_live);
+    free(form->user_start);
+    free(form->users);
+    free(form);
+}
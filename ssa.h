@@ -0,0 +1,76 @@
+/*
+    C-- Compiler Back End
+    Copyright (C) 2019 NSKernel. All rights reserved.
+
+    A lab of Compilers at Nanjing University
+
+    ssa.h
+    Static single assignment form of a function
+*/
+
+#include <stdint.h>
+
+#include <ir.h>
+#include <cfg.h>
+
+#ifndef SSA_H
+#define SSA_H
+
+#define SSA_DELETED       0x00        // op of an instruction a pass removed
+#define SSA_KEEP          0xFF        // replace_mode of a value nobody replaced
+#define SSA_PHI           0x80000000  // def of a value coming from a phi
+
+typedef struct ssa_value_t ssa_value;
+typedef struct ssa_phi_t ssa_phi;
+typedef struct ssa_form_t ssa_form;
+
+// while in ssa form every read and write of a candidate, that is a t or
+// v whose address is never taken, is an IR_MODE_S operand naming one of
+// these. passes replace a value with another or with a constant, and
+// ssa_apply rewrites the operands
+struct ssa_value_t {
+    uint32_t var;           // index into ssa_form.var_id
+    uint32_t def;           // instruction, SSA_PHI | phi, CFG_NONE if never written
+    uint8_t replace_mode;   // IR_MODE_S or IR_MODE_I, SSA_KEEP if not replaced
+    int32_t replace;
+};
+
+// arg[j] comes in from pred[j] of the block, args on edges that
+// can not be taken are left as #0
+struct ssa_phi_t {
+    uint32_t value;         // CFG_NONE once removed
+    uint32_t block;
+    uint32_t next;          // next phi of the same block
+    uint8_t *arg_mode;
+    int32_t *arg;
+};
+
+struct ssa_form_t {
+    ir_function *func;
+    cfg *graph;
+    int *var_id;            // frame id of each candidate
+    uint8_t *var_mode;      // IR_MODE_T or IR_MODE_V
+    uint32_t var_count;
+    ssa_value *values;
+    uint32_t value_count;
+    uint32_t value_capacity;
+    ssa_phi *phis;
+    uint32_t phi_count;
+    uint32_t phi_capacity;
+    uint32_t *block_phi;    // first phi of each block
+    uint8_t *block_live;    // blocks that may run
+    uint8_t *edge_live;     // [b * 2 + k] for succ[k] of block b
+    uint32_t *user_start;   // see ssa_link_users
+    uint32_t *users;
+};
+
+ssa_form *ssa_build(ir_function *func);
+void ssa_destroy(ssa_form *form);
+void ssa_resolve(ssa_form *form, uint8_t *mode, int32_t *value);
+void ssa_replace(ssa_form *form, uint32_t value, uint8_t mode, int32_t with);
+void ssa_apply(ssa_form *form);
+void ssa_sweep(ssa_form *form);
+void ssa_link_users(ssa_form *form);
+int ssa_edge_live(ssa_form *form, uint32_t from, uint32_t to);
+
+#endif
@@ -16,15 +16,75 @@
 #include <semantics.h>
 #include <ir.h>
 #include <symbol_table.h>
-
-symbol_list *_symtable_clear_when_exit = NULL;
+#include <arena.h>
+#include <context.h>
 
 void _symtable_print();
 
+uint32_t _symtable_hash(const char *id) {
+    // FNV-1a
+    uint32_t hash = 2166136261u;
+    while (*id) {
+        hash ^= (uint8_t)*id++;
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+void _symtable_grow() {
+    symtable_name **old_names = cmmc_ctx->symtable_names;
+    uint32_t old_capacity = cmmc_ctx->symtable_name_capacity;
+    uint32_t i, slot;
+
+    cmmc_ctx->symtable_name_capacity = old_capacity ? old_capacity * 2 : 256;
+    cmmc_ctx->symtable_names = calloc(cmmc_ctx->symtable_name_capacity, sizeof(symtable_name *));
+    for (i = 0; i < old_capacity; i++) {
+        if (old_names[i] == NULL)
+            continue;
+        slot = old_names[i]->hash & (cmmc_ctx->symtable_name_capacity - 1);
+        while (cmmc_ctx->symtable_names[slot] != NULL)
+            slot = (slot + 1) & (cmmc_ctx->symtable_name_capacity - 1);
+        cmmc_ctx->symtable_names[slot] = old_names[i];
+    }
+    free(old_names);
+}
+
+// find the interned name, creating it if asked to
+symtable_name *_symtable_lookup(const char *id, char create) {
+    uint32_t hash = _symtable_hash(id);
+    uint32_t slot;
+    symtable_name *name;
+
+    if (cmmc_ctx->symtable_name_capacity != 0) {
+        slot = hash & (cmmc_ctx->symtable_name_capacity - 1);
+        while ((name = cmmc_ctx->symtable_names[slot]) != NULL) {
+            if (name->hash == hash && !strcmp(name->id, id))
+                return name;
+            slot = (slot + 1) & (cmmc_ctx->symtable_name_capacity - 1);
+        }
+    }
+    if (!create)
+        return NULL;
+    // keep the load factor under 1/2
+    if ((cmmc_ctx->symtable_name_count + 1) * 2 > cmmc_ctx->symtable_name_capacity)
+        _symtable_grow();
+    name = arena_alloc(&cmmc_ctx->symbol_arena, sizeof(symtable_name));
+    name->id = arena_strdup(&cmmc_ctx->symbol_arena, id);
+    name->hash = hash;
+    name->has_definition = 0;
+    name->binding = NULL;
+    slot = hash & (cmmc_ctx->symtable_name_capacity - 1);
+    while (cmmc_ctx->symtable_names[slot] != NULL)
+        slot = (slot + 1) & (cmmc_ctx->symtable_name_capacity - 1);
+    cmmc_ctx->symtable_names[slot] = name;
+    cmmc_ctx->symtable_name_count++;
+    return name;
+}
+
 void symtable_init() {
-    symbol_table_root = NULL;
+    cmmc_ctx->symbol_table_root = NULL;
     // add read and write
-    symbol_entry *read_symbol = malloc(sizeof(symbol_entry));
+    symbol_entry *read_symbol = arena_alloc(&cmmc_ctx->symbol_arena, sizeof(symbol_entry));
     read_symbol->id = "read";
     read_symbol->type = SYMBOL_T_INT;
     read_symbol->is_array = 0;
@@ -39,7 +99,7 @@ void symtable_init() {
     read_symbol->struct_constant_space = NULL;
     read_symbol->struct_specifier = NULL;
     symtable_insert(read_symbol, 0, 0, 0, 0);
-    symbol_entry *write_symbol = malloc(sizeof(symbol_entry));
+    symbol_entry *write_symbol = arena_alloc(&cmmc_ctx->symbol_arena, sizeof(symbol_entry));
     write_symbol->id = "write";
     write_symbol->type = SYMBOL_T_VOID; // write is a void
     write_symbol->is_array = 0;
@@ -48,8 +108,8 @@ void symtable_init() {
     write_symbol->array_dimention = 0;
     write_symbol->array_size = NULL;
     write_symbol->param_count = 1;
-    symbol_list *write_param = malloc(sizeof(symbol_entry));
-    symbol_entry *write_param_entry = malloc(sizeof(symbol_entry));
+    symbol_list *write_param = arena_alloc(&cmmc_ctx->symbol_arena, sizeof(symbol_list));
+    symbol_entry *write_param_entry = arena_alloc(&cmmc_ctx->symbol_arena, sizeof(symbol_entry));
     write_param_entry->id = "content";
     write_param_entry->type = SYMBOL_T_INT;
     write_param_entry->is_constant = IR_NON_CONSTANT;
@@ -81,45 +141,54 @@ char symtable_param_struct_compare(symbol_list *sl1, symbol_list *sl2) {
 
 int symtable_insert(symbol_entry *symbol, int context, char in_struct, char do_not_free, char is_param) {
     symbol_table *new_node;
-    symbol_table *iterator = symbol_table_root;
+    symbol_table *iterator;
+    symtable_name *name;
+    uint32_t scope;
 
     assert(context >= 0);
     assert(symbol != NULL);
-    // check if current symbol exists
-    while (iterator != NULL && iterator->context == context) {
-        if (!strcmp(iterator->symbol->id, symbol->id)) {
-            // found symbol with a same name in the same context
+    name = _symtable_lookup(symbol->id, 1);
+    if (cmmc_ctx->symbol_table_root != NULL && cmmc_ctx->symbol_table_root->context == context) {
+        scope = cmmc_ctx->symbol_table_root->scope;
+    }
+    else {
+        scope = ++cmmc_ctx->symtable_scope_count;
+    }
+    // check if current symbol exists, same named symbols in the
+    // current scope are the newest ones on the shadow chain
+    iterator = name->binding;
+    while (iterator != NULL && iterator->scope == scope) {
+        // found symbol with a same name in the same context
 
-            // if context 0 that could be a redeclear instead of redefine of a function
-            if (context == 0 && iterator->symbol->is_function == 1 && symbol->is_function == 1
-                && (iterator->symbol->is_function_dec == 1 || symbol->is_function_dec == 1)) {
-                // not same type (including struct) or not same params
-                if (iterator->symbol->type != symbol->type ||
-                    (symbol->type == SYMBOL_T_STRUCT && 
-                        !symtable_param_struct_compare(iterator->symbol->struct_specifier->struct_contents, symbol->struct_specifier->struct_contents)) ||
-                    !symtable_param_struct_compare(iterator->symbol->params, symbol->params)) {
-                    _sem_report_error("Error type 19 at Line %d: Inconsistent declaration of function \"%s\"", symbol->line_no_def, symbol->id);
-                    return -1;
-                }
+        // if context 0 that could be a redeclear instead of redefine of a function
+        if (context == 0 && iterator->symbol->is_function == 1 && symbol->is_function == 1
+            && (iterator->symbol->is_function_dec == 1 || symbol->is_function_dec == 1)) {
+            // not same type (including struct) or not same params
+            if (iterator->symbol->type != symbol->type ||
+                (symbol->type == SYMBOL_T_STRUCT && 
+                    !symtable_param_struct_compare(iterator->symbol->struct_specifier->struct_contents, symbol->struct_specifier->struct_contents)) ||
+                !symtable_param_struct_compare(iterator->symbol->params, symbol->params)) {
+                _sem_report_error("Error type 19 at Line %d: Inconsistent declaration of function \"%s\"", symbol->line_no_def, symbol->id);
+                return -1;
+            }
 
+        }
+        else {
+            if (symbol->is_function || symbol->is_function_dec) {
+                _sem_report_error("Error type 4 at Line %d: Redefined symbol \"%s\"", symbol->line_no_def, symbol->id);
             }
-            else {
-                if (symbol->is_function || symbol->is_function_dec) {
-                    _sem_report_error("Error type 4 at Line %d: Redefined symbol \"%s\"", symbol->line_no_def, symbol->id);
-                }
-                else if (in_struct) {
-                    _sem_report_error("Error type 15 at Line %d: Redefined field \"%s\"", symbol->line_no_def, symbol->id);
-                }
-                else if (symbol->type == SYMBOL_T_STRUCT_DEFINE) {
-                    _sem_report_error("Error type 16 at Line %d: Defined a struct with an existing id \"%s\"", symbol->line_no_def, symbol->id);
-                }
-                else{
-                    _sem_report_error("Error type 3 at Line %d: Redefined symbol \"%s\"", symbol->line_no_def, symbol->id);
-                }
-                return -1;
+            else if (in_struct) {
+                _sem_report_error("Error type 15 at Line %d: Redefined field \"%s\"", symbol->line_no_def, symbol->id);
+            }
+            else if (symbol->type == SYMBOL_T_STRUCT_DEFINE) {
+                _sem_report_error("Error type 16 at Line %d: Defined a struct with an existing id \"%s\"", symbol->line_no_def, symbol->id);
             }
+            else{
+                _sem_report_error("Error type 3 at Line %d: Redefined symbol \"%s\"", symbol->line_no_def, symbol->id);
+            }
+            return -1;
         }
-        iterator = iterator->next;
+        iterator = iterator->shadow;
     }
     
     new_node = malloc(sizeof(symbol_table));
@@ -127,113 +196,54 @@ int symtable_insert(symbol_entry *symbol, int context, char in_struct, char do_n
     new_node->symbol->is_param = is_param;
     new_node->context = context;
     new_node->do_not_free = do_not_free;
-    new_node->next = symbol_table_root;
-    symbol_table_root = new_node;
+    new_node->scope = scope;
+    new_node->name = name;
+    new_node->shadow = name->binding;
+    name->binding = new_node;
+    new_node->next = cmmc_ctx->symbol_table_root;
+    cmmc_ctx->symbol_table_root = new_node;
     //_symtable_print();
     return 0;
 }
 
-void symtable_free_symbol(symbol_entry *se) {
-    if (se->type == SYMBOL_T_STRUCT_DEFINE) {
-        free(se->id); // which should be the same char *
-                      // with the one in struct_specifier
-        symtable_free_symbol_list(se->struct_specifier->struct_contents);
-        if (se->struct_specifier->struct_tag[0] <= '9' && se->struct_specifier->struct_tag[0] >= '0') {
-            // a name we initialized
-            // we should free it
-            free(se->struct_specifier->struct_tag);
-        }
-        free(se->struct_specifier);
-    }
-    if (se->is_array) {
-        free(se->array_size);
-    }
-    if (se->is_function || se->is_function_dec) {
-        symtable_free_symbol_list(se->params);
-    }
-    free(se);
-}
-
-void symtable_free_symbol_list(symbol_list *sl) {
-    if (sl != NULL) {
-        symtable_free_symbol(sl->symbol);
-        symtable_free_symbol_list(sl->next);
-        free(sl);
-    }
-}
-
+// symbols live in the symbol arena, popping a context only
+// unlinks its bindings so that struct specifiers and param
+// lists holding the symbols stay valid
 void symtable_pop_context(int context) {
-    assert((symbol_table_root == NULL) || (context >= symbol_table_root->context));
+    assert((cmmc_ctx->symbol_table_root == NULL) || (context >= cmmc_ctx->symbol_table_root->context));
 
-    symbol_table *iterator = symbol_table_root;
-    symbol_list *clear_when_exit_item;
+    symbol_table *iterator = cmmc_ctx->symbol_table_root;
 
     while (iterator != NULL && iterator->context == context) {
-        symbol_table_root = iterator->next;
-        if (!iterator->do_not_free) {
-            symtable_free_symbol(iterator->symbol);
-        }
-        else {
-            // because there are still structures that is using this
-            // struct_specifier information, we store it and release
-            // it when exit
-            if (iterator->symbol->type == SYMBOL_T_STRUCT_DEFINE) {
-                clear_when_exit_item = malloc(sizeof(symbol_list));
-                clear_when_exit_item->symbol = iterator->symbol;
-                clear_when_exit_item->next = _symtable_clear_when_exit;
-                _symtable_clear_when_exit = clear_when_exit_item;
-         }
-        }
+        cmmc_ctx->symbol_table_root = iterator->next;
+        // the newest binding overall is the newest of its name
+        iterator->name->binding = iterator->shadow;
         free(iterator);
-        iterator = symbol_table_root;
+        iterator = cmmc_ctx->symbol_table_root;
     }
 }
 
 // used for struct_specifier and param_list
 void symtable_pop_context_without_free(int context) {
-    assert((symbol_table_root == NULL) || (context >= symbol_table_root->context));
-
-    symbol_table *iterator = symbol_table_root;
-    symbol_list *clear_when_exit_item;
-
-    while (iterator != NULL && iterator->context == context) {
-        symbol_table_root = iterator->next;
-        // because there are still structures that is using this
-        // struct_specifier information, we store it and release
-        // it when exit
-        if (iterator->symbol->type == SYMBOL_T_STRUCT_DEFINE) {
-            clear_when_exit_item = malloc(sizeof(symbol_list));
-            clear_when_exit_item->symbol = iterator->symbol;
-            clear_when_exit_item->next = _symtable_clear_when_exit;
-            _symtable_clear_when_exit = clear_when_exit_item;
-        }
-        free(iterator);
-        iterator = symbol_table_root;
-    }
+    symtable_pop_context(context);
 }
  
 symbol_entry *symtable_query(char *id) {
-    symbol_table *iterator;
-    iterator = symbol_table_root;
-    int top_context;
-    if (symbol_table_root != NULL) {
-        top_context = symbol_table_root->context;
+    symtable_name *name = _symtable_lookup(id, 0);
+    symbol_table *binding;
+    if (name == NULL || name->binding == NULL) {
+        return NULL;
     }
-    while (iterator != NULL) {
-        if (!strcmp(iterator->symbol->id, id)) {
-            if (iterator->context == top_context)
-                iterator->symbol->is_top_context = 1;
-            else
-                iterator->symbol->is_top_context = 0;
-            return iterator->symbol;
-        }
-        iterator = iterator->next;
-    }
-    return NULL;
+    binding = name->binding;
+    if (binding->context == cmmc_ctx->symbol_table_root->context)
+        binding->symbol->is_top_context = 1;
+    else
+        binding->symbol->is_top_context = 0;
+    return binding->symbol;
 }
 
 void _symtable_print() {
-    symbol_table *iterator = symbol_table_root;
+    symbol_table *iterator = cmmc_ctx->symbol_table_root;
     while (iterator != NULL) {
         printf("%s, %d->", iterator->symbol->id, iterator->context);
         iterator = iterator->next;
@@ -242,36 +252,22 @@ void _symtable_print() {
 }
 
 void symtable_ensure_defined() {
-    symbol_table *iterator = symbol_table_root;
-    symbol_table *iterator2;
-    while (iterator != NULL) {
-        if (iterator->symbol->is_function) {
-            if (iterator->symbol->is_function_dec) {
-                iterator2 = iterator->next;
-                while (iterator2 != NULL) {
-                    if (!strcmp(iterator2->symbol->id, iterator->symbol->id)) {
-                        if (!iterator2->symbol->is_function_dec) {
-                            iterator->symbol->is_function_dec = 0;
-                            break;
-                        }
-                    }
-                    iterator2 = iterator2->next;
-                }
-                if (iterator->symbol->is_function_dec) {
-                    // undefined function
-                    _sem_report_error("Error type 18 at Line %d: Undefined function \"%s\"", iterator->symbol->line_no_def, iterator->symbol->id);
-                }
+    symbol_table *iterator;
+    // mark names having a definition first so that each
+    // declaration can be checked with a single lookup
+    for (iterator = cmmc_ctx->symbol_table_root; iterator != NULL; iterator = iterator->next) {
+        if (iterator->symbol->is_function && !iterator->symbol->is_function_dec)
+            iterator->name->has_definition = 1;
+    }
+    for (iterator = cmmc_ctx->symbol_table_root; iterator != NULL; iterator = iterator->next) {
+        if (iterator->symbol->is_function && iterator->symbol->is_function_dec) {
+            if (iterator->name->has_definition) {
+                iterator->symbol->is_function_dec = 0;
             }
             else {
-                iterator2 = iterator->next;
-                while (iterator2 != NULL) {
-                    if (!strcmp(iterator2->symbol->id, iterator->symbol->id)) {
-                        iterator2->symbol->is_function_dec = 0;
-                    }
-                    iterator2 = iterator2->next;
-                }
+                // undefined function
+                _sem_report_error("Error type 18 at Line %d: Undefined function \"%s\"", iterator->symbol->line_no_def, iterator->symbol->id);
             }
         }
-        iterator = iterator->next;
     }
-}
\ No newline at end of file
+}
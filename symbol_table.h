@@ -63,14 +63,27 @@ struct symbol_entry_t {
     char is_param;
 };
 
+typedef struct symtable_name_t symtable_name;
+
+// a binding of a symbol, bindings form a stack through next and
+// those of the same name are chained from the newest through shadow
 struct symbol_table_t {
     symbol_entry *symbol;
     int context;
     char do_not_free;
+    uint32_t scope;                // bindings inserted in a row with the same context
+    symtable_name *name;
+    symbol_table *shadow;
     symbol_table *next;
 };
 
-symbol_table *symbol_table_root;
+// interned identifier, slot of the hash table
+struct symtable_name_t {
+    char *id;
+    uint32_t hash;
+    char has_definition;
+    symbol_table *binding;         // innermost visible binding
+};
 
 void symtable_init();
 int symtable_insert(symbol_entry *symbol, int context, char in_struct, char do_not_free, char is_param);
@@ -79,8 +92,6 @@ void symtable_pop_context_without_free(int context);
 symbol_entry *symtable_query(char *id);
 char symtable_param_struct_compare(symbol_list *sl1, symbol_list *sl2);
 
-void symtable_free_symbol(symbol_entry *se);
-void symtable_free_symbol_list(symbol_list *sl);
 void _symtable_print();
 void symtable_ensure_defined();
 
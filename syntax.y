@@ -16,23 +16,33 @@
     #define YYERROR_VERBOSE
     #define _POSIX_C_SOURCE 200809L
 
-    ast_node *root_node;
-    extern char error_flag;
-    extern int yylineno;
-
-    extern int yylex();
-    int yyerror(const char* msg);
     #ifdef DEBUG
     #define YYDEBUG  1  
     int yydebug = 1;
     #endif
 %}
 
+%code requires {
+    #include <context.h>
+}
+
+// reentrant, the scanner and the context are handed down by cmmc_compile
+%define api.pure full
+%locations
+%param { void *scanner }
+%parse-param { cmmc_context *ctx }
+
 %union
 {
     ast_node *node;
 }
 
+%code {
+    extern int yylex(YYSTYPE *lvalp, YYLTYPE *llocp, void *scanner);
+    extern int yyget_lineno(void *scanner);
+    int yyerror(YYLTYPE *llocp, void *scanner, cmmc_context *ctx, const char *msg);
+}
+
 %type <node>     ExtDefList ExtDef ExtDecList
 %type <node>     Specifier  StructSpecifier OptTag Tag
 %type <node>     VarDec FunDec VarList ParamDec
@@ -75,24 +85,20 @@
 /* High-Level Definitions */
 Program : ExtDefList    
         { 
-            root_node = ast_make_new_node(
-                "Program", 
+            ctx->root_node = ast_make_new_node(
+                AST_PROGRAM,
                 @1.first_line,
-                false, 
-                NULL, 
-                T_NT,
+                NULL,
                 1);
-            root_node->children[0] = $1; 
+            ctx->root_node->children[0] = $1; 
         }
   ;
 ExtDefList : ExtDef ExtDefList 
         {
             $$ = ast_make_new_node(
-                "ExtDefList", 
+                AST_EXT_DEF_LIST,
                 @1.first_line,
-                false, 
-                NULL, 
-                T_NT,
+                NULL,
                 2);
             $$->children[0] = $1; 
             $$->children[1] = $2;
@@ -105,11 +111,9 @@ ExtDefList : ExtDef ExtDefList
 ExtDef : Specifier ExtDecList SEMI 
         {
             $$ = ast_make_new_node(
-                "ExtDef", 
+                AST_EXT_DEF,
                 @1.first_line,
-                false, 
-                NULL, 
-                T_NT,
+                NULL,
                 3);
             $$->children[0] = $1; 
             $$->children[1] = $2;
@@ -118,11 +122,9 @@ ExtDef : Specifier ExtDecList SEMI
   | Specifier SEMI 
         { 
             $$ = ast_make_new_node(
-                "ExtDef", 
+                AST_EXT_DEF,
                 @1.first_line,
-                false, 
-                NULL, 
-                T_NT,
+                NULL,
                 2);
             $$->children[0] = $1; 
             $$->children[1] = $2;
@@ -130,11 +132,9 @@ ExtDef : Specifier ExtDecList SEMI
   | Specifier FunDec CompSt 
         {
             $$ = ast_make_new_node(
-                "ExtDef", 
+                AST_EXT_DEF,
                 @1.first_line,
-                false, 
-                NULL, 
-                T_NT,
+                NULL,
                 3);
             $$->children[0] = $1;
             $$->children[1] = $2;
@@ -143,11 +143,9 @@ ExtDef : Specifier ExtDecList SEMI
   | Specifier FunDec SEMI 
         {
             $$ = ast_make_new_node(
-                "ExtDef", 
+                AST_EXT_DEF,
                 @1.first_line,
-                false, 
-                NULL, 
-                T_NT,
+                NULL,
                 3);
             $$->children[0] = $1;
             $$->children[1] = $2;
@@ -161,22 +159,18 @@ ExtDef : Specifier ExtDecList SEMI
 ExtDecList : VarDec 
         { 
             $$ = ast_make_new_node(
-                "ExtDecList", 
+                AST_EXT_DEC_LIST,
                 @1.first_line,
-                false, 
-                NULL, 
-                T_NT,
+                NULL,
                 1);
             $$->children[0] = $1;
         }
   | VarDec COMMA ExtDecList 
         { 
             $$ = ast_make_new_node(
-                "ExtDecList", 
+                AST_EXT_DEC_LIST,
                 @1.first_line,
-                false, 
-                NULL, 
-                T_NT,
+                NULL,
                 3);
             $$->children[0] = $1;
             $$->children[1] = $2;
@@ -188,22 +182,18 @@ ExtDecList : VarDec
 Specifier : TYPE 
         { 
             $$ = ast_make_new_node(
-                "Specifier", 
+                AST_SPECIFIER,
                 @1.first_line,
-                false, 
-                NULL, 
-                T_NT,
+                NULL,
                 1);
             $$->children[0] = $1;
         }
   | StructSpecifier  
         { 
             $$ = ast_make_new_node(
-                "Specifier", 
+                AST_SPECIFIER,
                 @1.first_line,
-                false, 
-                NULL, 
-                T_NT,
+                NULL,
                 1);
             $$->children[0] = $1;
         }
@@ -211,11 +201,9 @@ Specifier : TYPE
 StructSpecifier : STRUCT OptTag LC DefList RC 
         { 
             $$ = ast_make_new_node(
-                "StructSpecifier", 
+                AST_STRUCT_SPECIFIER,
                 @1.first_line,
-                false, 
-                NULL, 
-                T_NT,
+                NULL,
                 5);
             $$->children[0] = $1;
             $$->children[1] = $2;
@@ -226,11 +214,9 @@ StructSpecifier : STRUCT OptTag LC DefList RC
   | STRUCT Tag 
         { 
             $$ = ast_make_new_node(
-                "StructSpecifier", 
+                AST_STRUCT_SPECIFIER,
                 @1.first_line,
-                false, 
-                NULL, 
-                T_NT,
+                NULL,
                 2);
             $$->children[0] = $1;
             $$->children[1] = $2;
@@ -239,11 +225,9 @@ StructSpecifier : STRUCT OptTag LC DefList RC
 OptTag : ID 
         {
             $$ = ast_make_new_node(
-                "OptTag", 
+                AST_OPT_TAG,
                 @1.first_line,
-                false, 
-                NULL, 
-                T_NT,
+                NULL,
                 1);
             $$->children[0] = $1;
         }
@@ -252,11 +236,9 @@ OptTag : ID
 Tag : ID 
         { 
             $$ = ast_make_new_node(
-                "Tag", 
+                AST_TAG,
                 @1.first_line,
-                false, 
-                NULL, 
-                T_NT,
+                NULL,
                 1);
             $$->children[0] = $1;
         }
@@ -266,22 +248,18 @@ Tag : ID
 VarDec : ID 
         {
             $$ = ast_make_new_node(
-                "VarDec", 
+                AST_VAR_DEC,
                 @1.first_line,
-                false, 
-                NULL, 
-                T_NT,
+                NULL,
                 1);
             $$->children[0] = $1;
         }
   | VarDec LB INT RB 
         {
             $$ = ast_make_new_node(
-                "VarDec", 
+                AST_VAR_DEC,
                 @1.first_line,
-                false, 
-                NULL, 
-                T_NT,
+                NULL,
                 4);
             $$->children[0] = $1;
             $$->children[1] = $2;
@@ -294,11 +272,9 @@ VarDec : ID
 FunDec : ID LP VarList RP 
         {
             $$ = ast_make_new_node(
-                "FunDec", 
+                AST_FUN_DEC,
                 @1.first_line,
-                false, 
-                NULL, 
-                T_NT,
+                NULL,
                 4);
             $$->children[0] = $1;
             $$->children[1] = $2;
@@ -308,11 +284,9 @@ FunDec : ID LP VarList RP
   | ID LP RP 
         {
             $$ = ast_make_new_node(
-                "FunDec", 
+                AST_FUN_DEC,
                 @1.first_line,
-                false, 
-                NULL, 
-                T_NT,
+                NULL,
                 3);
             $$->children[0] = $1;
             $$->children[1] = $2;
@@ -323,11 +297,9 @@ FunDec : ID LP VarList RP
 VarList : ParamDec COMMA VarList 
         {
             $$ = ast_make_new_node(
-                "VarList", 
+                AST_VAR_LIST,
                 @1.first_line,
-                false, 
-                NULL, 
-                T_NT,
+                NULL,
                 3);
             $$->children[0] = $1;
             $$->children[1] = $2;
@@ -336,22 +308,18 @@ VarList : ParamDec COMMA VarList
   | ParamDec 
         {
             $$ = ast_make_new_node(
-                "VarList", 
+                AST_VAR_LIST,
                 @1.first_line,
-                false, 
-                NULL, 
-                T_NT,
+                NULL,
                 1);
             $$->children[0] = $1;
         }
 ParamDec : Specifier VarDec 
         {
             $$ = ast_make_new_node(
-                "ParamDec", 
+                AST_PARAM_DEC,
                 @1.first_line,
-                false, 
-                NULL, 
-                T_NT,
+                NULL,
                 2);
             $$->children[0] = $1;
             $$->children[1] = $2;
@@ -361,11 +329,9 @@ ParamDec : Specifier VarDec
 CompSt : LC DefList StmtList RC 
         {
             $$ = ast_make_new_node(
-                "CompSt", 
+                AST_COMP_ST,
                 @1.first_line,
-                false, 
-                NULL, 
-                T_NT,
+                NULL,
                 4);
             $$->children[0] = $1;
             $$->children[1] = $2;
@@ -377,11 +343,9 @@ CompSt : LC DefList StmtList RC
 StmtList : Stmt StmtList 
         {
             $$ = ast_make_new_node(
-                "StmtList", 
+                AST_STMT_LIST,
                 @1.first_line,
-                false, 
-                NULL, 
-                T_NT,
+                NULL,
                 2);
             $$->children[0] = $1;
             $$->children[1] = $2;
@@ -391,11 +355,9 @@ StmtList : Stmt StmtList
 Stmt : Exp SEMI 
         {
             $$ = ast_make_new_node(
-                "Stmt", 
+                AST_STMT,
                 @1.first_line,
-                false, 
-                NULL, 
-                T_NT,
+                NULL,
                 2);
             $$->children[0] = $1;
             $$->children[1] = $2;
@@ -403,22 +365,18 @@ Stmt : Exp SEMI
   | CompSt 
         {
             $$ = ast_make_new_node(
-                "Stmt", 
+                AST_STMT,
                 @1.first_line,
-                false, 
-                NULL, 
-                T_NT,
+                NULL,
                 1);
             $$->children[0] = $1;
         }
   | RETURN Exp SEMI
         {
             $$ = ast_make_new_node(
-                "Stmt", 
+                AST_STMT,
                 @1.first_line,
-                false, 
-                NULL, 
-                T_NT,
+                NULL,
                 3);
             $$->children[0] = $1;
             $$->children[1] = $2;
@@ -427,11 +385,9 @@ Stmt : Exp SEMI
   | IF LP Exp RP Stmt ELSE Stmt 
         {
             $$ = ast_make_new_node(
-                "Stmt", 
+                AST_STMT,
                 @1.first_line,
-                false, 
-                NULL, 
-                T_NT,
+                NULL,
                 7);
             $$->children[0] = $1;
             $$->children[1] = $2;
@@ -444,11 +400,9 @@ Stmt : Exp SEMI
   | IF LP Exp RP Stmt %prec ELSE_BREAKER 
         {
             $$ = ast_make_new_node(
-                "Stmt", 
+                AST_STMT,
                 @1.first_line,
-                false, 
-                NULL, 
-                T_NT,
+                NULL,
                 5);
             $$->children[0] = $1;
             $$->children[1] = $2;
@@ -459,11 +413,9 @@ Stmt : Exp SEMI
   | WHILE LP Exp RP Stmt 
         {
             $$ = ast_make_new_node(
-                "Stmt", 
+                AST_STMT,
                 @1.first_line,
-                false, 
-                NULL, 
-                T_NT,
+                NULL,
                 5);
             $$->children[0] = $1;
             $$->children[1] = $2;
@@ -478,11 +430,9 @@ Stmt : Exp SEMI
 DefList : Def DefList 
         {
             $$ = ast_make_new_node(
-                "DefList", 
+                AST_DEF_LIST,
                 @1.first_line,
-                false, 
-                NULL, 
-                T_NT,
+                NULL,
                 2);
             $$->children[0] = $1;
             $$->children[1] = $2;
@@ -492,11 +442,9 @@ DefList : Def DefList
 Def : Specifier DecList SEMI 
         {
             $$ = ast_make_new_node(
-                "Def", 
+                AST_DEF,
                 @1.first_line,
-                false, 
-                NULL, 
-                T_NT,
+                NULL,
                 3);
             $$->children[0] = $1;
             $$->children[1] = $2;
@@ -507,22 +455,18 @@ Def : Specifier DecList SEMI
 DecList : Dec 
         {
             $$ = ast_make_new_node(
-                "DecList", 
+                AST_DEC_LIST,
                 @1.first_line,
-                false, 
-                NULL, 
-                T_NT,
+                NULL,
                 1);
             $$->children[0] = $1;
         }
   | Dec COMMA DecList 
         {
             $$ = ast_make_new_node(
-                "DecList", 
+                AST_DEC_LIST,
                 @1.first_line,
-                false, 
-                NULL, 
-                T_NT,
+                NULL,
                 3);
             $$->children[0] = $1;
             $$->children[1] = $2;
@@ -532,22 +476,18 @@ DecList : Dec
 Dec : VarDec 
         {
             $$ = ast_make_new_node(
-                "Dec", 
+                AST_DEC,
                 @1.first_line,
-                false, 
-                NULL, 
-                T_NT,
+                NULL,
                 1);
             $$->children[0] = $1;
         }
   | VarDec ASSIGNOP Exp 
         {
             $$ = ast_make_new_node(
-                "Dec", 
+                AST_DEC,
                 @1.first_line,
-                false, 
-                NULL, 
-                T_NT,
+                NULL,
                 3);
             $$->children[0] = $1;
             $$->children[1] = $2;
@@ -559,11 +499,9 @@ Dec : VarDec
 Exp : Exp DOT ID 
         {
             $$ = ast_make_new_node(
-                "Exp", 
+                AST_EXP,
                 @1.first_line,
-                false, 
-                NULL, 
-                T_NT,
+                NULL,
                 3);
             $$->children[0] = $1;
             $$->children[1] = $2;
@@ -572,11 +510,9 @@ Exp : Exp DOT ID
   | LP Exp RP 
         {
             $$ = ast_make_new_node(
-                "Exp", 
+                AST_EXP,
                 @1.first_line,
-                false, 
-                NULL, 
-                T_NT,
+                NULL,
                 3);
             $$->children[0] = $1;
             $$->children[1] = $2;
@@ -585,11 +521,9 @@ Exp : Exp DOT ID
   | ID LP Args RP 
         {
             $$ = ast_make_new_node(
-                "Exp", 
+                AST_EXP,
                 @1.first_line,
-                false, 
-                NULL, 
-                T_NT,
+                NULL,
                 4);
             $$->children[0] = $1;
             $$->children[1] = $2;
@@ -599,11 +533,9 @@ Exp : Exp DOT ID
   | ID LP RP 
         {
             $$ = ast_make_new_node(
-                "Exp", 
+                AST_EXP,
                 @1.first_line,
-                false, 
-                NULL, 
-                T_NT,
+                NULL,
                 3);
             $$->children[0] = $1;
             $$->children[1] = $2;
@@ -612,44 +544,36 @@ Exp : Exp DOT ID
   | ID 
         {
             $$ = ast_make_new_node(
-                "Exp", 
+                AST_EXP,
                 @1.first_line,
-                false, 
-                NULL, 
-                T_NT,
+                NULL,
                 1);
             $$->children[0] = $1;
         }
   | INT 
         {
             $$ = ast_make_new_node(
-                "Exp", 
+                AST_EXP,
                 @1.first_line,
-                false, 
-                NULL, 
-                T_NT,
+                NULL,
                 1);
             $$->children[0] = $1;
         }
   | FLOAT 
         {
             $$ = ast_make_new_node(
-                "Exp", 
+                AST_EXP,
                 @1.first_line,
-                false, 
-                NULL, 
-                T_NT,
+                NULL,
                 1);
             $$->children[0] = $1;
         }
   | Exp LB Exp RB 
         {
             $$ = ast_make_new_node(
-                "Exp", 
+                AST_EXP,
                 @1.first_line,
-                false, 
-                NULL, 
-                T_NT,
+                NULL,
                 4);
             $$->children[0] = $1;
             $$->children[1] = $2;
@@ -659,11 +583,9 @@ Exp : Exp DOT ID
   | MINUS Exp %prec PREFIXMINUS 
         {
             $$ = ast_make_new_node(
-                "Exp", 
+                AST_EXP,
                 @1.first_line,
-                false, 
-                NULL, 
-                T_NT,
+                NULL,
                 2);
             $$->children[0] = $1;
             $$->children[1] = $2;
@@ -671,11 +593,9 @@ Exp : Exp DOT ID
   | NOT Exp 
         {
             $$ = ast_make_new_node(
-                "Exp", 
+                AST_EXP,
                 @1.first_line,
-                false, 
-                NULL, 
-                T_NT,
+                NULL,
                 2);
             $$->children[0] = $1;
             $$->children[1] = $2;
@@ -683,11 +603,9 @@ Exp : Exp DOT ID
   | Exp STAR Exp 
         {
             $$ = ast_make_new_node(
-                "Exp", 
+                AST_EXP,
                 @1.first_line,
-                false, 
-                NULL, 
-                T_NT,
+                NULL,
                 3);
             $$->children[0] = $1;
             $$->children[1] = $2;
@@ -696,11 +614,9 @@ Exp : Exp DOT ID
   | Exp DIV Exp 
         {
             $$ = ast_make_new_node(
-                "Exp", 
+                AST_EXP,
                 @1.first_line,
-                false, 
-                NULL, 
-                T_NT,
+                NULL,
                 3);
             $$->children[0] = $1;
             $$->children[1] = $2;
@@ -709,11 +625,9 @@ Exp : Exp DOT ID
   | Exp PLUS Exp
         {
             $$ = ast_make_new_node(
-                "Exp", 
+                AST_EXP,
                 @1.first_line,
-                false, 
-                NULL, 
-                T_NT,
+                NULL,
                 3);
             $$->children[0] = $1;
             $$->children[1] = $2;
@@ -722,11 +636,9 @@ Exp : Exp DOT ID
   | Exp MINUS Exp
         {
             $$ = ast_make_new_node(
-                "Exp", 
+                AST_EXP,
                 @1.first_line,
-                false, 
-                NULL, 
-                T_NT,
+                NULL,
                 3);
             $$->children[0] = $1;
             $$->children[1] = $2;
@@ -735,11 +647,9 @@ Exp : Exp DOT ID
   | Exp RELOP Exp
         {
             $$ = ast_make_new_node(
-                "Exp", 
+                AST_EXP,
                 @1.first_line,
-                false, 
-                NULL, 
-                T_NT,
+                NULL,
                 3);
             $$->children[0] = $1;
             $$->children[1] = $2;
@@ -748,11 +658,9 @@ Exp : Exp DOT ID
   | Exp AND Exp
         {
             $$ = ast_make_new_node(
-                "Exp", 
+                AST_EXP,
                 @1.first_line,
-                false, 
-                NULL, 
-                T_NT,
+                NULL,
                 3);
             $$->children[0] = $1;
             $$->children[1] = $2;
@@ -761,11 +669,9 @@ Exp : Exp DOT ID
   | Exp OR Exp 
         {
             $$ = ast_make_new_node(
-                "Exp", 
+                AST_EXP,
                 @1.first_line,
-                false, 
-                NULL, 
-                T_NT,
+                NULL,
                 3);
             $$->children[0] = $1;
             $$->children[1] = $2;
@@ -774,11 +680,9 @@ Exp : Exp DOT ID
   | Exp ASSIGNOP Exp
         {
             $$ = ast_make_new_node(
-                "Exp", 
+                AST_EXP,
                 @1.first_line,
-                false, 
-                NULL, 
-                T_NT,
+                NULL,
                 3);
             $$->children[0] = $1;
             $$->children[1] = $2;
@@ -790,11 +694,9 @@ Exp : Exp DOT ID
 Args : Exp COMMA Args
         {
             $$ = ast_make_new_node(
-                "Args", 
+                AST_ARGS,
                 @1.first_line,
-                false, 
-                NULL, 
-                T_NT,
+                NULL,
                 3);
             $$->children[0] = $1;
             $$->children[1] = $2;
@@ -803,11 +705,9 @@ Args : Exp COMMA Args
   | Exp 
         {
             $$ = ast_make_new_node(
-                "Args", 
+                AST_ARGS,
                 @1.first_line,
-                false, 
-                NULL, 
-                T_NT,
+                NULL,
                 1);
             $$->children[0] = $1;
         }
@@ -817,8 +717,8 @@ Args : Exp COMMA Args
 
 %%
 
-int yyerror(const char* msg) {
-    error_flag = true;
-	fprintf(stdout, "Error type B at Line %d: %s.\n",  yylineno, msg);
+int yyerror(YYLTYPE *llocp, void *scanner, cmmc_context *ctx, const char *msg) {
+    ctx->error_flag = true;
+	fprintf(ctx->diag_file, "Error type B at Line %d: %s.\n",  yyget_lineno(scanner), msg);
     return 0;
 }
\ No newline at end of file
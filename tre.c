@@ -0,0 +1,136 @@
+/*
+    C-- Compiler Back End
+    Copyright (C) 2019 NSKernel. All rights reserved.
+
+    A lab of Compilers at Nanjing University
+
+    tre.c
+    Tail recursion elimination
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include <ir.h>
+#include <cfg.h>
+#include <opt.h>
+#include <arena.h>
+#include <context.h>
+
+// a call of the function to itself whose result is returned right away
+// becomes a jump back to a label put after the DEC, the params already
+// at home by then. the args are all read into new temps before any
+// param is written, an arg may read the params. a function taking the
+// address of its locals is left alone, each call needs its own frame
+
+// 1 if the CALL at insts[c] is only followed by a RETURN of its result,
+// through labels and GOTOs
+int _tre_tail(ir_function *func, uint32_t c) {
+    ir_inst *call = &func->insts[c], *inst;
+    uint32_t i = c + 1, steps = 0, j;
+
+    while (i < func->count && steps++ < 8) {
+        inst = &func->insts[i];
+        if (inst->op == IR_OP_LABEL) {
+            i++;
+            continue;
+        }
+        if (inst->op == IR_OP_GOTO) {
+            for (j = 0; j < func->count; j++) {
+                if (func->insts[j].op == IR_OP_LABEL && func->insts[j].operand[0] == inst->operand[0])
+                    break;
+            }
+            i = j;
+            continue;
+        }
+        return inst->op == IR_OP_RETURN && inst->mode[1] == call->mode[0] && inst->operand[1] == call->operand[0]
+            && IR_INST_OP(call, 0) == IR_MODE_NORMAL;
+    }
+    return 0;
+}
+
+void tre_run(ir_function *func) {
+    ir_inst *insts, *inst;
+    int *params, *temps, entry = -1;
+    uint32_t i, j, n, count = 0, param_count = 0, site_count = 0, capacity;
+    char *tail;
+
+    if (ir_function_takes_address(func))
+        return;
+    tail = calloc(func->count, 1);
+
+    for (i = 0; i < func->count; i++) {
+        inst = &func->insts[i];
+        if (inst->op == IR_OP_PARAM)
+            param_count++;
+        if (inst->op != IR_OP_CALL || strcmp(func->names[inst->operand[1]], func->names[0])
+            || (uint32_t)inst->operand[2] != param_count || param_count > i || !_tre_tail(func, i))
+            continue;
+        for (j = i - inst->operand[2]; j < i && func->insts[j].op == IR_OP_ARG; j++)
+            ;
+        if (j < i)
+            continue;
+        tail[i] = 1;
+        site_count++;
+    }
+    if (site_count == 0) {
+        free(tail);
+        return;
+    }
+
+    params = malloc(sizeof(int) * (param_count + 1));
+    temps = malloc(sizeof(int) * (param_count + 1));
+    capacity = func->count + 1 + site_count * (param_count + 1);
+    insts = arena_alloc(&cmmc_ctx->ir_arena, sizeof(ir_inst) * capacity);
+    for (i = 0, n = 0; i < func->count; i++) {
+        inst = &func->insts[i];
+        if (inst->op == IR_OP_PARAM)
+            params[n++] = inst->operand[0];
+        if (!tail[i]) {
+            insts[count++] = *inst;
+            if (inst->op == IR_OP_DEC) {
+                entry = ir_new_label();
+                inst = &insts[count++];
+                memset(inst, 0, sizeof(ir_inst));
+                inst->op = IR_OP_LABEL;
+                inst->operand[0] = entry;
+            }
+            continue;
+        }
+        // args come last one first, the ARGs already copied become
+        // copies to the temps
+        for (j = 0; j < param_count; j++) {
+            temps[param_count - 1 - j] = ir_new_temp_val(4);
+            inst = &insts[count - param_count + j];
+            inst->op = IR_EXP_OP_ASSIGN;
+            inst->mode[0] = IR_MODE_T | IR_MODE_NORMAL;
+            inst->operand[0] = temps[param_count - 1 - j];
+        }
+        for (j = 0; j < param_count; j++) {
+            inst = &insts[count++];
+            memset(inst, 0, sizeof(ir_inst));
+            inst->op = IR_EXP_OP_ASSIGN;
+            inst->mode[0] = IR_MODE_V | IR_MODE_NORMAL;
+            inst->operand[0] = params[j];
+            inst->mode[1] = IR_MODE_T | IR_MODE_NORMAL;
+            inst->operand[1] = temps[j];
+        }
+        inst = &insts[count++];
+        memset(inst, 0, sizeof(ir_inst));
+        inst->op = IR_OP_GOTO;
+        inst->operand[0] = entry;
+    }
+    // new slots make the frame bigger
+    for (i = 0; i < count; i++) {
+        if (insts[i].op == IR_OP_DEC)
+            insts[i].operand[1] = ir_stack_size();
+    }
+    func->insts = insts;
+    func->count = count;
+    func->capacity = capacity;
+    cfg_invalidate(func);
+    free(params);
+    free(temps);
+    free(tail);
+}